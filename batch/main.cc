@@ -0,0 +1,503 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include <kamikaze/context.h>
+#include <kamikaze/nodes.h>
+#include <kamikaze/primitive.h>
+
+#include <tbb/task_scheduler_init.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+
+#include "core/context.h"
+#include "core/geometry_archive.h"
+#include "core/geometry_export.h"
+#include "core/graphs/object_graph.h"
+#include "core/graphs/object_nodes.h"
+#include "core/kamikaze_main.h"
+#include "core/object.h"
+#include "core/scene.h"
+#include "core/scene_file.h"
+
+/* Evaluate the objects of a scene over a range of frames, without user
+ * interface, and write the collections of the objects to disk. */
+
+static void print_usage(const char *program)
+{
+	std::cerr << "Usage: " << program << " [options]\n"
+	          << "\n"
+	          << "  --plugins DIR              directory to load the plugins from (default plugins)\n"
+	          << "  --scene FILE               read the objects to evaluate from a scene file\n"
+	          << "  --object NAME=NODE,...     add an object whose graph chains the given nodes,\n"
+	          << "                             e.g. --object ground=Grid,Noise,Normal\n"
+	          << "  --set NAME.NODE.PROP=VALUE set a property of the first node of the given name\n"
+	          << "                             of an object, vectors are written as x,y,z\n"
+	          << "  --start FRAME              first frame to evaluate (default 0)\n"
+	          << "  --end FRAME                last frame to evaluate (default start frame)\n"
+	          << "  --threads N                number of threads to use (default all)\n"
+	          << "  --output DIR               directory to write the collections to (default .)\n"
+	          << "  --archive                  write one archive per object holding all the frames,\n"
+	          << "                             instead of one file per object and frame\n"
+	          << "  --archive-delta            like --archive, and store the points of most frames\n"
+	          << "                             as differences to a previous frame\n"
+	          << "  --list-nodes               print the types of nodes which can be used\n";
+}
+
+struct PropAssignment {
+	std::string object = "";
+	std::string node = "";
+	std::string prop = "";
+	std::string value = "";
+};
+
+static bool parse_assignment(const std::string &arg, PropAssignment &r_assignment)
+{
+	const auto equal = arg.find('=');
+	const auto first_dot = arg.find('.');
+	const auto last_dot = arg.rfind('.', equal);
+
+	if (equal == std::string::npos || first_dot == std::string::npos || first_dot == last_dot || last_dot > equal) {
+		return false;
+	}
+
+	r_assignment.object = arg.substr(0, first_dot);
+	r_assignment.node = arg.substr(first_dot + 1, last_dot - first_dot - 1);
+	r_assignment.prop = arg.substr(last_dot + 1, equal - last_dot - 1);
+	r_assignment.value = arg.substr(equal + 1);
+
+	return true;
+}
+
+static bool set_prop(Node *node, const std::string &name, const std::string &value)
+{
+	for (auto &prop : node->props()) {
+		if (prop.desc->name != name) {
+			continue;
+		}
+
+		try {
+			switch (prop.desc->type) {
+				case property_type::prop_bool:
+					prop.data = (value == "true" || value == "1");
+					break;
+				case property_type::prop_int:
+				case property_type::prop_enum:
+					prop.data = std::stoi(value);
+					break;
+				case property_type::prop_float:
+					prop.data = std::stof(value);
+					break;
+				case property_type::prop_vec3:
+				{
+					glm::vec3 vec;
+					char comma;
+					std::istringstream is(value);
+
+					if (!(is >> vec.x >> comma >> vec.y >> comma >> vec.z)) {
+						return false;
+					}
+
+					prop.data = vec;
+					break;
+				}
+				case property_type::prop_input_file:
+				case property_type::prop_output_file:
+				case property_type::prop_string:
+					prop.data = value;
+					break;
+				case property_type::prop_list:
+					return false;
+			}
+		}
+		catch (const std::exception &) {
+			return false;
+		}
+
+		node->update_properties();
+		node->tag_update();
+		return true;
+	}
+
+	return false;
+}
+
+/* Create an object whose graph chains the nodes of the given types, the last
+ * one being connected to the output of the graph. */
+static Object *build_object(NodeFactory *node_factory, const std::string &name, const std::string &node_types)
+{
+	auto object = std::make_unique<Object>();
+	object->name(name);
+
+	auto graph = object->graph();
+	Node *previous = nullptr;
+
+	std::istringstream is(node_types);
+	std::string type;
+
+	while (std::getline(is, type, ',')) {
+		if (!node_factory->registered(type)) {
+			std::cerr << "Unknown node type '" << type << "'\n";
+			return nullptr;
+		}
+
+		auto node = (*node_factory)(type);
+		object->addNode(node);
+
+		if (previous != nullptr) {
+			if (node->inputs().empty() || previous->outputs().empty()) {
+				std::cerr << "Cannot connect node '" << previous->name()
+				          << "' to node '" << node->name() << "'\n";
+				return nullptr;
+			}
+
+			graph->connect(previous->output(0), node->input(0));
+		}
+
+		previous = node;
+	}
+
+	if (previous == nullptr || previous->outputs().empty()) {
+		std::cerr << "Object '" << name << "' does not output anything\n";
+		return nullptr;
+	}
+
+	graph->connect(previous->output(0), graph->output()->input(0));
+
+	return object.release();
+}
+
+static Object *find_object(Scene *scene, const std::string &name)
+{
+	for (const auto &scene_node : scene->nodes()) {
+		if (scene_node->name() == name) {
+			return static_cast<Object *>(scene_node.get());
+		}
+	}
+
+	return nullptr;
+}
+
+static Node *find_node(Object *object, const std::string &name)
+{
+	for (const auto &node : object->graph()->nodes()) {
+		if (node->name() == name) {
+			return node.get();
+		}
+	}
+
+	return nullptr;
+}
+
+/* Queue the collections to be written in the background, while the next frame
+ * is evaluated. */
+static void write_collections(Scene *scene, const std::string &directory, int frame)
+{
+	for (const auto &scene_node : scene->nodes()) {
+		auto object = static_cast<Object *>(scene_node.get());
+		const auto collection = object->collection();
+
+		if (collection == nullptr) {
+			continue;
+		}
+
+		std::ostringstream path;
+		path << directory << '/' << object->name() << '.'
+		     << std::setw(4) << std::setfill('0') << frame << ".kmkc";
+
+		geometry_export_queue().push(*collection, path.str());
+	}
+}
+
+using ArchiveMap = std::unordered_map<std::string, std::unique_ptr<GeometryArchiveWriter>>;
+
+static bool write_archives(Scene *scene, const std::string &directory, int flags, int frame, ArchiveMap &archives)
+{
+	std::string error;
+
+	for (const auto &scene_node : scene->nodes()) {
+		auto object = static_cast<Object *>(scene_node.get());
+		const auto collection = object->collection();
+
+		if (collection == nullptr) {
+			continue;
+		}
+
+		auto &archive = archives[object->name()];
+
+		if (archive == nullptr) {
+			archive = std::unique_ptr<GeometryArchiveWriter>(new GeometryArchiveWriter);
+
+			if (!archive->open(directory + '/' + object->name() + ".kmka", flags, error)) {
+				std::cerr << error << '\n';
+				return false;
+			}
+		}
+
+		if (!archive->add_frame(frame, *collection, error)) {
+			std::cerr << error << '\n';
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool close_archives(ArchiveMap &archives)
+{
+	std::string error;
+
+	for (auto &pair : archives) {
+		const auto written = pair.second->buffers_written();
+		const auto reused = pair.second->buffers_reused();
+
+		if (!pair.second->close(error)) {
+			std::cerr << error << '\n';
+			return false;
+		}
+
+		std::cerr << "Archive " << pair.first << ": " << written << " buffer(s) written, "
+		          << reused << " reused\n";
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	std::string plugin_path = "plugins";
+	std::string output_path = ".";
+	std::string scene_path = "";
+	std::vector<std::pair<std::string, std::string>> objects;
+	std::vector<PropAssignment> assignments;
+	auto start_frame = 0;
+	auto end_frame = -1;
+	auto num_threads = static_cast<int>(tbb::task_scheduler_init::automatic);
+	auto list_nodes = false;
+	auto use_archives = false;
+	auto archive_flags = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		const auto has_value = (i + 1 < argc);
+
+		if (std::strcmp(argv[i], "--plugins") == 0 && has_value) {
+			plugin_path = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--scene") == 0 && has_value) {
+			scene_path = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--object") == 0 && has_value) {
+			const std::string arg = argv[++i];
+			const auto equal = arg.find('=');
+
+			if (equal == std::string::npos) {
+				std::cerr << "Invalid object '" << arg << "'\n";
+				return 1;
+			}
+
+			objects.emplace_back(arg.substr(0, equal), arg.substr(equal + 1));
+		}
+		else if (std::strcmp(argv[i], "--set") == 0 && has_value) {
+			PropAssignment assignment;
+
+			if (!parse_assignment(argv[++i], assignment)) {
+				std::cerr << "Invalid property assignment '" << argv[i] << "'\n";
+				return 1;
+			}
+
+			assignments.push_back(assignment);
+		}
+		else if (std::strcmp(argv[i], "--start") == 0 && has_value) {
+			start_frame = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--end") == 0 && has_value) {
+			end_frame = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--threads") == 0 && has_value) {
+			num_threads = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--output") == 0 && has_value) {
+			output_path = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--archive") == 0) {
+			use_archives = true;
+		}
+		else if (std::strcmp(argv[i], "--archive-delta") == 0) {
+			use_archives = true;
+			archive_flags |= ARCHIVE_DELTA_POINTS;
+		}
+		else if (std::strcmp(argv[i], "--list-nodes") == 0) {
+			list_nodes = true;
+		}
+		else {
+			print_usage(argv[0]);
+			return (std::strcmp(argv[i], "--help") == 0) ? 0 : 1;
+		}
+	}
+
+	if (end_frame < start_frame) {
+		end_frame = start_frame;
+	}
+
+	tbb::task_scheduler_init scheduler(num_threads);
+
+	Main main;
+	main.initialize();
+	main.loadPlugins(plugin_path);
+
+	auto node_factory = main.node_factory();
+	auto scene = main.scene();
+
+	if (list_nodes) {
+		for (const auto &category : node_factory->categories()) {
+			for (const auto &key : node_factory->keys(category)) {
+				std::cout << category << '/' << key << '\n';
+			}
+		}
+
+		return 0;
+	}
+
+	if (objects.empty() && scene_path.empty()) {
+		std::cerr << "Nothing to evaluate, see --scene and --object\n";
+		return 1;
+	}
+
+	EvaluationContext eval_context;
+	eval_context.edit_mode = false;
+	eval_context.animation = false;
+	eval_context.time_direction = TIME_DIR_FORWARD;
+	eval_context.frame = start_frame;
+	eval_context.threaded_evaluation = true;
+
+	Context context;
+	context.eval_ctx = &eval_context;
+	context.scene = scene;
+	context.node_factory = node_factory;
+	context.primitive_factory = main.primitive_factory();
+	context.notifier_factory = nullptr;
+	context.active_widget = nullptr;
+
+	/* Every frame is evaluated below, in order: leave the evaluations requested
+	 * while reading the scene or editing the objects pending rather than
+	 * running them in the background, concurrently with the frame loop. */
+	scene->evaluationScheduler([]() {});
+
+	if (!scene_path.empty()) {
+		std::string error;
+
+		if (!read_scene(context, scene_path, error)) {
+			std::cerr << error << '\n';
+			return 1;
+		}
+	}
+
+	for (const auto &pair : objects) {
+		auto object = build_object(node_factory, pair.first, pair.second);
+
+		if (object == nullptr) {
+			return 1;
+		}
+
+		scene->addObject(object);
+	}
+
+	for (const auto &assignment : assignments) {
+		auto object = find_object(scene, assignment.object);
+
+		if (object == nullptr) {
+			std::cerr << "Unknown object '" << assignment.object << "'\n";
+			return 1;
+		}
+
+		auto node = find_node(object, assignment.node);
+
+		if (node == nullptr) {
+			std::cerr << "Unknown node '" << assignment.node << "' in object '" << assignment.object << "'\n";
+			return 1;
+		}
+
+		if (!set_prop(node, assignment.prop, assignment.value)) {
+			std::cerr << "Cannot set property '" << assignment.prop << "' of node '"
+			          << assignment.node << "' to '" << assignment.value << "'\n";
+			return 1;
+		}
+	}
+
+	scene->startFrame(start_frame);
+	scene->endFrame(end_frame);
+
+	ArchiveMap archives;
+
+	const auto batch_start = std::chrono::steady_clock::now();
+
+	for (int frame = start_frame; frame <= end_frame; ++frame) {
+		const auto frame_start = std::chrono::steady_clock::now();
+
+		scene->currentFrame(frame);
+		scene->depsgraph()->evaluate_frame(context, frame);
+
+		if (use_archives) {
+			if (!write_archives(scene, output_path, archive_flags, frame, archives)) {
+				return 1;
+			}
+		}
+		else {
+			write_collections(scene, output_path, frame);
+		}
+
+		const auto frame_end = std::chrono::steady_clock::now();
+
+		std::cerr << "Frame " << frame << ": "
+		          << std::chrono::duration<double>(frame_end - frame_start).count() << "s\n";
+	}
+
+	if (!close_archives(archives)) {
+		return 1;
+	}
+
+	const auto errors = geometry_export_queue().wait();
+
+	for (const auto &error : errors) {
+		std::cerr << error << '\n';
+	}
+
+	if (!errors.empty()) {
+		return 1;
+	}
+
+	const auto batch_end = std::chrono::steady_clock::now();
+
+	std::cerr << "Evaluated " << (end_frame - start_frame + 1) << " frame(s) in "
+	          << std::chrono::duration<double>(batch_end - batch_start).count() << "s\n";
+
+	return 0;
+}
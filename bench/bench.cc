@@ -0,0 +1,249 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include "bench.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <sstream>
+
+BenchRunner::BenchRunner(const BenchOptions &options)
+    : m_options(options)
+{}
+
+const BenchOptions &BenchRunner::options() const
+{
+	return m_options;
+}
+
+bool BenchRunner::enabled(const std::string &name) const
+{
+	return name.find(m_options.filter) != std::string::npos;
+}
+
+std::vector<size_t> BenchRunner::sizes(size_t max) const
+{
+	std::vector<size_t> sizes;
+
+	for (size_t size = 1000; size <= std::min(max, m_options.max_size); size *= 10) {
+		sizes.push_back(size);
+	}
+
+	return sizes;
+}
+
+const std::vector<BenchResult> &BenchRunner::results() const
+{
+	return m_results;
+}
+
+void BenchRunner::add_result(const std::string &name, size_t size, const std::vector<double> &times)
+{
+	if (times.empty()) {
+		return;
+	}
+
+	BenchResult result;
+	result.name = name;
+	result.size = size;
+	result.iterations = times.size();
+	result.mean = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+	result.min = *std::min_element(times.begin(), times.end());
+	result.max = *std::max_element(times.begin(), times.end());
+
+	if (result.min > 0.0) {
+		result.items_per_second = size / result.min;
+	}
+
+	std::cerr << std::left << std::setw(32) << name
+	          << std::right << std::setw(10) << size
+	          << std::setw(14) << std::fixed << std::setprecision(3) << result.min * 1000.0 << " ms"
+	          << std::setw(14) << std::scientific << std::setprecision(3) << result.items_per_second << " items/s\n"
+	          << std::defaultfloat;
+
+	m_results.push_back(result);
+}
+
+/* ************************************************************************** */
+
+void write_json(std::ostream &os, const std::vector<BenchResult> &results)
+{
+	os << "{\n";
+	os << "  \"benchmarks\": [\n";
+
+	for (size_t i = 0; i < results.size(); ++i) {
+		const auto &result = results[i];
+
+		os << "    {\"name\": \"" << result.name << "\""
+		   << ", \"size\": " << result.size
+		   << ", \"iterations\": " << result.iterations
+		   << std::setprecision(9)
+		   << ", \"mean\": " << result.mean
+		   << ", \"min\": " << result.min
+		   << ", \"max\": " << result.max
+		   << ", \"items_per_second\": " << result.items_per_second
+		   << "}" << ((i + 1 < results.size()) ? "," : "") << '\n';
+	}
+
+	os << "  ]\n";
+	os << "}\n";
+}
+
+/* Find the value of the given key in a line written by write_json. */
+static bool find_value(const std::string &line, const std::string &key, std::string &r_value)
+{
+	const auto pattern = "\"" + key + "\":";
+	auto pos = line.find(pattern);
+
+	if (pos == std::string::npos) {
+		return false;
+	}
+
+	pos = line.find_first_not_of(' ', pos + pattern.size());
+
+	if (pos == std::string::npos) {
+		return false;
+	}
+
+	if (line[pos] == '"') {
+		const auto end = line.find('"', pos + 1);
+
+		if (end == std::string::npos) {
+			return false;
+		}
+
+		r_value = line.substr(pos + 1, end - pos - 1);
+		return true;
+	}
+
+	const auto end = line.find_first_of(",}", pos);
+	r_value = line.substr(pos, end - pos);
+	return true;
+}
+
+std::vector<BenchResult> read_json(std::istream &is)
+{
+	std::vector<BenchResult> results;
+	std::string line, value;
+
+	while (std::getline(is, line)) {
+		BenchResult result;
+
+		if (!find_value(line, "name", result.name)) {
+			continue;
+		}
+
+		try {
+			if (find_value(line, "size", value)) {
+				result.size = std::stoull(value);
+			}
+
+			if (find_value(line, "iterations", value)) {
+				result.iterations = std::stoi(value);
+			}
+
+			if (find_value(line, "mean", value)) {
+				result.mean = std::stod(value);
+			}
+
+			if (find_value(line, "min", value)) {
+				result.min = std::stod(value);
+			}
+
+			if (find_value(line, "max", value)) {
+				result.max = std::stod(value);
+			}
+
+			if (find_value(line, "items_per_second", value)) {
+				result.items_per_second = std::stod(value);
+			}
+		}
+		catch (const std::exception &e) {
+			std::cerr << "Cannot read benchmark '" << result.name << "': " << e.what() << '\n';
+			continue;
+		}
+
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+int compare_results(std::ostream &os,
+                    const std::vector<BenchResult> &baseline,
+                    const std::vector<BenchResult> &results,
+                    double threshold)
+{
+	std::map<std::pair<std::string, size_t>, const BenchResult *> baseline_map;
+
+	for (const auto &result : baseline) {
+		baseline_map[std::make_pair(result.name, result.size)] = &result;
+	}
+
+	auto regressions = 0;
+
+	os << std::left << std::setw(32) << "benchmark"
+	   << std::right << std::setw(10) << "size"
+	   << std::setw(14) << "baseline ms"
+	   << std::setw(14) << "current ms"
+	   << std::setw(10) << "change" << '\n';
+
+	for (const auto &result : results) {
+		const auto iter = baseline_map.find(std::make_pair(result.name, result.size));
+
+		if (iter == baseline_map.end() || iter->second->min <= 0.0) {
+			os << std::left << std::setw(32) << result.name
+			   << std::right << std::setw(10) << result.size
+			   << "  (not in baseline)\n";
+			continue;
+		}
+
+		const auto reference = iter->second->min;
+		const auto change = (result.min - reference) / reference;
+
+		os << std::left << std::setw(32) << result.name
+		   << std::right << std::setw(10) << result.size
+		   << std::fixed << std::setprecision(3)
+		   << std::setw(14) << reference * 1000.0
+		   << std::setw(14) << result.min * 1000.0
+		   << std::showpos << std::setprecision(1)
+		   << std::setw(9) << change * 100.0 << '%'
+		   << std::noshowpos << std::defaultfloat;
+
+		if (change > threshold) {
+			os << "  SLOWER";
+			++regressions;
+		}
+		else if (change < -threshold) {
+			os << "  faster";
+		}
+
+		os << '\n';
+	}
+
+	return regressions;
+}
@@ -0,0 +1,150 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <chrono>
+#include <iosfwd>
+#include <kamikaze/primitive.h>
+#include <string>
+#include <vector>
+
+/* Timings of one benchmark, in seconds per iteration. */
+struct BenchResult {
+	std::string name = "";
+
+	/* Number of items (points, nodes, samples) processed per iteration. */
+	size_t size = 0;
+
+	int iterations = 0;
+
+	double mean = 0.0;
+	double min = 0.0;
+	double max = 0.0;
+
+	/* Items processed per second, based on the fastest iteration. */
+	double items_per_second = 0.0;
+};
+
+struct BenchOptions {
+	/* Only run the benchmarks whose name contains this string. */
+	std::string filter = "";
+
+	int iterations = 5;
+	int warmup = 1;
+
+	/* Upper bound on the number of items of the benchmarks. */
+	size_t max_size = 10000000;
+};
+
+class BenchRunner {
+	BenchOptions m_options;
+	std::vector<BenchResult> m_results{};
+
+	void add_result(const std::string &name, size_t size, const std::vector<double> &times);
+
+public:
+	explicit BenchRunner(const BenchOptions &options);
+
+	const BenchOptions &options() const;
+
+	/* Return whether the benchmark of the given name passes the filter. */
+	bool enabled(const std::string &name) const;
+
+	/* Return the sizes to run the benchmarks on, from 1K to 10M items, capped
+	 * by the max size of the options. */
+	std::vector<size_t> sizes(size_t max = 10000000) const;
+
+	const std::vector<BenchResult> &results() const;
+
+	/* Time op, calling setup before each iteration. The time spent in setup
+	 * is not measured, so it can be used to prepare the data that op
+	 * consumes, e.g. a fresh copy of a collection for a node to modify. */
+	template <typename SetupOp, typename RunOp>
+	void run(const std::string &name, size_t size, const SetupOp &setup, const RunOp &op)
+	{
+		if (!enabled(name)) {
+			return;
+		}
+
+		std::vector<double> times;
+		times.reserve(m_options.iterations);
+
+		for (int i = -m_options.warmup; i < m_options.iterations; ++i) {
+			setup();
+
+			const auto start = std::chrono::steady_clock::now();
+			op();
+			const auto end = std::chrono::steady_clock::now();
+
+			if (i >= 0) {
+				times.push_back(std::chrono::duration<double>(end - start).count());
+			}
+		}
+
+		add_result(name, size, times);
+	}
+
+	template <typename RunOp>
+	void run(const std::string &name, size_t size, const RunOp &op)
+	{
+		run(name, size, []() {}, op);
+	}
+};
+
+/* ************************************************************************** */
+
+/**
+ * Write the results as a JSON document, with one benchmark per line:
+ *
+ * {
+ *   "benchmarks": [
+ *     {"name": "mesh_compute_normals", "size": 1000, "iterations": 5, ...},
+ *     ...
+ *   ]
+ * }
+ */
+void write_json(std::ostream &os, const std::vector<BenchResult> &results);
+
+/* Read the results written by write_json. Lines which do not describe a
+ * benchmark are ignored, so this is not a general purpose JSON parser. */
+std::vector<BenchResult> read_json(std::istream &is);
+
+/* Print how the results compare to a baseline. A benchmark is considered to
+ * have regressed if its fastest iteration is slower than the one of the
+ * baseline by more than threshold (e.g. 0.05 for 5%). Returns the number of
+ * regressions. */
+int compare_results(std::ostream &os,
+                    const std::vector<BenchResult> &baseline,
+                    const std::vector<BenchResult> &results,
+                    double threshold);
+
+/* ************************************************************************** */
+
+class NodeFactory;
+
+/* Run the benchmarks of the SDK and core hot paths, see bench_cases.cc. */
+void run_benchmarks(BenchRunner &runner,
+                    PrimitiveFactory *primitive_factory,
+                    NodeFactory *node_factory);
@@ -0,0 +1,609 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include "bench.h"
+
+#include <kamikaze/mesh.h>
+#include <kamikaze/noise.h>
+#include <kamikaze/nodes.h>
+#include <kamikaze/normals.h>
+#include <kamikaze/primitive.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+
+#include "core/graphs/object_graph.h"
+#include "core/graphs/object_nodes.h"
+#include "core/geometry_cache.h"
+#include "core/geometry_import.h"
+
+/* Build a grid of quads having at least the given number of points. */
+static Mesh *make_grid(size_t num_points)
+{
+	const auto side = std::max(size_t(2), static_cast<size_t>(std::ceil(std::sqrt(num_points))));
+	const auto inv_side = 1.0f / (side - 1);
+
+	auto mesh = new Mesh;
+
+	auto points = mesh->points();
+	points->reserve(side * side);
+
+	for (size_t y = 0; y < side; ++y) {
+		for (size_t x = 0; x < side; ++x) {
+			points->push_back(glm::vec3{x * inv_side - 0.5f, 0.0f, y * inv_side - 0.5f});
+		}
+	}
+
+	auto polys = mesh->polys();
+	polys->reserve((side - 1) * (side - 1));
+
+	for (size_t y = 0; y < side - 1; ++y) {
+		for (size_t x = 0; x < side - 1; ++x) {
+			const auto index = static_cast<unsigned int>(y * side + x);
+			const auto next_row = static_cast<unsigned int>(index + side);
+
+			polys->push_back(glm::uvec4{index, index + 1, next_row + 1, next_row});
+		}
+	}
+
+	mesh->update();
+
+	return mesh;
+}
+
+static std::unique_ptr<PrimitiveCollection> make_grid_collection(PrimitiveFactory *factory, size_t num_points)
+{
+	auto collection = std::make_unique<PrimitiveCollection>(factory);
+	collection->add(make_grid(num_points));
+
+	return collection;
+}
+
+template <typename T>
+static void set_prop(Persona *persona, const std::string &name, const T &value)
+{
+	for (auto &prop : persona->props()) {
+		if (prop.desc->name == name) {
+			prop.data = value;
+			return;
+		}
+	}
+}
+
+/* ************************************************************************** */
+
+static void bench_collection_copy(BenchRunner &runner, PrimitiveFactory *factory)
+{
+	if (!runner.enabled("collection_copy")) {
+		return;
+	}
+
+	for (const auto size : runner.sizes()) {
+		auto source = make_grid_collection(factory, size);
+		auto mesh = static_cast<Mesh *>(source->primitives()[0]);
+		mesh->add_attribute("normal", ATTR_TYPE_VEC3, mesh->points()->size());
+		mesh->add_attribute("color", ATTR_TYPE_VEC3, mesh->points()->size());
+
+		std::unique_ptr<PrimitiveCollection> copy;
+
+		runner.run("collection_copy", mesh->points()->size(),
+		           [&]()
+		{
+			copy.reset();
+		},
+		           [&]()
+		{
+			copy.reset(source->copy());
+		});
+	}
+}
+
+static void bench_compute_normals(BenchRunner &runner)
+{
+	if (!runner.enabled("mesh_compute_normals")) {
+		return;
+	}
+
+	for (const auto size : runner.sizes()) {
+		std::unique_ptr<Mesh> mesh(make_grid(size));
+		auto normals = mesh->add_attribute("normal", ATTR_TYPE_VEC3, mesh->points()->size());
+
+		/* Same as Mesh::computeNormals(), which is private. */
+		runner.run("mesh_compute_normals", mesh->points()->size(), [&]()
+		{
+			compute_normals(*mesh->points(), *mesh->polys(),
+			                TypedAttribute<glm::vec3>(normals).begin(),
+			                NORMAL_WEIGHT_AREA, true);
+		});
+	}
+}
+
+/* Process a node on a fresh copy of a grid at each iteration. The points of
+ * the copy are shared with the grid until the node writes to them, so like in
+ * the evaluation of a graph the node pays for making them unique. */
+static void bench_node(BenchRunner &runner,
+                       PrimitiveFactory *primitive_factory,
+                       NodeFactory *node_factory,
+                       const std::string &bench_name,
+                       const std::string &node_name,
+                       const std::function<void(Node *)> &init)
+{
+	if (!runner.enabled(bench_name)) {
+		return;
+	}
+
+	std::unique_ptr<Node> node((*node_factory)(node_name));
+	init(node.get());
+
+	for (const auto size : runner.sizes()) {
+		auto source = make_grid_collection(primitive_factory, size);
+		const auto num_points = static_cast<Mesh *>(source->primitives()[0])->points()->size();
+
+		std::unique_ptr<PrimitiveCollection> collection;
+
+		runner.run(bench_name, num_points,
+		           [&]()
+		{
+			collection.reset(source->copy());
+			node->collection(collection.get());
+		},
+		           [&]()
+		{
+			node->process();
+		});
+
+		node->collection(nullptr);
+	}
+}
+
+static void bench_simplex_noise(BenchRunner &runner)
+{
+	if (!runner.enabled("simplex_noise_3d")) {
+		return;
+	}
+
+	for (const auto size : runner.sizes()) {
+		const auto side = static_cast<size_t>(std::cbrt(size)) + 1;
+		volatile float sink = 0.0f;
+
+		runner.run("simplex_noise_3d", size, [&]()
+		{
+			auto sum = 0.0f;
+
+			for (size_t i = 0; i < size; ++i) {
+				const auto x = static_cast<float>(i % side) * 0.173f;
+				const auto y = static_cast<float>((i / side) % side) * 0.173f;
+				const auto z = static_cast<float>(i / (side * side)) * 0.173f;
+
+				sum += simplex_noise_3d(x, y, z);
+			}
+
+			sink = sum;
+		});
+
+		static_cast<void>(sink);
+	}
+}
+
+/* Sort a graph where each node is fed by a random node created before it, so
+ * the graph is a random tree rooted at the output node. */
+static void bench_topology_sort(BenchRunner &runner, NodeFactory *node_factory)
+{
+	if (!runner.enabled("topology_sort")) {
+		return;
+	}
+
+	std::mt19937 rng(19937);
+
+	for (const auto size : runner.sizes(100000)) {
+		Graph graph;
+		std::vector<Node *> nodes;
+		nodes.reserve(size);
+
+		for (size_t i = 0; i < size; ++i) {
+			auto node = (*node_factory)("Normal");
+			graph.add(node);
+
+			if (!nodes.empty()) {
+				std::uniform_int_distribution<size_t> dist(0, nodes.size() - 1);
+				graph.connect(nodes[dist(rng)]->output(0), node->input(0));
+			}
+
+			nodes.push_back(node);
+		}
+
+		auto from = nodes.back()->output(0);
+		auto to = graph.output()->input(0);
+		graph.connect(from, to);
+
+		runner.run("topology_sort", size,
+		           [&]()
+		{
+			/* Force the graph to be sorted again. */
+			graph.disconnect(from, to);
+			graph.connect(from, to);
+		},
+		           [&]()
+		{
+			graph.build();
+		});
+	}
+}
+
+static void bench_attribute_access(BenchRunner &runner)
+{
+	if (!runner.enabled("attribute_")) {
+		return;
+	}
+
+	for (const auto size : runner.sizes()) {
+		Attribute attribute("bench", ATTR_TYPE_VEC3, size);
+		volatile float sink = 0.0f;
+
+		runner.run("attribute_accessor_write", size, [&]()
+		{
+			for (size_t i = 0; i < size; ++i) {
+				attribute.vec3(i, glm::vec3{static_cast<float>(i)});
+			}
+		});
+
+		runner.run("attribute_typed_write", size, [&]()
+		{
+			auto values = TypedAttribute<glm::vec3>(&attribute);
+
+			for (size_t i = 0; i < size; ++i) {
+				values[i] = glm::vec3{static_cast<float>(i)};
+			}
+		});
+
+		runner.run("attribute_accessor_read", size, [&]()
+		{
+			auto sum = glm::vec3{0.0f};
+
+			for (size_t i = 0; i < size; ++i) {
+				sum += attribute.vec3(i);
+			}
+
+			sink = sum.x + sum.y + sum.z;
+		});
+
+		runner.run("attribute_typed_read", size, [&]()
+		{
+			const auto values = TypedAttribute<const glm::vec3>(&static_cast<const Attribute &>(attribute));
+			auto sum = glm::vec3{0.0f};
+
+			for (const auto &value : values) {
+				sum += value;
+			}
+
+			sink = sum.x + sum.y + sum.z;
+		});
+
+		/* Gathers, as done when reading the attributes of the points of the
+		 * polygons. */
+		std::vector<size_t> indices(size);
+		std::iota(indices.begin(), indices.end(), 0);
+		std::shuffle(indices.begin(), indices.end(), std::mt19937(19937));
+
+		runner.run("attribute_typed_random_read", size, [&]()
+		{
+			const auto values = TypedAttribute<const glm::vec3>(&static_cast<const Attribute &>(attribute));
+			auto sum = glm::vec3{0.0f};
+
+			for (const auto index : indices) {
+				sum += values[index];
+			}
+
+			sink = sum.x + sum.y + sum.z;
+		});
+
+		static_cast<void>(sink);
+	}
+}
+
+/* Evaluate the last of a few properties, as nodes do in process(), by name and
+ * through a handle. */
+static void bench_prop_eval(BenchRunner &runner)
+{
+	if (!runner.enabled("prop_eval_")) {
+		return;
+	}
+
+	const char *names[] = { "octaves", "frequency", "amplitude", "persistence", "lacunarity" };
+
+	for (const auto size : runner.sizes(1000000)) {
+		Persona persona;
+		PropHandle<float> handle;
+
+		for (const auto name : names) {
+			handle = persona.add_prop(name, name, property_type::prop_float);
+		}
+
+		volatile float sink = 0.0f;
+
+		runner.run("prop_eval_by_name", size, [&]()
+		{
+			auto sum = 0.0f;
+
+			for (size_t i = 0; i < size; ++i) {
+				sum += persona.eval_float("lacunarity");
+			}
+
+			sink = sum;
+		});
+
+		runner.run("prop_eval_handle", size, [&]()
+		{
+			auto sum = 0.0f;
+
+			for (size_t i = 0; i < size; ++i) {
+				sum += persona.eval(handle);
+			}
+
+			sink = sum;
+		});
+
+		static_cast<void>(sink);
+	}
+}
+
+/* Read a grid back from disk, parsing the stream written by
+ * PrimitiveCollection::write(), and mapping a geometry cache file. Only the
+ * header of the mapped mesh is read, as the pages of its data are read when
+ * first accessed, which the summed points account for. */
+static void bench_geometry_cache(BenchRunner &runner, PrimitiveFactory *factory)
+{
+	if (!runner.enabled("geometry_cache_")) {
+		return;
+	}
+
+	const std::string stream_path = "/tmp/kamikaze_bench.kmkc";
+	const std::string cache_path = "/tmp/kamikaze_bench.kmkgeo";
+
+	for (const auto size : runner.sizes()) {
+		auto source = make_grid_collection(factory, size);
+		const auto num_points = static_cast<Mesh *>(source->primitives()[0])->points()->size();
+
+		std::string error;
+
+		{
+			std::ofstream os(stream_path, std::ios::binary);
+			source->write(os);
+		}
+
+		if (!write_geometry_cache(*source, cache_path, error)) {
+			std::cerr << error << '\n';
+			return;
+		}
+
+		std::unique_ptr<PrimitiveCollection> collection;
+		volatile float sink = 0.0f;
+
+		runner.run("geometry_cache_stream_read", num_points,
+		           [&]()
+		{
+			collection.reset(new PrimitiveCollection(factory));
+		},
+		           [&]()
+		{
+			std::ifstream is(stream_path, std::ios::binary);
+			collection->read(is);
+		});
+
+		runner.run("geometry_cache_mapped_read", num_points,
+		           [&]()
+		{
+			collection.reset(new PrimitiveCollection(factory));
+		},
+		           [&]()
+		{
+			read_geometry_cache(cache_path, *collection, error);
+		});
+
+		runner.run("geometry_cache_mapped_read_sum", num_points,
+		           [&]()
+		{
+			collection.reset(new PrimitiveCollection(factory));
+		},
+		           [&]()
+		{
+			read_geometry_cache(cache_path, *collection, error);
+
+			const Mesh *mesh = static_cast<Mesh *>(collection->primitives()[0]);
+			const auto points = mesh->points();
+			auto sum = 0.0f;
+
+			for (size_t i = 0, ie = points->size(); i < ie; ++i) {
+				sum += (*points)[i].y;
+			}
+
+			sink = sum;
+		});
+
+		static_cast<void>(sink);
+	}
+
+	std::remove(stream_path.c_str());
+	std::remove(cache_path.c_str());
+}
+
+/* Write the mesh as a binary or ASCII PLY file, or as an OBJ file. */
+static void write_mesh_file(const Mesh &mesh, const std::string &path, bool binary)
+{
+	const auto points = mesh.points();
+	const auto polys = mesh.polys();
+	const auto is_obj = (path.substr(path.size() - 4) == ".obj");
+
+	std::ofstream os(path, std::ios::binary);
+
+	if (is_obj) {
+		for (size_t i = 0; i < points->size(); ++i) {
+			const auto &point = (*points)[i];
+			os << "v " << point.x << ' ' << point.y << ' ' << point.z << '\n';
+		}
+
+		for (size_t i = 0; i < polys->size(); ++i) {
+			const auto &poly = (*polys)[i];
+			os << "f " << poly[0] + 1 << ' ' << poly[1] + 1 << ' ' << poly[2] + 1 << ' ' << poly[3] + 1 << '\n';
+		}
+
+		return;
+	}
+
+	os << "ply\n"
+	   << "format " << (binary ? "binary_little_endian" : "ascii") << " 1.0\n"
+	   << "element vertex " << points->size() << '\n'
+	   << "property float x\nproperty float y\nproperty float z\n"
+	   << "element face " << polys->size() << '\n'
+	   << "property list uchar int vertex_indices\n"
+	   << "end_header\n";
+
+	for (size_t i = 0; i < points->size(); ++i) {
+		const auto &point = (*points)[i];
+
+		if (binary) {
+			os.write(reinterpret_cast<const char *>(&point), sizeof(glm::vec3));
+		}
+		else {
+			os << point.x << ' ' << point.y << ' ' << point.z << '\n';
+		}
+	}
+
+	for (size_t i = 0; i < polys->size(); ++i) {
+		const auto &poly = (*polys)[i];
+
+		if (binary) {
+			const unsigned char count = 4;
+			os.write(reinterpret_cast<const char *>(&count), 1);
+			os.write(reinterpret_cast<const char *>(&poly), sizeof(glm::uvec4));
+		}
+		else {
+			os << "4 " << poly[0] << ' ' << poly[1] << ' ' << poly[2] << ' ' << poly[3] << '\n';
+		}
+	}
+}
+
+/* Import a grid from files of the supported formats, the cache of imported
+ * files being cleared before each run, except for the cached import. */
+static void bench_geometry_import(BenchRunner &runner, PrimitiveFactory *factory)
+{
+	if (!runner.enabled("geometry_import_")) {
+		return;
+	}
+
+	const std::string binary_path = "/tmp/kamikaze_bench_binary.ply";
+	const std::string ascii_path = "/tmp/kamikaze_bench_ascii.ply";
+	const std::string obj_path = "/tmp/kamikaze_bench.obj";
+
+	for (const auto size : runner.sizes()) {
+		auto mesh = std::unique_ptr<Mesh>(make_grid(size));
+		const auto num_points = mesh->points()->size();
+
+		write_mesh_file(*mesh, binary_path, true);
+		write_mesh_file(*mesh, ascii_path, false);
+		write_mesh_file(*mesh, obj_path, false);
+
+		std::unique_ptr<PrimitiveCollection> collection;
+		std::string error;
+
+		const std::pair<const char *, std::string> cases[] = {
+		    { "geometry_import_ply_binary", binary_path },
+		    { "geometry_import_ply_ascii", ascii_path },
+		    { "geometry_import_obj", obj_path },
+		};
+
+		for (const auto &test_case : cases) {
+			runner.run(test_case.first, num_points,
+			           [&]()
+			{
+				clear_geometry_import_cache();
+				collection.reset(new PrimitiveCollection(factory));
+			},
+			           [&]()
+			{
+				import_geometry(test_case.second, *collection, error);
+			});
+		}
+
+		runner.run("geometry_import_cached", num_points,
+		           [&]()
+		{
+			collection.reset(new PrimitiveCollection(factory));
+		},
+		           [&]()
+		{
+			import_geometry(binary_path, *collection, error);
+		});
+	}
+
+	clear_geometry_import_cache();
+
+	std::remove(binary_path.c_str());
+	std::remove(ascii_path.c_str());
+	std::remove(obj_path.c_str());
+}
+
+/* ************************************************************************** */
+
+void run_benchmarks(BenchRunner &runner,
+                    PrimitiveFactory *primitive_factory,
+                    NodeFactory *node_factory)
+{
+	bench_collection_copy(runner, primitive_factory);
+	bench_compute_normals(runner);
+
+	bench_node(runner, primitive_factory, node_factory, "node_normal", "Normal",
+	           [](Node *node)
+	{
+		set_prop(node, "weighting", static_cast<int>(NORMAL_WEIGHT_AREA));
+	});
+
+	bench_node(runner, primitive_factory, node_factory, "node_noise", "Noise",
+	           [](Node *node)
+	{
+		set_prop(node, "octaves", 4);
+	});
+
+	bench_node(runner, primitive_factory, node_factory, "node_color", "Color",
+	           [](Node *node)
+	{
+		/* Random colors per vertex, the unique color is a plain fill. */
+		set_prop(node, "fill_method", 1);
+		set_prop(node, "scope", 0);
+	});
+
+	bench_simplex_noise(runner);
+	bench_topology_sort(runner, node_factory);
+	bench_attribute_access(runner);
+	bench_prop_eval(runner);
+	bench_geometry_cache(runner, primitive_factory);
+	bench_geometry_import(runner, primitive_factory);
+}
@@ -0,0 +1,143 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include <kamikaze/mesh.h>
+#include <kamikaze/nodes.h>
+#include <kamikaze/prim_points.h>
+#include <kamikaze/primitive.h>
+#include <kamikaze/segmentprim.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "core/graphs/object_nodes.h"
+
+#include "bench.h"
+
+static void print_usage(const char *program)
+{
+	std::cerr << "Usage: " << program << " [options]\n"
+	          << "\n"
+	          << "  --filter STRING     only run the benchmarks whose name contains STRING\n"
+	          << "  --iterations N      number of timed iterations per benchmark (default 5)\n"
+	          << "  --warmup N          number of untimed iterations per benchmark (default 1)\n"
+	          << "  --max-size N        upper bound on the number of items (default 10000000)\n"
+	          << "  --output FILE       write the results as JSON to FILE instead of stdout\n"
+	          << "  --baseline FILE     compare the results to the JSON results in FILE\n"
+	          << "  --threshold PERCENT slowdown above which a benchmark regressed (default 5)\n";
+}
+
+int main(int argc, char *argv[])
+{
+	BenchOptions options;
+	std::string output_path = "";
+	std::string baseline_path = "";
+	auto threshold = 5.0;
+
+	for (int i = 1; i < argc; ++i) {
+		const auto has_value = (i + 1 < argc);
+
+		if (std::strcmp(argv[i], "--filter") == 0 && has_value) {
+			options.filter = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--iterations") == 0 && has_value) {
+			options.iterations = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--warmup") == 0 && has_value) {
+			options.warmup = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--max-size") == 0 && has_value) {
+			options.max_size = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--output") == 0 && has_value) {
+			output_path = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--baseline") == 0 && has_value) {
+			baseline_path = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--threshold") == 0 && has_value) {
+			threshold = std::atof(argv[++i]);
+		}
+		else {
+			print_usage(argv[0]);
+			return (std::strcmp(argv[i], "--help") == 0) ? 0 : 1;
+		}
+	}
+
+	std::vector<BenchResult> baseline;
+
+	if (!baseline_path.empty()) {
+		std::ifstream is(baseline_path);
+
+		if (!is.is_open()) {
+			std::cerr << "Cannot open baseline file '" << baseline_path << "'\n";
+			return 1;
+		}
+
+		baseline = read_json(is);
+	}
+
+	/* Register the types like Main::initialize() does, without the plugins so
+	 * the results only depend on the code of this tree. */
+	PrimitiveFactory primitive_factory;
+	NodeFactory node_factory;
+
+	{
+		auto factory = &primitive_factory;
+
+		Mesh::id = REGISTER_PRIMITIVE("Mesh", Mesh);
+		PrimPoints::id = REGISTER_PRIMITIVE("PrimPoints", PrimPoints);
+		SegmentPrim::id = REGISTER_PRIMITIVE("SegmentPrim", SegmentPrim);
+	}
+
+	register_builtin_nodes(&node_factory);
+
+	BenchRunner runner(options);
+	run_benchmarks(runner, &primitive_factory, &node_factory);
+
+	if (output_path.empty()) {
+		write_json(std::cout, runner.results());
+	}
+	else {
+		std::ofstream os(output_path);
+
+		if (!os.is_open()) {
+			std::cerr << "Cannot open output file '" << output_path << "'\n";
+			return 1;
+		}
+
+		write_json(os, runner.results());
+	}
+
+	if (baseline_path.empty()) {
+		return 0;
+	}
+
+	const auto regressions = compare_results(std::cerr, baseline, runner.results(), threshold / 100.0);
+
+	return (regressions > 0) ? 2 : 0;
+}
@@ -28,8 +28,8 @@
 #include <kamikaze/primitive.h>
 
 class EvaluationContext;
-class MainWindow;
 class Scene;
+class TaskNotifierFactory;
 class WidgetBase;
 
 /* - 0x000000ff Category.
@@ -138,7 +138,8 @@ struct Context {
 	Scene *scene;
 	PrimitiveFactory *primitive_factory;
 	NodeFactory *node_factory;
-	MainWindow *main_window;
+	/* Null when there is no user interface to notify about tasks. */
+	TaskNotifierFactory *notifier_factory;
 	WidgetBase *active_widget;
 };
 
@@ -0,0 +1,809 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include "geometry_archive.h"
+
+#include <kamikaze/primitive.h>
+#include <kamikaze/util_binary.h>
+#include <kamikaze/util_trace.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "geometry_cache.h"
+#include "mapped_file.h"
+
+static constexpr char GEOMETRY_ARCHIVE_MAGIC[8] = { 'K', 'M', 'K', 'G', 'E', 'O', 'A', 'R' };
+static constexpr uint32_t GEOMETRY_ARCHIVE_VERSION = 1;
+static constexpr size_t GEOMETRY_ARCHIVE_ALIGNMENT = 16;
+
+/* Number of frames between two key frames when delta compressing points. */
+static constexpr int GEOMETRY_ARCHIVE_KEY_INTERVAL = 16;
+
+enum {
+	CHUNK_POINTS    = 0,
+	CHUNK_POLYGONS  = 1,
+	CHUNK_EDGES     = 2,
+	CHUNK_ATTRIBUTE = 3,
+};
+
+enum {
+	/* The values as they are laid out in memory. */
+	ENCODING_RAW   = 0,
+	/* The values XORed with those of the base buffer, see encode_delta(). */
+	ENCODING_DELTA = 1,
+};
+
+/* ********************************* encoding ******************************* */
+
+/* 64-bit hash of a buffer, based on MurmurHash64A. */
+static uint64_t hash_buffer(const char *data, size_t size)
+{
+	constexpr uint64_t m = 0xc6a4a7935bd1e995ull;
+	constexpr int r = 47;
+
+	uint64_t h = 0x8445d61a4e774912ull ^ (size * m);
+
+	const auto num_words = size / sizeof(uint64_t);
+
+	for (auto i = 0ul; i < num_words; ++i) {
+		uint64_t k;
+		std::memcpy(&k, data + i * sizeof(uint64_t), sizeof(uint64_t));
+
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+
+		h ^= k;
+		h *= m;
+	}
+
+	const auto tail = data + num_words * sizeof(uint64_t);
+	const auto tail_size = size & (sizeof(uint64_t) - 1);
+
+	if (tail_size != 0) {
+		uint64_t k = 0;
+		std::memcpy(&k, tail, tail_size);
+
+		h ^= k;
+		h *= m;
+	}
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+
+	return h;
+}
+
+static void append_varint(std::string &out, uint64_t value)
+{
+	while (value >= 0x80) {
+		out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+		value >>= 7;
+	}
+
+	out.push_back(static_cast<char>(value));
+}
+
+static bool parse_varint(const char *&data, const char *end, uint64_t &r_value)
+{
+	r_value = 0;
+
+	for (int shift = 0; data < end && shift < 64; shift += 7) {
+		const auto byte = static_cast<uint8_t>(*data++);
+		r_value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+		if ((byte & 0x80) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Encode the difference between the points and the base points: the bits of
+ * the values are XORed, so that unchanged bits are zero, and the bytes are
+ * grouped by their position in the values, so that the high bytes, which
+ * hardly change when the points move a little, form long runs of zeros. The
+ * result is a sequence of runs of zero bytes and of literal bytes. */
+static std::string encode_delta(const char *points, const char *base, size_t num_values)
+{
+	std::string planes(num_values * sizeof(uint32_t), '\0');
+
+	for (auto i = 0ul; i < num_values; ++i) {
+		uint32_t a, b;
+		std::memcpy(&a, points + i * sizeof(uint32_t), sizeof(uint32_t));
+		std::memcpy(&b, base + i * sizeof(uint32_t), sizeof(uint32_t));
+
+		const auto x = a ^ b;
+
+		for (auto k = 0ul; k < sizeof(uint32_t); ++k) {
+			planes[k * num_values + i] = static_cast<char>((x >> (8 * k)) & 0xff);
+		}
+	}
+
+	std::string out;
+	const auto size = planes.size();
+
+	for (auto i = 0ul; i < size;) {
+		auto zeros = 0ul;
+
+		while (i < size && planes[i] == 0) {
+			++zeros;
+			++i;
+		}
+
+		/* Literals end with the next run of at least two zeros. */
+		const auto start = i;
+
+		while (i < size && !(planes[i] == 0 && (i + 1 == size || planes[i + 1] == 0))) {
+			++i;
+		}
+
+		append_varint(out, zeros);
+		append_varint(out, i - start);
+		out.append(planes, start, i - start);
+	}
+
+	return out;
+}
+
+static bool decode_delta(const char *data, size_t size, const char *base, size_t num_values, char *r_points)
+{
+	const auto num_bytes = num_values * sizeof(uint32_t);
+	std::vector<char> planes(num_bytes);
+
+	const auto end = data + size;
+	auto pos = 0ul;
+
+	while (data < end) {
+		uint64_t zeros, literals;
+
+		if (!parse_varint(data, end, zeros) || !parse_varint(data, end, literals)
+		    || zeros > num_bytes - pos || literals > num_bytes - pos - zeros
+		    || literals > static_cast<size_t>(end - data))
+		{
+			return false;
+		}
+
+		std::fill_n(planes.begin() + pos, zeros, 0);
+		pos += zeros;
+
+		std::copy_n(data, literals, planes.begin() + pos);
+		pos += literals;
+		data += literals;
+	}
+
+	if (pos != num_bytes) {
+		return false;
+	}
+
+	for (auto i = 0ul; i < num_values; ++i) {
+		uint32_t x = 0;
+
+		for (auto k = 0ul; k < sizeof(uint32_t); ++k) {
+			x |= static_cast<uint32_t>(static_cast<uint8_t>(planes[k * num_values + i])) << (8 * k);
+		}
+
+		uint32_t b;
+		std::memcpy(&b, base + i * sizeof(uint32_t), sizeof(uint32_t));
+
+		const auto a = x ^ b;
+		std::memcpy(r_points + i * sizeof(uint32_t), &a, sizeof(uint32_t));
+	}
+
+	return true;
+}
+
+/* ********************************** writing ******************************* */
+
+GeometryArchiveWriter::~GeometryArchiveWriter()
+{
+	/* Discard an archive which was not closed. */
+	if (m_stream.is_open()) {
+		m_stream.close();
+		std::remove(m_temp_path.c_str());
+	}
+}
+
+bool GeometryArchiveWriter::open(const std::string &path, int flags, std::string &r_error)
+{
+	const auto temp_path = temporary_path(path);
+
+	/* The buffers already written are read back when a buffer with the same
+	 * hash is added. */
+	m_stream.open(temp_path, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+
+	if (!m_stream.is_open()) {
+		r_error = "Cannot open file '" + temp_path + "' for writing";
+		return false;
+	}
+
+	m_path = path;
+	m_temp_path = temp_path;
+	m_flags = flags;
+	m_buffers.clear();
+	m_buffer_hashes.clear();
+	m_frames.clear();
+	m_key_points.clear();
+	m_frames_since_key = 0;
+	m_buffers_written = 0;
+	m_buffers_reused = 0;
+
+	write_binary(m_stream, GEOMETRY_ARCHIVE_MAGIC, sizeof(GEOMETRY_ARCHIVE_MAGIC));
+	write_binary(m_stream, GEOMETRY_ARCHIVE_VERSION);
+	write_binary(m_stream, static_cast<uint32_t>(flags));
+
+	return true;
+}
+
+bool GeometryArchiveWriter::is_open() const
+{
+	return m_stream.is_open();
+}
+
+bool GeometryArchiveWriter::same_content(const ArchiveBuffer &buffer, const char *data)
+{
+	char block[64 * 1024];
+
+	m_stream.seekg(buffer.offset);
+
+	for (auto offset = 0ul; offset < buffer.size; offset += sizeof(block)) {
+		const auto size = std::min(sizeof(block), buffer.size - offset);
+
+		if (!read_binary(m_stream, block, size) || std::memcmp(block, data + offset, size) != 0) {
+			m_stream.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+uint64_t GeometryArchiveWriter::add_buffer(const void *data, size_t size)
+{
+	const auto bytes = static_cast<const char *>(data);
+	const auto hash = hash_buffer(bytes, size);
+	const auto range = m_buffer_hashes.equal_range(hash);
+
+	for (auto iter = range.first; iter != range.second; ++iter) {
+		const auto &buffer = m_buffers[iter->second];
+
+		if (buffer.size == size && same_content(buffer, bytes)) {
+			++m_buffers_reused;
+			return iter->second;
+		}
+	}
+
+	static const char padding[GEOMETRY_ARCHIVE_ALIGNMENT] = {};
+
+	m_stream.seekp(0, std::ios::end);
+
+	const auto end = static_cast<size_t>(m_stream.tellp());
+	const auto offset = (end + GEOMETRY_ARCHIVE_ALIGNMENT - 1) & ~(GEOMETRY_ARCHIVE_ALIGNMENT - 1);
+
+	write_binary(m_stream, padding, offset - end);
+	write_binary(m_stream, bytes, size);
+
+	ArchiveBuffer buffer;
+	buffer.offset = offset;
+	buffer.size = size;
+
+	const auto index = m_buffers.size();
+	m_buffers.push_back(buffer);
+	m_buffer_hashes.emplace(hash, index);
+
+	++m_buffers_written;
+
+	return index;
+}
+
+ArchiveChunk GeometryArchiveWriter::points_chunk(size_t prim_index, const PointList &points)
+{
+	ArchiveChunk chunk;
+	chunk.kind = CHUNK_POINTS;
+	chunk.attribute_type = ATTR_TYPE_INVALID;
+	chunk.encoding = ENCODING_RAW;
+	chunk.count = points.size();
+	chunk.base_buffer = 0;
+
+	const auto data = static_cast<const char *>(points.data());
+
+	if ((m_flags & ARCHIVE_DELTA_POINTS) == 0) {
+		chunk.buffer = add_buffer(data, points.byte_size());
+		return chunk;
+	}
+
+	if (m_frames_since_key != 0 && prim_index < m_key_points.size() && points.size() != 0) {
+		const auto &key = m_key_points[prim_index];
+
+		if (key.points.size() == points.size()) {
+			const auto delta = encode_delta(data, static_cast<const char *>(key.points.data()),
+			                                points.size() * 3);
+
+			chunk.encoding = ENCODING_DELTA;
+			chunk.buffer = add_buffer(delta.data(), delta.size());
+			chunk.base_buffer = key.buffer;
+
+			return chunk;
+		}
+	}
+
+	chunk.buffer = add_buffer(data, points.byte_size());
+
+	if (prim_index >= m_key_points.size()) {
+		m_key_points.resize(prim_index + 1);
+	}
+
+	/* The copy shares the points of the primitive. */
+	m_key_points[prim_index].points = points;
+	m_key_points[prim_index].buffer = chunk.buffer;
+
+	return chunk;
+}
+
+bool GeometryArchiveWriter::add_frame(int frame, const PrimitiveCollection &collection, std::string &r_error)
+{
+	TRACE_SPAN("GeometryArchiveWriter::add_frame");
+
+	if (!m_stream.is_open()) {
+		r_error = "The archive is not open";
+		return false;
+	}
+
+	if (m_frames_since_key == GEOMETRY_ARCHIVE_KEY_INTERVAL) {
+		m_frames_since_key = 0;
+	}
+
+	ArchiveFrame archive_frame;
+	archive_frame.frame = frame;
+
+	for (const auto &prim : collection.primitives()) {
+		const PointList *points;
+		const PolygonList *polys;
+		const EdgeList *edges;
+
+		if (!primitive_lists(prim, points, polys, edges)) {
+			continue;
+		}
+
+		ArchivePrimitive archive_prim;
+		archive_prim.key = (polys != nullptr) ? "Mesh" : (edges != nullptr) ? "SegmentPrim" : "PrimPoints";
+		archive_prim.name = prim->name();
+		archive_prim.pos = prim->pos();
+		archive_prim.scale = prim->scale();
+		archive_prim.rotation = prim->rotation();
+		archive_prim.matrix = prim->matrix();
+
+		archive_prim.chunks.push_back(points_chunk(archive_frame.primitives.size(), *points));
+
+		ArchiveChunk chunk;
+		chunk.attribute_type = ATTR_TYPE_INVALID;
+		chunk.encoding = ENCODING_RAW;
+		chunk.base_buffer = 0;
+
+		if (polys != nullptr) {
+			chunk.kind = CHUNK_POLYGONS;
+			chunk.count = polys->size();
+			chunk.buffer = add_buffer(polys->data(), polys->byte_size());
+			archive_prim.chunks.push_back(chunk);
+		}
+
+		if (edges != nullptr) {
+			chunk.kind = CHUNK_EDGES;
+			chunk.count = edges->size();
+			chunk.buffer = add_buffer(edges->data(), edges->byte_size());
+			archive_prim.chunks.push_back(chunk);
+		}
+
+		for (const auto &attribute : prim->attributes()) {
+			chunk.kind = CHUNK_ATTRIBUTE;
+			chunk.attribute_type = attribute->type();
+			chunk.count = attribute->size();
+			chunk.name = attribute->name();
+
+			if (attribute->type() == ATTR_TYPE_STRING) {
+				const auto payload = string_attribute_payload(*attribute);
+				chunk.buffer = add_buffer(payload.data(), payload.size());
+			}
+			else {
+				const auto data = (chunk.count != 0) ? attribute->data() : nullptr;
+				chunk.buffer = add_buffer(data, attribute->byte_size());
+			}
+
+			archive_prim.chunks.push_back(chunk);
+		}
+
+		archive_frame.primitives.push_back(std::move(archive_prim));
+	}
+
+	m_frames.push_back(std::move(archive_frame));
+	++m_frames_since_key;
+
+	if (!m_stream.good()) {
+		r_error = "Cannot write file '" + m_temp_path + "'";
+		return false;
+	}
+
+	return true;
+}
+
+bool GeometryArchiveWriter::close(std::string &r_error)
+{
+	if (!m_stream.is_open()) {
+		r_error = "The archive is not open";
+		return false;
+	}
+
+	const auto &temp_path = m_temp_path;
+
+	m_stream.seekp(0, std::ios::end);
+
+	const auto index_offset = static_cast<uint64_t>(m_stream.tellp());
+
+	write_binary(m_stream, static_cast<uint64_t>(m_buffers.size()));
+	write_binary(m_stream, m_buffers.data(), m_buffers.size());
+	write_binary(m_stream, static_cast<uint64_t>(m_frames.size()));
+
+	for (const auto &frame : m_frames) {
+		write_binary(m_stream, static_cast<int32_t>(frame.frame));
+		write_binary(m_stream, static_cast<uint64_t>(frame.primitives.size()));
+
+		for (const auto &prim : frame.primitives) {
+			write_binary(m_stream, prim.key);
+			write_binary(m_stream, prim.name);
+			write_binary(m_stream, prim.pos);
+			write_binary(m_stream, prim.scale);
+			write_binary(m_stream, prim.rotation);
+			write_binary(m_stream, prim.matrix);
+			write_binary(m_stream, static_cast<uint64_t>(prim.chunks.size()));
+
+			for (const auto &chunk : prim.chunks) {
+				write_binary(m_stream, chunk.kind);
+				write_binary(m_stream, chunk.attribute_type);
+				write_binary(m_stream, chunk.encoding);
+				write_binary(m_stream, chunk.count);
+				write_binary(m_stream, chunk.buffer);
+				write_binary(m_stream, chunk.base_buffer);
+				write_binary(m_stream, chunk.name);
+			}
+		}
+	}
+
+	write_binary(m_stream, index_offset);
+	write_binary(m_stream, GEOMETRY_ARCHIVE_MAGIC, sizeof(GEOMETRY_ARCHIVE_MAGIC));
+
+	const auto good = m_stream.good();
+	m_stream.close();
+
+	m_frames.clear();
+	m_key_points.clear();
+
+	if (!good) {
+		r_error = "Cannot write file '" + temp_path + "'";
+		std::remove(temp_path.c_str());
+		return false;
+	}
+
+	if (std::rename(temp_path.c_str(), m_path.c_str()) != 0) {
+		r_error = "Cannot replace file '" + m_path + "'";
+		std::remove(temp_path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+size_t GeometryArchiveWriter::buffers_written() const
+{
+	return m_buffers_written;
+}
+
+size_t GeometryArchiveWriter::buffers_reused() const
+{
+	return m_buffers_reused;
+}
+
+/* ********************************** reading ******************************* */
+
+/* Minimum number of bytes taken by the entries of the index, used to check the
+ * counts read from the index before allocating memory for them. */
+static constexpr size_t INDEX_FRAME_SIZE = sizeof(int32_t) + sizeof(uint64_t);
+
+static constexpr size_t INDEX_PRIMITIVE_SIZE = 2 * sizeof(uint64_t) + 3 * sizeof(glm::vec3)
+                                               + sizeof(glm::mat4) + sizeof(uint64_t);
+
+static constexpr size_t INDEX_CHUNK_SIZE = sizeof(uint32_t) + sizeof(int32_t) + sizeof(uint32_t)
+                                           + 3 * sizeof(uint64_t) + sizeof(uint64_t);
+
+static bool read_index(std::istream &is, size_t file_size,
+                       std::vector<ArchiveBuffer> &r_buffers,
+                       std::vector<ArchiveFrame> &r_frames)
+{
+	uint64_t num_buffers, num_frames;
+
+	if (!read_binary(is, num_buffers) || !binary_count_fits(is, num_buffers, sizeof(ArchiveBuffer))) {
+		return false;
+	}
+
+	r_buffers.resize(num_buffers);
+
+	if (!read_binary(is, r_buffers.data(), r_buffers.size()) || !read_binary(is, num_frames)
+	    || !binary_count_fits(is, num_frames, INDEX_FRAME_SIZE))
+	{
+		return false;
+	}
+
+	for (const auto &buffer : r_buffers) {
+		if (buffer.offset > file_size || buffer.size > file_size - buffer.offset) {
+			return false;
+		}
+	}
+
+	r_frames.resize(num_frames);
+
+	for (auto &frame : r_frames) {
+		int32_t frame_number;
+		uint64_t num_prims;
+
+		if (!read_binary(is, frame_number) || !read_binary(is, num_prims)
+		    || !binary_count_fits(is, num_prims, INDEX_PRIMITIVE_SIZE))
+		{
+			return false;
+		}
+
+		frame.frame = frame_number;
+		frame.primitives.resize(num_prims);
+
+		for (auto &prim : frame.primitives) {
+			uint64_t num_chunks;
+
+			if (!read_binary(is, prim.key) || !read_binary(is, prim.name)
+			    || !read_binary(is, prim.pos) || !read_binary(is, prim.scale)
+			    || !read_binary(is, prim.rotation) || !read_binary(is, prim.matrix)
+			    || !read_binary(is, num_chunks) || !binary_count_fits(is, num_chunks, INDEX_CHUNK_SIZE))
+			{
+				return false;
+			}
+
+			prim.chunks.resize(num_chunks);
+
+			for (auto &chunk : prim.chunks) {
+				if (!read_binary(is, chunk.kind) || !read_binary(is, chunk.attribute_type)
+				    || !read_binary(is, chunk.encoding) || !read_binary(is, chunk.count)
+				    || !read_binary(is, chunk.buffer) || !read_binary(is, chunk.base_buffer)
+				    || !read_binary(is, chunk.name)
+				    || chunk.buffer >= num_buffers || chunk.base_buffer >= num_buffers)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+bool GeometryArchiveReader::open(const std::string &path, std::string &r_error)
+{
+	TRACE_SPAN("GeometryArchiveReader::open");
+
+	auto file = std::make_shared<MappedFile>();
+
+	if (!file->open(path)) {
+		r_error = "Cannot open file '" + path + "'";
+		return false;
+	}
+
+	const auto header_size = sizeof(GEOMETRY_ARCHIVE_MAGIC) + 2 * sizeof(uint32_t);
+	const auto footer_size = sizeof(uint64_t) + sizeof(GEOMETRY_ARCHIVE_MAGIC);
+
+	if (file->size() < header_size + footer_size
+	    || std::memcmp(file->data(), GEOMETRY_ARCHIVE_MAGIC, sizeof(GEOMETRY_ARCHIVE_MAGIC)) != 0
+	    || std::memcmp(file->data() + file->size() - sizeof(GEOMETRY_ARCHIVE_MAGIC),
+	                   GEOMETRY_ARCHIVE_MAGIC, sizeof(GEOMETRY_ARCHIVE_MAGIC)) != 0)
+	{
+		r_error = "File '" + path + "' is not a geometry archive";
+		return false;
+	}
+
+	uint32_t version;
+	std::memcpy(&version, file->data() + sizeof(GEOMETRY_ARCHIVE_MAGIC), sizeof(uint32_t));
+
+	if (version > GEOMETRY_ARCHIVE_VERSION) {
+		r_error = "File '" + path + "' was written with a newer version of the geometry archive format";
+		return false;
+	}
+
+	uint64_t index_offset;
+	std::memcpy(&index_offset, file->data() + file->size() - footer_size, sizeof(uint64_t));
+
+	std::vector<ArchiveBuffer> buffers;
+	std::vector<ArchiveFrame> frames;
+
+	if (index_offset < header_size || index_offset > file->size() - footer_size) {
+		r_error = "File '" + path + "' is corrupted";
+		return false;
+	}
+
+	MemoryStreamBuf buffer(file->data() + index_offset, file->size() - footer_size - index_offset);
+	std::istream is(&buffer);
+
+	if (!read_index(is, file->size(), buffers, frames)) {
+		r_error = "File '" + path + "' is corrupted";
+		return false;
+	}
+
+	m_file = std::move(file);
+	m_buffers = std::move(buffers);
+	m_frames = std::move(frames);
+	m_frame_indices.clear();
+
+	for (auto i = 0ul; i < m_frames.size(); ++i) {
+		m_frame_indices[m_frames[i].frame] = i;
+	}
+
+	return true;
+}
+
+std::vector<int> GeometryArchiveReader::frames() const
+{
+	std::vector<int> frames;
+	frames.reserve(m_frames.size());
+
+	for (const auto &frame : m_frames) {
+		frames.push_back(frame.frame);
+	}
+
+	return frames;
+}
+
+bool GeometryArchiveReader::has_frame(int frame) const
+{
+	return m_frame_indices.find(frame) != m_frame_indices.end();
+}
+
+/* Make the list refer to the buffer, if its size matches the number of values
+ * of the chunk. */
+template <typename ValueT, typename ListT>
+static bool reference_list(const std::shared_ptr<const MappedFile> &file, const ArchiveBuffer &buffer,
+                           const ArchiveChunk &chunk, ListT *list)
+{
+	if (chunk.encoding != ENCODING_RAW || buffer.size % sizeof(ValueT) != 0
+	    || chunk.count != buffer.size / sizeof(ValueT))
+	{
+		return false;
+	}
+
+	if (chunk.count != 0) {
+		list->reference(mapped_values<ValueT>(file, file->data() + buffer.offset), chunk.count);
+	}
+
+	return true;
+}
+
+bool GeometryArchiveReader::read_frame(int frame, PrimitiveCollection &collection, std::string &r_error) const
+{
+	TRACE_SPAN("GeometryArchiveReader::read_frame");
+
+	const auto iter = m_frame_indices.find(frame);
+
+	if (iter == m_frame_indices.end()) {
+		r_error = "Frame " + std::to_string(frame) + " is not in the archive";
+		return false;
+	}
+
+	const auto factory = collection.factory();
+	const auto data = m_file->data();
+	std::vector<std::unique_ptr<Primitive>> prims;
+
+	for (const auto &archive_prim : m_frames[iter->second].primitives) {
+		if (!factory->registered(archive_prim.key)) {
+			r_error = "Unknown primitive type '" + archive_prim.key + "'";
+			return false;
+		}
+
+		std::unique_ptr<Primitive> prim((*factory)(archive_prim.key));
+		PointList *points;
+		PolygonList *polys;
+		EdgeList *edges;
+
+		if (!primitive_lists(prim.get(), points, polys, edges)) {
+			r_error = "Unsupported primitive type '" + archive_prim.key + "'";
+			return false;
+		}
+
+		prim->name(archive_prim.name);
+		prim->pos() = archive_prim.pos;
+		prim->scale() = archive_prim.scale;
+		prim->rotation() = archive_prim.rotation;
+		prim->matrix(archive_prim.matrix);
+
+		for (const auto &chunk : archive_prim.chunks) {
+			const auto &buffer = m_buffers[chunk.buffer];
+			auto ok = true;
+
+			switch (chunk.kind) {
+				case CHUNK_POINTS:
+				{
+					if (chunk.encoding == ENCODING_RAW) {
+						ok = reference_list<glm::vec3>(m_file, buffer, chunk, points);
+						break;
+					}
+
+					const auto &base = m_buffers[chunk.base_buffer];
+
+					ok = (chunk.encoding == ENCODING_DELTA && base.size % sizeof(glm::vec3) == 0
+					      && chunk.count == base.size / sizeof(glm::vec3));
+
+					if (ok && chunk.count != 0) {
+						points->resize(chunk.count);
+						ok = decode_delta(data + buffer.offset, buffer.size, data + base.offset,
+						                  chunk.count * 3, reinterpret_cast<char *>(&(*points)[0]));
+					}
+
+					break;
+				}
+				case CHUNK_POLYGONS:
+					ok = polys == nullptr || reference_list<glm::uvec4>(m_file, buffer, chunk, polys);
+					break;
+				case CHUNK_EDGES:
+					ok = edges == nullptr || reference_list<glm::uvec2>(m_file, buffer, chunk, edges);
+					break;
+				case CHUNK_ATTRIBUTE:
+				{
+					auto attribute = mapped_attribute(chunk.name, static_cast<AttributeType>(chunk.attribute_type),
+					                                  chunk.count, m_file, data + buffer.offset, buffer.size);
+
+					if (attribute == nullptr) {
+						ok = false;
+						break;
+					}
+
+					prim->remove_attribute(attribute->name(), attribute->type());
+					prim->add_attribute(attribute);
+					break;
+				}
+				default:
+					break;
+			}
+
+			if (!ok) {
+				r_error = "Frame " + std::to_string(frame) + " of the archive is corrupted";
+				return false;
+			}
+		}
+
+		prim->tagUpdate();
+		prims.push_back(std::move(prim));
+	}
+
+	for (auto &prim : prims) {
+		collection.add(prim.release());
+	}
+
+	return true;
+}
@@ -0,0 +1,169 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <kamikaze/geomlists.h>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class MappedFile;
+class PrimitiveCollection;
+
+/* Geometry archives, storing the collections of a sequence of frames, e.g. of
+ * a deforming mesh, in a single file.
+ *
+ * Every buffer of the primitives of a frame (points, polygons, edges and
+ * attributes) is hashed, and only written if no buffer with the same content
+ * was written for a previous frame, so the topology and the attributes which
+ * do not change are stored once. The points can also be stored as their
+ * difference with those of the last key frame, see ARCHIVE_DELTA_POINTS.
+ *
+ * The file starts with the magic bytes "KMKGEOAR", the version of the format
+ * and the flags it was written with, followed by the buffers, aligned on 16
+ * bytes. The index of the frames, which lists the primitives of each frame and
+ * the buffers of their chunks, comes last, and the file ends with the offset
+ * of the index and the magic bytes again. Like for the geometry caches (see
+ * geometry_cache.h) the values are stored as they are laid out in memory, and
+ * the buffers which are not delta compressed are read in place. */
+
+enum {
+	/* Store the points of the frames following a key frame as the difference
+	 * with the points of the key frame, with the bits of the values XORed and
+	 * the runs of zero bytes encoded, which is lossless, and small when the
+	 * points move little. A key frame is written every few frames, and when
+	 * the number of points changes, so that any frame can be decoded from at
+	 * most two buffers. */
+	ARCHIVE_DELTA_POINTS = (1 << 0),
+};
+
+/* A chunk of a primitive stored in an archive, see geometry_archive.cc. */
+struct ArchiveChunk {
+	uint32_t kind;
+	int32_t attribute_type;
+	uint32_t encoding;
+	uint64_t count;
+	uint64_t buffer;
+	uint64_t base_buffer;
+	std::string name;
+};
+
+struct ArchivePrimitive {
+	std::string key;
+	std::string name;
+	glm::vec3 pos;
+	glm::vec3 scale;
+	glm::vec3 rotation;
+	glm::mat4 matrix;
+	std::vector<ArchiveChunk> chunks;
+};
+
+struct ArchiveFrame {
+	int frame;
+	std::vector<ArchivePrimitive> primitives;
+};
+
+struct ArchiveBuffer {
+	uint64_t offset;
+	uint64_t size;
+};
+
+class GeometryArchiveWriter {
+	std::fstream m_stream{};
+	std::string m_path = "";
+	std::string m_temp_path = "";
+	int m_flags = 0;
+
+	std::vector<ArchiveBuffer> m_buffers{};
+	std::unordered_multimap<uint64_t, uint64_t> m_buffer_hashes{};
+	std::vector<ArchiveFrame> m_frames{};
+
+	/* The points of the last key frame of each primitive, by their index in
+	 * the collection, along with the buffer they are stored in. */
+	struct KeyPoints {
+		PointList points;
+		uint64_t buffer;
+	};
+
+	std::vector<KeyPoints> m_key_points{};
+	int m_frames_since_key = 0;
+
+	size_t m_buffers_written = 0;
+	size_t m_buffers_reused = 0;
+
+public:
+	GeometryArchiveWriter() = default;
+	~GeometryArchiveWriter();
+
+	/* Disallow copy. */
+	GeometryArchiveWriter(const GeometryArchiveWriter &other) = delete;
+	GeometryArchiveWriter &operator=(const GeometryArchiveWriter &other) = delete;
+
+	/* Start writing an archive at the given path, which is only replaced once
+	 * the archive is closed. */
+	bool open(const std::string &path, int flags, std::string &r_error);
+
+	/* Add the meshes, point clouds and segment primitives of the collection as
+	 * the given frame. */
+	bool add_frame(int frame, const PrimitiveCollection &collection, std::string &r_error);
+
+	/* Write the index of the frames and replace the file at the path given to
+	 * open() with the archive. */
+	bool close(std::string &r_error);
+
+	bool is_open() const;
+
+	/* The number of buffers written to the archive, and of buffers which were
+	 * not written as they were already in the archive. */
+	size_t buffers_written() const;
+	size_t buffers_reused() const;
+
+private:
+	uint64_t add_buffer(const void *data, size_t size);
+	bool same_content(const ArchiveBuffer &buffer, const char *data);
+	ArchiveChunk points_chunk(size_t prim_index, const PointList &points);
+};
+
+/* Reads the frames of an archive, in any order and from any thread. */
+class GeometryArchiveReader {
+	std::shared_ptr<MappedFile> m_file{};
+	std::vector<ArchiveBuffer> m_buffers{};
+	std::vector<ArchiveFrame> m_frames{};
+	std::unordered_map<int, size_t> m_frame_indices{};
+
+public:
+	bool open(const std::string &path, std::string &r_error);
+
+	/* The frames stored in the archive, in the order they were added. */
+	std::vector<int> frames() const;
+
+	bool has_frame(int frame) const;
+
+	/* Add the primitives of the given frame to the collection, which is left
+	 * untouched if they cannot be read. */
+	bool read_frame(int frame, PrimitiveCollection &collection, std::string &r_error) const;
+};
@@ -0,0 +1,585 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include "geometry_cache.h"
+
+#include <kamikaze/mesh.h>
+#include <kamikaze/prim_points.h>
+#include <kamikaze/primitive.h>
+#include <kamikaze/segmentprim.h>
+#include <kamikaze/util_binary.h>
+#include <kamikaze/util_trace.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <tbb/parallel_for.h>
+#include <unistd.h>
+
+#include "mapped_file.h"
+
+static constexpr char GEOMETRY_CACHE_MAGIC[8] = { 'K', 'M', 'K', 'G', 'E', 'O', 'M', 'C' };
+static constexpr uint32_t GEOMETRY_CACHE_VERSION = 1;
+static constexpr size_t GEOMETRY_CACHE_ALIGNMENT = 16;
+
+enum {
+	CHUNK_POINTS    = 0,
+	CHUNK_POLYGONS  = 1,
+	CHUNK_EDGES     = 2,
+	CHUNK_ATTRIBUTE = 3,
+};
+
+struct ChunkHeader {
+	uint32_t kind;
+	int32_t attribute_type;
+	uint64_t count;
+	uint64_t name_size;
+	uint64_t payload_size;
+};
+
+static size_t align_offset(size_t offset)
+{
+	return (offset + GEOMETRY_CACHE_ALIGNMENT - 1) & ~(GEOMETRY_CACHE_ALIGNMENT - 1);
+}
+
+size_t attribute_value_size(AttributeType type)
+{
+	switch (type) {
+		case ATTR_TYPE_BYTE:
+			return sizeof(char);
+		case ATTR_TYPE_INT:
+			return sizeof(int);
+		case ATTR_TYPE_FLOAT:
+			return sizeof(float);
+		case ATTR_TYPE_VEC2:
+			return sizeof(glm::vec2);
+		case ATTR_TYPE_VEC3:
+			return sizeof(glm::vec3);
+		case ATTR_TYPE_VEC4:
+			return sizeof(glm::vec4);
+		case ATTR_TYPE_MAT3:
+			return sizeof(glm::mat3);
+		case ATTR_TYPE_MAT4:
+			return sizeof(glm::mat4);
+		default:
+			return 0;
+	}
+}
+
+bool primitive_lists(const Primitive *prim, const PointList *&r_points,
+                     const PolygonList *&r_polys, const EdgeList *&r_edges)
+{
+	r_polys = nullptr;
+	r_edges = nullptr;
+
+	if (prim->typeID() == Mesh::id) {
+		auto mesh = static_cast<const Mesh *>(prim);
+		r_points = mesh->points();
+		r_polys = mesh->polys();
+	}
+	else if (prim->typeID() == PrimPoints::id) {
+		r_points = static_cast<const PrimPoints *>(prim)->points();
+	}
+	else if (prim->typeID() == SegmentPrim::id) {
+		auto segment_prim = static_cast<const SegmentPrim *>(prim);
+		r_points = segment_prim->points();
+		r_edges = segment_prim->edges();
+	}
+	else {
+		r_points = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+bool primitive_lists(Primitive *prim, PointList *&r_points,
+                     PolygonList *&r_polys, EdgeList *&r_edges)
+{
+	const PointList *points;
+	const PolygonList *polys;
+	const EdgeList *edges;
+
+	if (!primitive_lists(static_cast<const Primitive *>(prim), points, polys, edges)) {
+		return false;
+	}
+
+	/* The lists are members of the primitive, which is not const. */
+	r_points = const_cast<PointList *>(points);
+	r_polys = const_cast<PolygonList *>(polys);
+	r_edges = const_cast<EdgeList *>(edges);
+
+	return true;
+}
+
+std::string string_attribute_payload(const Attribute &attribute)
+{
+	std::ostringstream strings;
+
+	for (auto i = 0ul, ie = attribute.size(); i < ie; ++i) {
+		write_binary(strings, attribute.stdstring(i));
+	}
+
+	return strings.str();
+}
+
+/* ********************************** writing ******************************* */
+
+static void write_chunk(std::ostream &os, uint32_t kind, int32_t attribute_type,
+                        const std::string &name, size_t count,
+                        const void *payload, size_t payload_size)
+{
+	static const char padding[GEOMETRY_CACHE_ALIGNMENT] = {};
+
+	ChunkHeader header;
+	header.kind = kind;
+	header.attribute_type = attribute_type;
+	header.count = count;
+	header.name_size = name.size();
+	header.payload_size = payload_size;
+
+	write_binary(os, header);
+	write_binary(os, name.data(), name.size());
+
+	const auto offset = static_cast<size_t>(os.tellp());
+	write_binary(os, padding, align_offset(offset) - offset);
+
+	if (payload_size != 0) {
+		write_binary(os, static_cast<const char *>(payload), payload_size);
+	}
+}
+
+static void write_attribute(std::ostream &os, const Attribute &attribute)
+{
+	const auto count = attribute.size();
+
+	if (attribute.type() != ATTR_TYPE_STRING) {
+		const auto data = (count != 0) ? attribute.data() : nullptr;
+
+		write_chunk(os, CHUNK_ATTRIBUTE, attribute.type(), attribute.name(),
+		            count, data, attribute.byte_size());
+		return;
+	}
+
+	/* Strings are stored one after the other, and copied when read. */
+	const auto payload = string_attribute_payload(attribute);
+
+	write_chunk(os, CHUNK_ATTRIBUTE, attribute.type(), attribute.name(),
+	            count, payload.data(), payload.size());
+}
+
+static bool write_primitive(std::ostream &os, const Primitive &prim)
+{
+	const PointList *points;
+	const PolygonList *polys;
+	const EdgeList *edges;
+
+	if (!primitive_lists(&prim, points, polys, edges)) {
+		return false;
+	}
+
+	const auto key = (polys != nullptr) ? "Mesh" : (edges != nullptr) ? "SegmentPrim" : "PrimPoints";
+
+	const auto &attributes = prim.attributes();
+	const auto num_chunks = 1 + (polys != nullptr) + (edges != nullptr) + attributes.size();
+
+	write_binary(os, std::string(key));
+	write_binary(os, prim.name());
+	write_binary(os, prim.pos());
+	write_binary(os, prim.scale());
+	write_binary(os, prim.rotation());
+	write_binary(os, prim.matrix());
+	write_binary(os, static_cast<uint64_t>(num_chunks));
+
+	write_chunk(os, CHUNK_POINTS, ATTR_TYPE_INVALID, "", points->size(), points->data(), points->byte_size());
+
+	if (polys != nullptr) {
+		write_chunk(os, CHUNK_POLYGONS, ATTR_TYPE_INVALID, "", polys->size(), polys->data(), polys->byte_size());
+	}
+
+	if (edges != nullptr) {
+		write_chunk(os, CHUNK_EDGES, ATTR_TYPE_INVALID, "", edges->size(), edges->data(), edges->byte_size());
+	}
+
+	for (const auto &attribute : attributes) {
+		write_attribute(os, *attribute);
+	}
+
+	return true;
+}
+
+std::string temporary_path(const std::string &path)
+{
+	static std::atomic<uint64_t> counter(0);
+
+	std::ostringstream ss;
+	ss << path << ".tmp." << getpid() << '.' << counter.fetch_add(1, std::memory_order_relaxed);
+
+	return ss.str();
+}
+
+bool write_geometry_cache(const PrimitiveCollection &collection, const std::string &path, std::string &r_error)
+{
+	TRACE_SPAN("write_geometry_cache");
+
+	std::vector<const Primitive *> prims;
+
+	for (const auto &prim : collection.primitives()) {
+		const PointList *points;
+		const PolygonList *polys;
+		const EdgeList *edges;
+
+		if (primitive_lists(prim, points, polys, edges)) {
+			prims.push_back(prim);
+		}
+	}
+
+	/* The file is written next to the one it replaces, and renamed once it is
+	 * complete, so that readers, which may still have the previous file
+	 * mapped, never see a partially written file. */
+	const auto temp_path = temporary_path(path);
+
+	{
+		std::ofstream os(temp_path, std::ios::binary);
+
+		if (!os.is_open()) {
+			r_error = "Cannot open file '" + temp_path + "' for writing";
+			return false;
+		}
+
+		write_binary(os, GEOMETRY_CACHE_MAGIC, sizeof(GEOMETRY_CACHE_MAGIC));
+		write_binary(os, GEOMETRY_CACHE_VERSION);
+		write_binary(os, static_cast<uint32_t>(prims.size()));
+
+		for (const auto &prim : prims) {
+			write_primitive(os, *prim);
+		}
+
+		if (!os.good()) {
+			r_error = "Cannot write file '" + temp_path + "'";
+			std::remove(temp_path.c_str());
+			return false;
+		}
+	}
+
+	if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+		r_error = "Cannot replace file '" + path + "'";
+		std::remove(temp_path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+/* ********************************** reading ******************************* */
+
+using MappedFilePtr = std::shared_ptr<const MappedFile>;
+
+template <typename T>
+static void reference_values(Attribute *attribute, const MappedFilePtr &file, const char *data, size_t count)
+{
+	attribute->typed_list<T>()->reference(mapped_values<T>(file, data), count);
+}
+
+Attribute *mapped_attribute(const std::string &name, AttributeType type, size_t count,
+                            const MappedFilePtr &file, const char *data, size_t size)
+{
+	if (type == ATTR_TYPE_STRING) {
+		/* Each string is written with its size. */
+		if (count > size / sizeof(uint64_t)) {
+			return nullptr;
+		}
+
+		std::unique_ptr<Attribute> attribute(new Attribute(name, type, count));
+
+		MemoryStreamBuf buffer(data, size);
+		std::istream is(&buffer);
+		std::string str;
+
+		for (auto i = 0ul; i < count; ++i) {
+			if (!read_binary(is, str)) {
+				return nullptr;
+			}
+
+			attribute->stdstring(i, str);
+		}
+
+		return attribute.release();
+	}
+
+	const auto value_size = attribute_value_size(type);
+
+	if (value_size == 0 || size % value_size != 0 || count != size / value_size) {
+		return nullptr;
+	}
+
+	auto attribute = new Attribute(name, type, 0);
+
+	if (count == 0) {
+		return attribute;
+	}
+
+	switch (type) {
+		case ATTR_TYPE_BYTE:
+			reference_values<char>(attribute, file, data, count);
+			break;
+		case ATTR_TYPE_INT:
+			reference_values<int>(attribute, file, data, count);
+			break;
+		case ATTR_TYPE_FLOAT:
+			reference_values<float>(attribute, file, data, count);
+			break;
+		case ATTR_TYPE_VEC2:
+			reference_values<glm::vec2>(attribute, file, data, count);
+			break;
+		case ATTR_TYPE_VEC3:
+			reference_values<glm::vec3>(attribute, file, data, count);
+			break;
+		case ATTR_TYPE_VEC4:
+			reference_values<glm::vec4>(attribute, file, data, count);
+			break;
+		case ATTR_TYPE_MAT3:
+			reference_values<glm::mat3>(attribute, file, data, count);
+			break;
+		case ATTR_TYPE_MAT4:
+			reference_values<glm::mat4>(attribute, file, data, count);
+			break;
+		default:
+			break;
+	}
+
+	return attribute;
+}
+
+/* Make the list refer to the payload of the chunk, if its size matches the
+ * number of values of the chunk. */
+template <typename ValueT, typename ListT>
+static bool read_list(const ChunkHeader &header, const MappedFilePtr &file, size_t offset, ListT *list)
+{
+	if (header.payload_size % sizeof(ValueT) != 0 || header.count != header.payload_size / sizeof(ValueT)) {
+		return false;
+	}
+
+	if (header.count != 0) {
+		list->reference(mapped_values<ValueT>(file, file->data() + offset), header.count);
+	}
+
+	return true;
+}
+
+static bool read_chunk(std::istream &is, const MappedFilePtr &file, Primitive *prim,
+                       PointList *points, PolygonList *polys, EdgeList *edges)
+{
+	ChunkHeader header;
+	std::string name;
+
+	if (!read_binary(is, header) || header.name_size > file->size()) {
+		return false;
+	}
+
+	name.resize(header.name_size);
+
+	if (!read_binary(is, &name[0], name.size())) {
+		return false;
+	}
+
+	const auto offset = align_offset(static_cast<size_t>(is.tellg()));
+
+	if (offset > file->size() || header.payload_size > file->size() - offset) {
+		return false;
+	}
+
+	/* Move past the payload, which is not read through the stream. */
+	is.seekg(offset + header.payload_size);
+
+	switch (header.kind) {
+		case CHUNK_POINTS:
+			return read_list<glm::vec3>(header, file, offset, points);
+		case CHUNK_POLYGONS:
+			return polys == nullptr || read_list<glm::uvec4>(header, file, offset, polys);
+		case CHUNK_EDGES:
+			return edges == nullptr || read_list<glm::uvec2>(header, file, offset, edges);
+		case CHUNK_ATTRIBUTE:
+		{
+			auto attribute = mapped_attribute(name, static_cast<AttributeType>(header.attribute_type),
+			                                  header.count, file, file->data() + offset,
+			                                  header.payload_size);
+
+			if (attribute == nullptr) {
+				return false;
+			}
+
+			/* Replace the attributes which the primitive is created with. */
+			prim->remove_attribute(attribute->name(), attribute->type());
+			prim->add_attribute(attribute);
+			return true;
+		}
+		default:
+			return true;
+	}
+}
+
+/* Return whether the polygons and edges only refer to existing points. */
+static bool valid_indices(const PointList *points, const PolygonList *polys, const EdgeList *edges)
+{
+	const auto num_points = points->size();
+	std::atomic<bool> valid(true);
+
+	if (polys != nullptr && polys->size() != 0) {
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, polys->size()),
+		                  [&](const tbb::blocked_range<size_t> &r)
+		{
+			for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+				const auto &poly = (*polys)[i];
+				const auto last = (poly[3] == INVALID_INDEX) ? 3 : 4;
+
+				for (auto k = 0; k < last; ++k) {
+					if (poly[k] >= num_points) {
+						valid = false;
+					}
+				}
+			}
+		});
+	}
+
+	if (edges != nullptr && edges->size() != 0) {
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, edges->size()),
+		                  [&](const tbb::blocked_range<size_t> &r)
+		{
+			for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+				const auto &edge = (*edges)[i];
+
+				if (edge[0] >= num_points || edge[1] >= num_points) {
+					valid = false;
+				}
+			}
+		});
+	}
+
+	return valid;
+}
+
+static Primitive *read_primitive(std::istream &is, const MappedFilePtr &file, PrimitiveFactory *factory)
+{
+	std::string key, name;
+	glm::vec3 pos, scale, rotation;
+	glm::mat4 matrix;
+	uint64_t num_chunks;
+
+	if (!read_binary(is, key) || !read_binary(is, name)
+	    || !read_binary(is, pos) || !read_binary(is, scale) || !read_binary(is, rotation)
+	    || !read_binary(is, matrix) || !read_binary(is, num_chunks))
+	{
+		return nullptr;
+	}
+
+	if (!factory->registered(key)) {
+		return nullptr;
+	}
+
+	std::unique_ptr<Primitive> prim((*factory)(key));
+	PointList *points;
+	PolygonList *polys;
+	EdgeList *edges;
+
+	if (!primitive_lists(prim.get(), points, polys, edges)) {
+		return nullptr;
+	}
+
+	prim->name(name);
+	prim->pos() = pos;
+	prim->scale() = scale;
+	prim->rotation() = rotation;
+	prim->matrix(matrix);
+
+	for (auto i = 0ul; i < num_chunks; ++i) {
+		if (!read_chunk(is, file, prim.get(), points, polys, edges)) {
+			return nullptr;
+		}
+	}
+
+	if (!valid_indices(points, polys, edges)) {
+		return nullptr;
+	}
+
+	prim->tagUpdate();
+
+	return prim.release();
+}
+
+bool read_geometry_cache(const std::string &path, PrimitiveCollection &collection, std::string &r_error)
+{
+	TRACE_SPAN("read_geometry_cache");
+
+	auto file = std::make_shared<MappedFile>();
+
+	if (!file->open(path)) {
+		r_error = "Cannot open file '" + path + "'";
+		return false;
+	}
+
+	MemoryStreamBuf buffer(file->data(), file->size());
+	std::istream is(&buffer);
+
+	char magic[sizeof(GEOMETRY_CACHE_MAGIC)];
+	uint32_t version, num_prims;
+
+	if (!read_binary(is, magic, sizeof(magic)) || std::memcmp(magic, GEOMETRY_CACHE_MAGIC, sizeof(magic)) != 0) {
+		r_error = "File '" + path + "' is not a geometry cache";
+		return false;
+	}
+
+	if (!read_binary(is, version) || version > GEOMETRY_CACHE_VERSION) {
+		r_error = "File '" + path + "' was written with a newer version of the geometry cache format";
+		return false;
+	}
+
+	if (!read_binary(is, num_prims)) {
+		r_error = "File '" + path + "' is corrupted";
+		return false;
+	}
+
+	/* The number of primitives is not trusted to reserve memory, as the file
+	 * may be corrupted. */
+	std::vector<std::unique_ptr<Primitive>> prims;
+
+	for (auto i = 0u; i < num_prims; ++i) {
+		std::unique_ptr<Primitive> prim(read_primitive(is, file, collection.factory()));
+
+		if (prim == nullptr) {
+			r_error = "File '" + path + "' is corrupted";
+			return false;
+		}
+
+		prims.push_back(std::move(prim));
+	}
+
+	for (auto &prim : prims) {
+		collection.add(prim.release());
+	}
+
+	return true;
+}
@@ -0,0 +1,103 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <kamikaze/attribute.h>
+#include <memory>
+#include <string>
+
+class EdgeList;
+class MappedFile;
+class PointList;
+class PolygonList;
+class Primitive;
+class PrimitiveCollection;
+
+/* Geometry cache files, storing the meshes, point clouds and segment
+ * primitives of a collection so that they can be read back without parsing.
+ *
+ * A file starts with a header: the magic bytes "KMKGEOMC", the version of the
+ * format and the number of primitives. Each primitive is stored as its factory
+ * key, its name and transformation, followed by chunks holding its points,
+ * polygons, edges and attributes. A chunk starts with its kind, the type of
+ * its values if it is an attribute, the number of values, and the sizes of its
+ * name and payload. The payload is aligned on 16 bytes from the start of the
+ * file, so that the values can be used where the file is mapped in memory.
+ * Readers skip the chunks of unknown kinds.
+ *
+ * As the values are stored as they are laid out in memory, files are only
+ * meant to be read on the platform they were written on. */
+
+/* Write the primitives of the collection to the given path, replacing the file
+ * only once it is entirely written. Primitives of other types than Mesh,
+ * PrimPoints and SegmentPrim are not written. Return false, and set r_error to
+ * the reason why, if the file could not be written. */
+bool write_geometry_cache(const PrimitiveCollection &collection, const std::string &path, std::string &r_error);
+
+/* Add the primitives of the cache file at the given path to the collection.
+ * The file is mapped in memory, and the points, polygons, edges and attributes
+ * of the primitives refer to the mapped pages until they are modified, so only
+ * the pages which are accessed are read from disk. Return false, and set
+ * r_error to the reason why, if the file could not be read, in which case the
+ * collection is left untouched. */
+bool read_geometry_cache(const std::string &path, PrimitiveCollection &collection, std::string &r_error);
+
+/* ******************** shared with the geometry archives ******************** */
+
+/* Return a path next to the given one to write a file to before renaming it,
+ * unique to the process and the call, so that concurrent writers of the same
+ * file do not write to the same temporary file. */
+std::string temporary_path(const std::string &path);
+
+/* Return the size of the values of an attribute of the given type, or 0 if the
+ * values do not have a fixed size. */
+size_t attribute_value_size(AttributeType type);
+
+/* Return the lists of the primitive, if it is a Mesh, PrimPoints or
+ * SegmentPrim, the lists it does not have being set to nullptr. */
+bool primitive_lists(const Primitive *prim, const PointList *&r_points,
+                     const PolygonList *&r_polys, const EdgeList *&r_edges);
+
+bool primitive_lists(Primitive *prim, PointList *&r_points,
+                     PolygonList *&r_polys, EdgeList *&r_edges);
+
+/* Return the values of an attribute as stored in the files, i.e. the strings
+ * one after the other, or the values as they are laid out in memory. */
+std::string string_attribute_payload(const Attribute &attribute);
+
+/* Return a pointer to the values at the given address of the mapped file, which
+ * keeps the file mapped for as long as it is owned. */
+template <typename T>
+std::shared_ptr<const T> mapped_values(const std::shared_ptr<const MappedFile> &file, const char *data)
+{
+	return std::shared_ptr<const T>(file, reinterpret_cast<const T *>(data));
+}
+
+/* Create an attribute from the size bytes of payload at the given address of
+ * the mapped file, which holds count values. The values are used in place,
+ * except for strings. Return nullptr if the size does not match. */
+Attribute *mapped_attribute(const std::string &name, AttributeType type, size_t count,
+                            const std::shared_ptr<const MappedFile> &file,
+                            const char *data, size_t size);
@@ -0,0 +1,564 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include "geometry_export.h"
+
+#include <kamikaze/geomlists.h>
+#include <kamikaze/primitive.h>
+#include <kamikaze/util_trace.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <experimental/filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "geometry_cache.h"
+
+namespace fs = std::experimental::filesystem;
+
+/* Size of the buffers in which the files are written before being given to the
+ * stream. */
+static constexpr size_t EXPORT_BUFFER_SIZE = 1024 * 1024;
+
+/* Number of errors kept until wait() is called. */
+static constexpr size_t EXPORT_MAX_ERRORS = 64;
+
+/* ********************************* writing ******************************** */
+
+/* The lists and attributes of a primitive to write. */
+struct ExportPrimitive {
+	const Primitive *prim = nullptr;
+	const PointList *points = nullptr;
+	const PolygonList *polys = nullptr;
+	const EdgeList *edges = nullptr;
+	const Attribute *normals = nullptr;
+	const Attribute *colors = nullptr;
+};
+
+static const Attribute *find_attribute(const Primitive *prim, const std::string &name, AttributeType type, size_t size)
+{
+	for (const auto &attribute : prim->attributes()) {
+		if (attribute->name() == name && attribute->type() == type && attribute->size() == size) {
+			return attribute;
+		}
+	}
+
+	return nullptr;
+}
+
+/* Return the primitives of the collection which can be exported. The normals
+ * and colors are only set if all the primitives have them. */
+static std::vector<ExportPrimitive> export_primitives(const PrimitiveCollection &collection)
+{
+	std::vector<ExportPrimitive> prims;
+	auto has_normals = true;
+	auto has_colors = true;
+
+	for (const auto &prim : collection.primitives()) {
+		ExportPrimitive export_prim;
+		export_prim.prim = prim;
+
+		if (!primitive_lists(prim, export_prim.points, export_prim.polys, export_prim.edges)) {
+			continue;
+		}
+
+		const auto num_points = export_prim.points->size();
+		export_prim.normals = find_attribute(prim, "normal", ATTR_TYPE_VEC3, num_points);
+		export_prim.colors = find_attribute(prim, "color", ATTR_TYPE_VEC3, num_points);
+
+		has_normals &= (export_prim.normals != nullptr);
+		has_colors &= (export_prim.colors != nullptr);
+
+		prims.push_back(export_prim);
+	}
+
+	for (auto &prim : prims) {
+		if (!has_normals) {
+			prim.normals = nullptr;
+		}
+
+		if (!has_colors) {
+			prim.colors = nullptr;
+		}
+	}
+
+	return prims;
+}
+
+/* Buffers the output to write it to the stream in large blocks. */
+class BufferedWriter {
+	std::ostream &m_os;
+	std::vector<char> m_buffer;
+	size_t m_size = 0;
+
+public:
+	explicit BufferedWriter(std::ostream &os)
+	    : m_os(os)
+	    , m_buffer(EXPORT_BUFFER_SIZE)
+	{}
+
+	~BufferedWriter()
+	{
+		flush();
+	}
+
+	void flush()
+	{
+		m_os.write(m_buffer.data(), m_size);
+		m_size = 0;
+	}
+
+	void write(const void *data, size_t size)
+	{
+		if (m_size + size > m_buffer.size()) {
+			flush();
+		}
+
+		if (size > m_buffer.size()) {
+			m_os.write(static_cast<const char *>(data), size);
+			return;
+		}
+
+		std::memcpy(m_buffer.data() + m_size, data, size);
+		m_size += size;
+	}
+
+	template <typename T>
+	void write(const T &value)
+	{
+		write(&value, sizeof(T));
+	}
+
+	void print(const char *format, ...)
+	{
+		/* Lines are short, a line not fitting in the end of the buffer is
+		 * printed again once the buffer is flushed. */
+		for (auto attempt = 0; attempt < 2; ++attempt) {
+			va_list args;
+			va_start(args, format);
+			const auto available = m_buffer.size() - m_size;
+			const auto size = std::vsnprintf(m_buffer.data() + m_size, available, format, args);
+			va_end(args);
+
+			if (size < 0) {
+				return;
+			}
+
+			if (static_cast<size_t>(size) < available) {
+				m_size += size;
+				return;
+			}
+
+			flush();
+		}
+	}
+};
+
+static bool is_identity(const glm::mat4 &matrix)
+{
+	return matrix == glm::mat4(1.0f);
+}
+
+static glm::vec3 transform_point(const glm::mat4 &matrix, const glm::vec3 &point)
+{
+	return glm::vec3(matrix * glm::vec4(point, 1.0f));
+}
+
+static glm::vec3 transform_normal(const glm::mat3 &matrix, const glm::vec3 &normal)
+{
+	const auto result = matrix * normal;
+	const auto length = glm::length(result);
+
+	return (length > 0.0f) ? result / length : result;
+}
+
+static unsigned char color_byte(float value)
+{
+	return static_cast<unsigned char>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+/* Write a binary PLY file, assuming the machine is little endian. */
+static void write_ply(std::ostream &os, const std::vector<ExportPrimitive> &prims)
+{
+	auto num_points = 0ul;
+	auto num_polys = 0ul;
+	auto num_edges = 0ul;
+
+	for (const auto &prim : prims) {
+		num_points += prim.points->size();
+		num_polys += (prim.polys != nullptr) ? prim.polys->size() : 0;
+		num_edges += (prim.edges != nullptr) ? prim.edges->size() : 0;
+	}
+
+	const auto has_normals = !prims.empty() && prims[0].normals != nullptr;
+	const auto has_colors = !prims.empty() && prims[0].colors != nullptr;
+
+	BufferedWriter writer(os);
+
+	writer.print("ply\nformat binary_little_endian 1.0\n");
+	writer.print("element vertex %zu\n", num_points);
+	writer.print("property float x\nproperty float y\nproperty float z\n");
+
+	if (has_normals) {
+		writer.print("property float nx\nproperty float ny\nproperty float nz\n");
+	}
+
+	if (has_colors) {
+		writer.print("property uchar red\nproperty uchar green\nproperty uchar blue\n");
+	}
+
+	if (num_polys != 0) {
+		writer.print("element face %zu\n", num_polys);
+		writer.print("property list uchar uint vertex_indices\n");
+	}
+
+	if (num_edges != 0) {
+		writer.print("element edge %zu\n", num_edges);
+		writer.print("property uint vertex1\nproperty uint vertex2\n");
+	}
+
+	writer.print("end_header\n");
+
+	for (const auto &prim : prims) {
+		const auto &matrix = prim.prim->matrix();
+		const auto identity = is_identity(matrix);
+		const auto normal_matrix = glm::transpose(glm::inverse(glm::mat3(matrix)));
+		const auto points = prim.points;
+
+		for (auto i = 0ul; i < points->size(); ++i) {
+			writer.write(identity ? (*points)[i] : transform_point(matrix, (*points)[i]));
+
+			if (has_normals) {
+				const auto &normal = prim.normals->vec3(i);
+				writer.write(identity ? normal : transform_normal(normal_matrix, normal));
+			}
+
+			if (has_colors) {
+				const auto &color = prim.colors->vec3(i);
+				const unsigned char bytes[3] = { color_byte(color.x), color_byte(color.y), color_byte(color.z) };
+				writer.write(bytes, sizeof(bytes));
+			}
+		}
+	}
+
+	auto offset = 0u;
+
+	for (const auto &prim : prims) {
+		if (prim.polys != nullptr) {
+			for (auto i = 0ul; i < prim.polys->size(); ++i) {
+				const auto &poly = (*prim.polys)[i];
+				const unsigned char count = (poly[3] == INVALID_INDEX) ? 3 : 4;
+
+				writer.write(count);
+
+				for (auto k = 0; k < count; ++k) {
+					writer.write(poly[k] + offset);
+				}
+			}
+		}
+
+		offset += static_cast<unsigned int>(prim.points->size());
+	}
+
+	offset = 0u;
+
+	for (const auto &prim : prims) {
+		if (prim.edges != nullptr) {
+			for (auto i = 0ul; i < prim.edges->size(); ++i) {
+				const auto &edge = (*prim.edges)[i];
+				writer.write(edge[0] + offset);
+				writer.write(edge[1] + offset);
+			}
+		}
+
+		offset += static_cast<unsigned int>(prim.points->size());
+	}
+}
+
+static void write_obj(std::ostream &os, const std::vector<ExportPrimitive> &prims)
+{
+	BufferedWriter writer(os);
+
+	/* Indices start at 1, and continue from one object to the next. */
+	auto offset = 1ul;
+
+	for (const auto &prim : prims) {
+		const auto &matrix = prim.prim->matrix();
+		const auto identity = is_identity(matrix);
+		const auto normal_matrix = glm::transpose(glm::inverse(glm::mat3(matrix)));
+		const auto points = prim.points;
+
+		writer.print("o %s\n", prim.prim->name().c_str());
+
+		for (auto i = 0ul; i < points->size(); ++i) {
+			const auto point = identity ? (*points)[i] : transform_point(matrix, (*points)[i]);
+
+			if (prim.colors != nullptr) {
+				const auto &color = prim.colors->vec3(i);
+				writer.print("v %.9g %.9g %.9g %.6g %.6g %.6g\n", point.x, point.y, point.z, color.x, color.y, color.z);
+			}
+			else {
+				writer.print("v %.9g %.9g %.9g\n", point.x, point.y, point.z);
+			}
+		}
+
+		if (prim.normals != nullptr) {
+			for (auto i = 0ul; i < points->size(); ++i) {
+				const auto &normal = prim.normals->vec3(i);
+				const auto n = identity ? normal : transform_normal(normal_matrix, normal);
+				writer.print("vn %.6g %.6g %.6g\n", n.x, n.y, n.z);
+			}
+		}
+
+		if (prim.polys != nullptr) {
+			for (auto i = 0ul; i < prim.polys->size(); ++i) {
+				const auto &poly = (*prim.polys)[i];
+				const auto count = (poly[3] == INVALID_INDEX) ? 3 : 4;
+
+				writer.print("f");
+
+				for (auto k = 0; k < count; ++k) {
+					const auto index = poly[k] + offset;
+
+					if (prim.normals != nullptr) {
+						writer.print(" %zu//%zu", index, index);
+					}
+					else {
+						writer.print(" %zu", index);
+					}
+				}
+
+				writer.print("\n");
+			}
+		}
+
+		if (prim.edges != nullptr) {
+			for (auto i = 0ul; i < prim.edges->size(); ++i) {
+				const auto &edge = (*prim.edges)[i];
+				writer.print("l %zu %zu\n", edge[0] + offset, edge[1] + offset);
+			}
+		}
+
+		offset += points->size();
+	}
+}
+
+/* Write the file next to the one it replaces, and rename it once it is entirely
+ * written, so that the file is never seen partially written. */
+template <typename WriteFunc>
+static bool write_file(const std::string &path, std::string &r_error, WriteFunc write)
+{
+	const auto temp_path = temporary_path(path);
+
+	std::ofstream os(temp_path, std::ios::binary);
+
+	if (!os.is_open()) {
+		r_error = "Cannot open file '" + temp_path + "' for writing";
+		return false;
+	}
+
+	write(os);
+	os.close();
+
+	if (!os) {
+		r_error = "Cannot write file '" + temp_path + "'";
+		std::remove(temp_path.c_str());
+		return false;
+	}
+
+	if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+		r_error = "Cannot replace file '" + path + "'";
+		std::remove(temp_path.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool export_geometry(const PrimitiveCollection &collection, const std::string &path, std::string &r_error)
+{
+	TRACE_SPAN("export_geometry");
+
+	auto extension = fs::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	if (extension == ".ply" || extension == ".obj") {
+		const auto prims = export_primitives(collection);
+
+		return write_file(path, r_error, [&](std::ostream &os)
+		{
+			if (extension == ".ply") {
+				write_ply(os, prims);
+			}
+			else {
+				write_obj(os, prims);
+			}
+		});
+	}
+
+	if (extension == ".kmkc") {
+		return write_file(path, r_error, [&](std::ostream &os)
+		{
+			collection.write(os);
+		});
+	}
+
+	return write_geometry_cache(collection, path, r_error);
+}
+
+/* ********************************** queue ********************************* */
+
+GeometryExportQueue::GeometryExportQueue(size_t capacity)
+    : m_capacity(std::max(capacity, size_t(1)))
+{
+	m_thread = std::thread([this]() { run(); });
+}
+
+GeometryExportQueue::~GeometryExportQueue()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+
+	m_job_added.notify_all();
+	m_thread.join();
+}
+
+void GeometryExportQueue::push(const PrimitiveCollection &collection, const std::string &path)
+{
+	TRACE_SPAN("GeometryExportQueue::push");
+
+	/* The copies share the lists of the primitives until either is modified. */
+	std::unique_ptr<PrimitiveCollection> snapshot(new PrimitiveCollection(collection.factory()));
+
+	for (const auto &prim : collection.primitives()) {
+		const PointList *points;
+		const PolygonList *polys;
+		const EdgeList *edges;
+
+		if (primitive_lists(prim, points, polys, edges)) {
+			snapshot->add(prim->copy());
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	for (auto &job : m_jobs) {
+		if (job.path == path) {
+			std::swap(job.collection, snapshot);
+			return;
+		}
+	}
+
+	m_job_done.wait(lock, [&]() { return m_jobs.size() < m_capacity; });
+
+	Job job;
+	job.path = path;
+	job.collection = std::move(snapshot);
+
+	m_jobs.push_back(std::move(job));
+	m_job_added.notify_one();
+}
+
+std::vector<std::string> GeometryExportQueue::wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_job_done.wait(lock, [&]() { return m_jobs.empty() && !m_writing; });
+
+	std::vector<std::string> errors;
+	std::swap(errors, m_errors);
+
+	return errors;
+}
+
+std::string GeometryExportQueue::take_error(const std::string &path)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	const auto iter = m_path_errors.find(path);
+
+	if (iter == m_path_errors.end()) {
+		return "";
+	}
+
+	const auto error = iter->second;
+	m_path_errors.erase(iter);
+
+	return error;
+}
+
+void GeometryExportQueue::run()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (true) {
+		m_job_added.wait(lock, [&]() { return m_stop || !m_jobs.empty(); });
+
+		/* The jobs still queued are written before stopping. */
+		if (m_jobs.empty()) {
+			return;
+		}
+
+		auto job = std::move(m_jobs.front());
+		m_jobs.pop_front();
+		m_writing = true;
+
+		/* A thread waiting to queue a job can do so now. */
+		m_job_done.notify_all();
+
+		lock.unlock();
+
+		std::string error;
+		const auto ok = export_geometry(*job.collection, job.path, error);
+		job.collection.reset();
+
+		lock.lock();
+
+		m_writing = false;
+
+		if (ok) {
+			m_path_errors.erase(job.path);
+		}
+		else {
+			if (m_errors.size() < EXPORT_MAX_ERRORS) {
+				m_errors.push_back(error);
+			}
+
+			m_path_errors[job.path] = error;
+		}
+
+		m_job_done.notify_all();
+	}
+}
+
+GeometryExportQueue &geometry_export_queue()
+{
+	static GeometryExportQueue queue;
+	return queue;
+}
@@ -0,0 +1,115 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class PrimitiveCollection;
+
+/* Export of the meshes, point clouds and segment primitives of a collection.
+ *
+ * The format is deduced from the extension of the path: ".ply" files are
+ * binary PLY files, ".obj" files OBJ files, ".kmkc" files the stream written
+ * by PrimitiveCollection::write(), and other files geometry caches (see
+ * geometry_cache.h).
+ *
+ * PLY and OBJ files hold a single mesh: the primitives are merged, with their
+ * transformation applied to their points, and their "normal" and "color"
+ * attributes are written if all the primitives have them. Segment primitives
+ * are written as PLY edges or OBJ lines. */
+
+/* Write the primitives of the collection to the given path, replacing the file
+ * only once it is entirely written. Return false, and set r_error to the reason
+ * why, if the file could not be written. */
+bool export_geometry(const PrimitiveCollection &collection, const std::string &path, std::string &r_error);
+
+/* Writes collections to files from a background thread, so that the threads
+ * evaluating the graphs do not wait for the disk.
+ *
+ * The collections queued are copies sharing the lists of the primitives with
+ * the originals, so queuing them is cheap, and the original collections can be
+ * modified right away, which gives the modified lists their own copy.
+ *
+ * At most a given number of collections wait to be written: queuing another
+ * one blocks until one is written, so that the pending copies cannot grow
+ * without bound when the evaluation is faster than the disk. A collection
+ * queued for a path which already has a collection waiting to be written
+ * replaces it instead. */
+class GeometryExportQueue {
+	struct Job {
+		std::string path;
+		std::unique_ptr<PrimitiveCollection> collection;
+	};
+
+	std::deque<Job> m_jobs{};
+	size_t m_capacity;
+	bool m_writing = false;
+	bool m_stop = false;
+
+	/* Errors of the writes since the last call to wait(), and of the last
+	 * write per path. */
+	std::vector<std::string> m_errors{};
+	std::unordered_map<std::string, std::string> m_path_errors{};
+
+	std::mutex m_mutex{};
+	std::condition_variable m_job_added{};
+	std::condition_variable m_job_done{};
+	std::thread m_thread{};
+
+public:
+	explicit GeometryExportQueue(size_t capacity = 4);
+
+	/* Write the collections still queued, and stop the thread. */
+	~GeometryExportQueue();
+
+	/* Disallow copy. */
+	GeometryExportQueue(const GeometryExportQueue &other) = delete;
+	GeometryExportQueue &operator=(const GeometryExportQueue &other) = delete;
+
+	/* Queue a copy of the primitives of the collection which can be exported,
+	 * to be written to the given path. */
+	void push(const PrimitiveCollection &collection, const std::string &path);
+
+	/* Wait for the collections queued to be written, and return the errors of
+	 * the writes since the last call. */
+	std::vector<std::string> wait();
+
+	/* Return the error of the last write to the given path, if it failed, and
+	 * forget it. */
+	std::string take_error(const std::string &path);
+
+private:
+	void run();
+};
+
+/* The queue shared by the export nodes and the batch tool. */
+GeometryExportQueue &geometry_export_queue();
@@ -0,0 +1,1442 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include "geometry_import.h"
+
+#include <kamikaze/mesh.h>
+#include <kamikaze/prim_points.h>
+#include <kamikaze/primitive.h>
+#include <kamikaze/util_parallel.h>
+#include <kamikaze/util_trace.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <experimental/filesystem>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <sstream>
+
+#include "mapped_file.h"
+
+namespace fs = std::experimental::filesystem;
+
+/* Size of the chunks of text parsed by a single task. */
+static constexpr size_t TEXT_CHUNK_SIZE = 1024 * 1024;
+
+/* Number of records of binary files parsed by a single task. */
+static constexpr size_t BINARY_CHUNK_RECORDS = 64 * 1024;
+
+/* Number of files whose primitives are kept around. */
+static constexpr size_t IMPORT_CACHE_SIZE = 4;
+
+/* ********************************** text ********************************** */
+
+static bool is_space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static void skip_spaces(const char *&p, const char *end)
+{
+	while (p < end && is_space(*p)) {
+		++p;
+	}
+}
+
+static const char *line_end(const char *p, const char *end)
+{
+	const auto newline = static_cast<const char *>(std::memchr(p, '\n', end - p));
+	return (newline != nullptr) ? newline : end;
+}
+
+static bool is_blank(const char *p, const char *end)
+{
+	skip_spaces(p, end);
+	return p == end;
+}
+
+/* Parse a decimal number. This is less exact than strtod() for numbers of more
+ * than 19 significant digits, which does not matter once stored as a float,
+ * but it does not need the text to be null terminated, and is a lot faster. */
+static bool parse_double(const char *&p, const char *end, double &r_value)
+{
+	static const double powers[] = {
+	    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+
+	skip_spaces(p, end);
+
+	const auto start = p;
+	auto negative = false;
+
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = (*p == '-');
+		++p;
+	}
+
+	uint64_t mantissa = 0;
+	auto digits = 0;
+	auto exponent = 0;
+	auto has_digits = false;
+
+	for (; p < end && is_digit(*p); ++p) {
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			digits += (mantissa != 0);
+		}
+		else {
+			++exponent;
+		}
+
+		has_digits = true;
+	}
+
+	if (p < end && *p == '.') {
+		for (++p; p < end && is_digit(*p); ++p) {
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += (mantissa != 0);
+				--exponent;
+			}
+
+			has_digits = true;
+		}
+	}
+
+	if (!has_digits) {
+		p = start;
+		return false;
+	}
+
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		const auto exponent_start = p++;
+		auto exponent_sign = 1;
+		auto value = 0;
+
+		if (p < end && (*p == '-' || *p == '+')) {
+			exponent_sign = (*p == '-') ? -1 : 1;
+			++p;
+		}
+
+		if (p == end || !is_digit(*p)) {
+			p = exponent_start;
+		}
+		else {
+			for (; p < end && is_digit(*p); ++p) {
+				value = std::min(value * 10 + (*p - '0'), 10000);
+			}
+
+			exponent += exponent_sign * value;
+		}
+	}
+
+	auto value = static_cast<double>(mantissa);
+
+	if (exponent < 0) {
+		value /= (exponent >= -22) ? powers[-exponent] : std::pow(10.0, -exponent);
+	}
+	else if (exponent > 0) {
+		value *= (exponent <= 22) ? powers[exponent] : std::pow(10.0, exponent);
+	}
+
+	r_value = negative ? -value : value;
+
+	return true;
+}
+
+static bool parse_long(const char *&p, const char *end, long &r_value)
+{
+	skip_spaces(p, end);
+
+	const auto start = p;
+	auto negative = false;
+
+	if (p < end && (*p == '-' || *p == '+')) {
+		negative = (*p == '-');
+		++p;
+	}
+
+	if (p == end || !is_digit(*p)) {
+		p = start;
+		return false;
+	}
+
+	/* Numbers of more digits than a long surely holds are rejected, rather
+	 * than overflowing. */
+	constexpr auto max_digits = std::numeric_limits<long>::digits10;
+	const auto digits_start = p;
+
+	long value = 0;
+
+	for (; p < end && is_digit(*p); ++p) {
+		if (p - digits_start == max_digits) {
+			p = start;
+			return false;
+		}
+
+		value = value * 10 + (*p - '0');
+	}
+
+	r_value = negative ? -value : value;
+
+	return true;
+}
+
+/* Split the text in chunks of about TEXT_CHUNK_SIZE bytes, each starting at the
+ * beginning of a line. Return the boundaries of the chunks. */
+static std::vector<const char *> split_lines(const char *begin, const char *end)
+{
+	std::vector<const char *> bounds = { begin };
+
+	while (static_cast<size_t>(end - bounds.back()) > TEXT_CHUNK_SIZE) {
+		const auto next = line_end(bounds.back() + TEXT_CHUNK_SIZE, end);
+
+		if (next == end) {
+			break;
+		}
+
+		bounds.push_back(next + 1);
+	}
+
+	bounds.push_back(end);
+
+	return bounds;
+}
+
+/* ******************************** polygons ******************************** */
+
+using PolygonChunks = std::vector<std::vector<glm::uvec4>>;
+
+/* Append the polygon to the list as a triangle or a quad, or as a fan of
+ * triangles if it has more vertices. */
+static void append_polygon(std::vector<glm::uvec4> &polys, const std::vector<unsigned int> &indices)
+{
+	const auto n = indices.size();
+
+	if (n == 3) {
+		polys.emplace_back(indices[0], indices[1], indices[2], INVALID_INDEX);
+	}
+	else if (n == 4) {
+		polys.emplace_back(indices[0], indices[1], indices[2], indices[3]);
+	}
+	else {
+		for (auto i = 2ul; i < n; ++i) {
+			polys.emplace_back(indices[0], indices[i - 1], indices[i], INVALID_INDEX);
+		}
+	}
+}
+
+/* Concatenate the polygons parsed by the tasks, each task copying its polygons
+ * after those of the tasks before it. Return false if an index is not the one
+ * of a point. */
+static bool gather_polygons(const PolygonChunks &chunks, size_t num_points, PolygonList &r_polys)
+{
+	std::vector<size_t> offsets(chunks.size() + 1, 0);
+
+	for (auto i = 0ul; i < chunks.size(); ++i) {
+		offsets[i + 1] = offsets[i] + chunks[i].size();
+	}
+
+	r_polys.resize(offsets.back());
+
+	if (offsets.back() == 0) {
+		return true;
+	}
+
+	const auto polys = &r_polys[0];
+	std::atomic<bool> valid(true);
+
+	parallel_for_heavy_items(tbb::blocked_range<size_t>(0, chunks.size()),
+	                         [&](const tbb::blocked_range<size_t> &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+			auto out = polys + offsets[i];
+
+			for (const auto &poly : chunks[i]) {
+				const auto last = (poly[3] == INVALID_INDEX) ? 3 : 4;
+
+				for (auto k = 0; k < last; ++k) {
+					if (poly[k] >= num_points) {
+						valid = false;
+					}
+				}
+
+				*out++ = poly;
+			}
+		}
+	});
+
+	return valid;
+}
+
+/* ***************************** primitives ********************************* */
+
+/* The lists and attributes filled by the tasks, allocated beforehand. */
+struct VertexTargets {
+	glm::vec3 *points = nullptr;
+	glm::vec3 *normals = nullptr;
+	glm::vec3 *colors = nullptr;
+	std::vector<float *> floats{};
+};
+
+static std::unique_ptr<Primitive> build_primitive(PrimitiveFactory *factory, bool is_mesh,
+                                                  const std::string &name, size_t num_points)
+{
+	std::unique_ptr<Primitive> prim((*factory)(is_mesh ? "Mesh" : "PrimPoints"));
+	prim->name(name);
+
+	auto points = is_mesh ? static_cast<Mesh *>(prim.get())->points()
+	                      : static_cast<PrimPoints *>(prim.get())->points();
+
+	points->resize(num_points);
+
+	return prim;
+}
+
+static glm::vec3 *point_data(Primitive *prim)
+{
+	auto points = (prim->typeID() == Mesh::id) ? static_cast<Mesh *>(prim)->points()
+	                                           : static_cast<PrimPoints *>(prim)->points();
+
+	return (points->size() != 0) ? &(*points)[0] : nullptr;
+}
+
+template <typename T>
+static T *attribute_data(Primitive *prim, const std::string &name, size_t size)
+{
+	auto attribute = prim->add_attribute(name, attribute_type_traits<T>::type, size);
+	attribute->resize(size);
+
+	return TypedAttribute<T>(attribute).begin();
+}
+
+/* *********************************** PLY ********************************** */
+
+enum PlyFormat {
+	PLY_ASCII,
+	PLY_BINARY_LITTLE_ENDIAN,
+	PLY_BINARY_BIG_ENDIAN,
+};
+
+enum PlyType {
+	PLY_INVALID,
+	PLY_INT8,
+	PLY_UINT8,
+	PLY_INT16,
+	PLY_UINT16,
+	PLY_INT32,
+	PLY_UINT32,
+	PLY_FLOAT32,
+	PLY_FLOAT64,
+};
+
+/* What a property of the vertices is imported as. */
+enum PlyRole {
+	ROLE_NONE,
+	ROLE_POSITION,
+	ROLE_NORMAL,
+	ROLE_COLOR,
+	ROLE_FLOAT,
+};
+
+struct PlyProperty {
+	std::string name = "";
+	PlyType type = PLY_INVALID;
+	/* Type of the number of values, if the property is a list. */
+	PlyType count_type = PLY_INVALID;
+
+	PlyRole role = ROLE_NONE;
+	/* Component of the vector, or index of the float attribute. */
+	int component = 0;
+	float scale = 1.0f;
+	size_t offset = 0;
+};
+
+struct PlyElement {
+	std::string name = "";
+	size_t count = 0;
+	std::vector<PlyProperty> properties{};
+
+	bool has_lists() const
+	{
+		return std::any_of(properties.begin(), properties.end(),
+		                   [](const PlyProperty &prop) { return prop.count_type != PLY_INVALID; });
+	}
+};
+
+static PlyType ply_type(const std::string &name)
+{
+	if (name == "char" || name == "int8") {
+		return PLY_INT8;
+	}
+
+	if (name == "uchar" || name == "uint8") {
+		return PLY_UINT8;
+	}
+
+	if (name == "short" || name == "int16") {
+		return PLY_INT16;
+	}
+
+	if (name == "ushort" || name == "uint16") {
+		return PLY_UINT16;
+	}
+
+	if (name == "int" || name == "int32") {
+		return PLY_INT32;
+	}
+
+	if (name == "uint" || name == "uint32") {
+		return PLY_UINT32;
+	}
+
+	if (name == "float" || name == "float32") {
+		return PLY_FLOAT32;
+	}
+
+	if (name == "double" || name == "float64") {
+		return PLY_FLOAT64;
+	}
+
+	return PLY_INVALID;
+}
+
+static size_t ply_type_size(PlyType type)
+{
+	switch (type) {
+		case PLY_INT8:
+		case PLY_UINT8:
+			return 1;
+		case PLY_INT16:
+		case PLY_UINT16:
+			return 2;
+		case PLY_INT32:
+		case PLY_UINT32:
+		case PLY_FLOAT32:
+			return 4;
+		case PLY_FLOAT64:
+			return 8;
+		case PLY_INVALID:
+			break;
+	}
+
+	return 0;
+}
+
+template <typename T>
+static T read_value(const char *p, bool swap)
+{
+	char bytes[sizeof(T)];
+	std::memcpy(bytes, p, sizeof(T));
+
+	if (swap) {
+		std::reverse(bytes, bytes + sizeof(T));
+	}
+
+	T value;
+	std::memcpy(&value, bytes, sizeof(T));
+
+	return value;
+}
+
+static double read_ply_value(const char *p, PlyType type, bool swap)
+{
+	switch (type) {
+		case PLY_INT8:
+			return read_value<int8_t>(p, swap);
+		case PLY_UINT8:
+			return read_value<uint8_t>(p, swap);
+		case PLY_INT16:
+			return read_value<int16_t>(p, swap);
+		case PLY_UINT16:
+			return read_value<uint16_t>(p, swap);
+		case PLY_INT32:
+			return read_value<int32_t>(p, swap);
+		case PLY_UINT32:
+			return read_value<uint32_t>(p, swap);
+		case PLY_FLOAT32:
+			return read_value<float>(p, swap);
+		case PLY_FLOAT64:
+			return read_value<double>(p, swap);
+		case PLY_INVALID:
+			break;
+	}
+
+	return 0.0;
+}
+
+/* Read the number of values of a list, return false if it is not a count, e.g.
+ * negative, as the type of the counts is given by the file. */
+static bool read_ply_count(const char *p, PlyType type, bool swap, size_t &r_count)
+{
+	const auto value = read_ply_value(p, type, swap);
+
+	if (!(value >= 0.0 && value <= static_cast<double>(std::numeric_limits<uint32_t>::max()))) {
+		return false;
+	}
+
+	r_count = static_cast<size_t>(value);
+
+	return true;
+}
+
+/* Read an index of a list, return false if it cannot be the one of a point,
+ * INVALID_INDEX marking the triangles. */
+static bool to_ply_index(double value, unsigned int &r_index)
+{
+	if (!(value >= 0.0 && value < static_cast<double>(INVALID_INDEX))) {
+		return false;
+	}
+
+	r_index = static_cast<unsigned int>(value);
+
+	return true;
+}
+
+/* Return the minimum size of a record of the element in the body of the file:
+ * a value and a line break in ASCII files, the values and the counts of the
+ * lists in binary files. */
+static size_t min_ply_record_size(const PlyElement &element, PlyFormat format)
+{
+	if (format == PLY_ASCII) {
+		return 2;
+	}
+
+	auto size = 0ul;
+
+	for (const auto &prop : element.properties) {
+		size += ply_type_size((prop.count_type != PLY_INVALID) ? prop.count_type : prop.type);
+	}
+
+	return std::max(size, 1ul);
+}
+
+static bool parse_ply_header(const char *data, size_t size, PlyFormat &r_format,
+                             std::vector<PlyElement> &r_elements, size_t &r_body_offset,
+                             std::string &r_error)
+{
+	const auto end = data + size;
+	auto has_format = false;
+
+	for (auto p = data; p < end;) {
+		const auto eol = line_end(p, end);
+		std::istringstream line(std::string(p, eol));
+		std::string keyword;
+
+		p = (eol < end) ? eol + 1 : end;
+		line >> keyword;
+
+		if (keyword == "ply" || keyword == "comment" || keyword == "obj_info" || keyword.empty()) {
+			continue;
+		}
+
+		if (keyword == "end_header") {
+			if (!has_format) {
+				r_error = "missing format";
+				return false;
+			}
+
+			r_body_offset = p - data;
+			return true;
+		}
+
+		if (keyword == "format") {
+			std::string format;
+			line >> format;
+
+			if (format == "ascii") {
+				r_format = PLY_ASCII;
+			}
+			else if (format == "binary_little_endian") {
+				r_format = PLY_BINARY_LITTLE_ENDIAN;
+			}
+			else if (format == "binary_big_endian") {
+				r_format = PLY_BINARY_BIG_ENDIAN;
+			}
+			else {
+				r_error = "unknown format '" + format + "'";
+				return false;
+			}
+
+			has_format = true;
+		}
+		else if (keyword == "element") {
+			PlyElement element;
+
+			if (!(line >> element.name >> element.count)) {
+				r_error = "invalid element";
+				return false;
+			}
+
+			r_elements.push_back(element);
+		}
+		else if (keyword == "property") {
+			PlyProperty prop;
+			std::string type;
+
+			if (r_elements.empty() || !(line >> type)) {
+				r_error = "invalid property";
+				return false;
+			}
+
+			if (type == "list") {
+				std::string count_type;
+				line >> count_type >> type;
+				prop.count_type = ply_type(count_type);
+
+				if (prop.count_type == PLY_INVALID || prop.count_type == PLY_FLOAT32 || prop.count_type == PLY_FLOAT64) {
+					r_error = "invalid list property";
+					return false;
+				}
+			}
+
+			prop.type = ply_type(type);
+
+			if (prop.type == PLY_INVALID || !(line >> prop.name)) {
+				r_error = "invalid property";
+				return false;
+			}
+
+			r_elements.back().properties.push_back(prop);
+		}
+		else {
+			r_error = "unknown keyword '" + keyword + "'";
+			return false;
+		}
+	}
+
+	r_error = "missing end_header";
+	return false;
+}
+
+/* Decide what the properties of the vertices are imported as, and compute their
+ * offsets in the records of binary files. */
+static void assign_vertex_roles(PlyElement &vertices, std::vector<std::string> &r_float_names)
+{
+	static const char *position_names[] = { "x", "y", "z" };
+	static const char *normal_names[] = { "nx", "ny", "nz" };
+	static const char *color_names[] = { "red", "green", "blue" };
+
+	auto offset = 0ul;
+
+	for (auto &prop : vertices.properties) {
+		prop.offset = offset;
+		offset += ply_type_size(prop.type);
+
+		for (auto i = 0; i < 3; ++i) {
+			if (prop.name == position_names[i]) {
+				prop.role = ROLE_POSITION;
+				prop.component = i;
+			}
+			else if (prop.name == normal_names[i]) {
+				prop.role = ROLE_NORMAL;
+				prop.component = i;
+			}
+			else if (prop.name == color_names[i]) {
+				prop.role = ROLE_COLOR;
+				prop.component = i;
+
+				if (prop.type == PLY_UINT8) {
+					prop.scale = 1.0f / 255.0f;
+				}
+				else if (prop.type == PLY_UINT16) {
+					prop.scale = 1.0f / 65535.0f;
+				}
+			}
+		}
+
+		if (prop.role == ROLE_NONE) {
+			prop.role = ROLE_FLOAT;
+			prop.component = static_cast<int>(r_float_names.size());
+			r_float_names.push_back(prop.name);
+		}
+	}
+}
+
+static void store_vertex_value(const VertexTargets &targets, const PlyProperty &prop, size_t index, double value)
+{
+	switch (prop.role) {
+		case ROLE_POSITION:
+			targets.points[index][prop.component] = static_cast<float>(value);
+			break;
+		case ROLE_NORMAL:
+			targets.normals[index][prop.component] = static_cast<float>(value);
+			break;
+		case ROLE_COLOR:
+			targets.colors[index][prop.component] = static_cast<float>(value) * prop.scale;
+			break;
+		case ROLE_FLOAT:
+			targets.floats[prop.component][index] = static_cast<float>(value);
+			break;
+		case ROLE_NONE:
+			break;
+	}
+}
+
+static bool is_face_indices(const PlyProperty &prop)
+{
+	return prop.count_type != PLY_INVALID && (prop.name == "vertex_indices" || prop.name == "vertex_index");
+}
+
+/* Return the size of the binary record at the given address, or 0 if it does
+ * not fit in the file. */
+static size_t ply_record_size(const char *p, const char *end, const PlyElement &element, bool swap)
+{
+	const auto start = p;
+
+	for (const auto &prop : element.properties) {
+		const auto value_size = ply_type_size(prop.type);
+
+		if (prop.count_type == PLY_INVALID) {
+			if (static_cast<size_t>(end - p) < value_size) {
+				return 0;
+			}
+
+			p += value_size;
+			continue;
+		}
+
+		const auto count_size = ply_type_size(prop.count_type);
+		size_t count;
+
+		if (static_cast<size_t>(end - p) < count_size || !read_ply_count(p, prop.count_type, swap, count)) {
+			return 0;
+		}
+
+		p += count_size;
+
+		if (value_size != 0 && count > static_cast<size_t>(end - p) / value_size) {
+			return 0;
+		}
+
+		p += count * value_size;
+	}
+
+	return static_cast<size_t>(p - start);
+}
+
+/* Locate the binary records of an element. Elements without lists have records
+ * of a fixed size, and so have most elements with lists, e.g. faces which are
+ * all triangles, which is checked in parallel. Otherwise the records have to be
+ * walked one after the other to find where they start. Set r_stride to the size
+ * of the records if it is fixed, or fill r_offsets with their offsets. Return
+ * the size of the element, or 0 if it does not fit in the file. */
+static size_t locate_ply_records(const char *data, const char *end, const PlyElement &element, bool swap,
+                                 size_t &r_stride, std::vector<size_t> &r_offsets)
+{
+	const auto available = static_cast<size_t>(end - data);
+
+	if (element.count == 0) {
+		r_stride = 0;
+		return 0;
+	}
+
+	if (!element.has_lists()) {
+		r_stride = 0;
+
+		for (const auto &prop : element.properties) {
+			r_stride += ply_type_size(prop.type);
+		}
+
+		if (r_stride != 0 && element.count > available / r_stride) {
+			return 0;
+		}
+
+		return r_stride * element.count;
+	}
+
+	r_stride = ply_record_size(data, end, element, swap);
+
+	if (r_stride == 0) {
+		return 0;
+	}
+
+	if (element.count <= available / r_stride) {
+		std::atomic<bool> fixed(true);
+
+		parallel_for_light_items(tbb::blocked_range<size_t>(0, element.count),
+		                         [&](const tbb::blocked_range<size_t> &r)
+		{
+			for (auto i = r.begin(), ie = r.end(); i < ie && fixed; ++i) {
+				if (ply_record_size(data + i * r_stride, end, element, swap) != r_stride) {
+					fixed = false;
+				}
+			}
+		});
+
+		if (fixed) {
+			return r_stride * element.count;
+		}
+	}
+
+	r_stride = 0;
+	r_offsets.resize(element.count + 1);
+	r_offsets[0] = 0;
+
+	for (auto i = 0ul; i < element.count; ++i) {
+		const auto size = ply_record_size(data + r_offsets[i], end, element, swap);
+
+		if (size == 0) {
+			return 0;
+		}
+
+		r_offsets[i + 1] = r_offsets[i] + size;
+	}
+
+	return r_offsets.back();
+}
+
+static bool parse_binary_ply(const char *data, const char *end, bool swap,
+                             const std::vector<PlyElement> &elements, size_t vertex_element,
+                             size_t face_element, const VertexTargets &targets,
+                             PolygonChunks &r_polys, std::string &r_error)
+{
+	auto p = data;
+
+	for (auto e = 0ul; e < elements.size(); ++e) {
+		const auto &element = elements[e];
+		std::vector<size_t> offsets;
+		size_t stride;
+
+		const auto size = locate_ply_records(p, end, element, swap, stride, offsets);
+
+		if (size == 0 && element.count != 0 && !element.properties.empty()) {
+			r_error = "element '" + element.name + "' is truncated";
+			return false;
+		}
+
+		if (e == vertex_element) {
+			parallel_for_light_items(tbb::blocked_range<size_t>(0, element.count),
+			                         [&](const tbb::blocked_range<size_t> &r)
+			{
+				for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+					const auto record = p + i * stride;
+
+					for (const auto &prop : element.properties) {
+						store_vertex_value(targets, prop, i, read_ply_value(record + prop.offset, prop.type, swap));
+					}
+				}
+			});
+		}
+		else if (e == face_element) {
+			const auto num_chunks = (element.count + BINARY_CHUNK_RECORDS - 1) / BINARY_CHUNK_RECORDS;
+			r_polys.resize(num_chunks);
+
+			std::atomic<bool> valid(true);
+
+			parallel_for_heavy_items(tbb::blocked_range<size_t>(0, num_chunks),
+			                         [&](const tbb::blocked_range<size_t> &r)
+			{
+				std::vector<unsigned int> indices;
+
+				for (auto c = r.begin(), ce = r.end(); c < ce; ++c) {
+					const auto first = c * BINARY_CHUNK_RECORDS;
+					const auto last = std::min(first + BINARY_CHUNK_RECORDS, element.count);
+					auto &polys = r_polys[c];
+
+					polys.reserve(last - first);
+
+					for (auto i = first; i < last; ++i) {
+						auto q = p + (offsets.empty() ? i * stride : offsets[i]);
+
+						for (const auto &prop : element.properties) {
+							const auto value_size = ply_type_size(prop.type);
+
+							if (prop.count_type == PLY_INVALID) {
+								q += value_size;
+								continue;
+							}
+
+							/* The counts were checked when locating the
+							 * records. */
+							size_t count = 0;
+							read_ply_count(q, prop.count_type, swap, count);
+							q += ply_type_size(prop.count_type);
+
+							if (is_face_indices(prop)) {
+								indices.resize(count);
+
+								for (auto k = 0ul; k < count; ++k) {
+									if (!to_ply_index(read_ply_value(q + k * value_size, prop.type, swap), indices[k])) {
+										valid = false;
+									}
+								}
+
+								append_polygon(polys, indices);
+							}
+
+							q += count * value_size;
+						}
+					}
+				}
+			});
+
+			if (!valid) {
+				r_error = "a face refers to a vertex which does not exist";
+				return false;
+			}
+		}
+
+		p += size;
+	}
+
+	return true;
+}
+
+static bool parse_ascii_ply(const char *data, const char *end,
+                            const std::vector<PlyElement> &elements, size_t vertex_element,
+                            size_t face_element, const VertexTargets &targets,
+                            PolygonChunks &r_polys, std::string &r_error)
+{
+	/* Each record is a line, the first pass counts the lines of the chunks, so
+	 * that the second one knows the record which each chunk starts with. */
+	const auto bounds = split_lines(data, end);
+	const auto num_chunks = bounds.size() - 1;
+
+	std::vector<size_t> first_rows(num_chunks + 1, 0);
+
+	parallel_for_heavy_items(tbb::blocked_range<size_t>(0, num_chunks),
+	                         [&](const tbb::blocked_range<size_t> &r)
+	{
+		for (auto c = r.begin(), ce = r.end(); c < ce; ++c) {
+			auto rows = 0ul;
+
+			for (auto p = bounds[c]; p < bounds[c + 1];) {
+				const auto eol = line_end(p, bounds[c + 1]);
+				rows += !is_blank(p, eol);
+				p = eol + 1;
+			}
+
+			first_rows[c + 1] = rows;
+		}
+	});
+
+	for (auto c = 0ul; c < num_chunks; ++c) {
+		first_rows[c + 1] += first_rows[c];
+	}
+
+	std::vector<size_t> element_rows(elements.size() + 1, 0);
+
+	for (auto e = 0ul; e < elements.size(); ++e) {
+		element_rows[e + 1] = element_rows[e] + elements[e].count;
+	}
+
+	if (first_rows.back() < element_rows.back()) {
+		r_error = "the file is truncated";
+		return false;
+	}
+
+	r_polys.resize(num_chunks);
+	std::atomic<size_t> invalid_row(std::numeric_limits<size_t>::max());
+
+	parallel_for_heavy_items(tbb::blocked_range<size_t>(0, num_chunks),
+	                         [&](const tbb::blocked_range<size_t> &r)
+	{
+		std::vector<unsigned int> indices;
+
+		for (auto c = r.begin(), ce = r.end(); c < ce; ++c) {
+			auto row = first_rows[c];
+			auto e = static_cast<size_t>(std::upper_bound(element_rows.begin(), element_rows.end(), row)
+			                             - element_rows.begin()) - 1;
+
+			for (auto p = bounds[c]; p < bounds[c + 1] && e < elements.size();) {
+				const auto eol = line_end(p, bounds[c + 1]);
+
+				if (is_blank(p, eol)) {
+					p = eol + 1;
+					continue;
+				}
+
+				while (e < elements.size() && row >= element_rows[e + 1]) {
+					++e;
+				}
+
+				if (e == elements.size()) {
+					break;
+				}
+
+				if (e != vertex_element && e != face_element) {
+					p = eol + 1;
+					++row;
+					continue;
+				}
+
+				const auto index = row - element_rows[e];
+				auto valid = true;
+				double value;
+
+				for (const auto &prop : elements[e].properties) {
+					if (prop.count_type == PLY_INVALID) {
+						valid = parse_double(p, eol, value);
+
+						if (valid && e == vertex_element) {
+							store_vertex_value(targets, prop, index, value);
+						}
+					}
+					else {
+						/* Each value takes at least a digit and a space, so
+						 * the count is checked against the rest of the line
+						 * before making room for the values. */
+						long count;
+						valid = parse_long(p, eol, count) && count >= 0 && count <= (eol - p + 1) / 2;
+						indices.resize(valid ? count : 0);
+
+						for (auto k = 0ul; valid && k < indices.size(); ++k) {
+							valid = parse_double(p, eol, value) && to_ply_index(value, indices[k]);
+						}
+
+						if (valid && e == face_element && is_face_indices(prop)) {
+							append_polygon(r_polys[c], indices);
+						}
+					}
+
+					if (!valid) {
+						break;
+					}
+				}
+
+				if (!valid) {
+					invalid_row = row;
+					break;
+				}
+
+				p = eol + 1;
+				++row;
+			}
+		}
+	});
+
+	if (invalid_row != std::numeric_limits<size_t>::max()) {
+		r_error = "invalid record on line " + std::to_string(invalid_row + 1) + " after the header";
+		return false;
+	}
+
+	return true;
+}
+
+static bool import_ply(const MappedFile &file, PrimitiveFactory *factory, const std::string &name,
+                       std::vector<std::unique_ptr<Primitive>> &r_prims, std::string &r_error)
+{
+	PlyFormat format;
+	std::vector<PlyElement> elements;
+	size_t body_offset;
+
+	if (file.size() < 4 || std::memcmp(file.data(), "ply", 3) != 0) {
+		r_error = "not a PLY file";
+		return false;
+	}
+
+	if (!parse_ply_header(file.data(), file.size(), format, elements, body_offset, r_error)) {
+		return false;
+	}
+
+	/* The counts are checked against the size of the body before making room
+	 * for the records, as the file may be corrupted. The last line of ASCII
+	 * files may not end with a line break. */
+	const auto body_size = file.size() - body_offset + (format == PLY_ASCII);
+
+	for (const auto &element : elements) {
+		if (element.count > body_size / min_ply_record_size(element, format)) {
+			r_error = "the element '" + element.name + "' has more records than the file holds";
+			return false;
+		}
+	}
+
+	auto vertex_element = elements.size();
+	auto face_element = elements.size();
+
+	for (auto e = 0ul; e < elements.size(); ++e) {
+		if (elements[e].name == "vertex") {
+			vertex_element = e;
+		}
+		else if (elements[e].name == "face") {
+			face_element = e;
+		}
+	}
+
+	if (vertex_element == elements.size()) {
+		r_error = "no vertex element";
+		return false;
+	}
+
+	auto &vertices = elements[vertex_element];
+
+	if (vertices.has_lists()) {
+		r_error = "list properties of vertices are not supported";
+		return false;
+	}
+
+	std::vector<std::string> float_names;
+	assign_vertex_roles(vertices, float_names);
+
+	const auto has_role = [&](PlyRole role)
+	{
+		return std::any_of(vertices.properties.begin(), vertices.properties.end(),
+		                   [&](const PlyProperty &prop) { return prop.role == role; });
+	};
+
+	const auto is_mesh = (face_element != elements.size() && elements[face_element].count != 0);
+	const auto num_points = vertices.count;
+
+	auto prim = build_primitive(factory, is_mesh, name, num_points);
+
+	VertexTargets targets;
+	targets.points = point_data(prim.get());
+
+	if (has_role(ROLE_NORMAL)) {
+		targets.normals = attribute_data<glm::vec3>(prim.get(), "normal", num_points);
+	}
+
+	if (has_role(ROLE_COLOR)) {
+		targets.colors = attribute_data<glm::vec3>(prim.get(), "color", num_points);
+	}
+
+	for (const auto &float_name : float_names) {
+		targets.floats.push_back(attribute_data<float>(prim.get(), float_name, num_points));
+	}
+
+	PolygonChunks polys;
+	const auto body = file.data() + body_offset;
+	const auto end = file.data() + file.size();
+	bool ok;
+
+	if (format == PLY_ASCII) {
+		ok = parse_ascii_ply(body, end, elements, vertex_element, face_element, targets, polys, r_error);
+	}
+	else {
+		/* Files are assumed to be read on little endian machines. */
+		const auto swap = (format == PLY_BINARY_BIG_ENDIAN);
+		ok = parse_binary_ply(body, end, swap, elements, vertex_element, face_element, targets, polys, r_error);
+	}
+
+	if (!ok) {
+		return false;
+	}
+
+	if (is_mesh && !gather_polygons(polys, num_points, *static_cast<Mesh *>(prim.get())->polys())) {
+		r_error = "a face refers to a vertex which does not exist";
+		return false;
+	}
+
+	r_prims.push_back(std::move(prim));
+
+	return true;
+}
+
+/* *********************************** OBJ ********************************** */
+
+static bool is_vertex_line(const char *p, const char *end)
+{
+	skip_spaces(p, end);
+	return (end - p) >= 2 && p[0] == 'v' && is_space(p[1]);
+}
+
+static bool import_obj(const MappedFile &file, PrimitiveFactory *factory, const std::string &name,
+                       std::vector<std::unique_ptr<Primitive>> &r_prims, std::string &r_error)
+{
+	const auto bounds = split_lines(file.data(), file.data() + file.size());
+	const auto num_chunks = bounds.size() - 1;
+
+	/* Faces refer to vertices by their index in the file, or relatively to the
+	 * last vertex defined, so the first pass counts the vertices of the chunks
+	 * to know the index of the first vertex of each chunk. */
+	std::vector<size_t> first_vertices(num_chunks + 1, 0);
+
+	parallel_for_heavy_items(tbb::blocked_range<size_t>(0, num_chunks),
+	                         [&](const tbb::blocked_range<size_t> &r)
+	{
+		for (auto c = r.begin(), ce = r.end(); c < ce; ++c) {
+			auto count = 0ul;
+
+			for (auto p = bounds[c]; p < bounds[c + 1];) {
+				const auto eol = line_end(p, bounds[c + 1]);
+				count += is_vertex_line(p, eol);
+				p = eol + 1;
+			}
+
+			first_vertices[c + 1] = count;
+		}
+	});
+
+	for (auto c = 0ul; c < num_chunks; ++c) {
+		first_vertices[c + 1] += first_vertices[c];
+	}
+
+	const auto num_points = first_vertices.back();
+	std::vector<glm::vec3> colors(num_points, glm::vec3(1.0f));
+	std::atomic<bool> has_colors(false);
+	std::atomic<bool> valid_file(true);
+
+	/* The mesh is only known once the faces are parsed, so the points are
+	 * parsed in a list which is then given to the primitive. */
+	PointList points;
+	points.resize(num_points);
+
+	const auto positions = (num_points != 0) ? &points[0] : nullptr;
+
+	PolygonChunks polys(num_chunks);
+
+	parallel_for_heavy_items(tbb::blocked_range<size_t>(0, num_chunks),
+	                         [&](const tbb::blocked_range<size_t> &r)
+	{
+		std::vector<unsigned int> indices;
+
+		for (auto c = r.begin(), ce = r.end(); c < ce; ++c) {
+			auto vertex = first_vertices[c];
+
+			for (auto p = bounds[c]; p < bounds[c + 1];) {
+				const auto eol = line_end(p, bounds[c + 1]);
+				auto valid = true;
+
+				skip_spaces(p, eol);
+
+				if (is_vertex_line(p, eol)) {
+					double values[6];
+					auto count = 0;
+
+					p += 2;
+
+					while (count < 6 && parse_double(p, eol, values[count])) {
+						++count;
+					}
+
+					valid = (count >= 3);
+
+					if (valid) {
+						positions[vertex] = glm::vec3(values[0], values[1], values[2]);
+
+						if (count == 6) {
+							colors[vertex] = glm::vec3(values[3], values[4], values[5]);
+							has_colors = true;
+						}
+					}
+
+					++vertex;
+				}
+				else if ((eol - p) >= 2 && p[0] == 'f' && is_space(p[1])) {
+					long index;
+
+					p += 2;
+					indices.clear();
+
+					while (parse_long(p, eol, index)) {
+						/* Skip the indices of the texture coordinates and normals. */
+						while (p < eol && !is_space(*p)) {
+							++p;
+						}
+
+						/* Negative indices are relative to the last vertex. */
+						const auto resolved = (index > 0) ? index - 1 : static_cast<long>(vertex) + index;
+
+						if (index == 0 || resolved < 0 || resolved >= static_cast<long>(INVALID_INDEX)) {
+							valid = false;
+							break;
+						}
+
+						indices.push_back(static_cast<unsigned int>(resolved));
+					}
+
+					valid = valid && indices.size() >= 3;
+
+					if (valid) {
+						append_polygon(polys[c], indices);
+					}
+				}
+
+				if (!valid) {
+					valid_file = false;
+					break;
+				}
+
+				p = eol + 1;
+			}
+		}
+	});
+
+	if (!valid_file) {
+		r_error = "invalid vertex or face";
+		return false;
+	}
+
+	const auto is_mesh = std::any_of(polys.begin(), polys.end(),
+	                                 [](const std::vector<glm::uvec4> &chunk) { return !chunk.empty(); });
+
+	auto prim = build_primitive(factory, is_mesh, name, 0);
+
+	if (is_mesh) {
+		auto mesh = static_cast<Mesh *>(prim.get());
+		*mesh->points() = points;
+
+		if (!gather_polygons(polys, num_points, *mesh->polys())) {
+			r_error = "a face refers to a vertex which does not exist";
+			return false;
+		}
+	}
+	else {
+		*static_cast<PrimPoints *>(prim.get())->points() = points;
+	}
+
+	if (has_colors) {
+		std::copy(colors.begin(), colors.end(), attribute_data<glm::vec3>(prim.get(), "color", num_points));
+	}
+
+	r_prims.push_back(std::move(prim));
+
+	return true;
+}
+
+/* ********************************** cache ********************************* */
+
+struct ImportedFile {
+	std::string path = "";
+	fs::file_time_type time{};
+	uintmax_t size = 0;
+	std::vector<std::unique_ptr<Primitive>> prims{};
+};
+
+/* The files imported last, the most recent first. The primitives share their
+ * lists with the copies given to the collections until either is modified. */
+static std::list<ImportedFile> import_cache;
+static std::mutex import_cache_mutex;
+
+static bool find_imported(const std::string &path, fs::file_time_type time, uintmax_t size,
+                          std::vector<std::unique_ptr<Primitive>> &r_prims)
+{
+	std::unique_lock<std::mutex> lock(import_cache_mutex);
+
+	for (auto iter = import_cache.begin(); iter != import_cache.end(); ++iter) {
+		if (iter->path != path) {
+			continue;
+		}
+
+		if (iter->time != time || iter->size != size) {
+			import_cache.erase(iter);
+			return false;
+		}
+
+		import_cache.splice(import_cache.begin(), import_cache, iter);
+
+		for (const auto &prim : iter->prims) {
+			r_prims.emplace_back(prim->copy());
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+static void add_imported(const std::string &path, fs::file_time_type time, uintmax_t size,
+                         const std::vector<std::unique_ptr<Primitive>> &prims)
+{
+	ImportedFile imported;
+	imported.path = path;
+	imported.time = time;
+	imported.size = size;
+
+	for (const auto &prim : prims) {
+		imported.prims.emplace_back(prim->copy());
+	}
+
+	std::unique_lock<std::mutex> lock(import_cache_mutex);
+
+	import_cache.remove_if([&](const ImportedFile &file) { return file.path == path; });
+	import_cache.push_front(std::move(imported));
+
+	if (import_cache.size() > IMPORT_CACHE_SIZE) {
+		import_cache.pop_back();
+	}
+}
+
+void clear_geometry_import_cache()
+{
+	std::unique_lock<std::mutex> lock(import_cache_mutex);
+	import_cache.clear();
+}
+
+/* ********************************* import ********************************* */
+
+bool import_geometry(const std::string &path, PrimitiveCollection &collection, std::string &r_error)
+{
+	TRACE_SPAN("import_geometry");
+
+	std::error_code ec;
+	const auto time = fs::last_write_time(path, ec);
+	const auto size = ec ? 0 : fs::file_size(path, ec);
+
+	if (ec) {
+		r_error = "Cannot open file '" + path + "'";
+		return false;
+	}
+
+	std::vector<std::unique_ptr<Primitive>> prims;
+
+	if (!find_imported(path, time, size, prims)) {
+		auto extension = fs::path(path).extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+		if (extension != ".ply" && extension != ".obj") {
+			r_error = "Cannot import file '" + path + "': unknown extension '" + extension + "'";
+			return false;
+		}
+
+		MappedFile file;
+
+		if (!file.open(path)) {
+			r_error = "Cannot open file '" + path + "'";
+			return false;
+		}
+
+		const auto name = fs::path(path).stem().string();
+		const auto factory = collection.factory();
+		std::string error;
+
+		const auto ok = (extension == ".ply") ? import_ply(file, factory, name, prims, error)
+		                                      : import_obj(file, factory, name, prims, error);
+
+		if (!ok) {
+			r_error = "Cannot import file '" + path + "': " + error;
+			return false;
+		}
+
+		add_imported(path, time, size, prims);
+	}
+
+	for (auto &prim : prims) {
+		prim->tagUpdate();
+		collection.add(prim.release());
+	}
+
+	return true;
+}
@@ -0,0 +1,57 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <string>
+
+class PrimitiveCollection;
+
+/* Import of the geometry of PLY and OBJ files.
+ *
+ * PLY files, whether ASCII or binary, give a Mesh if they have faces and a
+ * PrimPoints otherwise. The x, y and z properties of the vertices are their
+ * positions, nx, ny and nz their "normal" attribute, and red, green and blue
+ * their "color" attribute, the other scalar properties becoming float
+ * attributes of the same name.
+ *
+ * OBJ files give a single Mesh, or a PrimPoints if they have no faces, with a
+ * "color" attribute if the vertices have colors ("v x y z r g b"). Texture
+ * coordinates and normals are given per face corner in OBJ files, which the
+ * primitives cannot store, so they are ignored and the normals recomputed.
+ *
+ * Polygons of more than four vertices are split in fans of triangles.
+ *
+ * The file is mapped in memory and parsed in chunks by several threads. The
+ * primitives parsed are cached per path, and reused as long as the file is
+ * not modified. */
+
+/* Add the primitives imported from the PLY or OBJ file at the given path to the
+ * collection, the format being deduced from the extension of the path. Return
+ * false, and set r_error to the reason why, if the file could not be imported,
+ * in which case the collection is left untouched. */
+bool import_geometry(const std::string &path, PrimitiveCollection &collection, std::string &r_error);
+
+/* Release the primitives cached for the files imported. */
+void clear_geometry_import_cache();
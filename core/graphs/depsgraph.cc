@@ -25,12 +25,20 @@
 #include "depsgraph.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <unordered_set>
 
 #include <kamikaze/context.h>
 #include <kamikaze/nodes.h>
+#include <kamikaze/util_cancel.h>
+#include <kamikaze/util_parallel.h>
+#include <kamikaze/util_trace.h>
 
+#include <tbb/combinable.h>
 #include <tbb/tick_count.h>
 
 #include "graph_dumper.h"
@@ -84,12 +92,38 @@ void DepsObjectNode::pre_process()
 	m_object->collection(nullptr);
 }
 
-void DepsObjectNode::process(const Context & /*context*/, TaskNotifier */*notifier*/)
+/* Prepare the render data of the primitives before the viewer can see them, so
+ * that it only has to upload it. */
+static void pack_render_data(PrimitiveCollection *collection)
 {
+	if (collection == nullptr) {
+		return;
+	}
+
+	TRACE_SPAN("pack_render_data");
+
+	const auto &primitives = collection->primitives();
+
+	parallel_for_heavy_items(tbb::blocked_range<size_t>(0, primitives.size()),
+	                         [&](const tbb::blocked_range<size_t> &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie ; ++i) {
+			primitives[i]->packRenderData();
+		}
+	});
+}
+
+void DepsObjectNode::process(const Context & /*context*/, TaskNotifier */*notifier*/, const CancellationToken */*token*/)
+{
+	TRACE_SPAN("DepsObjectNode::process");
+
 	/* The graph should already have been updated. */
-	auto graph = m_object->graph();
-	auto output_node = graph->output();
-	m_object->collection(output_node->collection());
+	m_object->collection(m_object->graph()->result());
+}
+
+void DepsObjectNode::publish()
+{
+	m_object->publishCollection();
 }
 
 Object *DepsObjectNode::object()
@@ -109,85 +143,317 @@ const char *DepsObjectNode::name() const
 
 /* ************************************************************************** */
 
-ObjectGraphDepsNode::ObjectGraphDepsNode(Graph *graph)
+ObjectGraphDepsNode::ObjectGraphDepsNode(Graph *graph, FrameCache *frame_cache)
     : m_graph(graph)
+    , m_frame_cache(frame_cache)
 {}
 
-void ObjectGraphDepsNode::pre_process()
+/* Nodes which are not flagged as thread safe are never processed at the same
+ * time, be they part of the same graph or not. */
+static std::mutex unsafe_node_mutex;
+
+/* Process a single node of an object graph, record its measurements in the
+ * profiler, and return the time it took. */
+static float process_node(const Context &context, Node *node, NodeProfiler *profiler, const CancellationToken *token)
 {
-	m_graph->clear_cache();
+	const auto start = tbb::tick_count::now();
+
+	node->clear_copy_time();
+
+	PrimitiveCollection *collection = nullptr;
+
+	if (node->inputs().empty()) {
+		collection = new PrimitiveCollection(context.primitive_factory);
+	}
+	else {
+		collection = node->getInputCollection(0ul);
+	}
+
+	node->collection(collection);
+
+	/* Make sure warnings are cleared before processing. */
+	node->clear_warnings();
+
+	auto delta = 0.0f;
+
+	/* Time spent waiting for other nodes, not part of the cost of the node. */
+	auto wait_time = 0.0f;
+
+	if (node->collection()) {
+		std::unique_lock<std::mutex> lock(unsafe_node_mutex, std::defer_lock);
+
+		if (!node->thread_safe()) {
+			const auto wait_start = tbb::tick_count::now();
+			lock.lock();
+			wait_time = (tbb::tick_count::now() - wait_start).seconds();
+		}
+
+		node->cancellation_token(token);
+		node->frame(context.eval_ctx->frame);
+
+		auto t0 = tbb::tick_count::now();
+
+		try {
+			TRACE_SPAN(trace_intern(node->name()));
+			node->process();
+		}
+		catch (const std::exception &e) {
+			node->add_warning(e.what());
+		}
+
+		auto t1 = tbb::tick_count::now();
+
+		node->cancellation_token(nullptr);
+
+		delta = (t1 - t0).seconds();
+
+		node->process_time(delta);
+	}
+
+	if (!node->outputs().empty()) {
+		node->setOutputCollection(0ul, node->collection());
+	}
+
+	/* The node may have returned early, leaving its collection incomplete:
+	 * drop it, and tag the node so that the next evaluation processes it. The
+	 * collection is freed with the cache of the node. */
+	if (token != nullptr && token->cancelled()) {
+		node->tag_update();
+		node->collection(nullptr);
+
+		for (OutputSocket *output : node->outputs()) {
+			output->collection = nullptr;
+		}
+	}
+
+	NodeProfileSample sample;
+	sample.wall_time = std::max((tbb::tick_count::now() - start).seconds() - wait_time, 0.0);
+	sample.copy_time = node->copy_time();
+	sample.self_time = std::max(sample.wall_time - sample.copy_time, 0.0f);
+
+	if (node->collection()) {
+		for (const auto &prim : node->collection()->primitives()) {
+			sample.points += prim->pointCount();
+
+			/* Only count the buffers created or modified by the node, those
+			 * still shared with its inputs are owned upstream. Nodes passing
+			 * their input through own nothing. */
+			if (node->modifies_input()) {
+				sample.bytes += prim->ownedMemoryUsage();
+			}
+		}
+
+		sample.primitives = node->collection()->primitives().size();
+	}
+
+	profiler->record(node, sample);
+
+	return delta;
 }
 
-void ObjectGraphDepsNode::process(const Context &context, TaskNotifier *notifier)
+static inline auto get_parents(Node *node)
 {
+	std::vector<Node *> parents;
+
+	for (InputSocket *input : node->inputs()) {
+		if (input->link) {
+			parents.push_back(input->link->parent);
+		}
+	}
+
+	return parents;
+}
+
+static inline auto get_children(Node *node)
+{
+	std::vector<Node *> children;
+
+	for (OutputSocket *output : node->outputs()) {
+		for (InputSocket *input : output->links) {
+			children.push_back(input->parent);
+		}
+	}
+
+	return children;
+}
+
+void ObjectGraphDepsNode::process(const Context &context, TaskNotifier *notifier, const CancellationToken *token)
+{
+	TRACE_SPAN("ObjectGraphDepsNode::process");
+
 	auto output_node = m_graph->output();
 
 	if (!output_node->isLinked()) {
-		output_node->input(0)->collection = nullptr;
+		m_graph->clear_cache(output_node);
+		output_node->collection(nullptr);
+		m_graph->result(nullptr);
+		return;
+	}
+
+	/* The result of the graph may be displayed while the graph is evaluated
+	 * again, so it is shared with the objects, and never modified once it was
+	 * produced: its render data is packed here, and not when the object is
+	 * processed. */
+	if (!time_dependent()) {
+		evaluate_graph(context, notifier, token);
+
+		if (token != nullptr && token->cancelled()) {
+			return;
+		}
+
+		auto collection = m_graph->share_collection(output_node);
+
+		if (collection != m_graph->result()) {
+			pack_render_data(collection.get());
+			m_graph->result(collection);
+		}
 
-		/* Make sure the node's collection is updated, otherwise can crash. */
-		output_node->process();
 		return;
 	}
 
-	m_graph->build();
+	/* The collections of the graphs depending on time are cached per frame, so
+	 * that revisiting a frame does not require processing the graph again. */
+	const auto key = frame_key(context.eval_ctx->frame);
+	auto collection = m_frame_cache->find(key);
 
-	/* XXX */
-	for (const auto &node : m_graph->nodes()) {
-		for (OutputSocket *output : node->outputs()) {
-			output->collection = nullptr;
+	if (collection == nullptr) {
+		evaluate_graph(context, notifier, token);
+
+		if (token != nullptr && token->cancelled()) {
+			return;
+		}
+
+		/* Publish the cached copy, so that the collection shown by the object
+		 * does not depend on the state of the graph, which may be evaluated
+		 * for other frames during playback. */
+		if (output_node->collection() != nullptr) {
+			auto copy = output_node->collection()->copy();
+			pack_render_data(copy);
+
+			collection = m_frame_cache->add(key, copy);
 		}
 	}
 
-	auto stack = m_graph->finished_stack();
+	m_graph->result(collection);
+}
 
-	const auto size = static_cast<float>(stack.size());
-	auto index = 0;
+void ObjectGraphDepsNode::prefetch(const Context &context, const CancellationToken *token)
+{
+	TRACE_SPAN("ObjectGraphDepsNode::prefetch");
 
-	if (notifier) {
-		notifier->signalProgressUpdate(0.0f);
+	auto output_node = m_graph->output();
+
+	if (!output_node->isLinked()) {
+		return;
 	}
 
-	auto total_process_time = 0.0f;
+	const auto key = frame_key(context.eval_ctx->frame);
+
+	/* Collections written to disk are read back here rather than when the
+	 * frame is published from the thread of the user interface. */
+	if (m_frame_cache->load(key)) {
+		return;
+	}
+
+	evaluate_graph(context, nullptr, token);
 
-	for (auto iter = stack.rbegin(); iter != stack.rend(); ++iter) {
+	if (token->cancelled() || output_node->collection() == nullptr) {
+		return;
+	}
+
+	auto collection = output_node->collection()->copy();
+	pack_render_data(collection);
+
+	m_frame_cache->add(key, collection);
+}
+
+FrameCacheKey ObjectGraphDepsNode::frame_key(int frame) const
+{
+	FrameCacheKey key;
+	key.graph = m_graph;
+	key.frame = frame;
+	key.graph_version = m_graph->version();
+	key.props_hash = m_graph->props_hash();
+
+	return key;
+}
+
+void ObjectGraphDepsNode::evaluate_graph(const Context &context, TaskNotifier *notifier, const CancellationToken *token)
+{
+	auto output_node = m_graph->output();
+
+	/* The nodes depending on time only hold the results for the frame they
+	 * were last evaluated for. */
+	if (time_dependent() && context.eval_ctx->frame != m_evaluated_frame) {
+		m_graph->tag_time_update();
+		m_evaluated_frame = context.eval_ctx->frame;
+	}
+
+	m_graph->build();
+
+	/* Gather the nodes which need to be processed again: those whose
+	 * properties or inputs changed, and all the nodes downstream of them. The
+	 * other nodes keep the collection they output during the last evaluation. */
+	const auto &finished_stack = m_graph->finished_stack();
+	std::unordered_set<Node *> dirty_nodes;
+	auto cache_hits = 0;
+
+	for (auto iter = finished_stack.rbegin(); iter != finished_stack.rend(); ++iter) {
 		Node *node = *iter;
-		PrimitiveCollection *collection = nullptr;
+		auto need_update = node->need_update();
 
-		if (node->inputs().empty()) {
-			collection = new PrimitiveCollection(context.primitive_factory);
+		for (InputSocket *input : node->inputs()) {
+			if (input->link && dirty_nodes.count(input->link->parent) != 0) {
+				need_update = true;
+				break;
+			}
+		}
+
+		if (need_update) {
+			dirty_nodes.insert(node);
 		}
 		else {
-			collection = node->getInputCollection(0ul);
+			++cache_hits;
+			m_graph->profiler()->record_cache_hit(node);
 		}
+	}
 
-		node->collection(collection);
+	std::vector<Node *> stack;
+	stack.reserve(dirty_nodes.size());
 
-		/* Make sure warnings are cleared before processing. */
-		node->clear_warnings();
+	for (Node *node : finished_stack) {
+		if (dirty_nodes.count(node) == 0) {
+			continue;
+		}
 
-		if (node->collection()) {
-			auto t0 = tbb::tick_count::now();
+		node->clear_update();
 
-			try {
-				node->process();
-			}
-			catch (const std::exception &e) {
-				node->add_warning(e.what());
-			}
+		/* Free the collections from the last evaluation. */
+		m_graph->clear_cache(node);
+
+		for (OutputSocket *output : node->outputs()) {
+			output->collection = nullptr;
+		}
 
-			auto t1 = tbb::tick_count::now();
+		stack.push_back(node);
+	}
 
-			auto delta = (t1 - t0).seconds();
-			total_process_time += delta;
+	m_graph->cache_stats(cache_hits, stack.size());
 
-			node->process_time(delta);
-		}
+#ifdef DEBUG_DEPSGRAPH
+	std::cerr << "Graph cache hits: " << cache_hits
+	          << ", misses: " << stack.size() << '\n';
+#endif
 
-		if (!node->outputs().empty()) {
-			node->setOutputCollection(0ul, node->collection());
-		}
+	const auto size = static_cast<float>(stack.size());
+	std::atomic<int> index(0);
+
+	if (notifier) {
+		notifier->signalProgressUpdate(0.0f);
+	}
 
+	auto node_processed = [&](Node *node)
+	{
 		if (notifier) {
 			const float progress = (++index / size) * 100.0f;
 			notifier->signalProgressUpdate(progress);
@@ -197,11 +463,68 @@ void ObjectGraphDepsNode::process(const Context &context, TaskNotifier *notifier
 				notifier->signalNodeProcessed();
 			}
 		}
+	};
+
+	/* Once the evaluation is cancelled the remaining nodes are not processed,
+	 * but tagged so that the next evaluation processes them. */
+	auto skip_node = [&](Node *node)
+	{
+		if (token == nullptr || !token->cancelled()) {
+			return false;
+		}
+
+		node->tag_update();
+		node->collection(nullptr);
+
+		return true;
+	};
+
+	auto total_process_time = 0.0f;
+
+	if (context.eval_ctx->threaded_evaluation) {
+		/* Independent branches of the graph are processed concurrently, and
+		 * only joined where an input needs their result. */
+		tbb::combinable<float> process_times([]() { return 0.0f; });
+
+		parallel_process(stack, [&](Node *node)
+		{
+			if (skip_node(node)) {
+				return;
+			}
+
+			process_times.local() += process_node(context, node, m_graph->profiler(), token);
+			node_processed(node);
+		});
+
+		total_process_time = process_times.combine(std::plus<float>());
+	}
+	else {
+		for (auto iter = stack.rbegin(); iter != stack.rend(); ++iter) {
+			Node *node = *iter;
+
+			if (skip_node(node)) {
+				continue;
+			}
+
+			total_process_time += process_node(context, node, m_graph->profiler(), token);
+			node_processed(node);
+		}
 	}
 
 	output_node->process_time(total_process_time);
 }
 
+bool ObjectGraphDepsNode::time_dependent() const
+{
+	for (DepsOutputSocket *output : input()->links) {
+		if (dynamic_cast<TimeDepsNode *>(output->parent) != nullptr) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 Graph *ObjectGraphDepsNode::graph()
 {
 	return m_graph;
@@ -219,7 +542,7 @@ const char *ObjectGraphDepsNode::name() const
 
 /* ************************************************************************** */
 
-void TimeDepsNode::process(const Context & /*context*/, TaskNotifier */*notifier*/)
+void TimeDepsNode::process(const Context & /*context*/, TaskNotifier */*notifier*/, const CancellationToken */*token*/)
 {
 	/* Pass. */
 }
@@ -231,27 +554,46 @@ const char *TimeDepsNode::name() const
 
 /* ************************************************************************** */
 
+/* Evaluations are run with their own copy of the evaluation context, set for
+ * the frame to evaluate. */
+static Context frame_context(const Context &context, EvaluationContext &eval_ctx, int frame)
+{
+	eval_ctx = *context.eval_ctx;
+	eval_ctx.frame = frame;
+
+	auto result = context;
+	result.eval_ctx = &eval_ctx;
+
+	return result;
+}
+
 /* Evaluate depsgraph in another thread. */
 
 class GraphEvalTask : public Task {
 	Depsgraph *m_graph;
 	DepsNode *m_root;
+	std::shared_ptr<CancellationToken> m_token;
+
+	EvaluationContext m_eval_ctx;
+	Context m_frame_context;
 
 public:
-	GraphEvalTask(Depsgraph *graph, const Context &context, DepsNode *root);
+	GraphEvalTask(Depsgraph *graph, const Context &context, DepsNode *root, std::shared_ptr<CancellationToken> token);
 
 	void start(const Context &context) override;
 };
 
-GraphEvalTask::GraphEvalTask(Depsgraph *graph, const Context &context, DepsNode *root)
+GraphEvalTask::GraphEvalTask(Depsgraph *graph, const Context &context, DepsNode *root, std::shared_ptr<CancellationToken> token)
     : Task(context)
     , m_graph(graph)
     , m_root(root)
+    , m_token(std::move(token))
+    , m_frame_context(frame_context(context, m_eval_ctx, context.scene->currentFrame()))
 {}
 
-void GraphEvalTask::start(const Context &context)
+void GraphEvalTask::start(const Context &/*context*/)
 {
-	m_graph->evaluate_ex(context, m_root, m_notifier.get());
+	m_graph->evaluate_ex(m_frame_context, m_root, DEG_STATE_OBJECT, m_notifier.get(), m_token.get());
 }
 
 /* ************************************************************************** */
@@ -337,7 +679,7 @@ void Depsgraph::create_node(SceneNode *scene_node)
 
 	m_scene_node_map[scene_node] = node;
 
-	m_nodes.push_back(std::unique_ptr<DepsNode>(new ObjectGraphDepsNode(object->graph())));
+	m_nodes.push_back(std::unique_ptr<DepsNode>(new ObjectGraphDepsNode(object->graph(), &m_frame_cache)));
 	auto graph_node = m_nodes.back().get();
 
 	m_object_graph_map[object->graph()] = graph_node;
@@ -353,6 +695,8 @@ void Depsgraph::remove_node(SceneNode *scene_node)
 	/* First, remove graph node. */
 	{
 		auto object = static_cast<Object *>(scene_node);
+		m_frame_cache.remove(object->graph());
+
 		auto iter = m_object_graph_map.find(object->graph());
 		assert(iter != m_object_graph_map.end());
 
@@ -365,9 +709,13 @@ void Depsgraph::remove_node(SceneNode *scene_node)
 		});
 		assert(node_iter != m_nodes.end());
 
-		/* Disconnect input. */
-		for (DepsOutputSocket *output : node->input()->links) {
-			disconnect(output, node->input());
+		/* Disconnect input, which may be linked to the time node. */
+		{
+			std::unique_lock<std::mutex> lock(m_time_links_mutex);
+
+			for (DepsOutputSocket *output : node->input()->links) {
+				disconnect(output, node->input());
+			}
 		}
 
 		/* Disconnect output. */
@@ -410,35 +758,214 @@ void Depsgraph::remove_node(SceneNode *scene_node)
 	m_need_update = true;
 }
 
-void Depsgraph::connect_to_time(SceneNode *scene_node)
+void Depsgraph::update_time_links()
 {
-	auto node = find_node(scene_node, true);
-	connect(m_time_node->output(), node->input());
+	std::unique_lock<std::mutex> lock(m_time_links_mutex);
+
+	for (const auto &pair : m_object_graph_map) {
+		auto graph_node = static_cast<ObjectGraphDepsNode *>(pair.second);
+
+		if (pair.first->time_dependent() == graph_node->time_dependent()) {
+			continue;
+		}
+
+		if (graph_node->time_dependent()) {
+			disconnect(m_time_node->output(), graph_node->input());
+		}
+		else {
+			connect(m_time_node->output(), graph_node->input());
+		}
+	}
+}
+
+std::vector<ObjectGraphDepsNode *> Depsgraph::time_dependent_graphs() const
+{
+	std::unique_lock<std::mutex> lock(m_time_links_mutex);
+
+	std::vector<ObjectGraphDepsNode *> graph_nodes;
+	graph_nodes.reserve(m_time_node->output()->links.size());
+
+	for (const DepsInputSocket *input : m_time_node->output()->links) {
+		graph_nodes.push_back(static_cast<ObjectGraphDepsNode *>(input->parent));
+	}
+
+	return graph_nodes;
 }
 
 void Depsgraph::evaluate(const Context &context, SceneNode *scene_node)
 {
 	auto node = find_node(scene_node, true);
 
-	m_need_update |= (m_state != DEG_STATE_OBJECT);
-	m_state = DEG_STATE_OBJECT;
-
-	GraphEvalTask *t = new(tbb::task::allocate_root()) GraphEvalTask(this, context, node);
+	GraphEvalTask *t = new(tbb::task::allocate_root()) GraphEvalTask(this, context, node, new_token(node));
 	tbb::task::enqueue(*t);
 }
 
+static void gather_nodes(std::vector<DepsNode *> &nodes, DepsNode *root);
+
+size_t Depsgraph::evaluate(const Context &context, const std::vector<SceneNode *> &scene_nodes)
+{
+	/* The evaluation of an object also processes everything downstream of it,
+	 * so only the objects which are not downstream of another one are used as
+	 * roots. */
+	std::unordered_set<DepsNode *> downstream;
+
+	for (SceneNode *scene_node : scene_nodes) {
+		std::vector<DepsNode *> branch;
+		gather_nodes(branch, find_node(scene_node, true));
+
+		downstream.insert(branch.begin() + 1, branch.end());
+	}
+
+	auto num_evaluations = 0ul;
+
+	for (SceneNode *scene_node : scene_nodes) {
+		if (downstream.count(find_node(scene_node, true)) != 0) {
+			continue;
+		}
+
+		evaluate(context, scene_node);
+		++num_evaluations;
+	}
+
+	return num_evaluations;
+}
+
 void Depsgraph::evaluate_for_time_change(const Context &context)
 {
-	m_need_update |= (m_state != DEG_STATE_TIME);
-	m_state = DEG_STATE_TIME;
+	/* The graphs depending on time are entirely processed again, as they were
+	 * last evaluated for another frame, see ObjectGraphDepsNode. */
+	EvaluationContext eval_ctx;
+	auto time_context = frame_context(context, eval_ctx, context.scene->currentFrame());
+
+	evaluate_ex(time_context, m_time_node, DEG_STATE_TIME, nullptr, new_token(m_time_node).get());
+}
+
+void Depsgraph::evaluate_frame(const Context &context, int frame)
+{
+	EvaluationContext eval_ctx;
+	auto scene_context = frame_context(context, eval_ctx, frame);
 
-	evaluate_ex(context, m_time_node, nullptr);
+	/* A null root sorts the whole graph, see build(). */
+	evaluate_ex(scene_context, nullptr, DEG_STATE_SCENE, nullptr, new_token(nullptr).get());
 }
 
-void Depsgraph::evaluate_ex(const Context &context, DepsNode *root, TaskNotifier *notifier)
+void Depsgraph::prefetch_frame(const Context &context, int frame, const CancellationToken *token)
 {
-	if (m_need_update) {
+	EvaluationContext eval_ctx;
+	auto prefetch_context = frame_context(context, eval_ctx, frame);
+
+	std::unique_lock<std::mutex> lock(m_eval_mutex);
+
+	for (ObjectGraphDepsNode *graph_node : time_dependent_graphs()) {
+		if (token->cancelled()) {
+			return;
+		}
+
+		graph_node->prefetch(prefetch_context, token);
+	}
+}
+
+bool Depsgraph::frame_cached(int frame) const
+{
+	for (const ObjectGraphDepsNode *graph_node : time_dependent_graphs()) {
+		if (!m_frame_cache.resident(graph_node->frame_key(frame))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool Depsgraph::publish_cached_frame(const Context &context, int frame)
+{
+	std::vector<FrameCacheKey> keys;
+	std::vector<Object *> objects;
+
+	for (ObjectGraphDepsNode *graph_node : time_dependent_graphs()) {
+		for (DepsInputSocket *object_input : graph_node->output()->links) {
+			auto object_node = static_cast<DepsObjectNode *>(object_input->parent);
+
+			keys.push_back(graph_node->frame_key(frame));
+			objects.push_back(object_node->object());
+		}
+	}
+
+	const auto collections = m_frame_cache.find_resident(keys);
+
+	if (collections.size() != keys.size()) {
+		return false;
+	}
+
+	for (auto i = 0ul; i < objects.size(); ++i) {
+		objects[i]->publishCollection(collections[i]);
+	}
+
+	context.scene->notify_listeners(static_cast<event_type>(-1));
+
+	return true;
+}
+
+std::shared_ptr<CancellationToken> Depsgraph::new_token(DepsNode *root)
+{
+	auto token = std::make_shared<CancellationToken>();
+
+	std::unique_lock<std::mutex> lock(m_tokens_mutex);
+
+	auto &current_token = m_tokens[root];
+
+	if (current_token != nullptr) {
+		current_token->cancel();
+	}
+
+	current_token = token;
+
+	return token;
+}
+
+static inline auto get_parents(DepsNode *node)
+{
+	std::vector<DepsNode *> parents;
+
+	for (DepsOutputSocket *output : node->input()->links) {
+		parents.push_back(output->parent);
+	}
+
+	return parents;
+}
+
+static inline auto get_children(DepsNode *node)
+{
+	std::vector<DepsNode *> children;
+
+	for (DepsInputSocket *input : node->output()->links) {
+		children.push_back(input->parent);
+	}
+
+	return children;
+}
+
+void Depsgraph::evaluate_ex(const Context &context, DepsNode *root, int state, TaskNotifier *notifier, const CancellationToken *token)
+{
+	TRACE_SPAN("Depsgraph::evaluate");
+
+	std::unique_lock<std::mutex> lock(m_eval_mutex);
+
+	/* A newer evaluation was requested while this one was waiting. */
+	if (token->cancelled()) {
+		return;
+	}
+
+	/* The properties of the nodes may have changed whether their graph
+	 * depends on time. */
+	update_time_links();
+
+	/* The stack only holds the nodes reachable from the root it was built
+	 * for, e.g. a single object for the evaluations requested by the user
+	 * interface, which may run concurrently with the other kinds. */
+	if (m_need_update || root != m_stack_root || state != m_stack_state) {
 		build(root);
+		m_stack_root = root;
+		m_stack_state = state;
 		m_need_update = false;
 	}
 
@@ -452,9 +979,37 @@ void Depsgraph::evaluate_ex(const Context &context, DepsNode *root, TaskNotifier
 		node->pre_process();
 	}
 
-	for (auto iter = m_stack.rbegin(); iter != m_stack.rend(); ++iter) {
-		DepsNode *node = *iter;
-		node->process(context, notifier);
+	if (context.eval_ctx->threaded_evaluation) {
+		/* Nodes whose dependencies are satisfied are processed concurrently,
+		 * an object is still only processed after its graph. */
+		parallel_process(m_stack, [&](DepsNode *node)
+		{
+			if (!token->cancelled()) {
+				node->process(context, notifier, token);
+			}
+		});
+	}
+	else {
+		for (auto iter = m_stack.rbegin(); iter != m_stack.rend(); ++iter) {
+			DepsNode *node = *iter;
+
+			if (token->cancelled()) {
+				break;
+			}
+
+			node->process(context, notifier, token);
+		}
+	}
+
+	/* The evaluation superseding this one will publish its results and notify
+	 * the listeners, until then the viewer keeps displaying the results of the
+	 * last complete evaluation. */
+	if (token->cancelled()) {
+		return;
+	}
+
+	for (DepsNode *node : m_stack) {
+		node->publish();
 	}
 
 	context.scene->notify_listeners(static_cast<event_type>(-1));
@@ -465,6 +1020,11 @@ const std::vector<std::unique_ptr<DepsNode>> &Depsgraph::nodes() const
 	return m_nodes;
 }
 
+FrameCache *Depsgraph::frame_cache()
+{
+	return &m_frame_cache;
+}
+
 static void gather_nodes(std::vector<DepsNode *> &nodes, DepsNode *root)
 {
 	if (!root) {
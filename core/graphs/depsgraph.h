@@ -25,9 +25,13 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
+#include "frame_cache.h"
+
+class CancellationToken;
 class DepsNode;
 class Context;
 class EvaluationContext;
@@ -66,7 +70,11 @@ public:
 
 	virtual ~DepsNode() = default;
 	virtual void pre_process() {}
-	virtual void process(const Context &context, TaskNotifier *notifier) = 0;
+	virtual void process(const Context &context, TaskNotifier *notifier, const CancellationToken *token) = 0;
+
+	/* Make the results of the node visible, called once all the nodes of an
+	 * evaluation were processed without it being cancelled. */
+	virtual void publish() {}
 
 	DepsInputSocket *input();
 	const DepsInputSocket *input() const;
@@ -90,7 +98,8 @@ public:
 	~DepsObjectNode() = default;
 
 	void pre_process() override;
-	void process(const Context &context, TaskNotifier *notifier) override;
+	void process(const Context &context, TaskNotifier *notifier, const CancellationToken *token) override;
+	void publish() override;
 
 	Object *object();
 	const Object *object() const;
@@ -102,20 +111,34 @@ public:
 
 class ObjectGraphDepsNode : public DepsNode {
 	Graph *m_graph;
+	FrameCache *m_frame_cache;
+
+	/* The frame for which the nodes of the graph were last evaluated. */
+	int m_evaluated_frame = 0;
 
 public:
 	ObjectGraphDepsNode() = delete;
-	explicit ObjectGraphDepsNode(Graph *graph);
+	ObjectGraphDepsNode(Graph *graph, FrameCache *frame_cache);
 
 	~ObjectGraphDepsNode() = default;
 
-	void pre_process() override;
-	void process(const Context &context, TaskNotifier *notifier) override;
+	void process(const Context &context, TaskNotifier *notifier, const CancellationToken *token) override;
+
+	/* Evaluate the graph for the frame of the context and store the result in
+	 * the frame cache, without making it the result of the graph. */
+	void prefetch(const Context &context, const CancellationToken *token);
+
+	FrameCacheKey frame_key(int frame) const;
 
 	Graph *graph();
 	const Graph *graph() const;
 
 	const char *name() const override;
+
+	bool time_dependent() const;
+
+private:
+	void evaluate_graph(const Context &context, TaskNotifier *notifier, const CancellationToken *token);
 };
 
 /* ************************************************************************** */
@@ -125,7 +148,7 @@ public:
 	TimeDepsNode() = default;
 	~TimeDepsNode() = default;
 
-	void process(const Context &context, TaskNotifier *notifier) override;
+	void process(const Context &context, TaskNotifier *notifier, const CancellationToken *token) override;
 
 	const char *name() const override;
 };
@@ -136,6 +159,7 @@ enum {
 	DEG_STATE_NONE   = -1,
 	DEG_STATE_OBJECT = 0,
 	DEG_STATE_TIME   = 1,
+	DEG_STATE_SCENE  = 2,
 };
 
 class Depsgraph {
@@ -144,11 +168,27 @@ class Depsgraph {
 	std::unordered_map<SceneNode *, DepsNode *> m_scene_node_map;
 	std::unordered_map<const Graph *, DepsNode *> m_object_graph_map;
 
-	int m_state = DEG_STATE_NONE;
+	/* The root and the kind of evaluation the stack was built for, the stack
+	 * is built again when either of them changes. Only accessed with the
+	 * evaluation mutex locked, see evaluate_ex(). */
+	DepsNode *m_stack_root = nullptr;
+	int m_stack_state = DEG_STATE_NONE;
 	bool m_need_update = false;
 
 	DepsNode *m_time_node = nullptr;
 
+	FrameCache m_frame_cache{};
+
+	/* Evaluations are run one at a time, a new request for a given root node
+	 * cancelling the evaluation previously requested for it. */
+	std::mutex m_eval_mutex;
+	std::mutex m_tokens_mutex;
+	std::unordered_map<DepsNode *, std::shared_ptr<CancellationToken>> m_tokens;
+
+	/* Guards the links of the time node, which are updated by the evaluations
+	 * and read from the thread of the user interface during playback. */
+	mutable std::mutex m_time_links_mutex;
+
 	friend class GraphEvalTask;
 
 public:
@@ -168,16 +208,47 @@ public:
 	void create_node(SceneNode *scene_node);
 	void remove_node(SceneNode *scene_node);
 
-	void connect_to_time(SceneNode *scene_node);
-
 	void evaluate(const Context &context, SceneNode *scene_node);
+
+	/* Evaluate the given objects, those depending on another one of them are
+	 * evaluated along with it. Return the number of evaluations started. */
+	size_t evaluate(const Context &context, const std::vector<SceneNode *> &scene_nodes);
+
 	void evaluate_for_time_change(const Context &context);
 
+	/* Evaluate all the objects for the given frame, and wait for the evaluation
+	 * to finish. Meant for evaluating scenes without user interface. */
+	void evaluate_frame(const Context &context, int frame);
+
+	/* Evaluate the objects depending on time for the given frame, only storing
+	 * the result in the frame cache, or read their collections back into memory
+	 * if they were written to disk. Meant to be called from a worker thread. */
+	void prefetch_frame(const Context &context, int frame, const CancellationToken *token);
+
+	/* Return whether the objects depending on time are cached in memory for
+	 * the frame. */
+	bool frame_cached(int frame) const;
+
+	/* Make the cached collections of the given frame the collections of the
+	 * objects depending on time, return false if any of them is not cached in
+	 * memory. Never reads from disk, see prefetch_frame(). */
+	bool publish_cached_frame(const Context &context, int frame);
+
 	const std::vector<std::unique_ptr<DepsNode> > &nodes() const;
 
+	FrameCache *frame_cache();
+
 private:
 	void build(DepsNode *root);
 
-	void evaluate_ex(const Context &context, DepsNode *root, TaskNotifier *notifier);
+	/* Connect the graphs having nodes depending on time to the time node, and
+	 * disconnect the other ones. */
+	void update_time_links();
+
+	/* Return the graphs currently connected to the time node. */
+	std::vector<ObjectGraphDepsNode *> time_dependent_graphs() const;
+
+	void evaluate_ex(const Context &context, DepsNode *root, int state, TaskNotifier *notifier, const CancellationToken *token);
+	std::shared_ptr<CancellationToken> new_token(DepsNode *root);
 	DepsNode *find_node(SceneNode *scene_node, bool graph);
 };
@@ -0,0 +1,351 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include "frame_cache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+
+static inline void hash_combine(size_t &seed, size_t value)
+{
+	seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+bool FrameCacheKey::operator==(const FrameCacheKey &other) const
+{
+	return graph == other.graph
+	        && frame == other.frame
+	        && graph_version == other.graph_version
+	        && props_hash == other.props_hash;
+}
+
+size_t FrameCacheKeyHash::operator()(const FrameCacheKey &key) const
+{
+	auto seed = std::hash<const Graph *>()(key.graph);
+	hash_combine(seed, std::hash<int>()(key.frame));
+	hash_combine(seed, key.graph_version);
+	hash_combine(seed, key.props_hash);
+
+	return seed;
+}
+
+/* ************************************************************************** */
+
+FrameCache::~FrameCache()
+{
+	clear();
+}
+
+PrimitiveCollectionPtr FrameCache::find(const FrameCacheKey &key)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	auto collection = lookup(key);
+
+	if (collection == nullptr) {
+		++m_misses;
+		return nullptr;
+	}
+
+	++m_hits;
+
+	/* Reading from disk may have exceeded the budget. */
+	evict();
+
+	return collection;
+}
+
+std::vector<PrimitiveCollectionPtr> FrameCache::find_resident(const std::vector<FrameCacheKey> &keys)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	std::vector<PrimitiveCollectionPtr> collections;
+	collections.reserve(keys.size());
+
+	for (const auto &key : keys) {
+		auto iter = m_entry_map.find(key);
+
+		if (iter == m_entry_map.end()) {
+			++m_misses;
+			return {};
+		}
+
+		collections.push_back(iter->second->collection);
+	}
+
+	/* Mark the collections as the most recently used once they are all
+	 * found. */
+	for (const auto &key : keys) {
+		auto iter = m_entry_map.find(key);
+		m_entries.splice(m_entries.begin(), m_entries, iter->second);
+	}
+
+	m_hits += keys.size();
+
+	return collections;
+}
+
+bool FrameCache::contains(const FrameCacheKey &key) const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	return (m_entry_map.find(key) != m_entry_map.end())
+	        || (m_spilled.find(key) != m_spilled.end());
+}
+
+bool FrameCache::resident(const FrameCacheKey &key) const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	return m_entry_map.find(key) != m_entry_map.end();
+}
+
+bool FrameCache::load(const FrameCacheKey &key)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if (m_entry_map.find(key) != m_entry_map.end()) {
+		return true;
+	}
+
+	/* Hold the collection while evicting so that it is not released again
+	 * right away. */
+	auto collection = read_spilled(key);
+
+	if (collection == nullptr) {
+		return false;
+	}
+
+	evict();
+
+	return true;
+}
+
+PrimitiveCollectionPtr FrameCache::add(const FrameCacheKey &key, PrimitiveCollection *collection)
+{
+	if (collection == nullptr) {
+		return nullptr;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	auto iter = m_entry_map.find(key);
+
+	if (iter != m_entry_map.end()) {
+		delete collection;
+		return iter->second->collection;
+	}
+
+	m_factory = collection->factory();
+
+	auto result = PrimitiveCollectionPtr(collection);
+	insert(key, result);
+
+	evict();
+
+	return result;
+}
+
+void FrameCache::remove(const Graph *graph)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	for (auto iter = m_entries.begin(); iter != m_entries.end();) {
+		if (iter->key.graph != graph) {
+			++iter;
+			continue;
+		}
+
+		m_memory_usage -= iter->size;
+		m_entry_map.erase(iter->key);
+		iter = m_entries.erase(iter);
+	}
+
+	for (auto iter = m_spilled.begin(); iter != m_spilled.end();) {
+		if (iter->first.graph != graph) {
+			++iter;
+			continue;
+		}
+
+		std::remove(iter->second.c_str());
+		iter = m_spilled.erase(iter);
+	}
+}
+
+void FrameCache::clear()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	for (const auto &spilled : m_spilled) {
+		std::remove(spilled.second.c_str());
+	}
+
+	m_entries.clear();
+	m_entry_map.clear();
+	m_spilled.clear();
+	m_memory_usage = 0;
+}
+
+void FrameCache::budget(size_t bytes)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_budget = bytes;
+	evict();
+}
+
+size_t FrameCache::budget() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_budget;
+}
+
+void FrameCache::spill_directory(const std::string &path)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_spill_directory = path;
+}
+
+const std::string &FrameCache::spill_directory() const
+{
+	return m_spill_directory;
+}
+
+size_t FrameCache::memory_usage() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_memory_usage;
+}
+
+size_t FrameCache::hits() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_hits;
+}
+
+size_t FrameCache::misses() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_misses;
+}
+
+/* Return the collection for the given key, reading it from disk if needed, and
+ * mark it as the most recently used. */
+PrimitiveCollectionPtr FrameCache::lookup(const FrameCacheKey &key)
+{
+	auto iter = m_entry_map.find(key);
+
+	if (iter == m_entry_map.end()) {
+		return read_spilled(key);
+	}
+
+	m_entries.splice(m_entries.begin(), m_entries, iter->second);
+
+	return iter->second->collection;
+}
+
+void FrameCache::insert(const FrameCacheKey &key, PrimitiveCollectionPtr collection)
+{
+	Entry entry;
+	entry.key = key;
+	entry.size = collection->memoryUsage();
+	entry.collection = std::move(collection);
+
+	m_memory_usage += entry.size;
+
+	m_entries.push_front(std::move(entry));
+	m_entry_map[key] = m_entries.begin();
+}
+
+void FrameCache::evict()
+{
+	auto iter = m_entries.end();
+
+	while (m_memory_usage > m_budget && iter != m_entries.begin()) {
+		--iter;
+
+		/* Only the cache can hand out new references to the collection, so
+		 * a single owner means that it is not in use. */
+		if (iter->collection.use_count() > 1) {
+			continue;
+		}
+
+		/* Entries read back from disk are still there. */
+		if (!m_spill_directory.empty() && m_spilled.find(iter->key) == m_spilled.end()) {
+			const auto path = spill_path(iter->key);
+
+			std::ofstream os(path, std::ios::binary);
+			iter->collection->write(os);
+			os.close();
+
+			if (os.good()) {
+				m_spilled[iter->key] = path;
+			}
+			else {
+				std::remove(path.c_str());
+			}
+		}
+
+		m_memory_usage -= iter->size;
+		m_entry_map.erase(iter->key);
+		iter = m_entries.erase(iter);
+	}
+}
+
+PrimitiveCollectionPtr FrameCache::read_spilled(const FrameCacheKey &key)
+{
+	auto iter = m_spilled.find(key);
+
+	if (iter == m_spilled.end()) {
+		return nullptr;
+	}
+
+	auto collection = std::make_shared<PrimitiveCollection>(m_factory);
+
+	std::ifstream is(iter->second, std::ios::binary);
+
+	if (!is.is_open() || !collection->read(is)) {
+		std::remove(iter->second.c_str());
+		m_spilled.erase(iter);
+		return nullptr;
+	}
+
+	insert(key, collection);
+
+	return collection;
+}
+
+std::string FrameCache::spill_path(const FrameCacheKey &key) const
+{
+	std::ostringstream ss;
+	ss << m_spill_directory << "/kmk_frame_"
+	   << std::hex << reinterpret_cast<uintptr_t>(key.graph) << '_'
+	   << key.graph_version << '_'
+	   << key.props_hash << '_'
+	   << std::dec << key.frame << ".bin";
+
+	return ss.str();
+}
@@ -0,0 +1,146 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <kamikaze/primitive.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Graph;
+
+/* Identifies the result of the evaluation of an object's graph for a given
+ * frame, the graph version and properties hash making sure that the result is
+ * not used anymore once the graph is edited. */
+struct FrameCacheKey {
+	const Graph *graph;
+	int frame;
+	size_t graph_version;
+	size_t props_hash;
+
+	bool operator==(const FrameCacheKey &other) const;
+};
+
+struct FrameCacheKeyHash {
+	size_t operator()(const FrameCacheKey &key) const;
+};
+
+/* Cache of the collections evaluated for the frames of time dependent objects,
+ * so that going back to an already evaluated frame does not require evaluating
+ * their graphs again.
+ *
+ * The least recently used collections are released once the memory budget is
+ * exceeded, or written to the spill directory, if any, to be read back from
+ * disk when needed again. The collections still referenced outside of the
+ * cache, e.g. displayed by an object, are never released. */
+class FrameCache {
+	struct Entry {
+		FrameCacheKey key;
+		PrimitiveCollectionPtr collection;
+		size_t size;
+	};
+
+	using entry_list = std::list<Entry>;
+
+	/* Most recently used entries first. */
+	entry_list m_entries{};
+	std::unordered_map<FrameCacheKey, entry_list::iterator, FrameCacheKeyHash> m_entry_map{};
+
+	/* Entries written to disk. */
+	std::unordered_map<FrameCacheKey, std::string, FrameCacheKeyHash> m_spilled{};
+
+	size_t m_budget = 512ul * 1024ul * 1024ul;
+	size_t m_memory_usage = 0;
+	std::string m_spill_directory = "";
+
+	PrimitiveFactory *m_factory = nullptr;
+
+	size_t m_hits = 0;
+	size_t m_misses = 0;
+
+	mutable std::mutex m_mutex;
+
+public:
+	FrameCache() = default;
+	~FrameCache();
+
+	/* Disallow copy. */
+	FrameCache(const FrameCache &other) = delete;
+	FrameCache &operator=(const FrameCache &other) = delete;
+
+	/* Return the collection cached for the given key, or nullptr. */
+	PrimitiveCollectionPtr find(const FrameCacheKey &key);
+
+	/* Same as above for several keys at once, return the collections in the
+	 * order of the keys, or nothing if any of them is missing. The collections
+	 * written to disk are considered missing, so that this can be called from
+	 * the thread of the user interface, see load(). */
+	std::vector<PrimitiveCollectionPtr> find_resident(const std::vector<FrameCacheKey> &keys);
+
+	/* Return whether a collection is cached for the given key, in memory or
+	 * on disk. */
+	bool contains(const FrameCacheKey &key) const;
+
+	/* Return whether a collection is cached in memory for the given key. */
+	bool resident(const FrameCacheKey &key) const;
+
+	/* Read the collection of the given key back from disk if it was written
+	 * there, return whether it is in memory afterwards. */
+	bool load(const FrameCacheKey &key);
+
+	/* Take ownership of the given collection, and return the collection stored
+	 * for the key, which is the given one unless the key was already present. */
+	PrimitiveCollectionPtr add(const FrameCacheKey &key, PrimitiveCollection *collection);
+
+	/* Release the collections of the given graph. */
+	void remove(const Graph *graph);
+
+	/* Release all the collections. */
+	void clear();
+
+	/* The maximum number of bytes used by the collections kept in memory. */
+	void budget(size_t bytes);
+	size_t budget() const;
+
+	/* The directory where to write the collections released from memory,
+	 * nothing is written if empty. */
+	void spill_directory(const std::string &path);
+	const std::string &spill_directory() const;
+
+	size_t memory_usage() const;
+
+	size_t hits() const;
+	size_t misses() const;
+
+private:
+	PrimitiveCollectionPtr lookup(const FrameCacheKey &key);
+	void insert(const FrameCacheKey &key, PrimitiveCollectionPtr collection);
+	void evict();
+	PrimitiveCollectionPtr read_spilled(const FrameCacheKey &key);
+	std::string spill_path(const FrameCacheKey &key) const;
+};
@@ -121,12 +121,24 @@ inline static std::string output_id(const OutputSocket *socket, int index, bool
 	return ss.str();
 }
 
-inline void dump_node(systeme_fichier::File &file, Node *node)
+static std::string hex_color(const glm::vec3 &color)
+{
+	std::stringstream ss;
+	ss << '#' << std::hex << std::setfill('0');
+
+	for (int i = 0; i < 3; ++i) {
+		ss << std::setw(2) << static_cast<int>(color[i] * 255.0f);
+	}
+
+	return ss.str();
+}
+
+inline void dump_node(systeme_fichier::File &file, Node *node, const NodeProfile *profile, float max_time)
 {
 	constexpr auto shape = "box";
 	constexpr auto style = "filled,rounded";
 	constexpr auto color = "black";
-	constexpr auto fillcolor = "gainsboro";
+	auto fillcolor = std::string("gainsboro");
 	auto penwidth = 1.0f;
 
 	file.print("// %s\n", node->name().c_str());
@@ -177,6 +189,23 @@ inline void dump_node(systeme_fichier::File &file, Node *node)
 		file.print("</TR>");
 	}
 
+	if (profile != nullptr) {
+		file.print("<TR><TD COLSPAN=\"2\">%.3f ms (self: %.3f ms, copy: %.3f ms)</TD></TR>",
+		           profile->wall_time * 1000.0f,
+		           profile->self_time * 1000.0f,
+		           profile->copy_time * 1000.0f);
+
+		file.print("<TR><TD COLSPAN=\"2\">%lu points, %lu prims, %lu bytes</TD></TR>",
+		           profile->points, profile->primitives, profile->bytes);
+
+		file.print("<TR><TD COLSPAN=\"2\">cache hits: %d, misses: %d</TD></TR>",
+		           profile->cache_hits, profile->cache_misses);
+
+		if (max_time > 0.0f) {
+			fillcolor = hex_color(heat_color(profile->wall_time / max_time));
+		}
+	}
+
 	file.print("</TABLE>>");
 
 	file.print(",fontname=\"%s\"", fontname);
@@ -184,7 +213,7 @@ inline void dump_node(systeme_fichier::File &file, Node *node)
 	file.print(",shape=\"%s\"", shape);
 	file.print(",style=\"%s\"", style);
 	file.print(",color=\"%s\"", color);
-	file.print(",fillcolor=\"%s\"", fillcolor);
+	file.print(",fillcolor=\"%s\"", fillcolor.c_str());
 	file.print(",penwidth=\"%f\"", penwidth);
 	file.print("];\n");
 	file.print("\n");
@@ -217,8 +246,9 @@ inline void dump_node_links(systeme_fichier::File &file, const Node *node)
 	}
 }
 
-GraphDumper::GraphDumper(Graph *graph)
+GraphDumper::GraphDumper(Graph *graph, bool annotate)
     : m_graph(graph)
+    , m_annotate(annotate)
 {}
 
 void GraphDumper::operator()(const std::experimental::filesystem::path &path)
@@ -235,11 +265,21 @@ void GraphDumper::operator()(const std::experimental::filesystem::path &path)
 	file.print("labbelloc=\"t\"");
 	file.print(",fontsize=\"%f\"", fontsize);
 	file.print("fontname=\"%s\"", fontname);
-	file.print("label=\"Object Graph\"");
+	file.print("label=\"Object Graph (cache hits: %d, misses: %d)\"",
+	           m_graph->cache_hits(), m_graph->cache_misses());
 	file.print("]\n");
 
+	const auto profiler = m_graph->profiler();
+	const auto max_time = profiler->max_wall_time();
+
 	for (const auto &node : m_graph->nodes()) {
-		dump_node(file, node.get());
+		if (m_annotate) {
+			const auto profile = profiler->profile(node.get());
+			dump_node(file, node.get(), &profile, max_time);
+		}
+		else {
+			dump_node(file, node.get(), nullptr, 0.0f);
+		}
 	}
 
 	for (const auto &node : m_graph->nodes()) {
@@ -31,9 +31,12 @@ class Graph;
 
 class GraphDumper {
 	Graph *m_graph;
+	bool m_annotate;
 
 public:
-	explicit GraphDumper(Graph *graph);
+	/* If annotate is true, the nodes are labelled with the measurements of
+	 * their profiler, and coloured by cost. */
+	explicit GraphDumper(Graph *graph, bool annotate = false);
 
 	void operator()(const std::experimental::filesystem::path &path);
 };
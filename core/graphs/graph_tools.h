@@ -24,6 +24,13 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <tbb/task_group.h>
+
 /* Perform a topological sort of the nodes in a directed acyclic graph.
  * This is templated over the node type and all of the functions called in here
  * are to be overloaded with the right node type. */
@@ -92,3 +99,70 @@ static void topology_sort(const std::vector<NodeType *> &nodes, std::vector<Node
 		}
 	}
 }
+
+/* Process the nodes of a topologically sorted stack on the task scheduler. A
+ * node is spawned as soon as all of its parents in the stack are processed, so
+ * nodes which do not depend on each other are processed concurrently. Parents
+ * which are not part of the stack are considered to be up to date. Like for
+ * topology_sort, get_parents and get_children are to be overloaded with the
+ * right node type. */
+template <typename NodeType, typename OpType>
+static void parallel_process(const std::vector<NodeType *> &stack, const OpType &op)
+{
+	std::unordered_map<NodeType *, size_t> indices;
+
+	for (size_t i = 0; i < stack.size(); ++i) {
+		indices[stack[i]] = i;
+	}
+
+	/* Number of parents left to process for each node. */
+	std::vector<std::atomic<int>> pending(stack.size());
+	std::vector<size_t> roots;
+
+	for (size_t i = 0; i < stack.size(); ++i) {
+		auto count = 0;
+
+		for (auto parent : get_parents(stack[i])) {
+			if (indices.find(parent) != indices.end()) {
+				++count;
+			}
+		}
+
+		pending[i] = count;
+
+		if (count == 0) {
+			roots.push_back(i);
+		}
+	}
+
+	tbb::task_group task_group;
+	std::function<void(size_t)> spawn;
+
+	spawn = [&](size_t index)
+	{
+		task_group.run([&, index]()
+		{
+			auto node = stack[index];
+
+			op(node);
+
+			for (auto child : get_children(node)) {
+				auto iter = indices.find(child);
+
+				if (iter == indices.end()) {
+					continue;
+				}
+
+				if (--pending[iter->second] == 0) {
+					spawn(iter->second);
+				}
+			}
+		});
+	};
+
+	for (auto index : roots) {
+		spawn(index);
+	}
+
+	task_group.wait();
+}
@@ -0,0 +1,304 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include "node_profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <kamikaze/nodes.h>
+#include <ostream>
+
+void NodeProfiler::record(const Node *node, const NodeProfileSample &sample)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	auto &samples = m_samples[node];
+	samples.push_back(sample);
+
+	while (samples.size() > m_window) {
+		samples.pop_front();
+	}
+}
+
+void NodeProfiler::record_cache_hit(const Node *node)
+{
+	NodeProfileSample sample;
+	sample.cache_hit = true;
+
+	record(node, sample);
+}
+
+void NodeProfiler::remove(const Node *node)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_samples.erase(node);
+}
+
+void NodeProfiler::clear()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_samples.clear();
+}
+
+void NodeProfiler::window(size_t evaluations)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_window = std::max(evaluations, 1ul);
+
+	for (auto &samples : m_samples) {
+		while (samples.second.size() > m_window) {
+			samples.second.pop_front();
+		}
+	}
+}
+
+size_t NodeProfiler::window() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_window;
+}
+
+NodeProfile NodeProfiler::profile(const Node *node) const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	auto iter = m_samples.find(node);
+
+	if (iter == m_samples.end()) {
+		NodeProfile profile;
+		profile.node = node;
+		return profile;
+	}
+
+	return aggregate(node, iter->second);
+}
+
+std::vector<NodeProfile> NodeProfiler::profiles() const
+{
+	std::vector<NodeProfile> profiles;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		profiles.reserve(m_samples.size());
+
+		for (const auto &samples : m_samples) {
+			profiles.push_back(aggregate(samples.first, samples.second));
+		}
+	}
+
+	std::sort(profiles.begin(), profiles.end(),
+	          [](const NodeProfile &a, const NodeProfile &b)
+	{
+		return a.wall_time > b.wall_time;
+	});
+
+	return profiles;
+}
+
+float NodeProfiler::max_wall_time() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	auto max_time = 0.0f;
+
+	for (const auto &samples : m_samples) {
+		max_time = std::max(max_time, aggregate(samples.first, samples.second).wall_time);
+	}
+
+	return max_time;
+}
+
+NodeProfile NodeProfiler::aggregate(const Node *node, const std::deque<NodeProfileSample> &samples) const
+{
+	NodeProfile profile;
+	profile.node = node;
+	profile.evaluations = samples.size();
+
+	for (const auto &sample : samples) {
+		if (sample.cache_hit) {
+			++profile.cache_hits;
+			continue;
+		}
+
+		++profile.cache_misses;
+
+		profile.wall_time += sample.wall_time;
+		profile.self_time += sample.self_time;
+		profile.copy_time += sample.copy_time;
+		profile.max_wall_time = std::max(profile.max_wall_time, sample.wall_time);
+
+		profile.points = sample.points;
+		profile.primitives = sample.primitives;
+		profile.bytes = sample.bytes;
+	}
+
+	if (profile.cache_misses != 0) {
+		profile.wall_time /= profile.cache_misses;
+		profile.self_time /= profile.cache_misses;
+		profile.copy_time /= profile.cache_misses;
+	}
+
+	return profile;
+}
+
+/* ************************************************************************** */
+
+static void write_csv_string(std::ostream &os, const std::string &str)
+{
+	os << '"';
+
+	for (const auto c : str) {
+		if (c == '"') {
+			os << '"';
+		}
+
+		os << c;
+	}
+
+	os << '"';
+}
+
+void NodeProfiler::write_csv(std::ostream &os) const
+{
+	os << "node,evaluations,cache_hits,cache_misses,"
+	   << "wall_time,self_time,copy_time,max_wall_time,"
+	   << "points,primitives,bytes\n";
+
+	for (const auto &profile : profiles()) {
+		write_csv_string(os, profile.node->name());
+
+		os << ',' << profile.evaluations
+		   << ',' << profile.cache_hits
+		   << ',' << profile.cache_misses
+		   << ',' << profile.wall_time
+		   << ',' << profile.self_time
+		   << ',' << profile.copy_time
+		   << ',' << profile.max_wall_time
+		   << ',' << profile.points
+		   << ',' << profile.primitives
+		   << ',' << profile.bytes
+		   << '\n';
+	}
+}
+
+static void write_json_string(std::ostream &os, const std::string &str)
+{
+	os << '"';
+
+	for (const auto c : str) {
+		switch (c) {
+			case '"':
+				os << "\\\"";
+				break;
+			case '\\':
+				os << "\\\\";
+				break;
+			case '\n':
+				os << "\\n";
+				break;
+			case '\t':
+				os << "\\t";
+				break;
+			default:
+				os << c;
+				break;
+		}
+	}
+
+	os << '"';
+}
+
+void NodeProfiler::write_json(std::ostream &os) const
+{
+	os << "{\n";
+	os << "\t\"window\": " << window() << ",\n";
+	os << "\t\"nodes\": [";
+
+	auto first = true;
+
+	for (const auto &profile : profiles()) {
+		os << (first ? "\n" : ",\n");
+		first = false;
+
+		os << "\t\t{ \"name\": ";
+		write_json_string(os, profile.node->name());
+
+		os << ", \"evaluations\": " << profile.evaluations
+		   << ", \"cache_hits\": " << profile.cache_hits
+		   << ", \"cache_misses\": " << profile.cache_misses
+		   << ", \"wall_time\": " << profile.wall_time
+		   << ", \"self_time\": " << profile.self_time
+		   << ", \"copy_time\": " << profile.copy_time
+		   << ", \"max_wall_time\": " << profile.max_wall_time
+		   << ", \"points\": " << profile.points
+		   << ", \"primitives\": " << profile.primitives
+		   << ", \"bytes\": " << profile.bytes
+		   << " }";
+	}
+
+	os << "\n\t]\n";
+	os << "}\n";
+}
+
+bool NodeProfiler::write_csv(const std::string &path) const
+{
+	std::ofstream os(path);
+
+	if (!os.is_open()) {
+		return false;
+	}
+
+	write_csv(os);
+
+	return os.good();
+}
+
+bool NodeProfiler::write_json(const std::string &path) const
+{
+	std::ofstream os(path);
+
+	if (!os.is_open()) {
+		return false;
+	}
+
+	write_json(os);
+
+	return os.good();
+}
+
+/* ************************************************************************** */
+
+glm::vec3 heat_color(float heat)
+{
+	heat = glm::clamp(heat, 0.0f, 1.0f);
+
+	/* Go through yellow, so that the nodes in the middle stand out as well. */
+	if (heat < 0.5f) {
+		return glm::vec3(heat * 2.0f, 0.8f, 0.0f);
+	}
+
+	return glm::vec3(1.0f, 0.8f * (1.0f - heat) * 2.0f, 0.0f);
+}
@@ -0,0 +1,130 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <deque>
+#include <glm/glm.hpp>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Node;
+
+/* Measurements taken for a node during one evaluation of its graph. */
+struct NodeProfileSample {
+	/* Time spent processing the node, including the copy of its inputs, but
+	 * not the time spent waiting for the nodes which are not thread safe. */
+	float wall_time = 0.0f;
+
+	/* Time spent in the node itself, i.e. excluding the copy of its inputs. */
+	float self_time = 0.0f;
+
+	/* Time spent copying the collections of the inputs. */
+	float copy_time = 0.0f;
+
+	size_t points = 0;
+	size_t primitives = 0;
+
+	/* Bytes used by the attributes and geometry of the output primitives which
+	 * are not shared with the inputs of the node. */
+	size_t bytes = 0;
+
+	/* Whether the node was not processed, its previous output being reused. */
+	bool cache_hit = false;
+};
+
+/* Measurements of a node aggregated over the last evaluations of its graph,
+ * times are averaged over the evaluations where it was processed. */
+struct NodeProfile {
+	const Node *node = nullptr;
+
+	int evaluations = 0;
+	int cache_hits = 0;
+	int cache_misses = 0;
+
+	float wall_time = 0.0f;
+	float self_time = 0.0f;
+	float copy_time = 0.0f;
+	float max_wall_time = 0.0f;
+
+	/* Output of the last evaluation where the node was processed. */
+	size_t points = 0;
+	size_t primitives = 0;
+	size_t bytes = 0;
+};
+
+/* Collect the measurements of the nodes of a graph over the last evaluations.
+ * Samples may be recorded concurrently from the evaluation threads. */
+class NodeProfiler {
+	std::unordered_map<const Node *, std::deque<NodeProfileSample>> m_samples{};
+
+	/* Number of evaluations the measurements are aggregated over. */
+	size_t m_window = 16;
+
+	mutable std::mutex m_mutex;
+
+public:
+	NodeProfiler() = default;
+
+	/* Disallow copy. */
+	NodeProfiler(const NodeProfiler &other) = delete;
+	NodeProfiler &operator=(const NodeProfiler &other) = delete;
+
+	void record(const Node *node, const NodeProfileSample &sample);
+	void record_cache_hit(const Node *node);
+
+	/* Forget about the given node, e.g. once it is removed from the graph. */
+	void remove(const Node *node);
+	void clear();
+
+	void window(size_t evaluations);
+	size_t window() const;
+
+	NodeProfile profile(const Node *node) const;
+
+	/* Return the profiles of all the nodes, the most expensive ones first. */
+	std::vector<NodeProfile> profiles() const;
+
+	/* Return the highest average wall time of the nodes, to normalize the
+	 * times of the nodes when comparing them. */
+	float max_wall_time() const;
+
+	void write_csv(std::ostream &os) const;
+	void write_json(std::ostream &os) const;
+
+	/* Same as above, writing to the file at the given path, return false if
+	 * it could not be written. */
+	bool write_csv(const std::string &path) const;
+	bool write_json(const std::string &path) const;
+
+private:
+	NodeProfile aggregate(const Node *node, const std::deque<NodeProfileSample> &samples) const;
+};
+
+/* Return the colour of a node in a heat map given its cost relative to the
+ * most expensive node, from green for the cheapest to red. */
+glm::vec3 heat_color(float heat);
@@ -52,7 +52,12 @@ const std::vector<std::unique_ptr<Node>> &Graph::nodes() const
 void Graph::add(Node *node)
 {
 	m_nodes.push_back(std::unique_ptr<Node>(node));
-	node->setPrimitiveCache(&m_cache);
+
+	auto cache = new PrimitiveCache;
+	m_caches[node] = std::unique_ptr<PrimitiveCache>(cache);
+	node->setPrimitiveCache(cache);
+
+	++m_version;
 }
 
 void Graph::remove(Node *node)
@@ -82,9 +87,12 @@ void Graph::remove(Node *node)
 		}
 	}
 
+	m_caches.erase(node);
+	m_profiler.remove(node);
 	m_nodes.erase(iter);
 
 	m_need_update = true;
+	++m_version;
 }
 
 static inline auto is_linked(Node *node)
@@ -176,8 +184,10 @@ void Graph::connect(OutputSocket *from, InputSocket *to)
 
 	to->link = from;
 	from->links.push_back(to);
+	to->parent->tag_update();
 
 	m_need_update = true;
+	++m_version;
 }
 
 void Graph::disconnect(OutputSocket *from, InputSocket *to)
@@ -191,8 +201,10 @@ void Graph::disconnect(OutputSocket *from, InputSocket *to)
 
 	from->links.erase(iter);
 	to->link = nullptr;
+	to->parent->tag_update();
 
 	m_need_update = true;
+	++m_version;
 }
 
 void Graph::active_node(Node *node)
@@ -211,7 +223,128 @@ Node *Graph::active_node() const
 
 void Graph::clear_cache()
 {
-	m_cache.clear();
+	for (const auto &node : m_nodes) {
+		clear_cache(node.get());
+		node->tag_update();
+	}
+}
+
+void Graph::clear_cache(Node *node)
+{
+	auto iter = m_caches.find(node);
+
+	if (iter != m_caches.end()) {
+		iter->second->clear();
+	}
+}
+
+PrimitiveCollectionPtr Graph::share_collection(Node *node) const
+{
+	const auto collection = node->collection();
+
+	if (collection == nullptr) {
+		return nullptr;
+	}
+
+	while (node != nullptr) {
+		auto iter = m_caches.find(node);
+
+		if (iter == m_caches.end()) {
+			return nullptr;
+		}
+
+		auto shared = iter->second->share(collection);
+
+		if (shared != nullptr || node->modifies_input() || node->inputs().empty()) {
+			return shared;
+		}
+
+		auto link = node->inputs()[0]->link;
+		node = (link != nullptr) ? link->parent : nullptr;
+	}
+
+	return nullptr;
+}
+
+void Graph::result(PrimitiveCollectionPtr collection)
+{
+	m_result = std::move(collection);
+}
+
+PrimitiveCollectionPtr Graph::result() const
+{
+	return m_result;
+}
+
+void Graph::tag_update()
+{
+	for (const auto &node : m_nodes) {
+		node->tag_update();
+	}
+}
+
+void Graph::tag_time_update()
+{
+	/* The nodes downstream of them are processed again as well, see
+	 * ObjectGraphDepsNode::evaluate_graph(). */
+	for (const auto &node : m_nodes) {
+		if (node->time_dependent()) {
+			node->tag_update();
+		}
+	}
+}
+
+bool Graph::time_dependent() const
+{
+	for (const auto &node : m_nodes) {
+		if (node->time_dependent()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+size_t Graph::version() const
+{
+	return m_version;
+}
+
+size_t Graph::props_hash() const
+{
+	size_t seed = 0;
+
+	for (const auto &node : m_nodes) {
+		seed ^= node->props_hash() + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	}
+
+	return seed;
+}
+
+void Graph::cache_stats(int hits, int misses)
+{
+	m_cache_hits = hits;
+	m_cache_misses = misses;
+}
+
+NodeProfiler *Graph::profiler()
+{
+	return &m_profiler;
+}
+
+const NodeProfiler *Graph::profiler() const
+{
+	return &m_profiler;
+}
+
+int Graph::cache_hits() const
+{
+	return m_cache_hits;
+}
+
+int Graph::cache_misses() const
+{
+	return m_cache_misses;
 }
 
 void Graph::add_to_selection(Node *node)
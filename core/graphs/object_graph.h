@@ -26,9 +26,13 @@
 
 #include <kamikaze/nodes.h>
 #include <kamikaze/primitive.h>
+#include <atomic>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
+#include "node_profiler.h"
+
 class InputSocket;
 class OutputNode;
 class OutputSocket;
@@ -44,10 +48,26 @@ class Graph {
 
 	Node *m_active_node = nullptr;
 
-	PrimitiveCache m_cache;
+	/* Each node has its own cache, so that the collections of the nodes which
+	 * do not need an update can be kept across evaluations. */
+	std::unordered_map<Node *, std::unique_ptr<PrimitiveCache>> m_caches;
+
+	/* The collection output by the last complete evaluation. */
+	PrimitiveCollectionPtr m_result{};
 
 	bool m_need_update;
 
+	/* Incremented whenever nodes or connections are added or removed. */
+	size_t m_version = 0;
+
+	/* Number of nodes reused from or missing in the cache during the last
+	 * evaluation, set from the thread evaluating the graph and read from the
+	 * one of the user interface. */
+	std::atomic<int> m_cache_hits{0};
+	std::atomic<int> m_cache_misses{0};
+
+	NodeProfiler m_profiler{};
+
 public:
 	Graph();
 	~Graph();
@@ -69,6 +89,36 @@ public:
 	Node *active_node() const;
 
 	void clear_cache();
+	void clear_cache(Node *node);
+
+	/* Share the ownership of the collection of a node, which then remains
+	 * valid after the cache of the node is cleared. The collection passed
+	 * through by a node not modifying its input is owned by the cache of the
+	 * upstream node. */
+	PrimitiveCollectionPtr share_collection(Node *node) const;
+
+	void result(PrimitiveCollectionPtr collection);
+	PrimitiveCollectionPtr result() const;
+
+	void tag_update();
+
+	/* Tag the nodes whose output depends on the frame. */
+	void tag_time_update();
+
+	/* Return whether the output of any node depends on the frame. */
+	bool time_dependent() const;
+
+	size_t version() const;
+
+	/* Return a hash of the property values of all the nodes. */
+	size_t props_hash() const;
+
+	NodeProfiler *profiler();
+	const NodeProfiler *profiler() const;
+
+	void cache_stats(int hits, int misses);
+	int cache_hits() const;
+	int cache_misses() const;
 
 	void add_to_selection(Node *node);
 
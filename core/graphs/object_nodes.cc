@@ -26,32 +26,55 @@
 
 #include <kamikaze/mesh.h>
 #include <kamikaze/noise.h>
+#include <kamikaze/normals.h>
 #include <kamikaze/primitive.h>
 #include <kamikaze/prim_points.h>
 #include <kamikaze/util_parallel.h>
 #include <kamikaze/utils_glm.h>
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <experimental/filesystem>
 #include <random>
 #include <sstream>
 
-#include "ui/paramfactory.h"
+#include "geometry_cache.h"
+#include "geometry_export.h"
+#include "geometry_import.h"
 
 /* ************************************************************************** */
 
 OutputNode::OutputNode(const std::string &name)
     : Node(name)
 {
+	thread_safe(true);
+	modifies_input(false);
+
 	addInput("Primitive");
 }
 
-PrimitiveCollection *OutputNode::collection() const
+void OutputNode::process()
 {
-	return m_collection;
+	/* Nothing to do, the collection from the input socket is retrieved before
+	 * processing, without being copied, and made available to the object
+	 * through collection(). */
 }
 
-void OutputNode::process()
+/* ************************************************************************** */
+
+UnresolvedNode::UnresolvedNode(const std::string &type, const std::string &name)
+    : Node(name)
 {
-	m_collection = getInputCollection("Primitive");
+	this->type(type);
+	thread_safe(true);
+}
+
+void UnresolvedNode::process()
+{
+	/* Pass the input through, the sockets and properties are those read from
+	 * the scene file. */
+	this->add_warning("Unknown node type '" + this->type() + "', is the plugin defining it loaded?");
 }
 
 /* ************************************************************************** */
@@ -59,6 +82,8 @@ void OutputNode::process()
 TransformNode::TransformNode()
     : Node("Transform")
 {
+	thread_safe(true);
+
 	addInput("Prim");
 	addOutput("Prim");
 
@@ -168,6 +193,8 @@ void TransformNode::process()
 CreateBoxNode::CreateBoxNode()
     : Node("Box")
 {
+	thread_safe(true);
+
 	addOutput("Prim");
 
 	add_prop("size", "Size", property_type::prop_vec3);
@@ -243,6 +270,8 @@ void CreateBoxNode::process()
 CreateTorusNode::CreateTorusNode()
     : Node("Torus")
 {
+	thread_safe(true);
+
 	addOutput("Prim");
 
 	add_prop("center", "Center", property_type::prop_vec3);
@@ -348,6 +377,8 @@ void CreateTorusNode::process()
 CreateGridNode::CreateGridNode()
     : Node("Grid")
 {
+	thread_safe(true);
+
 	addOutput("Prim");
 
 	add_prop("center", "Center", property_type::prop_vec3);
@@ -438,6 +469,8 @@ public:
 CreateCircleNode::CreateCircleNode()
     : Node("Circle")
 {
+	thread_safe(true);
+
 	addOutput("Primitive");
 
 	add_prop("vertices", "Vertices", property_type::prop_int);
@@ -573,6 +606,8 @@ public:
 CreateTubeNode::CreateTubeNode()
     : Node("Tube")
 {
+	thread_safe(true);
+
 	addOutput("Primitive");
 
 	add_prop("vertices", "Vertices", property_type::prop_int);
@@ -614,6 +649,8 @@ public:
 CreateConeNode::CreateConeNode()
     : Node("Cone")
 {
+	thread_safe(true);
+
 	addOutput("Primitive");
 
 	add_prop("vertices", "Vertices", property_type::prop_int);
@@ -698,6 +735,8 @@ public:
 CreateIcoSphereNode::CreateIcoSphereNode()
     : Node("IcoSphere")
 {
+	thread_safe(true);
+
 	addOutput("Primitive");
 
 	add_prop("radius", "Radius", property_type::prop_float);
@@ -744,69 +783,42 @@ void CreateIcoSphereNode::process()
 
 /* ************************************************************************** */
 
-static inline glm::vec3 get_normal(const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2)
-{
-	const auto n0 = v0 - v1;
-	const auto n1 = v2 - v1;
-
-	return glm::cross(n1, n0);
-}
-
 class NormalNode : public Node {
 public:
 	NormalNode()
 	    : Node("Normal")
 	{
+		thread_safe(true);
+
 		addInput("input");
 		addOutput("output");
 
+		EnumProperty weighting_enum_prop;
+		weighting_enum_prop.insert("Area", NORMAL_WEIGHT_AREA);
+		weighting_enum_prop.insert("Angle", NORMAL_WEIGHT_ANGLE);
+
+		add_prop("weighting", "Weighting", property_type::prop_enum);
+		set_prop_enum_values(weighting_enum_prop);
+
 		add_prop("flip", "Flip", property_type::prop_bool);
 	}
 
 	void process() override
 	{
+		const auto weighting = eval_enum("weighting");
 		const auto flip = eval_bool("flip");
 
 		for (auto &prim : primitive_iterator(this->m_collection, Mesh::id)) {
 			auto mesh = static_cast<Mesh *>(prim);
-			auto normals = mesh->attribute("normal", ATTR_TYPE_VEC3);
-			auto points = mesh->points();
-
-			normals->resize(points->size());
+			const PointList *points = mesh->points();
+			const PolygonList *polys = mesh->polys();
 
-			auto polys = mesh->polys();
+			auto normal_attr = mesh->add_attribute("normal", ATTR_TYPE_VEC3, points->size());
+			normal_attr->resize(points->size());
 
-			for (size_t i = 0, ie = points->size(); i < ie ; ++i) {
-				normals->vec3(i, glm::vec3(0.0f));
-			}
-
-			parallel_for(tbb::blocked_range<size_t>(0, polys->size()),
-			             [&](const tbb::blocked_range<size_t> &r)
-			{
-				for (auto i = r.begin(), ie = r.end(); i < ie ; ++i) {
-					const auto &quad = (*polys)[i];
-
-					const auto v0 = (*points)[quad[0]];
-					const auto v1 = (*points)[quad[1]];
-					const auto v2 = (*points)[quad[2]];
-
-					const auto normal = get_normal(v0, v1, v2);
+			auto normals = TypedAttribute<glm::vec3>(normal_attr);
 
-					normals->vec3(quad[0], normals->vec3(quad[0]) + normal);
-					normals->vec3(quad[1], normals->vec3(quad[1]) + normal);
-					normals->vec3(quad[2], normals->vec3(quad[2]) + normal);
-
-					if (quad[3] != INVALID_INDEX) {
-						normals->vec3(quad[3], normals->vec3(quad[3]) + normal);
-					}
-				}
-			});
-
-			if (flip) {
-				for (size_t i = 0, ie = points->size(); i < ie ; ++i) {
-					normals->vec3(i, -glm::normalize(normals->vec3(i)));
-				}
-			}
+			compute_normals(*points, *polys, normals.begin(), weighting, flip);
 		}
 	}
 };
@@ -814,41 +826,78 @@ public:
 /* ************************************************************************** */
 
 class NoiseNode : public Node {
+	/* The properties are declared once for all the instances, and read once
+	 * per process() through handles rather than looked up by name. */
+	struct Props {
+		PropertySchema schema;
+		PropHandle<int> octaves;
+		PropHandle<float> frequency;
+		PropHandle<float> amplitude;
+		PropHandle<float> persistence;
+		PropHandle<float> lacunarity;
+		PropHandle<float> time_scale;
+
+		Props()
+		{
+			octaves = schema.add_prop("octaves", "Octaves", property_type::prop_int);
+			schema.set_prop_min_max(1, 10);
+			schema.set_prop_default_value_int(1);
+
+			frequency = schema.add_prop("frequency", "Frequency", property_type::prop_float);
+			schema.set_prop_min_max(0.0f, 1.0f);
+			schema.set_prop_default_value_float(1.0f);
+
+			amplitude = schema.add_prop("amplitude", "Amplitude", property_type::prop_float);
+			schema.set_prop_min_max(0.0f, 10.0f);
+			schema.set_prop_default_value_float(1.0f);
+
+			persistence = schema.add_prop("persistence", "Persistence", property_type::prop_float);
+			schema.set_prop_min_max(0.0f, 10.0f);
+			schema.set_prop_default_value_float(1.0f);
+
+			lacunarity = schema.add_prop("lacunarity", "Lacunarity", property_type::prop_float);
+			schema.set_prop_min_max(0.0f, 10.0f);
+			schema.set_prop_default_value_float(2.0f);
+
+			time_scale = schema.add_prop("time_scale", "Time Scale", property_type::prop_float);
+			schema.set_prop_min_max(0.0f, 10.0f);
+			schema.set_prop_default_value_float(0.0f);
+			schema.set_prop_tooltip("Offset of the noise per frame, the noise does not change over time if zero.");
+		}
+	};
+
+	static const Props &props_schema()
+	{
+		static const Props props;
+		return props;
+	}
+
 public:
 	NoiseNode()
 	    : Node("Noise")
 	{
-		addInput("input");
-		addOutput("output");
-
-		add_prop("octaves", "Octaves", property_type::prop_int);
-		set_prop_min_max(1, 10);
-		set_prop_default_value_int(1);
-
-		add_prop("frequency", "Frequency", property_type::prop_float);
-		set_prop_min_max(0.0f, 1.0f);
-		set_prop_default_value_float(1.0f);
+		thread_safe(true);
 
-		add_prop("amplitude", "Amplitude", property_type::prop_float);
-		set_prop_min_max(0.0f, 10.0f);
-		set_prop_default_value_float(1.0f);
+		use_schema(props_schema().schema);
 
-		add_prop("persistence", "Persistence", property_type::prop_float);
-		set_prop_min_max(0.0f, 10.0f);
-		set_prop_default_value_float(1.0f);
+		addInput("input");
+		addOutput("output");
+	}
 
-		add_prop("lacunarity", "Lacunarity", property_type::prop_float);
-		set_prop_min_max(0.0f, 10.0f);
-		set_prop_default_value_float(2.0f);
+	bool time_dependent() const override
+	{
+		return eval(props_schema().time_scale) != 0.0f;
 	}
 
 	void process() override
 	{
-		const auto octaves = eval_int("octaves");
-		const auto lacunarity = eval_float("lacunarity");
-		const auto persistence = eval_float("persistence");
-		const auto ofrequency = eval_float("frequency");
-		const auto oamplitude = eval_float("amplitude");
+		const auto &props = props_schema();
+		const auto octaves = eval(props.octaves);
+		const auto lacunarity = eval(props.lacunarity);
+		const auto persistence = eval(props.persistence);
+		const auto ofrequency = eval(props.frequency);
+		const auto oamplitude = eval(props.amplitude);
+		const auto offset = static_cast<float>(frame()) * eval(props.time_scale);
 
 		for (auto prim : primitive_iterator(this->m_collection)) {
 			PointList *points;
@@ -865,6 +914,8 @@ public:
 				continue;
 			}
 
+			points->detach();
+
 			for (size_t i = 0, e = points->size(); i < e; ++i) {
 				auto &point = (*points)[i];
 				const auto x = point.x;
@@ -876,7 +927,9 @@ public:
 					auto frequency = ofrequency;
 					auto amplitude = oamplitude;
 
-					output += (amplitude * simplex_noise_3d(x * frequency, y * frequency, z * frequency));
+					output += (amplitude * simplex_noise_3d(x * frequency + offset,
+					                                        y * frequency + offset,
+					                                        z * frequency + offset));
 
 					frequency *= lacunarity;
 					amplitude *= persistence;
@@ -907,6 +960,8 @@ public:
 	ColorNode()
 	    : Node("Color")
 	{
+		thread_safe(true);
+
 		addInput("input");
 		addOutput("output");
 
@@ -959,39 +1014,37 @@ public:
 		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
 
 		for (auto prim : primitive_iterator(this->m_collection)) {
-			Attribute *colors;
+			Attribute *attribute;
 
 			if (prim->typeID() == Mesh::id) {
 				auto mesh = static_cast<Mesh *>(prim);
-				colors = mesh->add_attribute("color", ATTR_TYPE_VEC3, mesh->points()->size());
+				attribute = mesh->add_attribute("color", ATTR_TYPE_VEC3, mesh->points()->size());
 			}
 			else if (prim->typeID() == PrimPoints::id) {
 				auto prim_points = static_cast<PrimPoints *>(prim);
-				colors = prim_points->add_attribute("color", ATTR_TYPE_VEC3, prim_points->points()->size());
+				attribute = prim_points->add_attribute("color", ATTR_TYPE_VEC3, prim_points->points()->size());
 			}
 			else {
 				continue;
 			}
 
+			auto colors = TypedAttribute<glm::vec3>(attribute);
+
 			if (method == COLOR_NODE_UNIQUE) {
 				const auto &color = eval_vec3("color");
 
-				for (size_t i = 0, e = colors->size(); i < e; ++i) {
-					colors->vec3(i, color);
-				}
+				std::fill(colors.begin(), colors.end(), color);
 			}
 			else if (method == COLOR_NODE_RANDOM) {
 				if (scope == COLOR_NODE_VERTEX) {
-					for (size_t i = 0, e = colors->size(); i < e; ++i) {
-						colors->vec3(i, glm::vec3{dist(rng), dist(rng), dist(rng)});
+					for (auto &color : colors) {
+						color = glm::vec3{dist(rng), dist(rng), dist(rng)};
 					}
 				}
 				else if (scope == COLOR_NODE_PRIMITIVE) {
 					const auto &color = glm::vec3{dist(rng), dist(rng), dist(rng)};
 
-					for (size_t i = 0, e = colors->size(); i < e; ++i) {
-						colors->vec3(i, color);
-					}
+					std::fill(colors.begin(), colors.end(), color);
 				}
 			}
 		}
@@ -1005,6 +1058,8 @@ public:
 	CollectionMergeNode()
 	    : Node("Merge Collection")
 	{
+		thread_safe(true);
+
 		addInput("input1");
 		addInput("input2");
 		addOutput("output");
@@ -1029,6 +1084,8 @@ public:
 	CreatePointCloudNode()
 	    : Node("Point Cloud")
 	{
+		thread_safe(true);
+
 		addOutput("Primitive");
 
 		add_prop("points_count", "Points Count", property_type::prop_int);
@@ -1080,6 +1137,8 @@ public:
 	CreateAttributeNode()
 	    : Node("Attribute Create")
 	{
+		thread_safe(true);
+
 		addInput("input");
 		addOutput("output");
 
@@ -1144,6 +1203,8 @@ public:
 	DeleteAttributeNode()
 	    : Node("Attribute Delete")
 	{
+		thread_safe(true);
+
 		addInput("input");
 		addOutput("output");
 
@@ -1197,6 +1258,8 @@ public:
 	RandomiseAttributeNode()
 	    : Node("Attribute Randomise")
 	{
+		thread_safe(true);
+
 		addInput("input");
 		addOutput("output");
 
@@ -1284,9 +1347,9 @@ public:
 		}
 
 		for (Primitive *prim : primitive_iterator(m_collection)) {
-			auto attribute = prim->attribute(name, attribute_type);
+			auto attribute = prim->typed_attribute<glm::vec3>(name);
 
-			if (!attribute) {
+			if (!attribute.valid()) {
 				std::stringstream ss;
 				ss << prim->name() << " does not have an attribute named \"" << name
 				   << "\" of type " << static_cast<int>(attribute_type);
@@ -1298,9 +1361,7 @@ public:
 			switch (distribution) {
 				case DIST_CONSTANT:
 				{
-					for (size_t i = 0; i < attribute->size(); ++i) {
-						attribute->vec3(i, glm::vec3{value, value, value});
-					}
+					std::fill(attribute.begin(), attribute.end(), glm::vec3{value, value, value});
 
 					break;
 				}
@@ -1308,8 +1369,8 @@ public:
 				{
 					std::uniform_real_distribution<float> dist(min_value, max_value);
 
-					for (size_t i = 0; i < attribute->size(); ++i) {
-						attribute->vec3(i, glm::vec3{dist(rng), dist(rng), dist(rng)});
+					for (auto &v : attribute) {
+						v = glm::vec3{dist(rng), dist(rng), dist(rng)};
 					}
 
 					break;
@@ -1318,8 +1379,8 @@ public:
 				{
 					std::normal_distribution<float> dist(mean, stddev);
 
-					for (size_t i = 0; i < attribute->size(); ++i) {
-						attribute->vec3(i, glm::vec3{dist(rng), dist(rng), dist(rng)});
+					for (auto &v : attribute) {
+						v = glm::vec3{dist(rng), dist(rng), dist(rng)};
 					}
 
 					break;
@@ -1338,6 +1399,8 @@ public:
 	FurNode()
 	    : Node("Fur")
 	{
+		thread_safe(true);
+
 		addInput("input");
 		addOutput("output");
 
@@ -1371,7 +1434,7 @@ public:
 		}
 
 		auto input_mesh = static_cast<Mesh *>(iter.get());
-		auto input_points = input_mesh->points();
+		const PointList *input_points = input_mesh->points();
 
 		const auto segment_number = eval_int("segment");
 		const auto segment_normal = eval_vec3("normal");
@@ -1423,6 +1486,276 @@ public:
 
 /* ************************************************************************** */
 
+/* Return whether the path contains a frame number pattern: "$F", optionally
+ * followed by a padding width as in "$F4", or a run of '#' whose length gives
+ * the padding width, as in "####". */
+static bool has_frame_pattern(const std::string &path)
+{
+	return path.find("$F") != std::string::npos || path.find('#') != std::string::npos;
+}
+
+static void append_frame_number(std::string &result, int frame, size_t width)
+{
+	auto digits = std::to_string(std::abs(frame));
+
+	if (frame < 0) {
+		result.push_back('-');
+	}
+
+	if (digits.size() < width) {
+		result.append(width - digits.size(), '0');
+	}
+
+	result.append(digits);
+}
+
+/* Replace the frame number patterns of the path with the number of the frame,
+ * see has_frame_pattern(). */
+static std::string expand_frame_pattern(const std::string &path, int frame)
+{
+	std::string result;
+	result.reserve(path.size() + 8);
+
+	for (size_t i = 0; i < path.size();) {
+		if (path[i] == '#') {
+			auto end = path.find_first_not_of('#', i);
+
+			if (end == std::string::npos) {
+				end = path.size();
+			}
+
+			append_frame_number(result, frame, end - i);
+			i = end;
+		}
+		else if (path.compare(i, 2, "$F") == 0) {
+			i += 2;
+
+			size_t width = 0;
+
+			if (i < path.size() && std::isdigit(static_cast<unsigned char>(path[i]))) {
+				width = static_cast<size_t>(path[i] - '0');
+				++i;
+			}
+
+			append_frame_number(result, frame, width);
+		}
+		else {
+			result.push_back(path[i]);
+			++i;
+		}
+	}
+
+	return result;
+}
+
+enum {
+	FILE_CACHE_AUTOMATIC = 0,
+	FILE_CACHE_READ      = 1,
+	FILE_CACHE_WRITE     = 2,
+};
+
+class FileCacheNode : public Node {
+	struct Props {
+		PropertySchema schema;
+		PropHandle<std::string> file_path;
+		PropHandle<int> mode;
+
+		Props()
+		{
+			file_path = schema.add_prop("file_path", "File", property_type::prop_output_file);
+			schema.set_prop_tooltip("Path of the geometry cache file. "
+			                        "\"$F\" is replaced with the frame number, \"$F4\" or \"####\" with the frame number padded to four digits, "
+			                        "so that each frame is cached in its own file.");
+
+			EnumProperty mode_enum;
+			mode_enum.insert("Automatic", FILE_CACHE_AUTOMATIC);
+			mode_enum.insert("Read", FILE_CACHE_READ);
+			mode_enum.insert("Write", FILE_CACHE_WRITE);
+
+			mode = schema.add_prop("mode", "Mode", property_type::prop_enum);
+			schema.set_prop_enum_values(mode_enum);
+			schema.set_prop_tooltip("Automatic writes the input to the file if it does not exist, and reads the file otherwise.");
+		}
+	};
+
+	static const Props &props_schema()
+	{
+		static const Props props;
+		return props;
+	}
+
+public:
+	FileCacheNode()
+	    : Node("File Cache")
+	{
+		thread_safe(true);
+
+		use_schema(props_schema().schema);
+
+		addInput("input");
+		addOutput("output");
+	}
+
+	/* The file read depends on the frame if its path has a frame number. */
+	bool time_dependent() const override
+	{
+		return has_frame_pattern(eval(props_schema().file_path));
+	}
+
+	void process() override
+	{
+		const auto &props = props_schema();
+		const auto path = expand_frame_pattern(eval(props.file_path), frame());
+
+		if (path.empty()) {
+			this->add_warning("No file path specified!");
+			return;
+		}
+
+		auto mode = eval(props.mode);
+
+		if (mode == FILE_CACHE_AUTOMATIC) {
+			mode = std::experimental::filesystem::exists(path) ? FILE_CACHE_READ : FILE_CACHE_WRITE;
+		}
+
+		std::string error;
+
+		if (mode == FILE_CACHE_WRITE) {
+			if (!write_geometry_cache(*m_collection, path, error)) {
+				this->add_warning(error);
+			}
+
+			return;
+		}
+
+		/* The primitives read refer to the pages of the mapped file, they are
+		 * only copied if modified downstream. */
+		PrimitiveCollection collection(m_collection->factory());
+
+		if (!read_geometry_cache(path, collection, error)) {
+			this->add_warning(error);
+			return;
+		}
+
+		m_collection->free_all();
+		m_collection->merge_collection(collection);
+	}
+};
+
+/* ************************************************************************** */
+
+class FileImportNode : public Node {
+public:
+	FileImportNode()
+	    : Node("File Import")
+	{
+		thread_safe(true);
+
+		addOutput("output");
+
+		add_prop("file_path", "File", property_type::prop_input_file);
+		set_prop_tooltip("Path of the PLY or OBJ file to import.");
+	}
+
+	void process() override
+	{
+		const auto path = eval_string("file_path");
+
+		if (path.empty()) {
+			this->add_warning("No file path specified!");
+			return;
+		}
+
+		/* The file is only parsed again if it was modified since it was last
+		 * imported. */
+		std::string error;
+
+		if (!import_geometry(path, *m_collection, error)) {
+			this->add_warning(error);
+		}
+	}
+};
+
+/* ************************************************************************** */
+
+class FileExportNode : public Node {
+	struct Props {
+		PropertySchema schema;
+		PropHandle<std::string> file_path;
+		PropHandle<bool> background;
+
+		Props()
+		{
+			file_path = schema.add_prop("file_path", "File", property_type::prop_output_file);
+			schema.set_prop_tooltip("Path of the file to write, whose extension gives the format: .ply, .obj, or a geometry cache otherwise. "
+			                        "\"$F\" is replaced with the frame number, \"$F4\" or \"####\" with the frame number padded to four digits.");
+
+			background = schema.add_prop("background", "Background", property_type::prop_bool);
+			schema.set_prop_default_value_bool(true);
+			schema.set_prop_tooltip("Write the file from a background thread, without waiting for it to be written.");
+		}
+	};
+
+	static const Props &props_schema()
+	{
+		static const Props props;
+		return props;
+	}
+
+public:
+	FileExportNode()
+	    : Node("File Export")
+	{
+		thread_safe(true);
+		modifies_input(false);
+
+		use_schema(props_schema().schema);
+
+		addInput("input");
+		addOutput("output");
+	}
+
+	/* A file is written for every frame if its path has a frame number. */
+	bool time_dependent() const override
+	{
+		return has_frame_pattern(eval(props_schema().file_path));
+	}
+
+	void process() override
+	{
+		const auto &props = props_schema();
+		const auto path = expand_frame_pattern(eval(props.file_path), frame());
+
+		if (path.empty()) {
+			this->add_warning("No file path specified!");
+			return;
+		}
+
+		auto &queue = geometry_export_queue();
+
+		/* A write in the background only fails after the node was processed,
+		 * so the failure is reported the next time it is. */
+		const auto previous_error = queue.take_error(path);
+
+		if (!previous_error.empty()) {
+			this->add_warning(previous_error);
+		}
+
+		if (eval(props.background)) {
+			queue.push(*m_collection, path);
+			return;
+		}
+
+		std::string error;
+
+		if (!export_geometry(*m_collection, path, error)) {
+			this->add_warning(error);
+		}
+	}
+};
+
+/* ************************************************************************** */
+
 void register_builtin_nodes(NodeFactory *factory)
 {
 	REGISTER_NODE("Geometry", "Box", CreateBoxNode);
@@ -1439,6 +1772,9 @@ void register_builtin_nodes(NodeFactory *factory)
 	REGISTER_NODE("Geometry", "Merge Collection", CollectionMergeNode);
 	REGISTER_NODE("Geometry", "Point Cloud", CreatePointCloudNode);
 	REGISTER_NODE("Geometry", "Fur", FurNode);
+	REGISTER_NODE("Geometry", "File Cache", FileCacheNode);
+	REGISTER_NODE("Geometry", "File Import", FileImportNode);
+	REGISTER_NODE("Geometry", "File Export", FileExportNode);
 
 	REGISTER_NODE("Attribute", "Attribute Create", CreateAttributeNode);
 	REGISTER_NODE("Attribute", "Attribute Delete", DeleteAttributeNode);
@@ -31,12 +31,18 @@
 void register_builtin_nodes(NodeFactory *factory);
 
 class OutputNode : public Node {
-	PrimitiveCollection *m_collection = nullptr;
-
 public:
 	explicit OutputNode(const std::string &name);
 
-	PrimitiveCollection *collection() const;
+	void process() override;
+};
+
+/* Stands in for a node whose type is not registered, e.g. because the plugin
+ * defining it is not loaded, so that a scene using it can still be opened, and
+ * saved back without losing the node, its properties nor its links. */
+class UnresolvedNode : public Node {
+public:
+	UnresolvedNode(const std::string &type, const std::string &name);
 
 	void process() override;
 };
@@ -24,7 +24,6 @@
 #include "grid.h"
 
 #include <algorithm>
-#include <ego/utils.h>
 #include <GL/glew.h>
 #include <numeric>
 
@@ -32,30 +31,24 @@
 
 static RenderBuffer *create_buffer(const glm::vec4 &color, float line_size)
 {
-	RenderBuffer *buffer = new RenderBuffer;
-
-	buffer->set_shader_source(ego::VERTEX_SHADER, ego::util::str_from_file("shaders/flat_shader.vert"));
-	buffer->set_shader_source(ego::FRAGMENT_SHADER, ego::util::str_from_file("shaders/flat_shader.frag"));
-	buffer->finalize_shader();
-
 	ProgramParams params;
 	params.add_attribute("vertex");
 	params.add_uniform("matrix");
 	params.add_uniform("MVP");
 	params.add_uniform("color");
+	params.add_uniform("has_vcolors");
 
-	buffer->set_shader_params(params);
+	RenderBuffer *buffer = new RenderBuffer;
+	buffer->set_program(get_program(shader_source("flat_shader.vert"),
+	                                shader_source("flat_shader.frag"),
+	                                params));
 
 	DrawParams draw_params;
 	draw_params.set_draw_type(GL_LINES);
 	draw_params.set_line_size(line_size);
 
 	buffer->set_draw_params(draw_params);
-
-	ego::Program *program = buffer->program();
-	program->enable();
-	program->uniform("color", color.r, color.g, color.b, color.a);
-	program->disable();
+	buffer->set_uniform("color", color);
 
 	return buffer;
 }
@@ -45,7 +45,14 @@ static std::vector<sf::shared_library> load_plugins(const fs::path &path)
 	std::vector<sf::shared_library> plugins;
 
 	std::error_code ec;
-	for (const auto &entry : fs::directory_iterator(path)) {
+	auto iter = fs::directory_iterator(path, ec);
+
+	if (ec) {
+		std::cerr << "Cannot open plugin directory " << path << ": " << ec.message() << '\n';
+		return plugins;
+	}
+
+	for (const auto &entry : iter) {
 		if (!sf::est_bibilotheque(entry)) {
 			continue;
 		}
@@ -70,9 +77,9 @@ Main::Main()
     , m_scene(new Scene)
 {}
 
-void Main::loadPlugins()
+void Main::loadPlugins(const std::string &path)
 {
-	m_plugins = load_plugins("plugins");
+	m_plugins = load_plugins(path);
 
 	std::error_code ec;
 	for (auto &plugin : m_plugins) {
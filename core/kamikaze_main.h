@@ -46,7 +46,8 @@ public:
 	Main &operator=(const Main &other) = delete;
 
 	void initialize();
-	void loadPlugins();
+	/* Load the plugins found in the given directory. */
+	void loadPlugins(const std::string &path = "plugins");
 
 	PrimitiveFactory *primitive_factory() const;
 	NodeFactory *node_factory() const;
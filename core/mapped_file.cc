@@ -0,0 +1,144 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string &path)
+{
+	close();
+
+	const auto fd = ::open(path.c_str(), O_RDONLY);
+
+	if (fd == -1) {
+		return false;
+	}
+
+	struct stat info;
+
+	if (fstat(fd, &info) == -1) {
+		::close(fd);
+		return false;
+	}
+
+	m_size = static_cast<size_t>(info.st_size);
+
+	/* Mapping an empty file fails, there is nothing to read anyway. */
+	if (m_size == 0) {
+		::close(fd);
+		return true;
+	}
+
+	auto data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	/* The mapping remains valid once the file is closed. */
+	::close(fd);
+
+	if (data == MAP_FAILED) {
+		m_size = 0;
+		return false;
+	}
+
+	m_data = static_cast<const char *>(data);
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_data != nullptr) {
+		munmap(const_cast<char *>(m_data), m_size);
+	}
+
+	m_data = nullptr;
+	m_size = 0;
+}
+
+bool MappedFile::is_open() const
+{
+	return m_data != nullptr;
+}
+
+const char *MappedFile::data() const
+{
+	return m_data;
+}
+
+size_t MappedFile::size() const
+{
+	return m_size;
+}
+
+/* ************************************************************************** */
+
+MemoryStreamBuf::MemoryStreamBuf(const char *data, size_t size)
+{
+	auto begin = const_cast<char *>(data);
+	setg(begin, begin, begin + size);
+}
+
+MemoryStreamBuf::pos_type MemoryStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+	if ((which & std::ios_base::in) == 0) {
+		return pos_type(off_type(-1));
+	}
+
+	char *base;
+
+	switch (dir) {
+		case std::ios_base::beg:
+			base = eback();
+			break;
+		case std::ios_base::end:
+			base = egptr();
+			break;
+		default:
+			base = gptr();
+			break;
+	}
+
+	auto pos = base + off;
+
+	if (pos < eback() || pos > egptr()) {
+		return pos_type(off_type(-1));
+	}
+
+	setg(eback(), pos, egptr());
+
+	return pos_type(pos - eback());
+}
+
+MemoryStreamBuf::pos_type MemoryStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+	return seekoff(off_type(pos), std::ios_base::beg, which);
+}
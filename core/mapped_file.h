@@ -0,0 +1,65 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <streambuf>
+#include <string>
+
+/* A file mapped in memory for reading. The pages of the file are only read
+ * from disk when first accessed, and are shared between the threads reading
+ * different parts of the file. */
+class MappedFile {
+	const char *m_data = nullptr;
+	size_t m_size = 0;
+
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	/* Disallow copy. */
+	MappedFile(const MappedFile &other) = delete;
+	MappedFile &operator=(const MappedFile &other) = delete;
+
+	/* Map the file at the given path, return false if it cannot be opened. */
+	bool open(const std::string &path);
+
+	void close();
+
+	bool is_open() const;
+
+	const char *data() const;
+	size_t size() const;
+};
+
+/* Stream buffer reading from a range of memory, e.g. a part of a mapped file,
+ * without copying it, to read it with the std::istream based functions. */
+class MemoryStreamBuf : public std::streambuf {
+public:
+	MemoryStreamBuf(const char *data, size_t size);
+
+protected:
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+	pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+};
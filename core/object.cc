@@ -25,6 +25,7 @@
 #include "object.h"
 
 #include <glm/gtc/matrix_transform.hpp>
+#include <memory>
 #include <kamikaze/context.h>
 #include <kamikaze/primitive.h>
 
@@ -33,8 +34,6 @@
 #include "scene.h"
 #include "task.h"
 
-#include "ui/paramfactory.h"
-
 Object::Object()
 {
 	add_input("Parent");
@@ -55,14 +54,24 @@ Object::Object()
 	updateMatrix();
 }
 
-PrimitiveCollection *Object::collection() const
+PrimitiveCollectionPtr Object::collection() const
+{
+	return std::atomic_load(&m_collection);
+}
+
+void Object::collection(PrimitiveCollectionPtr coll)
+{
+	m_evaluated_collection = std::move(coll);
+}
+
+void Object::publishCollection()
 {
-	return m_collection;
+	std::atomic_store(&m_collection, m_evaluated_collection);
 }
 
-void Object::collection(PrimitiveCollection *coll)
+void Object::publishCollection(PrimitiveCollectionPtr coll)
 {
-	m_collection = coll;
+	std::atomic_store(&m_collection, std::move(coll));
 }
 
 void Object::matrix(const glm::mat4 &m)
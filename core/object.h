@@ -28,10 +28,13 @@
 #include "graphs/scene_node.h"
 
 class Node;
-class PrimitiveCollection;
 
 class Object : public SceneNode {
-	PrimitiveCollection *m_collection = nullptr;
+	/* The collection displayed, only ever replaced as a whole, and the one
+	 * resulting from the ongoing evaluation, which is published once the
+	 * evaluation is complete. */
+	PrimitiveCollectionPtr m_collection{};
+	PrimitiveCollectionPtr m_evaluated_collection{};
 
 	glm::mat4 m_matrix = glm::mat4(0.0f);
 	glm::mat4 m_inv_matrix = glm::mat4(0.0f);
@@ -45,8 +48,21 @@ public:
 	Object();
 	~Object() = default;
 
-	PrimitiveCollection *collection() const;
-	void collection(PrimitiveCollection *coll);
+	/* Return the collection to display. It is not modified by the evaluations,
+	 * and remains valid for as long as the returned pointer is held, so it can
+	 * be used without locking while another evaluation is running. */
+	PrimitiveCollectionPtr collection() const;
+
+	/* Set the result of the evaluation of the object, which is not displayed
+	 * until publishCollection() is called. */
+	void collection(PrimitiveCollectionPtr coll);
+
+	/* Make the result of the last evaluation the collection to display. */
+	void publishCollection();
+
+	/* Make the given collection, e.g. a cached one, the collection to
+	 * display. */
+	void publishCollection(PrimitiveCollectionPtr coll);
 
 	/* Return the object's matrix. */
 	void matrix(const glm::mat4 &m);
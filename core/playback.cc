@@ -0,0 +1,210 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include "playback.h"
+
+#include <kamikaze/util_cancel.h>
+#include <kamikaze/util_trace.h>
+
+#include "scene.h"
+
+PlaybackEngine::PlaybackEngine(Scene *scene)
+    : m_scene(scene)
+    , m_token(std::make_shared<CancellationToken>())
+{}
+
+PlaybackEngine::~PlaybackEngine()
+{
+	stop();
+	m_tasks.wait();
+}
+
+void PlaybackEngine::start(const Context &context)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		/* A worker left from a previous playback exits on its own. */
+		m_token->cancel();
+		m_token = std::make_shared<CancellationToken>();
+		m_worker_running = false;
+	}
+
+	m_frames_shown = 0;
+	m_frames_held = 0;
+	m_frames_dropped = 0;
+
+	request_frames(context);
+}
+
+void PlaybackEngine::stop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_token->cancel();
+	m_queue.clear();
+}
+
+void PlaybackEngine::tick(const Context &context)
+{
+	const auto frame = next_frame(m_scene->currentFrame(), context.eval_ctx->time_direction);
+
+	if (m_scene->depsgraph()->publish_cached_frame(context, frame)) {
+		m_scene->currentFrame(frame);
+		++m_frames_shown;
+	}
+	else if (m_policy == PLAYBACK_DROP_FRAMES) {
+		m_scene->currentFrame(frame);
+		++m_frames_dropped;
+	}
+	else {
+		++m_frames_held;
+	}
+
+	request_frames(context);
+}
+
+void PlaybackEngine::look_ahead(int frames)
+{
+	m_look_ahead = frames;
+}
+
+int PlaybackEngine::look_ahead() const
+{
+	return m_look_ahead;
+}
+
+void PlaybackEngine::policy(int value)
+{
+	m_policy = value;
+}
+
+int PlaybackEngine::policy() const
+{
+	return m_policy;
+}
+
+size_t PlaybackEngine::frames_shown() const
+{
+	return m_frames_shown;
+}
+
+size_t PlaybackEngine::frames_held() const
+{
+	return m_frames_held;
+}
+
+size_t PlaybackEngine::frames_dropped() const
+{
+	return m_frames_dropped;
+}
+
+int PlaybackEngine::next_frame(int frame, char direction) const
+{
+	if (direction == TIME_DIR_FORWARD) {
+		++frame;
+
+		if (frame > m_scene->endFrame()) {
+			frame = m_scene->startFrame();
+		}
+	}
+	else {
+		--frame;
+
+		if (frame < m_scene->startFrame()) {
+			frame = m_scene->endFrame();
+		}
+	}
+
+	return frame;
+}
+
+void PlaybackEngine::request_frames(const Context &context)
+{
+	auto depsgraph = m_scene->depsgraph();
+	auto frame = m_scene->currentFrame();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if (m_token->cancelled()) {
+		return;
+	}
+
+	/* Frames which were queued but are now behind the current frame are not
+	 * needed anymore. */
+	m_queue.clear();
+
+	for (auto i = 0; i < m_look_ahead; ++i) {
+		frame = next_frame(frame, context.eval_ctx->time_direction);
+
+		if (!depsgraph->frame_cached(frame)) {
+			m_queue.push_back(frame);
+		}
+	}
+
+	if (m_queue.empty() || m_worker_running) {
+		return;
+	}
+
+	m_worker_running = true;
+
+	auto token = m_token;
+
+	/* The worker may outlive the evaluation context of the caller. */
+	auto eval_ctx = *context.eval_ctx;
+
+	m_tasks.run([this, context, eval_ctx, token]()
+	{
+		run_worker(context, eval_ctx, token);
+	});
+}
+
+void PlaybackEngine::run_worker(Context context, EvaluationContext eval_ctx, std::shared_ptr<CancellationToken> token)
+{
+	TRACE_SPAN("PlaybackEngine::run_worker");
+
+	auto depsgraph = m_scene->depsgraph();
+	context.eval_ctx = &eval_ctx;
+
+	while (true) {
+		int frame;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			if (token->cancelled() || m_queue.empty()) {
+				if (token == m_token) {
+					m_worker_running = false;
+				}
+
+				return;
+			}
+
+			frame = m_queue.front();
+			m_queue.pop_front();
+		}
+
+		depsgraph->prefetch_frame(context, frame, token.get());
+	}
+}
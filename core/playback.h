@@ -0,0 +1,102 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include <tbb/task_group.h>
+
+#include "context.h"
+
+class CancellationToken;
+class Scene;
+
+enum {
+	/* Wait for the next frame to be evaluated before showing it. */
+	PLAYBACK_HOLD_FRAMES = 0,
+	/* Keep advancing at the scene rate, skipping the frames which are not
+	 * evaluated in time. */
+	PLAYBACK_DROP_FRAMES = 1,
+};
+
+/* Plays the scene's animation back by evaluating the frames ahead of the
+ * current frame on a worker thread, in the direction of the playback, into the
+ * frame cache of the depsgraph. Each tick shows the next frame if it is ready,
+ * otherwise the frame is held or dropped depending on the policy. */
+class PlaybackEngine {
+	Scene *m_scene = nullptr;
+
+	int m_look_ahead = 8;
+	int m_policy = PLAYBACK_HOLD_FRAMES;
+
+	/* Frames left to evaluate, shared with the worker. */
+	std::deque<int> m_queue{};
+	std::mutex m_mutex{};
+	bool m_worker_running = false;
+
+	std::shared_ptr<CancellationToken> m_token;
+	tbb::task_group m_tasks{};
+
+	size_t m_frames_shown = 0;
+	size_t m_frames_held = 0;
+	size_t m_frames_dropped = 0;
+
+public:
+	explicit PlaybackEngine(Scene *scene);
+	~PlaybackEngine();
+
+	/* Disallow copy. */
+	PlaybackEngine(const PlaybackEngine &other) = delete;
+	PlaybackEngine &operator=(const PlaybackEngine &other) = delete;
+
+	void start(const Context &context);
+	void stop();
+
+	/* Advance the playback by one frame, to be called at the scene rate. */
+	void tick(const Context &context);
+
+	void look_ahead(int frames);
+	int look_ahead() const;
+
+	void policy(int value);
+	int policy() const;
+
+	size_t frames_shown() const;
+
+	/* Number of ticks for which the next frame was not ready, and the current
+	 * frame was kept, see PLAYBACK_HOLD_FRAMES. */
+	size_t frames_held() const;
+
+	/* Number of ticks for which the next frame was not ready, and was skipped,
+	 * see PLAYBACK_DROP_FRAMES. */
+	size_t frames_dropped() const;
+
+private:
+	int next_frame(int frame, char direction) const;
+	void request_frames(const Context &context);
+	void run_worker(Context context, EvaluationContext eval_ctx, std::shared_ptr<CancellationToken> token);
+};
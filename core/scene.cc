@@ -42,6 +42,9 @@ void Scene::removeObject(SceneNode *node)
 
 	notify_listeners(event_type::object | event_type::removed);
 
+	m_eval_requests.erase(std::remove(m_eval_requests.begin(), m_eval_requests.end(), node),
+	                      m_eval_requests.end());
+
 	m_depsgraph.remove_node(node);
 
 	if (node == m_active_node) {
@@ -51,6 +54,13 @@ void Scene::removeObject(SceneNode *node)
 	m_nodes.erase(iter);
 }
 
+void Scene::clear()
+{
+	while (!m_nodes.empty()) {
+		removeObject(m_nodes.back().get());
+	}
+}
+
 void Scene::addObject(SceneNode *node)
 {
 	auto name = node->name();
@@ -80,11 +90,17 @@ void Scene::selectObject(const glm::vec3 &pos)
 	for (auto &node : m_nodes) {
 		auto object = static_cast<Object *>(node.get());
 
-		if (!object || !object->collection()) {
+		if (!object) {
 			continue;
 		}
 
-		for (const auto &prim : object->collection()->primitives()) {
+		const auto collection = object->collection();
+
+		if (!collection) {
+			continue;
+		}
+
+		for (const auto &prim : collection->primitives()) {
 			float dist = glm::distance(prim->pos(), pos);
 
 			if (/*dist < 1.0f &&*/ dist < min) {
@@ -107,6 +123,11 @@ Depsgraph *Scene::depsgraph()
 	return &m_depsgraph;
 }
 
+PlaybackEngine *Scene::playback()
+{
+	return &m_playback;
+}
+
 SceneNode *Scene::active_node()
 {
 	if (!m_nodes.empty()) {
@@ -126,8 +147,10 @@ void Scene::tagObjectUpdate()
 
 	object->updateMatrix();
 
-	if (object->collection()) {
-		for (auto &prim : object->collection()->primitives()) {
+	const auto collection = object->collection();
+
+	if (collection) {
+		for (auto &prim : collection->primitives()) {
 			prim->tagUpdate();
 		}
 	}
@@ -157,12 +180,61 @@ void Scene::set_active_node(SceneNode *node)
 
 void Scene::updateForNewFrame(const Context &context)
 {
-	m_depsgraph.evaluate_for_time_change(context);
+	/* Only evaluate the objects if the frame was not evaluated before. */
+	if (!m_depsgraph.publish_cached_frame(context, m_cur_frame)) {
+		m_depsgraph.evaluate_for_time_change(context);
+	}
 }
 
 void Scene::evalObjectDag(const Context &context, SceneNode *node)
 {
-	m_depsgraph.evaluate(context, node);
+	if (node == nullptr) {
+		return;
+	}
+
+	++m_evals_requested;
+	m_eval_context = context;
+
+	if (std::find(m_eval_requests.begin(), m_eval_requests.end(), node) == m_eval_requests.end()) {
+		m_eval_requests.push_back(node);
+	}
+
+	if (!m_eval_scheduler) {
+		flushEvaluations();
+		return;
+	}
+
+	if (!m_eval_scheduled) {
+		m_eval_scheduled = true;
+		m_eval_scheduler();
+	}
+}
+
+void Scene::flushEvaluations()
+{
+	m_eval_scheduled = false;
+
+	/* Requests made while evaluating are left for the next flush. */
+	std::vector<SceneNode *> requests;
+	requests.swap(m_eval_requests);
+
+	m_evals_executed += m_depsgraph.evaluate(m_eval_context, requests);
+}
+
+void Scene::evaluationScheduler(std::function<void()> scheduler)
+{
+	m_eval_scheduler = std::move(scheduler);
+	m_eval_scheduled = false;
+}
+
+size_t Scene::evaluationsRequested() const
+{
+	return m_evals_requested;
+}
+
+size_t Scene::evaluationsExecuted() const
+{
+	return m_evals_executed;
 }
 
 void Scene::connect(const Context &context, SceneNode *node_from, SceneNode *node_to)
@@ -176,7 +248,7 @@ void Scene::connect(const Context &context, SceneNode *node_from, SceneNode *nod
 	node_from->outputs()[0]->links.push_back(node_to->inputs()[0].get());
 
 	m_depsgraph.connect(node_from, node_to);
-	m_depsgraph.evaluate(context, node_from);
+	evalObjectDag(context, node_from);
 }
 
 void Scene::disconnect(const Context &context, SceneNode *node_from, SceneNode *node_to)
@@ -199,7 +271,7 @@ void Scene::disconnect(const Context &context, SceneNode *node_from, SceneNode *
 	from->links.erase(iter);
 
 	m_depsgraph.disconnect(node_from, node_to);
-	m_depsgraph.evaluate(context, node_to);
+	evalObjectDag(context, node_to);
 }
 
 int Scene::flags() const
@@ -24,12 +24,13 @@
 
 #pragma once
 
-#include <QString>
+#include <functional>
 
 #include <kamikaze/util_render.h>
 
 #include "context.h"
 #include "object.h"
+#include "playback.h"
 #include "graphs/depsgraph.h"
 
 class Depsgraph;
@@ -49,6 +50,7 @@ class Scene : public Listened {
 	int m_mode = 0;
 
 	Depsgraph m_depsgraph{};
+	PlaybackEngine m_playback{this};
 
 	int m_start_frame = 0;
 	int m_end_frame = 250;
@@ -57,6 +59,17 @@ class Scene : public Listened {
 
 	int m_flags = 0;
 
+	/* Evaluation requests are merged per depsgraph root and run when the
+	 * queue is flushed, either by the scheduler or right away when there is
+	 * none. */
+	std::vector<SceneNode *> m_eval_requests = {};
+	Context m_eval_context{};
+	std::function<void()> m_eval_scheduler = nullptr;
+	bool m_eval_scheduled = false;
+
+	size_t m_evals_requested = 0;
+	size_t m_evals_executed = 0;
+
 public:
 	Scene() = default;
 	~Scene() = default;
@@ -67,12 +80,17 @@ public:
 	void addObject(SceneNode *node);
 	void removeObject(SceneNode *node);
 
+	/* Remove all the objects. */
+	void clear();
+
 	void intersect(const Ray &ray);
 
 	void selectObject(const glm::vec3 &pos);
 
 	Depsgraph *depsgraph();
 
+	PlaybackEngine *playback();
+
 	/* Time/Frame */
 
 	int startFrame() const;
@@ -94,6 +112,16 @@ public:
 	void tagObjectUpdate();
 
 	void evalObjectDag(const Context &context, SceneNode *node);
+	void flushEvaluations();
+
+	/* The scheduler is called once for the first request made after a flush,
+	 * and is expected to call flushEvaluations() later on. A scheduler which
+	 * never flushes leaves the requests pending, e.g. when the frames are
+	 * evaluated otherwise, see Depsgraph::evaluate_frame(). */
+	void evaluationScheduler(std::function<void()> scheduler);
+
+	size_t evaluationsRequested() const;
+	size_t evaluationsExecuted() const;
 
 	void connect(const Context &context, SceneNode *node_from, SceneNode *node_to);
 	void disconnect(const Context &context, SceneNode *node_from, SceneNode *node_to);
@@ -0,0 +1,703 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include "scene_file.h"
+
+#include <kamikaze/nodes.h>
+#include <kamikaze/primitive.h>
+#include <kamikaze/util_binary.h>
+#include <kamikaze/util_parallel.h>
+#include <kamikaze/util_trace.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+#include "graphs/object_graph.h"
+#include "graphs/object_nodes.h"
+
+#include "context.h"
+#include "mapped_file.h"
+#include "object.h"
+#include "scene.h"
+
+static constexpr char SCENE_FILE_MAGIC[8] = { 'K', 'M', 'K', 'S', 'C', 'E', 'N', 'E' };
+static constexpr uint32_t SCENE_FILE_VERSION = 1;
+
+/* ******************************** properties ****************************** */
+
+static void write_prop_value(std::ostream &os, const Property &prop)
+{
+	using std::experimental::any_cast;
+
+	switch (prop.desc->type) {
+		case property_type::prop_bool:
+			write_binary(os, static_cast<uint8_t>(any_cast<bool>(prop.data)));
+			break;
+		case property_type::prop_int:
+		case property_type::prop_enum:
+			write_binary(os, static_cast<int32_t>(any_cast<int>(prop.data)));
+			break;
+		case property_type::prop_float:
+			write_binary(os, any_cast<float>(prop.data));
+			break;
+		case property_type::prop_vec3:
+			write_binary(os, any_cast<glm::vec3>(prop.data));
+			break;
+		case property_type::prop_input_file:
+		case property_type::prop_output_file:
+		case property_type::prop_string:
+		case property_type::prop_list:
+		{
+			const auto &str = any_cast<std::string>(prop.data);
+			write_binary(os, str.data(), str.size());
+			break;
+		}
+	}
+}
+
+static bool read_prop_value(const std::string &value, Property &prop)
+{
+	MemoryStreamBuf buffer(value.data(), value.size());
+	std::istream is(&buffer);
+
+	switch (prop.desc->type) {
+		case property_type::prop_bool:
+		{
+			uint8_t b;
+
+			if (!read_binary(is, b)) {
+				return false;
+			}
+
+			prop.data = (b != 0);
+			return true;
+		}
+		case property_type::prop_int:
+		case property_type::prop_enum:
+		{
+			int32_t i;
+
+			if (!read_binary(is, i)) {
+				return false;
+			}
+
+			prop.data = static_cast<int>(i);
+			return true;
+		}
+		case property_type::prop_float:
+		{
+			float f;
+
+			if (!read_binary(is, f)) {
+				return false;
+			}
+
+			prop.data = f;
+			return true;
+		}
+		case property_type::prop_vec3:
+		{
+			glm::vec3 v;
+
+			if (!read_binary(is, v)) {
+				return false;
+			}
+
+			prop.data = v;
+			return true;
+		}
+		case property_type::prop_input_file:
+		case property_type::prop_output_file:
+		case property_type::prop_string:
+		case property_type::prop_list:
+			prop.data = value;
+			return true;
+	}
+
+	return false;
+}
+
+/* Each value is written as a string holding its bytes, so that the values of
+ * unknown properties can be skipped. */
+static void write_props(std::ostream &os, Persona &persona)
+{
+	auto &props = persona.props();
+
+	write_binary(os, static_cast<uint64_t>(props.size()));
+
+	std::ostringstream value;
+
+	for (const auto &prop : props) {
+		value.str("");
+		write_prop_value(value, prop);
+
+		write_binary(os, prop.desc->name);
+		write_binary(os, static_cast<uint8_t>(prop.desc->type));
+		write_binary(os, value.str());
+	}
+}
+
+/* Read the values of the properties of a persona. Properties which the persona
+ * does not have, or whose type changed, are ignored unless add_missing is true,
+ * in which case they are added to the persona. */
+static bool read_props(std::istream &is, Persona &persona, bool add_missing)
+{
+	uint64_t num_props;
+
+	if (!read_binary(is, num_props)) {
+		return false;
+	}
+
+	std::string name, value;
+
+	for (auto i = 0ul; i < num_props; ++i) {
+		uint8_t type;
+
+		if (!read_binary(is, name) || !read_binary(is, type) || !read_binary(is, value)) {
+			return false;
+		}
+
+		if (type > static_cast<uint8_t>(property_type::prop_list)) {
+			continue;
+		}
+
+		auto &props = persona.props();
+		auto iter = std::find_if(props.begin(), props.end(), [&](const Property &prop)
+		{
+			return prop.desc->name == name;
+		});
+
+		if (iter == props.end()) {
+			if (!add_missing) {
+				continue;
+			}
+
+			persona.add_prop(name, name, static_cast<property_type>(type));
+			iter = props.end() - 1;
+		}
+		else if (iter->desc->type != static_cast<property_type>(type)) {
+			continue;
+		}
+
+		if (!read_prop_value(value, *iter)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* ********************************** graphs ******************************** */
+
+static void write_sockets(std::ostream &os, const std::vector<std::string> &names)
+{
+	write_binary(os, static_cast<uint64_t>(names.size()));
+
+	for (const auto &name : names) {
+		write_binary(os, name);
+	}
+}
+
+static bool read_sockets(std::istream &is, std::vector<std::string> &r_names)
+{
+	uint64_t num_sockets;
+
+	/* Each name is written with its size. */
+	if (!read_binary(is, num_sockets) || !binary_count_fits(is, num_sockets, sizeof(uint64_t))) {
+		return false;
+	}
+
+	r_names.resize(num_sockets);
+
+	for (auto &name : r_names) {
+		if (!read_binary(is, name)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void write_graph(std::ostream &os, const Graph &graph)
+{
+	const auto &nodes = graph.nodes();
+	std::unordered_map<const Node *, uint64_t> indices;
+
+	write_binary(os, static_cast<uint64_t>(nodes.size()));
+
+	for (const auto &node : nodes) {
+		const auto index = indices.size();
+		indices[node.get()] = index;
+
+		std::vector<std::string> inputs, outputs;
+
+		for (const auto &input : node->inputs()) {
+			inputs.push_back(input->name);
+		}
+
+		for (const auto &output : node->outputs()) {
+			outputs.push_back(output->name);
+		}
+
+		write_binary(os, node->type());
+		write_binary(os, node->name());
+		write_binary(os, node->xpos());
+		write_binary(os, node->ypos());
+		write_binary(os, static_cast<int32_t>(node->flags()));
+		write_sockets(os, inputs);
+		write_sockets(os, outputs);
+		write_props(os, *node);
+	}
+
+	struct Link {
+		uint64_t from_node;
+		uint64_t from_output;
+		uint64_t to_node;
+		uint64_t to_input;
+	};
+
+	std::vector<Link> links;
+
+	for (const auto &node : nodes) {
+		const auto inputs = node->inputs();
+
+		for (auto i = 0ul; i < inputs.size(); ++i) {
+			const auto output = inputs[i]->link;
+
+			if (output == nullptr) {
+				continue;
+			}
+
+			const auto parent_outputs = output->parent->outputs();
+			const auto iter = std::find(parent_outputs.begin(), parent_outputs.end(), output);
+
+			Link link;
+			link.from_node = indices[output->parent];
+			link.from_output = std::distance(parent_outputs.begin(), iter);
+			link.to_node = indices[node.get()];
+			link.to_input = i;
+
+			links.push_back(link);
+		}
+	}
+
+	write_binary(os, static_cast<uint64_t>(links.size()));
+	write_binary(os, links.data(), links.size());
+}
+
+static bool read_graph(std::istream &is, const Context &context, Object &object)
+{
+	auto graph = object.graph();
+	uint64_t num_nodes;
+
+	/* Each node is written with at least its type and name. */
+	if (!read_binary(is, num_nodes) || num_nodes == 0
+	    || !binary_count_fits(is, num_nodes, 2 * sizeof(uint64_t)))
+	{
+		return false;
+	}
+
+	std::vector<Node *> nodes;
+	nodes.reserve(num_nodes);
+
+	std::string type, name;
+	std::vector<std::string> inputs, outputs;
+
+	for (auto i = 0ul; i < num_nodes; ++i) {
+		float xpos, ypos;
+		int32_t flags;
+
+		if (!read_binary(is, type) || !read_binary(is, name)
+		    || !read_binary(is, xpos) || !read_binary(is, ypos) || !read_binary(is, flags)
+		    || !read_sockets(is, inputs) || !read_sockets(is, outputs))
+		{
+			return false;
+		}
+
+		Node *node;
+		auto resolved = true;
+
+		/* The output node is created along with the graph, and written first. */
+		if (i == 0) {
+			node = graph->output();
+
+			if (type != node->type()) {
+				return false;
+			}
+		}
+		else if (context.node_factory->registered(type)) {
+			node = (*context.node_factory)(type);
+			graph->add(node);
+		}
+		else {
+			node = new UnresolvedNode(type, name);
+			resolved = false;
+
+			for (const auto &input : inputs) {
+				node->addInput(input);
+			}
+
+			for (const auto &output : outputs) {
+				node->addOutput(output);
+			}
+
+			graph->add(node);
+		}
+
+		node->name(name);
+		node->xpos(xpos);
+		node->ypos(ypos);
+		node->set_flags(flags);
+
+		if (!read_props(is, *node, !resolved)) {
+			return false;
+		}
+
+		node->update_properties();
+		nodes.push_back(node);
+	}
+
+	uint64_t num_links;
+
+	if (!read_binary(is, num_links)) {
+		return false;
+	}
+
+	for (auto i = 0ul; i < num_links; ++i) {
+		uint64_t from_node, from_output, to_node, to_input;
+
+		if (!read_binary(is, from_node) || !read_binary(is, from_output)
+		    || !read_binary(is, to_node) || !read_binary(is, to_input))
+		{
+			return false;
+		}
+
+		/* The sockets of the node types may have changed since the file was
+		 * written. */
+		if (from_node >= nodes.size() || to_node >= nodes.size()
+		    || from_output >= nodes[from_node]->outputs().size()
+		    || to_input >= nodes[to_node]->inputs().size()
+		    || nodes[to_node]->input(to_input)->link != nullptr)
+		{
+			std::cerr << "Ignoring invalid link in the graph of object '" << object.name() << "'\n";
+			continue;
+		}
+
+		graph->connect(nodes[from_node]->output(from_output), nodes[to_node]->input(to_input));
+	}
+
+	return true;
+}
+
+/* ********************************* objects ******************************** */
+
+static void write_object(std::ostream &os, Object &object, int flags)
+{
+	write_binary(os, object.name());
+	write_binary(os, object.xpos());
+	write_binary(os, object.ypos());
+	write_binary(os, static_cast<int32_t>(object.flags()));
+	write_props(os, object);
+	write_graph(os, *object.graph());
+
+	const auto collection = object.collection();
+
+	if ((flags & SCENE_FILE_CACHES) == 0 || collection == nullptr) {
+		write_binary(os, static_cast<uint8_t>(0));
+		return;
+	}
+
+	write_binary(os, static_cast<uint8_t>(1));
+	collection->write(os);
+}
+
+static bool read_object(std::istream &is, const Context &context, Object &object, PrimitiveCollectionPtr &r_cache)
+{
+	std::string name;
+	float xpos, ypos;
+	int32_t flags;
+
+	if (!read_binary(is, name) || !read_binary(is, xpos) || !read_binary(is, ypos) || !read_binary(is, flags)) {
+		return false;
+	}
+
+	object.name(name);
+	object.xpos(xpos);
+	object.ypos(ypos);
+	object.set_flags(flags);
+
+	if (!read_props(is, object, false)) {
+		return false;
+	}
+
+	object.updateMatrix();
+
+	if (!read_graph(is, context, object)) {
+		return false;
+	}
+
+	uint8_t has_cache;
+
+	if (!read_binary(is, has_cache)) {
+		return false;
+	}
+
+	if (has_cache == 0) {
+		return true;
+	}
+
+	auto collection = std::make_shared<PrimitiveCollection>(context.primitive_factory);
+
+	if (!collection->read(is)) {
+		return false;
+	}
+
+	for (auto prim : collection->primitives()) {
+		prim->packRenderData();
+	}
+
+	r_cache = std::move(collection);
+
+	return true;
+}
+
+/* ********************************** scenes ******************************** */
+
+bool write_scene(const Context &context, const std::string &path, int flags, std::string &r_error)
+{
+	TRACE_SPAN("write_scene");
+
+	auto scene = context.scene;
+	const auto &scene_nodes = scene->nodes();
+
+	std::unordered_map<const SceneNode *, uint64_t> indices;
+
+	for (const auto &scene_node : scene_nodes) {
+		const auto index = indices.size();
+		indices[scene_node.get()] = index;
+	}
+
+	/* The records are written concurrently, as their offsets in the file are
+	 * only known once all of them are written. */
+	std::vector<std::string> records(scene_nodes.size());
+
+	parallel_for_heavy_items(tbb::blocked_range<size_t>(0, scene_nodes.size()),
+	                         [&](const tbb::blocked_range<size_t> &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+			std::ostringstream os;
+			write_object(os, *static_cast<Object *>(scene_nodes[i].get()), flags);
+			records[i] = os.str();
+		}
+	});
+
+	std::ofstream os(path, std::ios::binary);
+
+	if (!os.is_open()) {
+		r_error = "Cannot open file '" + path + "' for writing";
+		return false;
+	}
+
+	write_binary(os, SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC));
+	write_binary(os, SCENE_FILE_VERSION);
+	write_binary(os, static_cast<uint32_t>(flags));
+	write_binary(os, static_cast<int32_t>(scene->startFrame()));
+	write_binary(os, static_cast<int32_t>(scene->endFrame()));
+	write_binary(os, static_cast<int32_t>(scene->currentFrame()));
+	write_binary(os, scene->framesPerSecond());
+	write_binary(os, static_cast<uint64_t>(records.size()));
+
+	/* The offsets of the records, and of the links which follow them. */
+	uint64_t offset = static_cast<uint64_t>(os.tellp()) + (records.size() + 1) * sizeof(uint64_t);
+
+	for (const auto &record : records) {
+		write_binary(os, offset);
+		offset += record.size();
+	}
+
+	write_binary(os, offset);
+
+	for (const auto &record : records) {
+		write_binary(os, record.data(), record.size());
+	}
+
+	std::vector<std::pair<uint64_t, uint64_t>> links;
+
+	for (const auto &scene_node : scene_nodes) {
+		for (const auto &input : scene_node->inputs()) {
+			if (input->link != nullptr) {
+				links.emplace_back(indices[input->link->parent], indices[scene_node.get()]);
+			}
+		}
+	}
+
+	write_binary(os, static_cast<uint64_t>(links.size()));
+
+	for (const auto &link : links) {
+		write_binary(os, link.first);
+		write_binary(os, link.second);
+	}
+
+	if (!os.good()) {
+		r_error = "Cannot write file '" + path + "'";
+		return false;
+	}
+
+	return true;
+}
+
+bool read_scene(const Context &context, const std::string &path, std::string &r_error)
+{
+	TRACE_SPAN("read_scene");
+
+	MappedFile file;
+
+	if (!file.open(path)) {
+		r_error = "Cannot open file '" + path + "'";
+		return false;
+	}
+
+	MemoryStreamBuf buffer(file.data(), file.size());
+	std::istream is(&buffer);
+
+	char magic[sizeof(SCENE_FILE_MAGIC)];
+	uint32_t version, flags;
+	int32_t start_frame, end_frame, current_frame;
+	float fps;
+	uint64_t num_objects;
+
+	if (!read_binary(is, magic, sizeof(magic)) || std::memcmp(magic, SCENE_FILE_MAGIC, sizeof(magic)) != 0) {
+		r_error = "File '" + path + "' is not a scene file";
+		return false;
+	}
+
+	if (!read_binary(is, version) || version > SCENE_FILE_VERSION) {
+		r_error = "File '" + path + "' was written with a newer version of the scene format";
+		return false;
+	}
+
+	if (!read_binary(is, flags) || !read_binary(is, start_frame) || !read_binary(is, end_frame)
+	    || !read_binary(is, current_frame) || !read_binary(is, fps) || !read_binary(is, num_objects)
+	    || !binary_count_fits(is, num_objects, sizeof(uint64_t)))
+	{
+		r_error = "File '" + path + "' is corrupted";
+		return false;
+	}
+
+	std::vector<uint64_t> offsets(num_objects + 1);
+
+	/* The records follow the table of offsets. */
+	if (!read_binary(is, offsets.data(), offsets.size())
+	    || offsets.front() < static_cast<uint64_t>(is.tellg())
+	    || !std::is_sorted(offsets.begin(), offsets.end())
+	    || offsets.back() > file.size())
+	{
+		r_error = "File '" + path + "' is corrupted";
+		return false;
+	}
+
+	/* Each object is read from its own part of the file. */
+	std::vector<std::unique_ptr<Object>> objects(num_objects);
+	std::vector<PrimitiveCollectionPtr> caches(num_objects);
+	std::vector<char> valid(num_objects, 0);
+
+	parallel_for_heavy_items(tbb::blocked_range<size_t>(0, num_objects),
+	                         [&](const tbb::blocked_range<size_t> &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie; ++i) {
+			MemoryStreamBuf object_buffer(file.data() + offsets[i], offsets[i + 1] - offsets[i]);
+			std::istream object_is(&object_buffer);
+
+			objects[i].reset(new Object);
+			valid[i] = read_object(object_is, context, *objects[i], caches[i]);
+		}
+	});
+
+	if (std::find(valid.begin(), valid.end(), 0) != valid.end()) {
+		r_error = "File '" + path + "' is corrupted";
+		return false;
+	}
+
+	MemoryStreamBuf links_buffer(file.data() + offsets.back(), file.size() - offsets.back());
+	std::istream links_is(&links_buffer);
+	std::vector<std::pair<uint64_t, uint64_t>> links;
+	uint64_t num_links;
+
+	if (!read_binary(links_is, num_links) || !binary_count_fits(links_is, num_links, 2 * sizeof(uint64_t))) {
+		r_error = "File '" + path + "' is corrupted";
+		return false;
+	}
+
+	for (auto i = 0ul; i < num_links; ++i) {
+		uint64_t from, to;
+
+		if (!read_binary(links_is, from) || !read_binary(links_is, to)
+		    || from >= num_objects || to >= num_objects)
+		{
+			r_error = "File '" + path + "' is corrupted";
+			return false;
+		}
+
+		links.emplace_back(from, to);
+	}
+
+	/* The file was read entirely, the scene can be replaced. */
+	auto scene = context.scene;
+	scene->clear();
+	scene->startFrame(start_frame);
+	scene->endFrame(end_frame);
+	scene->currentFrame(current_frame);
+	scene->framesPerSecond(fps);
+
+	std::vector<Object *> scene_objects;
+	scene_objects.reserve(num_objects);
+
+	for (auto i = 0ul; i < num_objects; ++i) {
+		auto object = objects[i].release();
+
+		if (caches[i] != nullptr) {
+			object->publishCollection(caches[i]);
+		}
+
+		scene->addObject(object);
+		scene_objects.push_back(object);
+	}
+
+	for (const auto &link : links) {
+		scene->connect(context, scene_objects[link.first], scene_objects[link.second]);
+	}
+
+	/* The objects whose collections were not stored are evaluated. */
+	for (auto i = 0ul; i < num_objects; ++i) {
+		if (caches[i] == nullptr) {
+			scene->evalObjectDag(context, scene_objects[i]);
+		}
+	}
+
+	return true;
+}
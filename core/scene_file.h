@@ -0,0 +1,63 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <string>
+
+struct Context;
+
+/* Binary scene files.
+ *
+ * A file starts with a header: the magic bytes "KMKSCENE", the version of the
+ * format, the flags it was written with, and the frame range and rate of the
+ * scene. It is followed by a table holding the offset of the record of each
+ * object, so that the objects can be read concurrently, and by the records.
+ * The links between the objects come last.
+ *
+ * The record of an object holds its properties and its graph: the type, name,
+ * position, sockets and properties of each node, and the links between them,
+ * and optionally the collection the object last output. Properties are stored
+ * by name along with their type and size, so that properties added to, or
+ * removed from, a node type do not prevent reading older files, and nodes of
+ * types which are not registered, for example because a plugin is not loaded,
+ * are read as UnresolvedNode, and written back as they were read. Readers
+ * ignore the data at the end of the records which they do not know about, so
+ * that new versions of the format can append data to them. */
+
+enum {
+	/* Store the collections of the objects, to display them without having to
+	 * evaluate the scene first. */
+	SCENE_FILE_CACHES = (1 << 0),
+};
+
+/* Write the scene of the context to the given path. Return false, and set
+ * r_error to the reason why, if the file could not be written. */
+bool write_scene(const Context &context, const std::string &path, int flags, std::string &r_error);
+
+/* Replace the objects of the scene of the context with the ones of the scene
+ * file at the given path, and use its frame range and rate. Return false, and
+ * set r_error to the reason why, if the file could not be read, in which case
+ * the scene is left untouched. */
+bool read_scene(const Context &context, const std::string &path, std::string &r_error);
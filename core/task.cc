@@ -24,56 +24,27 @@
 
 #include "task.h"
 
-#include "ui/mainwindow.h"
+#include "context.h"
 
-/* ************************ */
-
-TaskNotifier::TaskNotifier(MainWindow *window)
+Task::Task(const Context &context)
+    : m_context(context)
 {
-	if (!window) {
-		return;
+	if (context.notifier_factory != nullptr) {
+		m_notifier.reset(context.notifier_factory->create_notifier());
 	}
-
-	connect(this, SIGNAL(startTask()), window, SLOT(taskStarted()));
-	connect(this, SIGNAL(updateProgress(float)), window, SLOT(updateProgress(float)));
-	connect(this, SIGNAL(endTask()), window, SLOT(taskEnded()));
-	connect(this, SIGNAL(nodeProcessed()), window, SLOT(nodeProcessed()));
-}
-
-void TaskNotifier::signalStart()
-{
-	Q_EMIT(startTask());
-}
-
-void TaskNotifier::signalProgressUpdate(float progress)
-{
-	Q_EMIT(updateProgress(progress));
-}
-
-void TaskNotifier::signalEnd()
-{
-	Q_EMIT(endTask());
-}
-
-void TaskNotifier::signalNodeProcessed()
-{
-	Q_EMIT(nodeProcessed());
 }
 
-/* ************************ */
-
-Task::Task(const Context &context)
-    : m_notifier(new TaskNotifier(context.main_window))
-    , m_context(context)
-{}
-
 tbb::task *Task::execute()
 {
-	m_notifier->signalStart();
+	if (m_notifier) {
+		m_notifier->signalStart();
+	}
 
 	this->start(this->m_context);
 
-	m_notifier->signalEnd();
+	if (m_notifier) {
+		m_notifier->signalEnd();
+	}
 
 	return nullptr;
 }
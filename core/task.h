@@ -25,32 +25,33 @@
 #pragma once
 
 #include <memory>
-#include <QObject>
+#include <string>
 #include <tbb/task.h>
 
 class Context;
-class MainWindow;
-
-/* Apparently we can not have a class derived from both a QObject and a
- * tbb::task so this class is to be used in conjunction with a tbb::task derived
- * class to notify the UI about certain events.
- */
-class TaskNotifier : public QObject {
-	Q_OBJECT
 
+/* Interface used by the tasks to notify the user interface, if any, about
+ * their progress. The notifications are sent from the threads running the
+ * tasks. */
+class TaskNotifier {
 public:
-	explicit TaskNotifier(MainWindow *window);
+	virtual ~TaskNotifier() = default;
+
+	virtual void signalStart() = 0;
+	virtual void signalProgressUpdate(float progress) = 0;
+	virtual void signalEnd() = 0;
+	virtual void signalNodeProcessed() = 0;
 
-	void signalStart();
-	void signalProgressUpdate(float progress);
-	void signalEnd();
-	void signalNodeProcessed();
+	/* Show a short message to the user, e.g. some statistics. */
+	virtual void signalMessage(const std::string &text) = 0;
+};
+
+/* Creates the notifiers of the tasks, see Context::notifier_factory. */
+class TaskNotifierFactory {
+public:
+	virtual ~TaskNotifierFactory() = default;
 
-Q_SIGNALS:
-	void startTask();
-	void updateProgress(float progress);
-	void endTask();
-	void nodeProcessed();
+	virtual TaskNotifier *create_notifier() = 0;
 };
 
 class Task : public tbb::task {
@@ -73,3 +73,9 @@ void CommandManager::redo()
 {
 	undo_redo_ex(m_redo_commands, m_undo_commands, true);
 }
+
+void CommandManager::clear()
+{
+	release_stack_memory(m_undo_commands);
+	release_stack_memory(m_redo_commands);
+}
@@ -56,6 +56,9 @@ public:
 	void execute(Command *command, const Context &context);
 	void undo();
 	void redo();
+
+	/* Release the commands, e.g. when the objects they refer to are gone. */
+	void clear();
 };
 
 using CommandFactory = Factory<Command>;
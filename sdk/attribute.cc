@@ -24,10 +24,16 @@
 
 #include "attribute.h"
 
-template <typename Container>
-void copy(const Container &from, Container &to)
+#include <cstdint>
+
+#include "util_binary.h"
+
+/* Access the data of the attribute through a const reference, so as to not
+ * trigger a copy of it if it is shared with another attribute. */
+template <typename T>
+static inline const T &const_list(const T *list)
 {
-	std::copy(from->begin(), from->end(), to->begin());
+	return *list;
 }
 
 Attribute::Attribute(const std::string &name, AttributeType type, size_t size)
@@ -36,31 +42,31 @@ Attribute::Attribute(const std::string &name, AttributeType type, size_t size)
 {
 	switch (m_type) {
 		case ATTR_TYPE_BYTE:
-			m_data.char_list = new std::vector<char>(size);
+			m_data.char_list = new cow_vector<char>(size);
 			break;
 		case ATTR_TYPE_INT:
-			m_data.int_list = new std::vector<int>(size);
+			m_data.int_list = new cow_vector<int>(size);
 			break;
 		case ATTR_TYPE_FLOAT:
-			m_data.float_list = new std::vector<float>(size);
+			m_data.float_list = new cow_vector<float>(size);
 			break;
 		case ATTR_TYPE_STRING:
-			m_data.string_list = new std::vector<std::string>(size);
+			m_data.string_list = new cow_vector<std::string>(size);
 			break;
 		case ATTR_TYPE_VEC2:
-			m_data.vec2_list = new std::vector<glm::vec2>(size);
+			m_data.vec2_list = new cow_vector<glm::vec2>(size);
 			break;
 		case ATTR_TYPE_VEC3:
-			m_data.vec3_list = new std::vector<glm::vec3>(size);
+			m_data.vec3_list = new cow_vector<glm::vec3>(size);
 			break;
 		case ATTR_TYPE_VEC4:
-			m_data.vec4_list = new std::vector<glm::vec4>(size);
+			m_data.vec4_list = new cow_vector<glm::vec4>(size);
 			break;
 		case ATTR_TYPE_MAT3:
-			m_data.mat3_list = new std::vector<glm::mat3>(size);
+			m_data.mat3_list = new cow_vector<glm::mat3>(size);
 			break;
 		case ATTR_TYPE_MAT4:
-			m_data.mat4_list = new std::vector<glm::mat4>(size);
+			m_data.mat4_list = new cow_vector<glm::mat4>(size);
 			break;
 		default:
 			break;
@@ -68,35 +74,37 @@ Attribute::Attribute(const std::string &name, AttributeType type, size_t size)
 }
 
 Attribute::Attribute(const Attribute &rhs)
-    : Attribute(rhs.name(), rhs.type(), rhs.size())
+    : m_name(rhs.m_name)
+    , m_type(rhs.m_type)
 {
+	/* The data is shared with rhs until either of them is modified. */
 	switch (m_type) {
 		case ATTR_TYPE_BYTE:
-			copy(rhs.m_data.char_list, m_data.char_list);
+			m_data.char_list = new cow_vector<char>(*rhs.m_data.char_list);
 			break;
 		case ATTR_TYPE_INT:
-			copy(rhs.m_data.int_list, m_data.int_list);
+			m_data.int_list = new cow_vector<int>(*rhs.m_data.int_list);
 			break;
 		case ATTR_TYPE_FLOAT:
-			copy(rhs.m_data.float_list, m_data.float_list);
+			m_data.float_list = new cow_vector<float>(*rhs.m_data.float_list);
 			break;
 		case ATTR_TYPE_STRING:
-			copy(rhs.m_data.string_list, m_data.string_list);
+			m_data.string_list = new cow_vector<std::string>(*rhs.m_data.string_list);
 			break;
 		case ATTR_TYPE_VEC2:
-			copy(rhs.m_data.vec2_list, m_data.vec2_list);
+			m_data.vec2_list = new cow_vector<glm::vec2>(*rhs.m_data.vec2_list);
 			break;
 		case ATTR_TYPE_VEC3:
-			copy(rhs.m_data.vec3_list, m_data.vec3_list);
+			m_data.vec3_list = new cow_vector<glm::vec3>(*rhs.m_data.vec3_list);
 			break;
 		case ATTR_TYPE_VEC4:
-			copy(rhs.m_data.vec4_list, m_data.vec4_list);
+			m_data.vec4_list = new cow_vector<glm::vec4>(*rhs.m_data.vec4_list);
 			break;
 		case ATTR_TYPE_MAT3:
-			copy(rhs.m_data.mat3_list, m_data.mat3_list);
+			m_data.mat3_list = new cow_vector<glm::mat3>(*rhs.m_data.mat3_list);
 			break;
 		case ATTR_TYPE_MAT4:
-			copy(rhs.m_data.mat4_list, m_data.mat4_list);
+			m_data.mat4_list = new cow_vector<glm::mat4>(*rhs.m_data.mat4_list);
 			break;
 		default:
 			break;
@@ -143,7 +151,7 @@ AttributeType Attribute::type() const
 	return m_type;
 }
 
-std::string Attribute::name() const
+const std::string &Attribute::name() const
 {
 	return m_name;
 }
@@ -283,23 +291,23 @@ const void *Attribute::data() const
 {
 	switch (m_type) {
 		case ATTR_TYPE_BYTE:
-			return &(*(m_data.char_list))[0];
+			return &const_list(m_data.char_list)[0];
 		case ATTR_TYPE_INT:
-			return &(*(m_data.int_list))[0];
+			return &const_list(m_data.int_list)[0];
 		case ATTR_TYPE_FLOAT:
-			return &(*(m_data.float_list))[0];
+			return &const_list(m_data.float_list)[0];
 		case ATTR_TYPE_STRING:
-			return &(*(m_data.string_list))[0];
+			return &const_list(m_data.string_list)[0];
 		case ATTR_TYPE_VEC2:
-			return &(*(m_data.vec2_list))[0][0];
+			return &const_list(m_data.vec2_list)[0][0];
 		case ATTR_TYPE_VEC3:
-			return &(*(m_data.vec3_list))[0][0];
+			return &const_list(m_data.vec3_list)[0][0];
 		case ATTR_TYPE_VEC4:
-			return &(*(m_data.vec4_list))[0][0];
+			return &const_list(m_data.vec4_list)[0][0];
 		case ATTR_TYPE_MAT3:
-			return &(*(m_data.mat3_list))[0][0];
+			return &const_list(m_data.mat3_list)[0][0];
 		case ATTR_TYPE_MAT4:
-			return &(*(m_data.mat4_list))[0][0];
+			return &const_list(m_data.mat4_list)[0][0];
 		default:
 			return nullptr;
 	}
@@ -331,92 +339,232 @@ size_t Attribute::byte_size() const
 	}
 }
 
+bool Attribute::shared() const
+{
+	switch (m_type) {
+		case ATTR_TYPE_BYTE:
+			return m_data.char_list->shared();
+		case ATTR_TYPE_INT:
+			return m_data.int_list->shared();
+		case ATTR_TYPE_FLOAT:
+			return m_data.float_list->shared();
+		case ATTR_TYPE_STRING:
+			return m_data.string_list->shared();
+		case ATTR_TYPE_VEC2:
+			return m_data.vec2_list->shared();
+		case ATTR_TYPE_VEC3:
+			return m_data.vec3_list->shared();
+		case ATTR_TYPE_VEC4:
+			return m_data.vec4_list->shared();
+		case ATTR_TYPE_MAT3:
+			return m_data.mat3_list->shared();
+		case ATTR_TYPE_MAT4:
+			return m_data.mat4_list->shared();
+		default:
+			return false;
+	}
+}
+
 void Attribute::byte(size_t n, char b)
 {
-	(*(m_data.char_list))[n] = b;
+	m_data.char_list->data()[n] = b;
 }
 
 char Attribute::byte(size_t n) const
 {
-	return (*(m_data.char_list))[n];
+	return const_list(m_data.char_list)[n];
 }
 
 void Attribute::integer(size_t n, int i)
 {
-	(*(m_data.int_list))[n] = i;
+	m_data.int_list->data()[n] = i;
 }
 
 int Attribute::integer(size_t n) const
 {
-	return (*(m_data.int_list))[n];
+	return const_list(m_data.int_list)[n];
 }
 
 void Attribute::float_(size_t n, float f)
 {
-	(*(m_data.float_list))[n] = f;
+	m_data.float_list->data()[n] = f;
 }
 
-int Attribute::float_(size_t n) const
+float Attribute::float_(size_t n) const
 {
-	return (*(m_data.float_list))[n];
+	return const_list(m_data.float_list)[n];
 }
 
 void Attribute::vec2(size_t n, const glm::vec2 &v)
 {
-	(*(m_data.vec2_list))[n] = v;
+	m_data.vec2_list->data()[n] = v;
 }
 
 const glm::vec2 &Attribute::vec2(size_t n) const
 {
-	return (*(m_data.vec2_list))[n];
+	return const_list(m_data.vec2_list)[n];
 }
 
 void Attribute::vec3(size_t n, const glm::vec3 &v)
 {
-	(*(m_data.vec3_list))[n] = v;
+	m_data.vec3_list->data()[n] = v;
 }
 
 const glm::vec3 &Attribute::vec3(size_t n) const
 {
-	return (*(m_data.vec3_list))[n];
+	return const_list(m_data.vec3_list)[n];
 }
 
 void Attribute::vec4(size_t n, const glm::vec4 &v)
 {
-	(*(m_data.vec4_list))[n] = v;
+	m_data.vec4_list->data()[n] = v;
 }
 
 const glm::vec4 &Attribute::vec4(size_t n) const
 {
-	return (*(m_data.vec4_list))[n];
+	return const_list(m_data.vec4_list)[n];
 }
 
 void Attribute::mat3(size_t n, const glm::mat3 &m)
 {
-	(*(m_data.mat3_list))[n] = m;
+	m_data.mat3_list->data()[n] = m;
 }
 
 const glm::mat3 &Attribute::mat3(size_t n) const
 {
-	return (*(m_data.mat3_list))[n];
+	return const_list(m_data.mat3_list)[n];
 }
 
 void Attribute::mat4(size_t n, const glm::mat4 &m)
 {
-	(*(m_data.mat4_list))[n] = m;
+	m_data.mat4_list->data()[n] = m;
 }
 
 const glm::mat4 &Attribute::mat4(size_t n) const
 {
-	return (*(m_data.mat4_list))[n];
+	return const_list(m_data.mat4_list)[n];
 }
 
 void Attribute::stdstring(size_t n, const std::string &str)
 {
-	(*(m_data.string_list))[n] = str;
+	m_data.string_list->data()[n] = str;
 }
 
 const std::string &Attribute::stdstring(size_t n) const
 {
-	return (*(m_data.string_list))[n];
+	return const_list(m_data.string_list)[n];
+}
+
+/* ************************************************************************** */
+
+template <typename T>
+static bool read_values(std::istream &is, cow_vector<T> *list)
+{
+	return read_binary(is, list->data(), list->size());
+}
+
+void Attribute::write(std::ostream &os) const
+{
+	write_binary(os, m_name);
+	write_binary(os, static_cast<int32_t>(m_type));
+	write_binary(os, static_cast<uint64_t>(size()));
+
+	if (m_type == ATTR_TYPE_STRING) {
+		for (const auto &str : const_list(m_data.string_list)) {
+			write_binary(os, str);
+		}
+	}
+	else if (size() != 0) {
+		write_binary(os, static_cast<const char *>(data()), byte_size());
+	}
+}
+
+/* Return the minimum number of bytes written for a value of the given type. */
+static size_t min_written_size(AttributeType type)
+{
+	switch (type) {
+		case ATTR_TYPE_BYTE:
+			return sizeof(char);
+		case ATTR_TYPE_INT:
+			return sizeof(int);
+		case ATTR_TYPE_FLOAT:
+			return sizeof(float);
+		case ATTR_TYPE_STRING:
+			return sizeof(uint64_t);
+		case ATTR_TYPE_VEC2:
+			return sizeof(glm::vec2);
+		case ATTR_TYPE_VEC3:
+			return sizeof(glm::vec3);
+		case ATTR_TYPE_VEC4:
+			return sizeof(glm::vec4);
+		case ATTR_TYPE_MAT3:
+			return sizeof(glm::mat3);
+		case ATTR_TYPE_MAT4:
+			return sizeof(glm::mat4);
+		default:
+			return 1;
+	}
+}
+
+Attribute *Attribute::read(std::istream &is)
+{
+	std::string name;
+	int32_t type;
+	uint64_t size;
+
+	if (!read_binary(is, name) || !read_binary(is, type) || !read_binary(is, size)) {
+		return nullptr;
+	}
+
+	if (type < ATTR_TYPE_BYTE || type > ATTR_TYPE_MAT4) {
+		return nullptr;
+	}
+
+	if (!binary_count_fits(is, size, min_written_size(static_cast<AttributeType>(type)))) {
+		return nullptr;
+	}
+
+	auto attr = new Attribute(name, static_cast<AttributeType>(type), size);
+	auto ok = true;
+
+	switch (attr->m_type) {
+		case ATTR_TYPE_BYTE:
+			ok = read_values(is, attr->m_data.char_list);
+			break;
+		case ATTR_TYPE_INT:
+			ok = read_values(is, attr->m_data.int_list);
+			break;
+		case ATTR_TYPE_FLOAT:
+			ok = read_values(is, attr->m_data.float_list);
+			break;
+		case ATTR_TYPE_STRING:
+			for (auto &str : *attr->m_data.string_list) {
+				ok = ok && read_binary(is, str);
+			}
+			break;
+		case ATTR_TYPE_VEC2:
+			ok = read_values(is, attr->m_data.vec2_list);
+			break;
+		case ATTR_TYPE_VEC3:
+			ok = read_values(is, attr->m_data.vec3_list);
+			break;
+		case ATTR_TYPE_VEC4:
+			ok = read_values(is, attr->m_data.vec4_list);
+			break;
+		case ATTR_TYPE_MAT3:
+			ok = read_values(is, attr->m_data.mat3_list);
+			break;
+		case ATTR_TYPE_MAT4:
+			ok = read_values(is, attr->m_data.mat4_list);
+			break;
+		default:
+			break;
+	}
+
+	if (!ok) {
+		delete attr;
+		return nullptr;
+	}
+
+	return attr;
 }
@@ -25,8 +25,11 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <iosfwd>
 #include <string>
-#include <vector>
+#include <type_traits>
+
+#include "util_cow.h"
 
 enum AttributeType {
 	ATTR_TYPE_INVALID = -1,
@@ -41,29 +44,91 @@ enum AttributeType {
 	ATTR_TYPE_MAT4,
 };
 
+/**
+ * @brief attribute_type_traits Map the type of the values of an attribute to
+ *                              its AttributeType.
+ */
+template <typename T>
+struct attribute_type_traits {
+	static constexpr AttributeType type = ATTR_TYPE_INVALID;
+};
+
+#define DEFINE_ATTRIBUTE_TYPE_TRAITS(value_type, attribute_type) \
+	template <> \
+	struct attribute_type_traits<value_type> { \
+		static constexpr AttributeType type = attribute_type; \
+	}
+
+DEFINE_ATTRIBUTE_TYPE_TRAITS(char, ATTR_TYPE_BYTE);
+DEFINE_ATTRIBUTE_TYPE_TRAITS(int, ATTR_TYPE_INT);
+DEFINE_ATTRIBUTE_TYPE_TRAITS(float, ATTR_TYPE_FLOAT);
+DEFINE_ATTRIBUTE_TYPE_TRAITS(std::string, ATTR_TYPE_STRING);
+DEFINE_ATTRIBUTE_TYPE_TRAITS(glm::vec2, ATTR_TYPE_VEC2);
+DEFINE_ATTRIBUTE_TYPE_TRAITS(glm::vec3, ATTR_TYPE_VEC3);
+DEFINE_ATTRIBUTE_TYPE_TRAITS(glm::vec4, ATTR_TYPE_VEC4);
+DEFINE_ATTRIBUTE_TYPE_TRAITS(glm::mat3, ATTR_TYPE_MAT3);
+DEFINE_ATTRIBUTE_TYPE_TRAITS(glm::mat4, ATTR_TYPE_MAT4);
+
+#undef DEFINE_ATTRIBUTE_TYPE_TRAITS
+
 class Attribute {
 	union {
-		std::vector<char> *char_list;
-		std::vector<int> *int_list;
-		std::vector<float> *float_list;
-		std::vector<std::string> *string_list;
-		std::vector<glm::vec2> *vec2_list;
-		std::vector<glm::vec3> *vec3_list;
-		std::vector<glm::vec4> *vec4_list;
-		std::vector<glm::mat3> *mat3_list;
-		std::vector<glm::mat4> *mat4_list;
+		cow_vector<char> *char_list;
+		cow_vector<int> *int_list;
+		cow_vector<float> *float_list;
+		cow_vector<std::string> *string_list;
+		cow_vector<glm::vec2> *vec2_list;
+		cow_vector<glm::vec3> *vec3_list;
+		cow_vector<glm::vec4> *vec4_list;
+		cow_vector<glm::mat3> *mat3_list;
+		cow_vector<glm::mat4> *mat4_list;
 	} m_data;
 
 	std::string m_name;
 	AttributeType m_type;
 
+	/* Overloads used to retrieve the list matching a given value type. */
+	cow_vector<char> *get_list(char *) const { return m_data.char_list; }
+	cow_vector<int> *get_list(int *) const { return m_data.int_list; }
+	cow_vector<float> *get_list(float *) const { return m_data.float_list; }
+	cow_vector<std::string> *get_list(std::string *) const { return m_data.string_list; }
+	cow_vector<glm::vec2> *get_list(glm::vec2 *) const { return m_data.vec2_list; }
+	cow_vector<glm::vec3> *get_list(glm::vec3 *) const { return m_data.vec3_list; }
+	cow_vector<glm::vec4> *get_list(glm::vec4 *) const { return m_data.vec4_list; }
+	cow_vector<glm::mat3> *get_list(glm::mat3 *) const { return m_data.mat3_list; }
+	cow_vector<glm::mat4> *get_list(glm::mat4 *) const { return m_data.mat4_list; }
+
 public:
 	Attribute(const Attribute &rhs);
 	Attribute(const std::string &name, AttributeType type, size_t size = 0);
 	~Attribute();
 
 	AttributeType type() const;
-	std::string name() const;
+	const std::string &name() const;
+
+	/**
+	 * @brief typed_list Return the list of values of this attribute, or nullptr
+	 *                   if T does not match the type of this attribute.
+	 */
+	template <typename T>
+	cow_vector<T> *typed_list()
+	{
+		if (attribute_type_traits<T>::type != m_type) {
+			return nullptr;
+		}
+
+		return get_list(static_cast<T *>(nullptr));
+	}
+
+	template <typename T>
+	const cow_vector<T> *typed_list() const
+	{
+		if (attribute_type_traits<T>::type != m_type) {
+			return nullptr;
+		}
+
+		return get_list(static_cast<T *>(nullptr));
+	}
 
 	void reserve(size_t n);
 	void resize(size_t n);
@@ -75,6 +140,16 @@ public:
 	size_t byte_size() const;
 	size_t size() const;
 
+	/**
+	 * @brief shared Return whether the values are shared with another
+	 *               attribute, see cow_vector::shared().
+	 */
+	bool shared() const;
+
+	/* The setters below make the values unique to the attribute (see
+	 * cow_vector), they must not be called concurrently. Loops should rather
+	 * go through a TypedAttribute. */
+
 	/**
 	 * @brief byte Set a byte in the attribute list.
 	 * @param n The position to write the byte in the list.
@@ -93,7 +168,7 @@ public:
 	int integer(size_t n) const;
 
 	void float_(size_t n, float f);
-	int float_(size_t n) const;
+	float float_(size_t n) const;
 
 	void vec2(size_t n, const glm::vec2 &v);
 	const glm::vec2 &vec2(size_t n) const;
@@ -112,4 +187,109 @@ public:
 
 	void stdstring(size_t n, const std::string &str);
 	const std::string &stdstring(size_t n) const;
+
+	/**
+	 * @brief write Write the name, type and values of this attribute to a
+	 *              binary stream.
+	 */
+	void write(std::ostream &os) const;
+
+	/**
+	 * @brief read Read an attribute written by write() from a binary stream.
+	 * @return A new attribute, or nullptr if the stream could not be read.
+	 */
+	static Attribute *read(std::istream &is);
+};
+
+/* ************************************************************************** */
+
+/**
+ * @brief TypedAttribute is a handle to the values of an attribute of a known
+ *        type, meant to be resolved once, e.g. at the beginning of a node's
+ *        process() function. Accessing the values is then a plain, inlinable,
+ *        array access without function call nor type check.
+ *
+ *        A handle on mutable values (e.g. TypedAttribute<glm::vec3>) makes the
+ *        values unique to the attribute when resolved (see cow_vector), while a
+ *        handle on const values (e.g. TypedAttribute<const glm::vec3>) leaves
+ *        them shared. Resizing the attribute invalidates its handles.
+ */
+template <typename T>
+class TypedAttribute {
+	using value_type = typename std::remove_const<T>::type;
+	using list_type = typename std::conditional<std::is_const<T>::value,
+	                                            const cow_vector<value_type>,
+	                                            cow_vector<value_type>>::type;
+
+	T *m_data = nullptr;
+	size_t m_size = 0;
+
+	/* Whether the handle was resolved to an attribute of type T, the data of
+	 * an empty attribute is null. */
+	bool m_valid = false;
+
+public:
+	TypedAttribute() = default;
+
+	template <typename AttributeT>
+	explicit TypedAttribute(AttributeT *attribute)
+	{
+		if (attribute == nullptr) {
+			return;
+		}
+
+		list_type *list = attribute->template typed_list<value_type>();
+
+		if (list == nullptr) {
+			return;
+		}
+
+		m_data = list->data();
+		m_size = list->size();
+		m_valid = true;
+	}
+
+	/**
+	 * @brief valid Return whether the handle points to an attribute, which
+	 *              may be empty.
+	 */
+	bool valid() const
+	{
+		return m_valid;
+	}
+
+	size_t size() const
+	{
+		return m_size;
+	}
+
+	T &operator[](size_t n)
+	{
+		return m_data[n];
+	}
+
+	const T &operator[](size_t n) const
+	{
+		return m_data[n];
+	}
+
+	T *begin()
+	{
+		return m_data;
+	}
+
+	T *end()
+	{
+		return m_data + m_size;
+	}
+
+	const T *begin() const
+	{
+		return m_data;
+	}
+
+	const T *end() const
+	{
+		return m_data + m_size;
+	}
 };
@@ -45,6 +45,14 @@ struct EvaluationContext {
 	bool animation;
 
 	char time_direction;
+
+	/** The frame for which the graphs are evaluated, which is not always the
+	 *  current frame of the scene, e.g. during playback. */
+	int frame;
+
+	/** Whether independent objects, and independent branches of their
+	 *  graphs, are evaluated concurrently. */
+	bool threaded_evaluation;
 };
 
 class ViewerContext {
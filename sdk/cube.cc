@@ -24,60 +24,48 @@
 #include "cube.h"
 #include "context.h"
 
-#include <ego/utils.h>
 #include <GL/glew.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "renderbuffer.h"
 
-Cube::Cube(const glm::vec3 &min, const glm::vec3 &max)
-    : m_buffer(new RenderBuffer)
+/* A single buffer holding a unit cube centered on the origin is shared by all
+ * the cubes, which are drawn by transforming it with their own matrix. It is
+ * created the first time a cube is drawn, from the thread owning the OpenGL
+ * context, and lives as long as the program. */
+static RenderBuffer *create_unit_cube_buffer()
 {
-	m_buffer->set_shader_source(ego::VERTEX_SHADER, ego::util::str_from_file("shaders/flat_shader.vert"));
-	m_buffer->set_shader_source(ego::FRAGMENT_SHADER, ego::util::str_from_file("shaders/flat_shader.frag"));
-	m_buffer->finalize_shader();
-
 	ProgramParams params;
 	params.add_attribute("vertex");
 	params.add_uniform("matrix");
 	params.add_uniform("MVP");
 	params.add_uniform("color");
+	params.add_uniform("has_vcolors");
 
-	m_buffer->set_shader_params(params);
+	RenderBuffer *buffer = new RenderBuffer;
+	buffer->set_program(get_program(shader_source("flat_shader.vert"),
+	                                shader_source("flat_shader.frag"),
+	                                params));
+	buffer->set_uniform("color", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
 
 	DrawParams draw_params;
 	draw_params.set_draw_type(GL_LINES);
+	draw_params.set_data_type(GL_UNSIGNED_SHORT);
 
-	m_buffer->set_draw_params(draw_params);
-
-	ego::Program *program = m_buffer->program();
-	program->enable();
-	program->uniform("color", 1.0f, 1.0f, 1.0f, 1.0f);
-	program->disable();
+	buffer->set_draw_params(draw_params);
 
 	const glm::vec3 vertices[8] = {
-	    glm::vec3(min[0], min[1], min[2]),
-	    glm::vec3(max[0], min[1], min[2]),
-	    glm::vec3(max[0], max[1], min[2]),
-	    glm::vec3(min[0], max[1], min[2]),
-	    glm::vec3(min[0], min[1], max[2]),
-	    glm::vec3(max[0], min[1], max[2]),
-	    glm::vec3(max[0], max[1], max[2]),
-	    glm::vec3(min[0], max[1], max[2])
+	    glm::vec3(-0.5f, -0.5f, -0.5f),
+	    glm::vec3( 0.5f, -0.5f, -0.5f),
+	    glm::vec3( 0.5f,  0.5f, -0.5f),
+	    glm::vec3(-0.5f,  0.5f, -0.5f),
+	    glm::vec3(-0.5f, -0.5f,  0.5f),
+	    glm::vec3( 0.5f, -0.5f,  0.5f),
+	    glm::vec3( 0.5f,  0.5f,  0.5f),
+	    glm::vec3(-0.5f,  0.5f,  0.5f)
 	};
 
-	m_min = min;
-	m_max = max;
-	m_pos = (min + max) / 2.0f;
-	m_dimensions = max - min;
-
-	updateMatrix();
-
-	for (int i = 0; i < 8; ++i) {
-		m_vertices.push_back(vertices[i] * glm::mat3(m_inv_matrix));
-	}
-
 	const GLushort indices[24] = {
 	    0, 1, 1, 2,
 	    2, 3, 3, 0,
@@ -87,22 +75,40 @@ Cube::Cube(const glm::vec3 &min, const glm::vec3 &max)
 	    2, 6, 3, 7
 	};
 
-	m_buffer->set_vertex_buffer("vertex",
-	                            &m_vertices[0][0],
-	                            m_vertices.size() * sizeof(glm::vec3),
-	                            &indices[0],
-	                            sizeof(indices),
-	        24);
+	buffer->set_vertex_buffer("vertex",
+	                          &vertices[0][0],
+	                          sizeof(vertices),
+	                          &indices[0],
+	                          sizeof(indices),
+	                          24);
+
+	return buffer;
 }
 
-Cube::~Cube()
+static RenderBuffer *unit_cube_buffer()
 {
-	free_renderbuffer(m_buffer);
+	static RenderBuffer *buffer = create_unit_cube_buffer();
+	return buffer;
+}
+
+/* ************************************************************************** */
+
+Cube::Cube(const glm::vec3 &min, const glm::vec3 &max)
+{
+	m_min = min;
+	m_max = max;
+	m_pos = (min + max) / 2.0f;
+	m_dimensions = max - min;
+
+	updateMatrix();
 }
 
 void Cube::render(const ViewerContext &context)
 {
-	m_buffer->render(context);
+	auto cube_context = context;
+	cube_context.setMatrix(context.matrix() * m_matrix);
+
+	unit_cube_buffer()->render(cube_context);
 }
 
 void Cube::updateMatrix()
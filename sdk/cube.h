@@ -24,15 +24,12 @@
 #pragma once
 
 #include <glm/glm.hpp>
-#include <vector>
 
-class RenderBuffer;
 class ViewerContext;
 
+/* Bounding box drawn as a unit cube shared by all the boxes, transformed to
+ * fit their bounds. Cubes do not own any OpenGL resource. */
 class Cube {
-	RenderBuffer *m_buffer;
-
-	std::vector<glm::vec3> m_vertices;
 	glm::vec3 m_dimensions, m_scale, m_rotation;
 	glm::vec3 m_min, m_max, m_pos;
 	glm::mat4 m_matrix, m_inv_matrix;
@@ -41,11 +38,6 @@ class Cube {
 
 public:
 	Cube(const glm::vec3 &min, const glm::vec3 &max);
-	~Cube();
-
-	/* Disallow copy. */
-	Cube(const Cube &other) = delete;
-	Cube &operator=(const Cube &other) = delete;
 
 	void render(const ViewerContext &context);
 };
@@ -24,6 +24,33 @@
 
 #include "geomlists.h"
 
+#include <cstdint>
+
+#include "util_binary.h"
+
+template <typename T>
+static void write_list(std::ostream &os, const cow_vector<T> &list)
+{
+	write_binary(os, static_cast<uint64_t>(list.size()));
+	write_binary(os, list.data(), list.size());
+}
+
+template <typename T>
+static bool read_list(std::istream &is, cow_vector<T> &list)
+{
+	uint64_t size;
+
+	if (!read_binary(is, size) || !binary_count_fits(is, size, sizeof(T))) {
+		return false;
+	}
+
+	list.resize(size);
+
+	return read_binary(is, list.data(), size);
+}
+
+/* ************************************************************************** */
+
 void PointList::push_back(const glm::vec3 &point)
 {
 	m_points.push_back(point);
@@ -31,7 +58,7 @@ void PointList::push_back(const glm::vec3 &point)
 
 void PointList::push_back(glm::vec3 &&point)
 {
-	m_points.emplace_back(std::move(point));
+	m_points.push_back(std::move(point));
 }
 
 void PointList::reserve(size_t n)
@@ -44,6 +71,21 @@ void PointList::resize(size_t n)
 	m_points.resize(n);
 }
 
+void PointList::write(std::ostream &os) const
+{
+	write_list(os, m_points);
+}
+
+bool PointList::read(std::istream &is)
+{
+	return read_list(is, m_points);
+}
+
+void PointList::detach()
+{
+	m_points.detach();
+}
+
 size_t PointList::size() const
 {
 	return m_points.size();
@@ -63,6 +105,21 @@ const void *PointList::data() const
 	return (&m_points[0][0]);
 }
 
+size_t PointList::buffer_id() const
+{
+	return m_points.buffer_id();
+}
+
+bool PointList::shared() const
+{
+	return m_points.shared();
+}
+
+void PointList::reference(std::shared_ptr<const glm::vec3> points, size_t n)
+{
+	m_points.reference(std::move(points), n);
+}
+
 glm::vec3 &PointList::operator[](size_t i)
 {
 	return m_points[i];
@@ -95,6 +152,21 @@ void EdgeList::resize(size_t n)
 	m_edge.resize(n);
 }
 
+void EdgeList::write(std::ostream &os) const
+{
+	write_list(os, m_edge);
+}
+
+bool EdgeList::read(std::istream &is)
+{
+	return read_list(is, m_edge);
+}
+
+void EdgeList::detach()
+{
+	m_edge.detach();
+}
+
 size_t EdgeList::size() const
 {
 	return m_edge.size();
@@ -114,6 +186,21 @@ const void *EdgeList::data() const
 	return (&m_edge[0][0]);
 }
 
+size_t EdgeList::buffer_id() const
+{
+	return m_edge.buffer_id();
+}
+
+bool EdgeList::shared() const
+{
+	return m_edge.shared();
+}
+
+void EdgeList::reference(std::shared_ptr<const glm::uvec2> edges, size_t n)
+{
+	m_edge.reference(std::move(edges), n);
+}
+
 glm::uvec2 &EdgeList::operator[](size_t i)
 {
 	return m_edge[i];
@@ -126,14 +213,43 @@ const glm::uvec2 &EdgeList::operator[](size_t i) const
 
 /* ************************************************************************** */
 
+static std::atomic<size_t> topology_version_counter(0);
+
+/* The version is resolved before copying, so that the copies share it with
+ * their source. */
+PolygonList::PolygonList(const PolygonList &other)
+    : m_polys(other.m_polys)
+    , m_topology_version(other.topology_version())
+    , m_topology_changed(false)
+    , m_topology_writable(false)
+{}
+
+PolygonList &PolygonList::operator=(const PolygonList &other)
+{
+	m_polys = other.m_polys;
+	m_topology_version = other.topology_version();
+	m_topology_changed = false;
+	m_topology_writable = false;
+
+	return *this;
+}
+
+void PolygonList::tag_topology_changed()
+{
+	m_topology_changed.store(true, std::memory_order_relaxed);
+	m_topology_writable.store(true, std::memory_order_relaxed);
+}
+
 void PolygonList::push_back(const glm::uvec4 &poly)
 {
+	tag_topology_changed();
 	m_polys.push_back(poly);
 }
 
 void PolygonList::push_back(glm::uvec4 &&poly)
 {
-	m_polys.emplace_back(std::move(poly));
+	tag_topology_changed();
+	m_polys.push_back(std::move(poly));
 }
 
 void PolygonList::reserve(size_t n)
@@ -143,9 +259,27 @@ void PolygonList::reserve(size_t n)
 
 void PolygonList::resize(size_t n)
 {
+	tag_topology_changed();
 	m_polys.resize(n);
 }
 
+void PolygonList::write(std::ostream &os) const
+{
+	write_list(os, m_polys);
+}
+
+bool PolygonList::read(std::istream &is)
+{
+	tag_topology_changed();
+	return read_list(is, m_polys);
+}
+
+void PolygonList::detach()
+{
+	tag_topology_changed();
+	m_polys.detach();
+}
+
 size_t PolygonList::size() const
 {
 	return m_polys.size();
@@ -165,8 +299,40 @@ const void *PolygonList::data() const
 	return (&m_polys[0][0]);
 }
 
+size_t PolygonList::buffer_id() const
+{
+	return m_polys.buffer_id();
+}
+
+bool PolygonList::shared() const
+{
+	return m_polys.shared();
+}
+
+void PolygonList::reference(std::shared_ptr<const glm::uvec4> polys, size_t n)
+{
+	tag_topology_changed();
+	m_polys.reference(std::move(polys), n);
+}
+
+size_t PolygonList::topology_version() const
+{
+	/* Writes made after the version is handed out change the topology. */
+	m_topology_writable.store(false, std::memory_order_relaxed);
+
+	if (m_topology_changed.exchange(false)) {
+		m_topology_version = ++topology_version_counter;
+	}
+
+	return m_topology_version;
+}
+
 glm::uvec4 &PolygonList::operator[](size_t i)
 {
+	if (!m_topology_writable.load(std::memory_order_relaxed)) {
+		tag_topology_changed();
+	}
+
 	return m_polys[i];
 }
 
@@ -24,11 +24,22 @@
 
 #pragma once
 
+#include <atomic>
 #include <glm/glm.hpp>
-#include <vector>
+#include <iosfwd>
+
+#include "util_cow.h"
+
+/* The lists below share their data with their copies until either of them is
+ * modified, access the lists through const pointers to only read from them.
+ * Their non-const operator[] detaches the list if needed, which is not thread
+ * safe: lists written to from a parallel loop must be detached beforehand,
+ * through their detach() method. See cow_vector::buffer_id(), cow_vector::shared() and cow_vector::reference()
+ * for their buffer_id(), shared() and reference() methods. Their write() and read() methods store them in
+ * binary streams, read() returns false on failure. */
 
 class PointList {
-	std::vector<glm::vec3> m_points{};
+	cow_vector<glm::vec3> m_points{};
 
 public:
 	PointList() = default;
@@ -40,12 +51,23 @@ public:
 
 	void resize(size_t n);
 
+	void detach();
+
 	size_t size() const;
 
 	size_t byte_size() const;
 
 	const void *data() const;
 
+	size_t buffer_id() const;
+
+	bool shared() const;
+
+	void reference(std::shared_ptr<const glm::vec3> points, size_t n);
+
+	void write(std::ostream &os) const;
+	bool read(std::istream &is);
+
 	glm::vec3 &operator[](size_t i);
 	const glm::vec3 &operator[](size_t i) const;
 };
@@ -53,7 +75,7 @@ public:
 /* ************************************************************************** */
 
 class EdgeList {
-	std::vector<glm::uvec2> m_edge{};
+	cow_vector<glm::uvec2> m_edge{};
 
 public:
 	EdgeList() = default;
@@ -65,12 +87,23 @@ public:
 
 	void resize(size_t n);
 
+	void detach();
+
 	size_t size() const;
 
 	size_t byte_size() const;
 
 	const void *data() const;
 
+	size_t buffer_id() const;
+
+	bool shared() const;
+
+	void reference(std::shared_ptr<const glm::uvec2> edges, size_t n);
+
+	void write(std::ostream &os) const;
+	bool read(std::istream &is);
+
 	glm::uvec2 &operator[](size_t i);
 	const glm::uvec2 &operator[](size_t i) const;
 };
@@ -84,10 +117,23 @@ public:
 static constexpr auto INVALID_INDEX = std::numeric_limits<unsigned int>::max();
 
 class PolygonList {
-	std::vector<glm::uvec4> m_polys{};
+	cow_vector<glm::uvec4> m_polys{};
+
+	/* See topology_version(), the version is only assigned when requested
+	 * after a modification, to keep write accesses cheap. */
+	mutable std::atomic<size_t> m_topology_version{0};
+	mutable std::atomic<bool> m_topology_changed{true};
+
+	/* Whether writes are already accounted for by m_topology_changed, so that
+	 * the non-const operator[] does not tag the list for every access. */
+	mutable std::atomic<bool> m_topology_writable{true};
+
+	void tag_topology_changed();
 
 public:
 	PolygonList() = default;
+	PolygonList(const PolygonList &other);
+	PolygonList &operator=(const PolygonList &other);
 
 	void push_back(const glm::uvec4 &poly);
 
@@ -97,12 +143,34 @@ public:
 
 	void resize(size_t n);
 
+	void detach();
+
 	size_t size() const;
 
 	size_t byte_size() const;
 
 	const void *data() const;
 
+	size_t buffer_id() const;
+
+	bool shared() const;
+
+	void reference(std::shared_ptr<const glm::uvec4> polys, size_t n);
+
+	void write(std::ostream &os) const;
+	bool read(std::istream &is);
+
+	/**
+	 * @brief topology_version Return a number identifying the current
+	 *                         topology of this list. Versions are unique
+	 *                         process-wide, a list and its unmodified copies
+	 *                         have the same version, and any modification of
+	 *                         the list (detach(), or any method changing its
+	 *                         size) gives it a new version. This should not be
+	 *                         called while the list is being modified.
+	 */
+	size_t topology_version() const;
+
 	glm::uvec4 &operator[](size_t i);
 
 	const glm::uvec4 &operator[](size_t i) const;
@@ -25,24 +25,18 @@
 #include "mesh.h"
 
 #include <algorithm>
-#include <ego/utils.h>
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "context.h"
+#include "normals.h"
 #include "renderbuffer.h"
-#include "util_parallel.h"
+#include "util_trace.h"
 
 /* ************************************************************************** */
 
 static RenderBuffer *create_surface_buffer()
 {
-	RenderBuffer *renderbuffer = new RenderBuffer;
-
-	renderbuffer->set_shader_source(ego::VERTEX_SHADER, ego::util::str_from_file("shaders/object.vert"));
-	renderbuffer->set_shader_source(ego::FRAGMENT_SHADER, ego::util::str_from_file("shaders/object.frag"));
-	renderbuffer->finalize_shader();
-
 	ProgramParams params;
 	params.add_attribute("vertex");
 	params.add_attribute("normal");
@@ -54,21 +48,59 @@ static RenderBuffer *create_surface_buffer()
 	params.add_uniform("color");
 	params.add_uniform("has_vcolors");
 
-	ego::Program *program = renderbuffer->program();
-	program->uniform("color", 0.0f, 0.0f, 0.0f);
-
-	renderbuffer->set_shader_params(params);
+	RenderBuffer *renderbuffer = new RenderBuffer;
+	renderbuffer->set_program(get_program(shader_source("object.vert"),
+	                                      shader_source("object.frag"),
+	                                      params));
+	renderbuffer->set_uniform("color", glm::vec3(0.0f, 0.0f, 0.0f));
 
 	return renderbuffer;
 }
 
+static bool update_surface_buffer(RenderBuffer *buffer,
+                                  const std::vector<size_t> &sources,
+                                  const PointList &points,
+                                  const Attribute *normals,
+                                  const Attribute *colors)
+{
+	const auto &old_sources = buffer->sources();
+
+	/* The buffer must hold the same attributes. */
+	if (old_sources.size() != sources.size()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < sources.size(); ++i) {
+		if ((sources[i] == 0) != (old_sources[i] == 0)) {
+			return false;
+		}
+	}
+
+	/* The buffer will not hold its old data anymore, even partially. */
+	buffer->set_sources({});
+
+	if (!buffer->update_buffer("vertex", points.data(), points.byte_size())) {
+		return false;
+	}
+
+	if (normals != nullptr && !buffer->update_buffer("normal", normals->data(), normals->byte_size())) {
+		return false;
+	}
+
+	if (colors != nullptr && !buffer->update_buffer("vertex_color", colors->data(), colors->byte_size())) {
+		return false;
+	}
+
+	return true;
+}
+
 /* ************************************************************************** */
 
 size_t Mesh::id = -1;
 
 Mesh::Mesh()
     : Primitive()
-    , m_renderbuffer(nullptr)
+    , m_render_cache(std::make_shared<RenderBufferCache>())
 {
 	add_attribute("normal", ATTR_TYPE_VEC3, 0);
 	m_need_update = true;
@@ -76,29 +108,12 @@ Mesh::Mesh()
 
 Mesh::Mesh(const Mesh &other)
     : Primitive(other)
-    , m_renderbuffer(nullptr)
-{
-	/* Copy points. */
-	auto points = other.points();
-	m_point_list.resize(points->size());
-
-	for (auto i = 0ul; i < points->size(); ++i) {
-		m_point_list[i] = (*points)[i];
-	}
-
-	/* Copy points. */
-	auto polys = other.polys();
-	m_poly_list.resize(polys->size());
-
-	for (auto i = 0ul; i < polys->size(); ++i) {
-		m_poly_list[i] = (*polys)[i];
-	}
-}
+    , m_point_list(other.m_point_list)
+    , m_poly_list(other.m_poly_list)
+    , m_render_cache(other.m_render_cache)
+{}
 
-Mesh::~Mesh()
-{
-	free_renderbuffer(m_renderbuffer);
-}
+Mesh::~Mesh() = default;
 
 PointList *Mesh::points()
 {
@@ -120,6 +135,11 @@ const PolygonList *Mesh::polys() const
 	return &m_poly_list;
 }
 
+const std::vector<unsigned int> *Mesh::indices() const
+{
+	return m_indices.get();
+}
+
 void Mesh::update()
 {
 	if (m_need_update) {
@@ -143,6 +163,39 @@ size_t Mesh::typeID() const
 	return Mesh::id;
 }
 
+size_t Mesh::memoryUsage() const
+{
+	return Primitive::memoryUsage()
+	       + m_point_list.byte_size()
+	       + m_poly_list.byte_size();
+}
+
+size_t Mesh::ownedMemoryUsage() const
+{
+	return Primitive::ownedMemoryUsage()
+	       + (m_point_list.shared() ? 0ul : m_point_list.byte_size())
+	       + (m_poly_list.shared() ? 0ul : m_poly_list.byte_size());
+}
+
+size_t Mesh::pointCount() const
+{
+	return m_point_list.size();
+}
+
+void Mesh::write(std::ostream &os) const
+{
+	Primitive::write(os);
+	m_point_list.write(os);
+	m_poly_list.write(os);
+}
+
+bool Mesh::read(std::istream &is)
+{
+	return Primitive::read(is)
+	       && m_point_list.read(is)
+	       && m_poly_list.read(is);
+}
+
 void Mesh::render(const ViewerContext &context)
 {
 	/* Render vertices. */
@@ -152,11 +205,7 @@ void Mesh::render(const ViewerContext &context)
 		draw_params.set_point_size(2.0f);
 
 		m_renderbuffer->set_draw_params(draw_params);
-
-		ego::Program *program = m_renderbuffer->program();
-		program->enable();
-		program->uniform("color", 0.0f, 0.0f, 0.0f);
-		program->disable();
+		m_renderbuffer->set_uniform("color", glm::vec3(0.0f, 0.0f, 0.0f));
 
 		m_renderbuffer->render(context);
 	}
@@ -167,81 +216,140 @@ void Mesh::render(const ViewerContext &context)
 		draw_params.set_draw_type(GL_TRIANGLES);
 
 		m_renderbuffer->set_draw_params(draw_params);
-
-		ego::Program *program = m_renderbuffer->program();
-		program->enable();
-		program->uniform("color", 1.0f, 1.0f, 1.0f);
-		program->disable();
+		m_renderbuffer->set_uniform("color", glm::vec3(1.0f, 1.0f, 1.0f));
 
 		m_renderbuffer->render(context);
 	}
 }
 
+void Mesh::packRenderData()
+{
+	update();
+
+	if (!m_need_data_pack) {
+		return;
+	}
+
+	auto normals = this->attribute("normal", ATTR_TYPE_VEC3);
+
+	if (normals != nullptr && normals->size() != this->points()->size()) {
+		computeNormals();
+	}
+
+	/* Copies of this mesh with the same topology, e.g. deformed ones, share
+	 * the same triangulation. */
+	const auto topology_version = m_poly_list.topology_version();
+
+	m_indices = m_render_cache->indices(topology_version);
+
+	if (m_indices == nullptr) {
+		const PolygonList *polys = this->polys();
+
+		auto indices = std::make_shared<std::vector<unsigned int>>();
+		indices->reserve(polys->size() * 3);
+
+		for (auto i = 0ul, ie = polys->size(); i < ie; ++i) {
+			const auto &quad = (*polys)[i];
+
+			indices->push_back(quad[0]);
+			indices->push_back(quad[1]);
+			indices->push_back(quad[2]);
+
+			if (quad[3] != INVALID_INDEX) {
+				indices->push_back(quad[0]);
+				indices->push_back(quad[2]);
+				indices->push_back(quad[3]);
+			}
+		}
+
+		m_indices = indices;
+		m_render_cache->indices(topology_version, m_indices);
+	}
+
+	m_need_data_pack = false;
+}
+
 void Mesh::prepareRenderData()
 {
 	if (!m_need_data_update) {
 		return;
 	}
 
-	if (!m_renderbuffer) {
-		m_renderbuffer = create_surface_buffer();
-	}
+	TRACE_SPAN("Mesh::prepareRenderData");
 
-	for (size_t i = 0, ie = this->points()->size(); i < ie; ++i) {
-		m_point_list[i] = m_point_list[i] * glm::mat3(m_inv_matrix);
+	if (m_need_data_pack) {
+		packRenderData();
 	}
 
-	auto indices = std::vector<unsigned int>{};
-	indices.reserve(this->polys()->size());
+	/* The points are uploaded as is, the matrix of the mesh is applied when
+	 * drawing, so a transformed copy can reuse the buffer of its source. */
+	auto normals = this->attribute("normal", ATTR_TYPE_VEC3);
+	auto colors = this->attribute("color", ATTR_TYPE_VEC3);
+
+	const auto sources = std::vector<size_t>{
+		m_point_list.buffer_id(),
+		m_poly_list.buffer_id(),
+		(normals != nullptr) ? normals->typed_list<glm::vec3>()->buffer_id() : 0,
+		(colors != nullptr) ? colors->typed_list<glm::vec3>()->buffer_id() : 0,
+	};
+
+	m_renderbuffer = m_render_cache->find(sources);
+
+	if (m_renderbuffer != nullptr) {
+		m_need_data_update = false;
+		return;
+	}
 
-	auto polys = this->polys();
+	const auto topology_version = m_poly_list.topology_version();
 
-	for (auto i = 0ul, ie = polys->size(); i < ie; ++i) {
-		const auto &quad = (*polys)[i];
+	/* If only the points or the attributes changed, e.g. when the mesh is
+	 * deformed, update the buffers of the last drawn copy in place, keeping
+	 * its index buffer. */
+	auto buffer = m_render_cache->unused_buffer();
 
-		indices.push_back(quad[0]);
-		indices.push_back(quad[1]);
-		indices.push_back(quad[2]);
+	if (buffer != nullptr && buffer->topology_version() == topology_version) {
+		if (update_surface_buffer(buffer.get(), sources, m_point_list, normals, colors)) {
+			buffer->set_sources(sources);
 
-		if (quad[3] != INVALID_INDEX) {
-			indices.push_back(quad[0]);
-			indices.push_back(quad[2]);
-			indices.push_back(quad[3]);
+			m_renderbuffer = buffer;
+			m_need_data_update = false;
+			return;
 		}
 	}
 
+	m_renderbuffer = m_render_cache->add(create_surface_buffer());
+	m_renderbuffer->topology_version(topology_version);
+
+	const auto &indices = *m_indices;
+
 	m_renderbuffer->can_outline(true);
 
 	m_renderbuffer->set_vertex_buffer("vertex",
 	                                  m_point_list.data(),
 	                                  m_point_list.byte_size(),
-	                                  &indices[0],
+	                                  indices.data(),
 	                                  indices.size() * sizeof(GLuint),
 	                                  indices.size());
 
-	auto normals = this->attribute("normal", ATTR_TYPE_VEC3);
-
 	if (normals != nullptr) {
-		if (normals->size() != this->points()->size()) {
-			computeNormals();
-		}
-
 		m_renderbuffer->set_normal_buffer("normal", normals->data(), normals->byte_size());
 	}
 
-	auto colors = this->attribute("color", ATTR_TYPE_VEC3);
-
 	if (colors != nullptr) {
 		m_renderbuffer->set_color_buffer("vertex_color", colors->data(), colors->byte_size());
 	}
 
+	m_renderbuffer->set_sources(sources);
+
 	m_need_data_update = false;
 }
 
 void Mesh::computeBBox(glm::vec3 &min, glm::vec3 &max)
 {
-	for (size_t i = 0, ie = m_point_list.size(); i < ie; ++i) {
-		const auto &vert = m_point_list[i];
+	const PointList &points = m_point_list;
+
+	for (size_t i = 0, ie = points.size(); i < ie; ++i) {
+		const auto &vert = points[i];
 
 		if (vert.x < m_min.x) {
 			m_min.x = vert.x;
@@ -270,44 +378,12 @@ void Mesh::computeBBox(glm::vec3 &min, glm::vec3 &max)
 	m_dimensions = m_max - m_min;
 }
 
-static inline glm::vec3 get_normal(const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2)
-{
-	const auto n0 = v0 - v1;
-	const auto n1 = v2 - v1;
-
-	return glm::cross(n1, n0);
-}
-
 void Mesh::computeNormals()
 {
 	auto normals = this->attribute("normal", ATTR_TYPE_VEC3);
 	normals->resize(this->points()->size());
 
-	auto polys = this->polys();
-
-	parallel_for(tbb::blocked_range<size_t>(0, polys->size()),
-	             [&](const tbb::blocked_range<size_t> &r)
-	{
-		for (auto i = r.begin(), ie = r.end(); i < ie ; ++i) {
-			const auto &quad = (*polys)[i];
-
-			const auto v0 = m_point_list[quad[0]];
-			const auto v1 = m_point_list[quad[1]];
-			const auto v2 = m_point_list[quad[2]];
-
-			const auto normal = get_normal(v0, v1, v2);
-
-			normals->vec3(quad[0], normals->vec3(quad[0]) + normal);
-			normals->vec3(quad[1], normals->vec3(quad[1]) + normal);
-			normals->vec3(quad[2], normals->vec3(quad[2]) + normal);
-
-			if (quad[3] != INVALID_INDEX) {
-				normals->vec3(quad[3], normals->vec3(quad[3]) + normal);
-			}
-		}
-	});
-
-	for (size_t i = 0, ie = this->points()->size(); i < ie ; ++i) {
-		normals->vec3(i, -glm::normalize(normals->vec3(i)));
-	}
+	compute_normals(m_point_list, m_poly_list,
+	                TypedAttribute<glm::vec3>(normals).begin(),
+	                NORMAL_WEIGHT_AREA, true);
 }
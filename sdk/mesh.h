@@ -29,12 +29,19 @@
 #include "primitive.h"
 
 class RenderBuffer;
+class RenderBufferCache;
 
 class Mesh : public Primitive {
 	PointList m_point_list = {};
 	PolygonList m_poly_list = {};
 
-	RenderBuffer *m_renderbuffer = nullptr;
+	std::shared_ptr<RenderBuffer> m_renderbuffer = nullptr;
+
+	/* Shared with the copies of this primitive. */
+	std::shared_ptr<RenderBufferCache> m_render_cache = nullptr;
+
+	/* Triangulation of the polygons, see packRenderData(). */
+	std::shared_ptr<const std::vector<unsigned int>> m_indices = nullptr;
 
 public:
 	Mesh();
@@ -65,10 +72,20 @@ public:
 	 */
 	const PolygonList *polys() const;
 
+	/**
+	 * @brief indices The triangulation of the polys computed by
+	 *                packRenderData(), shared with the copies of this mesh
+	 *                having the same topology.
+	 * @return nullptr if the render data was not packed yet.
+	 */
+	const std::vector<unsigned int> *indices() const;
+
 	void update() override;
 
 	void render(const ViewerContext &context) override;
 
+	void packRenderData() override;
+
 	void prepareRenderData() override;
 
 	void computeBBox(glm::vec3 &min, glm::vec3 &max) override;
@@ -78,6 +95,15 @@ public:
 	static size_t id;
 	size_t typeID() const override;
 
+	size_t memoryUsage() const override;
+	size_t ownedMemoryUsage() const override;
+
+	size_t pointCount() const override;
+
+	void write(std::ostream &os) const override;
+
+	bool read(std::istream &is) override;
+
 private:
 	void computeNormals();
 };
@@ -25,9 +25,11 @@
 #include "nodes.h"
 
 #include <cassert>
+#include <chrono>
 
 #include "context.h"
 #include "primitive.h"
+#include "util_cancel.h"
 
 Node::Node(const std::string &name)
     : m_name(name)
@@ -54,6 +56,16 @@ const std::string &Node::name() const noexcept
 	return m_name;
 }
 
+void Node::type(const std::string &key)
+{
+	m_type = key;
+}
+
+const std::string &Node::type() const noexcept
+{
+	return m_type;
+}
+
 float Node::xpos() const
 {
 	return m_xpos;
@@ -84,6 +96,82 @@ void Node::process_time(float time)
 	m_process_time = time;
 }
 
+float Node::copy_time() const
+{
+	return m_copy_time;
+}
+
+void Node::clear_copy_time()
+{
+	m_copy_time = 0.0f;
+}
+
+bool Node::thread_safe() const
+{
+	return m_thread_safe;
+}
+
+void Node::thread_safe(bool yesno)
+{
+	m_thread_safe = yesno;
+}
+
+bool Node::modifies_input() const
+{
+	return m_modifies_input;
+}
+
+void Node::modifies_input(bool yesno)
+{
+	m_modifies_input = yesno;
+}
+
+bool Node::time_dependent() const
+{
+	return m_time_dependent;
+}
+
+void Node::time_dependent(bool yesno)
+{
+	m_time_dependent = yesno;
+}
+
+void Node::tag_update()
+{
+	m_need_update = true;
+}
+
+bool Node::need_update() const
+{
+	return m_need_update || (props_hash() != m_props_hash);
+}
+
+void Node::clear_update()
+{
+	m_need_update = false;
+	m_props_hash = props_hash();
+}
+
+void Node::cancellation_token(const CancellationToken *token)
+{
+	m_cancellation_token = token;
+}
+
+bool Node::cancelled() const
+{
+	return (m_cancellation_token != nullptr) && m_cancellation_token->cancelled();
+}
+
+void Node::frame(int value)
+{
+	m_frame = value;
+}
+
+int Node::frame() const
+{
+	return m_frame;
+}
+
 void Node::addInput(const std::string &sname)
 {
 	auto in = new InputSocket(sname);
@@ -254,19 +342,28 @@ PrimitiveCollection *Node::getInputCollection(InputSocket *socket)
 		return nullptr;
 	}
 
-	if (socket->link->links.size() > 1) {
-		auto copy = collection->copy();
+	/* The collection remains owned by the upstream node. */
+	if (!m_modifies_input) {
+		return collection;
+	}
 
-		if (!copy) {
-			return nullptr;
-		}
+	/* The collection is kept around by the upstream node, so that it can be
+	 * reused by later evaluations if that node does not need to be processed
+	 * again: always work on a copy of it. */
+	const auto t0 = std::chrono::steady_clock::now();
 
-		m_cache->add(copy);
+	auto copy = collection->copy();
 
-		return copy;
+	const auto t1 = std::chrono::steady_clock::now();
+	m_copy_time += std::chrono::duration<float>(t1 - t0).count();
+
+	if (!copy) {
+		return nullptr;
 	}
 
-	return collection;
+	m_cache->add(copy);
+
+	return copy;
 }
 
 void Node::setOutputCollection(OutputSocket *socket, PrimitiveCollection *collection)
@@ -309,7 +406,10 @@ Node *NodeFactory::operator()(const std::string &name)
 	const auto iter = m_map.find(name);
 	assert(iter != m_map.end());
 
-	return iter->second();
+	auto node = iter->second();
+	node->type(name);
+
+	return node;
 }
 
 size_t NodeFactory::numEntries() const
@@ -317,6 +417,11 @@ size_t NodeFactory::numEntries() const
 	return m_map.size();
 }
 
+bool NodeFactory::registered(const std::string &name) const
+{
+	return m_map.find(name) != m_map.end();
+}
+
 std::vector<std::string> NodeFactory::keys(const std::string &category) const
 {
 	const auto iter = m_cat_map.find(category);
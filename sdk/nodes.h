@@ -30,6 +30,7 @@
 
 #include "persona.h"
 
+class CancellationToken;
 class EvaluationContext;
 class InputSocket;
 class Node;
@@ -89,6 +90,7 @@ protected:
 	std::vector<InputSocket *> m_inputs = {};
 	std::vector<OutputSocket *> m_outputs = {};
 	std::string m_name = "";
+	std::string m_type = "";
 	std::string m_icon_path = "";
 	PrimitiveCache *m_cache = nullptr;
 	PrimitiveCollection *m_collection = nullptr;
@@ -100,6 +102,28 @@ protected:
 	int m_flags = 0;
 
 	float m_process_time = 0.0f;
+	float m_copy_time = 0.0f;
+
+	/* Whether this node can be processed concurrently with other nodes. */
+	bool m_thread_safe = false;
+
+	/* Whether this node modifies the collections of its inputs, or only reads
+	 * them, in which case they are not copied. */
+	bool m_modifies_input = true;
+
+	/* Whether the output of this node depends on the frame it is evaluated
+	 * for. */
+	bool m_time_dependent = false;
+
+	/* Whether this node needs to be processed again, and the hash of its
+	 * properties the last time it was. */
+	bool m_need_update = true;
+	size_t m_props_hash = 0;
+
+	const CancellationToken *m_cancellation_token = nullptr;
+
+	/* The frame this node is being processed for. */
+	int m_frame = 0;
 
 public:
 	explicit Node(const std::string &name);
@@ -117,6 +141,18 @@ public:
 	 */
 	const std::string &name() const noexcept;
 
+	/**
+	 * Set the key under which the type of this node is registered in the node
+	 * factory, which does it when creating the node.
+	 */
+	void type(const std::string &key);
+
+	/**
+	 * Return the key under which the type of this node is registered in the
+	 * node factory, used to create the node again when reading a scene.
+	 */
+	const std::string &type() const noexcept;
+
 	/**
 	 * Return the X position of this node in the node editor.
 	 */
@@ -147,6 +183,99 @@ public:
 	 */
 	void process_time(float time);
 
+	/**
+	 * Return the time spent copying the collections of the inputs of this
+	 * node since the last call to clear_copy_time().
+	 */
+	float copy_time() const;
+
+	/**
+	 * Reset the time spent copying the collections of the inputs.
+	 */
+	void clear_copy_time();
+
+	/**
+	 * Return whether this node can be processed concurrently with other nodes.
+	 */
+	bool thread_safe() const;
+
+	/**
+	 * Set whether this node can be processed concurrently with other nodes.
+	 * Nodes which only touch the collections they receive through their
+	 * inputs can safely opt in; nodes relying on some global state should not.
+	 */
+	void thread_safe(bool yesno);
+
+	/**
+	 * Return whether this node modifies the collections of its inputs.
+	 */
+	bool modifies_input() const;
+
+	/**
+	 * Set whether this node modifies the collections of its inputs. Nodes
+	 * which only read them, e.g. to write them to a file, can opt out so that
+	 * they receive the collections of the upstream nodes instead of a copy,
+	 * and pass them through to their output.
+	 */
+	void modifies_input(bool yesno);
+
+	/**
+	 * Return whether the output of this node depends on the frame it is
+	 * evaluated for. Nodes for which this depends on their properties can
+	 * override this method.
+	 */
+	virtual bool time_dependent() const;
+
+	/**
+	 * Set whether the output of this node depends on the frame it is evaluated
+	 * for, so that it is processed again when the frame changes. The other
+	 * nodes are only processed again if one of their inputs was.
+	 */
+	void time_dependent(bool yesno);
+
+	/**
+	 * Tag this node as needing to be processed again, for example when one of
+	 * its inputs got connected or disconnected.
+	 */
+	void tag_update();
+
+	/**
+	 * Return whether this node needs to be processed again, that is if it was
+	 * tagged as such, or if any of its properties changed since the last time
+	 * it was processed. Otherwise the collection it last output can be reused.
+	 */
+	bool need_update() const;
+
+	/**
+	 * Mark this node as up to date with its current properties.
+	 */
+	void clear_update();
+
+	/**
+	 * Set the token of the evaluation this node is being processed for, or
+	 * nullptr once it is done.
+	 */
+	void cancellation_token(const CancellationToken *token);
+
+	/**
+	 * Return whether the evaluation this node is being processed for was
+	 * cancelled, e.g. because a newer one was requested, in which case the
+	 * output of this node is discarded. Long running nodes should check this
+	 * regularly, and return early when it is true.
+	 */
+	bool cancelled() const;
+
+	/**
+	 * Set the frame this node is being processed for.
+	 */
+	void frame(int value);
+
+	/**
+	 * Return the frame this node is being processed for, which is not always
+	 * the current frame of the scene, e.g. during playback.
+	 */
+	int frame() const;
+
 	/**
 	 * Return this node's flags.
 	 */
@@ -326,6 +455,8 @@ public:
 
 	size_t numEntries() const;
 
+	bool registered(const std::string &name) const;
+
 	std::vector<std::string> keys(const std::string &category) const;
 
 	std::vector<std::string> categories() const;
@@ -0,0 +1,177 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+#include "normals.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#include "geomlists.h"
+#include "util_parallel.h"
+
+static inline unsigned int poly_size(const glm::uvec4 &poly)
+{
+	return (poly[3] == INVALID_INDEX) ? 3 : 4;
+}
+
+/* Return the normal of a face, whose length is twice the area of the face. */
+static inline glm::vec3 face_normal(const PointList &points, const glm::uvec4 &poly)
+{
+	const auto &v0 = points[poly[0]];
+	const auto &v1 = points[poly[1]];
+	const auto &v2 = points[poly[2]];
+
+	auto normal = glm::cross(v1 - v0, v2 - v0);
+
+	if (poly[3] != INVALID_INDEX) {
+		const auto &v3 = points[poly[3]];
+		normal += glm::cross(v2 - v0, v3 - v0);
+	}
+
+	return normal;
+}
+
+/* Return the angle of a face at the given corner. */
+static inline float corner_angle(const PointList &points, const glm::uvec4 &poly, unsigned int corner)
+{
+	const auto size = poly_size(poly);
+	const auto &v = points[poly[corner]];
+	const auto e0 = points[poly[(corner + size - 1) % size]] - v;
+	const auto e1 = points[poly[(corner + 1) % size]] - v;
+
+	const auto l0 = glm::length(e0);
+	const auto l1 = glm::length(e1);
+
+	if (l0 == 0.0f || l1 == 0.0f) {
+		return 0.0f;
+	}
+
+	return std::acos(glm::clamp(glm::dot(e0, e1) / (l0 * l1), -1.0f, 1.0f));
+}
+
+void compute_normals(const PointList &points,
+                     const PolygonList &polys,
+                     glm::vec3 *normals,
+                     int weighting,
+                     bool flip)
+{
+	const auto num_points = points.size();
+	const auto num_polys = polys.size();
+
+	/* 1. Compute the normals of the faces. */
+	std::vector<glm::vec3> face_normals(num_polys);
+
+	parallel_for_light_items(tbb::blocked_range<size_t>(0, num_polys),
+	                         [&](const tbb::blocked_range<size_t> &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie ; ++i) {
+			face_normals[i] = face_normal(points, polys[i]);
+		}
+	});
+
+	/* 2. Build the vertex to face corner adjacency table: the corners of the
+	 * faces using vertex i are corners[offsets[i]] to corners[offsets[i + 1]],
+	 * each corner being encoded as face * 4 + index of the corner. */
+	std::vector<std::atomic<unsigned int>> counts(num_points);
+
+	parallel_for_light_items(tbb::blocked_range<size_t>(0, num_polys),
+	                         [&](const tbb::blocked_range<size_t> &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie ; ++i) {
+			const auto &poly = polys[i];
+
+			for (auto j = 0u, je = poly_size(poly); j < je; ++j) {
+				counts[poly[j]].fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+	});
+
+	std::vector<unsigned int> offsets(num_points + 1);
+	offsets[0] = 0;
+
+	for (size_t i = 0; i < num_points; ++i) {
+		offsets[i + 1] = offsets[i] + counts[i].load(std::memory_order_relaxed);
+		counts[i].store(offsets[i], std::memory_order_relaxed);
+	}
+
+	std::vector<unsigned int> corners(offsets[num_points]);
+
+	parallel_for_light_items(tbb::blocked_range<size_t>(0, num_polys),
+	                         [&](const tbb::blocked_range<size_t> &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie ; ++i) {
+			const auto &poly = polys[i];
+
+			for (auto j = 0u, je = poly_size(poly); j < je; ++j) {
+				const auto index = counts[poly[j]].fetch_add(1, std::memory_order_relaxed);
+				corners[index] = i * 4 + j;
+			}
+		}
+	});
+
+	/* 3. Gather the normals of the faces around each vertex. The corners are
+	 * sorted first, so that the sums are always done in the same order. */
+	const auto sign = (flip) ? -1.0f : 1.0f;
+
+	parallel_for_light_items(tbb::blocked_range<size_t>(0, num_points),
+	                         [&](const tbb::blocked_range<size_t> &r)
+	{
+		for (auto i = r.begin(), ie = r.end(); i < ie ; ++i) {
+			const auto begin = corners.begin() + offsets[i];
+			const auto end = corners.begin() + offsets[i + 1];
+
+			std::sort(begin, end);
+
+			auto normal = glm::vec3(0.0f);
+
+			for (auto iter = begin; iter != end; ++iter) {
+				const auto face = *iter / 4;
+
+				if (weighting == NORMAL_WEIGHT_ANGLE) {
+					const auto length = glm::length(face_normals[face]);
+
+					if (length == 0.0f) {
+						continue;
+					}
+
+					const auto angle = corner_angle(points, polys[face], *iter % 4);
+					normal += face_normals[face] * (angle / length);
+				}
+				else {
+					normal += face_normals[face];
+				}
+			}
+
+			const auto length = glm::length(normal);
+
+			if (length == 0.0f) {
+				normals[i] = glm::vec3(0.0f);
+				continue;
+			}
+
+			normals[i] = normal * (sign / length);
+		}
+	});
+}
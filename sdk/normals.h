@@ -0,0 +1,57 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+#pragma once
+
+#include <glm/glm.hpp>
+
+class PointList;
+class PolygonList;
+
+enum {
+	/* Weight the normal of each face by its area. */
+	NORMAL_WEIGHT_AREA  = 0,
+	/* Weight the normal of each face by its angle at the vertex. */
+	NORMAL_WEIGHT_ANGLE = 1,
+};
+
+/**
+ * @brief compute_normals Compute the vertex normals of a polygon mesh.
+ *
+ * Rather than scattering the face normals to the vertices, which would need
+ * some synchronisation, each vertex gathers the normals of the faces around
+ * it through a vertex to face adjacency table, so every step runs in parallel
+ * without any data race. The result does not depend on the number of threads.
+ *
+ * @param points    The points of the mesh.
+ * @param polys     The polygons of the mesh, triangles or quads.
+ * @param normals   The array to write the normals to, of points.size() size.
+ * @param weighting How to weight the normals of the faces, one of the
+ *                  NORMAL_WEIGHT_* values.
+ * @param flip      Whether to flip the normals.
+ */
+void compute_normals(const PointList &points,
+                     const PolygonList &polys,
+                     glm::vec3 *normals,
+                     int weighting,
+                     bool flip);
@@ -24,39 +24,169 @@
 
 #include "persona.h"
 
-void Persona::add_prop(std::string name, std::string ui_name, property_type type)
-{
-	Property prop;
-	prop.name = std::move(name);
-	prop.ui_name = std::move(ui_name);
-	prop.type = type;
-	prop.visible = true;
+#include <functional>
 
+static std::experimental::any initial_value(property_type type)
+{
 	switch (type) {
 		case property_type::prop_bool:
-			prop.data = std::experimental::any(false);
-			break;
+			return std::experimental::any(false);
 		case property_type::prop_float:
-			prop.data = std::experimental::any(0.0f);
-			break;
+			return std::experimental::any(0.0f);
 		case property_type::prop_vec3:
-			prop.data = std::experimental::any(glm::vec3(0.0f));
-			break;
+			return std::experimental::any(glm::vec3(0.0f));
 		case property_type::prop_enum:
 		case property_type::prop_int:
-			prop.data = std::experimental::any(int(0));
-			break;
+			return std::experimental::any(int(0));
 		case property_type::prop_input_file:
 		case property_type::prop_output_file:
 		case property_type::prop_string:
 		case property_type::prop_list:
-			prop.data = std::experimental::any(std::string(""));
-			break;
+			return std::experimental::any(std::string(""));
 	}
 
-	assert(!prop.data.empty());
+	return {};
+}
+
+static std::shared_ptr<PropertyDesc> new_desc(std::string name, std::string ui_name, property_type type)
+{
+	auto desc = std::make_shared<PropertyDesc>();
+	desc->name = std::move(name);
+	desc->ui_name = std::move(ui_name);
+	desc->type = type;
+	desc->default_val = initial_value(type);
+
+	assert(!desc->default_val.empty());
+
+	return desc;
+}
+
+static bool is_string_type(property_type type)
+{
+	return type == property_type::prop_string ||
+	       type == property_type::prop_input_file ||
+	       type == property_type::prop_output_file ||
+	       type == property_type::prop_list;
+}
+
+/* ******************************** schema ********************************** */
+
+PropRef PropertySchema::add_prop(std::string name, std::string ui_name, property_type type)
+{
+	m_descs.push_back(new_desc(std::move(name), std::move(ui_name), type));
+	return PropRef(m_descs.size() - 1, type);
+}
+
+void PropertySchema::set_prop_min_max(const float min, const float max)
+{
+	auto &desc = *m_descs.back();
+	desc.min = min;
+	desc.max = max;
+}
+
+void PropertySchema::set_prop_enum_values(const EnumProperty &enum_prop)
+{
+	auto &desc = *m_descs.back();
+
+	assert(desc.type == property_type::prop_enum || desc.type == property_type::prop_list);
+
+	desc.enum_items = enum_prop;
+}
+
+void PropertySchema::set_prop_default_value_int(int value)
+{
+	auto &desc = *m_descs.back();
+
+	assert(desc.type == property_type::prop_int || desc.type == property_type::prop_enum);
+
+	desc.default_val = std::experimental::any(value);
+}
+
+void PropertySchema::set_prop_default_value_float(float value)
+{
+	auto &desc = *m_descs.back();
+
+	assert(desc.type == property_type::prop_float);
+
+	desc.default_val = std::experimental::any(value);
+}
+
+void PropertySchema::set_prop_default_value_bool(bool value)
+{
+	auto &desc = *m_descs.back();
+
+	assert(desc.type == property_type::prop_bool);
+
+	desc.default_val = std::experimental::any(value);
+}
+
+void PropertySchema::set_prop_default_value_string(const std::string &value)
+{
+	auto &desc = *m_descs.back();
+
+	assert(is_string_type(desc.type));
+
+	desc.default_val = std::experimental::any(value);
+}
+
+void PropertySchema::set_prop_default_value_vec3(const glm::vec3 &value)
+{
+	auto &desc = *m_descs.back();
+
+	assert(desc.type == property_type::prop_vec3);
+
+	desc.default_val = std::experimental::any(value);
+}
+
+void PropertySchema::set_prop_tooltip(std::string tooltip)
+{
+	m_descs.back()->tooltip = std::move(tooltip);
+}
+
+const std::vector<std::shared_ptr<PropertyDesc>> &PropertySchema::descs() const
+{
+	return m_descs;
+}
+
+/* ******************************** persona ********************************* */
+
+PropRef Persona::add_prop(std::string name, std::string ui_name, property_type type)
+{
+	Property prop;
+	prop.desc = new_desc(std::move(name), std::move(ui_name), type);
+	prop.data = prop.desc->default_val;
+	prop.visible = true;
 
 	m_props.push_back(std::move(prop));
+
+	return PropRef(m_props.size() - 1, type);
+}
+
+void Persona::use_schema(const PropertySchema &schema)
+{
+	assert(m_props.empty());
+
+	m_props.reserve(schema.descs().size());
+
+	for (const auto &desc : schema.descs()) {
+		Property prop;
+		prop.desc = desc;
+		prop.data = desc->default_val;
+		prop.visible = true;
+
+		m_props.push_back(std::move(prop));
+	}
+}
+
+PropertyDesc &Persona::last_desc()
+{
+	auto &desc = m_props.back().desc;
+
+	if (desc.use_count() > 1) {
+		desc = std::make_shared<PropertyDesc>(*desc);
+	}
+
+	return *desc;
 }
 
 void Persona::set_prop_visible(const std::string &prop_name, bool visible)
@@ -135,18 +265,18 @@ std::string Persona::eval_string(const std::string &prop_name)
 
 void Persona::set_prop_min_max(const float min, const float max)
 {
-	Property &prop = this->m_props.back();
-	prop.min = min;
-	prop.max = max;
+	auto &desc = last_desc();
+	desc.min = min;
+	desc.max = max;
 }
 
 void Persona::set_prop_enum_values(const EnumProperty &enum_prop)
 {
-	Property &prop = this->m_props.back();
+	auto &desc = last_desc();
 
-	assert(prop.type == property_type::prop_enum || prop.type == property_type::prop_list);
+	assert(desc.type == property_type::prop_enum || desc.type == property_type::prop_list);
 
-	prop.enum_items = enum_prop;
+	desc.enum_items = enum_prop;
 }
 
 void Persona::set_prop_enum_values(const std::string &prop_name, const EnumProperty &enum_prop)
@@ -157,63 +287,69 @@ void Persona::set_prop_enum_values(const std::string &prop_name, const EnumPrope
 		return;
 	}
 
-	assert(prop->type == property_type::prop_enum || prop->type == property_type::prop_list);
+	assert(prop->desc->type == property_type::prop_enum || prop->desc->type == property_type::prop_list);
 
-	prop->enum_items = enum_prop;
+	/* The items only change for this persona. */
+	if (prop->desc.use_count() > 1) {
+		prop->desc = std::make_shared<PropertyDesc>(*prop->desc);
+	}
+
+	prop->desc->enum_items = enum_prop;
 }
 
 void Persona::set_prop_default_value_int(int value)
 {
-	Property &prop = this->m_props.back();
+	auto &desc = last_desc();
 
-	assert(prop.type == property_type::prop_int || prop.type == property_type::prop_enum);
+	assert(desc.type == property_type::prop_int || desc.type == property_type::prop_enum);
 
-	prop.data = std::experimental::any(value);
+	desc.default_val = std::experimental::any(value);
+	m_props.back().data = desc.default_val;
 }
 
 void Persona::set_prop_default_value_float(float value)
 {
-	Property &prop = this->m_props.back();
+	auto &desc = last_desc();
 
-	assert(prop.type == property_type::prop_float);
+	assert(desc.type == property_type::prop_float);
 
-	prop.data = std::experimental::any(value);
+	desc.default_val = std::experimental::any(value);
+	m_props.back().data = desc.default_val;
 }
 
 void Persona::set_prop_default_value_bool(bool value)
 {
-	Property &prop = this->m_props.back();
+	auto &desc = last_desc();
 
-	assert(prop.type == property_type::prop_bool);
+	assert(desc.type == property_type::prop_bool);
 
-	prop.data = std::experimental::any(value);
+	desc.default_val = std::experimental::any(value);
+	m_props.back().data = desc.default_val;
 }
 
 void Persona::set_prop_default_value_string(const std::string &value)
 {
-	Property &prop = this->m_props.back();
+	auto &desc = last_desc();
 
-	assert(prop.type == property_type::prop_string ||
-	       prop.type == property_type::prop_input_file ||
-	       prop.type == property_type::prop_output_file ||
-	       prop.type == property_type::prop_list);
+	assert(is_string_type(desc.type));
 
-	prop.data = std::experimental::any(value);
+	desc.default_val = std::experimental::any(value);
+	m_props.back().data = desc.default_val;
 }
 
 void Persona::set_prop_default_value_vec3(const glm::vec3 &value)
 {
-	Property &prop = this->m_props.back();
+	auto &desc = last_desc();
 
-	assert(prop.type == property_type::prop_vec3);
+	assert(desc.type == property_type::prop_vec3);
 
-	prop.data = std::experimental::any(value);
+	desc.default_val = std::experimental::any(value);
+	m_props.back().data = desc.default_val;
 }
 
 void Persona::set_prop_tooltip(std::string tooltip)
 {
-	Property &prop = this->m_props.back();
-	prop.tooltip = std::move(tooltip);
+	last_desc().tooltip = std::move(tooltip);
 }
 
 std::vector<Property> &Persona::props()
@@ -221,4 +357,46 @@ std::vector<Property> &Persona::props()
 	return m_props;
 }
 
+template <typename T>
+static inline void hash_combine(size_t &seed, const T &value)
+{
+	seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+size_t Persona::props_hash() const
+{
+	using std::experimental::any_cast;
+
+	size_t seed = 0;
+
+	for (const Property &prop : m_props) {
+		switch (prop.desc->type) {
+			case property_type::prop_bool:
+				hash_combine(seed, any_cast<bool>(prop.data));
+				break;
+			case property_type::prop_float:
+				hash_combine(seed, any_cast<float>(prop.data));
+				break;
+			case property_type::prop_vec3:
+			{
+				const auto value = any_cast<glm::vec3>(prop.data);
+				hash_combine(seed, value.x);
+				hash_combine(seed, value.y);
+				hash_combine(seed, value.z);
+				break;
+			}
+			case property_type::prop_enum:
+			case property_type::prop_int:
+				hash_combine(seed, any_cast<int>(prop.data));
+				break;
+			case property_type::prop_input_file:
+			case property_type::prop_output_file:
+			case property_type::prop_string:
+			case property_type::prop_list:
+				hash_combine(seed, any_cast<std::string>(prop.data));
+				break;
+		}
+	}
 
+	return seed;
+}
@@ -25,9 +25,12 @@
 #pragma once
 
 #include <algorithm>
+#include <cassert>
 #include <experimental/any>
 #include <glm/glm.hpp>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -61,21 +64,188 @@ struct EnumProperty {
 	}
 };
 
-struct Property {
+/**
+ * @brief PropertyDesc describes a property: how it is named, shown and
+ *        initialized. Descriptions declared in a PropertySchema are shared by
+ *        the properties of all the personas using the schema.
+ */
+struct PropertyDesc {
 	std::string name;
 	std::string ui_name;
 	std::string tooltip;
 	property_type type;
 
-	std::experimental::any data;
 	std::experimental::any default_val;
 
 	EnumProperty enum_items;
 
-	float min, max;
+	float min = 0.0f, max = 0.0f;
+};
+
+struct Property {
+	/* Shared with the other instances of the persona, it is copied before
+	 * being modified for a single instance, see Persona::set_prop_enum_values(). */
+	std::shared_ptr<PropertyDesc> desc;
+
+	std::experimental::any data;
+
 	bool visible;
 };
 
+/**
+ * @brief prop_type_traits Map the type of the values of properties to the
+ *                         property types holding them.
+ */
+template <typename T>
+struct prop_type_traits {
+	static bool holds(property_type /*type*/)
+	{
+		return false;
+	}
+};
+
+#define DEFINE_PROP_TYPE_TRAITS(value_type, ...) \
+	template <> \
+	struct prop_type_traits<value_type> { \
+		static bool holds(property_type type) \
+		{ \
+			const property_type types[] = { __VA_ARGS__ }; \
+			return std::find(std::begin(types), std::end(types), type) != std::end(types); \
+		} \
+	}
+
+DEFINE_PROP_TYPE_TRAITS(bool, property_type::prop_bool);
+DEFINE_PROP_TYPE_TRAITS(int, property_type::prop_int, property_type::prop_enum);
+DEFINE_PROP_TYPE_TRAITS(float, property_type::prop_float);
+DEFINE_PROP_TYPE_TRAITS(glm::vec3, property_type::prop_vec3);
+DEFINE_PROP_TYPE_TRAITS(std::string, property_type::prop_string, property_type::prop_input_file,
+                        property_type::prop_output_file, property_type::prop_list);
+
+#undef DEFINE_PROP_TYPE_TRAITS
+
+/**
+ * @brief PropHandle is a handle to a property whose values are of type T,
+ *        i.e. its index in the properties of the persona. It is obtained from
+ *        add_prop(), and evaluated with Persona::eval(), which does not look
+ *        up the property by name.
+ */
+template <typename T>
+class PropHandle {
+	size_t m_index = static_cast<size_t>(-1);
+
+public:
+	PropHandle() = default;
+
+	explicit PropHandle(size_t index)
+	    : m_index(index)
+	{}
+
+	size_t index() const
+	{
+		return m_index;
+	}
+
+	bool valid() const
+	{
+		return m_index != static_cast<size_t>(-1);
+	}
+};
+
+/**
+ * @brief PropRef is returned by add_prop(), it converts to the PropHandle
+ *        of the type of the values of the property, which is checked once at
+ *        conversion, a mismatch being a programming error, e.g.
+ * @code
+ * PropHandle<float> m_frequency = add_prop("frequency", "Frequency", property_type::prop_float);
+ * @endcode
+ */
+class PropRef {
+	size_t m_index;
+	property_type m_type;
+
+public:
+	PropRef(size_t index, property_type type)
+	    : m_index(index)
+	    , m_type(type)
+	{}
+
+	size_t index() const
+	{
+		return m_index;
+	}
+
+	template <typename T>
+	operator PropHandle<T>() const
+	{
+		assert(prop_type_traits<T>::holds(m_type));
+		return PropHandle<T>(m_index);
+	}
+};
+
+/**
+ * @brief PropertySchema declares the properties of a type of persona once,
+ *        so that their descriptions are shared by all the instances of the
+ *        type instead of being built for each of them. It has the same
+ *        functions as Persona to declare the properties, a typical use being:
+ * @code
+ * class MyNode : public Node {
+ *     struct Props {
+ *         PropertySchema schema;
+ *         PropHandle<float> size;
+ *
+ *         Props()
+ *         {
+ *             size = schema.add_prop("size", "Size", property_type::prop_float);
+ *             schema.set_prop_default_value_float(1.0f);
+ *         }
+ *     };
+ *
+ *     static const Props &props_schema()
+ *     {
+ *         static const Props props;
+ *         return props;
+ *     }
+ *
+ * public:
+ *     MyNode()
+ *         : Node("My Node")
+ *     {
+ *         use_schema(props_schema().schema);
+ *     }
+ *
+ *     void process() override
+ *     {
+ *         const auto size = eval(props_schema().size);
+ *         ...
+ *     }
+ * };
+ * @endcode
+ */
+class PropertySchema {
+	std::vector<std::shared_ptr<PropertyDesc>> m_descs;
+
+public:
+	PropRef add_prop(std::string name, std::string ui_name, property_type type);
+
+	void set_prop_min_max(const float min, const float max);
+
+	void set_prop_enum_values(const EnumProperty &enum_prop);
+
+	void set_prop_default_value_int(int value);
+
+	void set_prop_default_value_float(float value);
+
+	void set_prop_default_value_bool(bool value);
+
+	void set_prop_default_value_string(const std::string &value);
+
+	void set_prop_default_value_vec3(const glm::vec3 &value);
+
+	void set_prop_tooltip(std::string tooltip);
+
+	const std::vector<std::shared_ptr<PropertyDesc>> &descs() const;
+};
+
 /**
  * @brief Persona is the base class which defines the characteristics of the
  * objects that can have properties exposed in the UI.
@@ -86,7 +256,15 @@ class Persona {
 public:
 	virtual ~Persona() = default;
 
-	void add_prop(std::string name, std::string ui_name, property_type type);
+	PropRef add_prop(std::string name, std::string ui_name, property_type type);
+
+	/**
+	 * @brief use_schema Add the properties declared in the schema, sharing
+	 *                   their descriptions. This must be called before any
+	 *                   other property is added, so that the handles of the
+	 *                   schema refer to the properties of this persona.
+	 */
+	void use_schema(const PropertySchema &schema);
 
 	void set_prop_visible(const std::string &prop_name, bool visible);
 
@@ -104,6 +282,21 @@ public:
 
 	std::string eval_string(const std::string &prop_name);
 
+	/**
+	 * @brief eval Return the value of the property of the handle, which stays
+	 *             valid until the property is modified.
+	 */
+	template <typename T>
+	const T &eval(PropHandle<T> handle) const
+	{
+		assert(handle.index() < m_props.size());
+
+		const auto value = std::experimental::any_cast<T>(&m_props[handle.index()].data);
+		assert(value != nullptr);
+
+		return *value;
+	}
+
 	void set_prop_min_max(const float min, const float max);
 
 	void set_prop_enum_values(const EnumProperty &enum_prop);
@@ -123,6 +316,12 @@ public:
 
 	std::vector<Property> &props();
 
+	/**
+	 * @brief props_hash Compute a hash of the values of the properties, to
+	 *                   detect whether any of them changed.
+	 */
+	size_t props_hash() const;
+
 private:
 	inline Property *find_property(const std::string &prop_name)
 	{
@@ -130,7 +329,7 @@ private:
 		const auto &iter = std::find_if(m_props.begin(), m_props.end(),
 		                                [&](const Property &prop)
 		{
-			return prop.name == prop_name;
+			return prop.desc->name == prop_name;
 		});
 
 		if (iter == m_props.end()) {
@@ -141,4 +340,8 @@ private:
 		const auto index = iter - m_props.begin();
 		return &m_props[index];
 	}
+
+	/* Return the description of the last property added, copied first if it
+	 * is shared. */
+	PropertyDesc &last_desc();
 };
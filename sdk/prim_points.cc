@@ -25,23 +25,17 @@
 #include "prim_points.h"
 
 #include <algorithm>
-#include <ego/utils.h>
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "context.h"
 #include "renderbuffer.h"
+#include "util_trace.h"
 
 /* ************************************************************************** */
 
 static RenderBuffer *create_point_buffer()
 {
-	RenderBuffer *renderbuffer = new RenderBuffer;
-
-	renderbuffer->set_shader_source(ego::VERTEX_SHADER, ego::util::str_from_file("shaders/flat_shader.vert"));
-	renderbuffer->set_shader_source(ego::FRAGMENT_SHADER, ego::util::str_from_file("shaders/flat_shader.frag"));
-	renderbuffer->finalize_shader();
-
 	ProgramParams params;
 	params.add_attribute("vertex");
 	params.add_attribute("vertex_color");
@@ -51,10 +45,11 @@ static RenderBuffer *create_point_buffer()
 	params.add_uniform("color");
 	params.add_uniform("has_vcolors");
 
-	renderbuffer->set_shader_params(params);
-
-	ego::Program *program = renderbuffer->program();
-	program->uniform("color", 0.0f, 0.0f, 0.0f, 1.0f);
+	RenderBuffer *renderbuffer = new RenderBuffer;
+	renderbuffer->set_program(get_program(shader_source("flat_shader.vert"),
+	                                      shader_source("flat_shader.frag"),
+	                                      params));
+	renderbuffer->set_uniform("color", glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
 
 	DrawParams draw_params;
 	draw_params.set_draw_type(GL_POINTS);
@@ -70,26 +65,16 @@ static RenderBuffer *create_point_buffer()
 size_t PrimPoints::id = -1;
 
 PrimPoints::PrimPoints()
-    : m_renderbuffer(nullptr)
+    : m_render_cache(std::make_shared<RenderBufferCache>())
 {}
 
 PrimPoints::PrimPoints(const PrimPoints &other)
     : Primitive(other)
-    , m_renderbuffer(nullptr)
-{
-	/* Copy points. */
-	auto points = other.points();
-	m_points.resize(points->size());
+    , m_points(other.m_points)
+    , m_render_cache(other.m_render_cache)
+{}
 
-	for (auto i = 0ul; i < points->size(); ++i) {
-		m_points[i] = (*points)[i];
-	}
-}
-
-PrimPoints::~PrimPoints()
-{
-	free_renderbuffer(m_renderbuffer);
-}
+PrimPoints::~PrimPoints() = default;
 
 PointList *PrimPoints::points()
 {
@@ -114,27 +99,79 @@ size_t PrimPoints::typeID() const
 	return PrimPoints::id;
 }
 
+size_t PrimPoints::memoryUsage() const
+{
+	return Primitive::memoryUsage()
+	       + m_points.byte_size();
+}
+
+size_t PrimPoints::ownedMemoryUsage() const
+{
+	return Primitive::ownedMemoryUsage()
+	       + (m_points.shared() ? 0ul : m_points.byte_size());
+}
+
+size_t PrimPoints::pointCount() const
+{
+	return m_points.size();
+}
+
+void PrimPoints::write(std::ostream &os) const
+{
+	Primitive::write(os);
+	m_points.write(os);
+}
+
+bool PrimPoints::read(std::istream &is)
+{
+	return Primitive::read(is)
+	       && m_points.read(is);
+}
+
 void PrimPoints::render(const ViewerContext &context)
 {
 	m_renderbuffer->render(context);
 }
 
+void PrimPoints::packRenderData()
+{
+	if (m_need_data_pack) {
+		computeBBox(m_min, m_max);
+	}
+
+	Primitive::packRenderData();
+}
+
 void PrimPoints::prepareRenderData()
 {
 	if (!m_need_data_update) {
 		return;
 	}
 
-	if (!m_renderbuffer) {
-		m_renderbuffer = create_point_buffer();
+	TRACE_SPAN("PrimPoints::prepareRenderData");
+
+	if (m_need_data_pack) {
+		packRenderData();
 	}
 
-	computeBBox(m_min, m_max);
+	/* The points are uploaded as is, the matrix of the primitive is applied
+	 * when drawing, so a transformed copy can reuse the buffer of its source. */
+	auto colors = this->attribute("color", ATTR_TYPE_VEC3);
+
+	const auto sources = std::vector<size_t>{
+		m_points.buffer_id(),
+		(colors != nullptr) ? colors->typed_list<glm::vec3>()->buffer_id() : 0,
+	};
 
-	for (size_t i = 0, ie = this->points()->size(); i < ie; ++i) {
-		m_points[i] = m_points[i] * glm::mat3(m_inv_matrix);
+	m_renderbuffer = m_render_cache->find(sources);
+
+	if (m_renderbuffer != nullptr) {
+		m_need_data_update = false;
+		return;
 	}
 
+	m_renderbuffer = m_render_cache->add(create_point_buffer());
+
 	m_renderbuffer->set_vertex_buffer("vertex",
 	                                  m_points.data(),
 	                                  m_points.byte_size(),
@@ -142,19 +179,21 @@ void PrimPoints::prepareRenderData()
 	                                  0,
 	                                  m_points.size());
 
-	auto colors = this->attribute("color", ATTR_TYPE_VEC3);
-
 	if (colors != nullptr) {
 		m_renderbuffer->set_color_buffer("vertex_color", colors->data(), colors->byte_size());
 	}
 
+	m_renderbuffer->set_sources(sources);
+
 	m_need_data_update = false;
 }
 
 void PrimPoints::computeBBox(glm::vec3 &min, glm::vec3 &max)
 {
-	for (size_t i = 0, ie = this->points()->size(); i < ie; ++i) {
-		auto vert = m_points[i];
+	const PointList &points = m_points;
+
+	for (size_t i = 0, ie = points.size(); i < ie; ++i) {
+		const auto &vert = points[i];
 
 		if (vert.x < m_min.x) {
 			m_min.x = vert.x;
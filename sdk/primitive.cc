@@ -24,9 +24,11 @@
 #include "primitive.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <GL/glew.h>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "util_binary.h"
 #include "util_render.h"
 #include "util_string.h"
 
@@ -44,6 +46,7 @@ Primitive::Primitive(const Primitive &other)
     , m_draw_bbox(other.m_draw_bbox)
     , m_need_update(other.m_need_update)
     , m_need_data_update(other.m_need_data_update)
+    , m_need_data_pack(other.m_need_data_pack)
 {
 	for (auto attr : m_attributes) {
 		delete attr;
@@ -157,6 +160,102 @@ void Primitive::tagUpdate()
 {
 	m_need_update = true;
 	m_need_data_update = true;
+	m_need_data_pack = true;
+}
+
+void Primitive::packRenderData()
+{
+	update();
+	m_need_data_pack = false;
+}
+
+size_t Primitive::memoryUsage() const
+{
+	auto size = 0ul;
+
+	for (const auto &attr : m_attributes) {
+		size += attr->byte_size();
+	}
+
+	return size;
+}
+
+size_t Primitive::ownedMemoryUsage() const
+{
+	auto size = 0ul;
+
+	for (const auto &attr : m_attributes) {
+		if (!attr->shared()) {
+			size += attr->byte_size();
+		}
+	}
+
+	return size;
+}
+
+size_t Primitive::pointCount() const
+{
+	return 0;
+}
+
+void Primitive::write(std::ostream &os) const
+{
+	write_binary(os, m_name);
+	write_binary(os, m_dimensions);
+	write_binary(os, m_scale);
+	write_binary(os, m_inv_size);
+	write_binary(os, m_rotation);
+	write_binary(os, m_min);
+	write_binary(os, m_max);
+	write_binary(os, m_pos);
+	write_binary(os, m_matrix);
+	write_binary(os, m_inv_matrix);
+
+	write_binary(os, static_cast<uint64_t>(m_attributes.size()));
+
+	for (const auto &attr : m_attributes) {
+		attr->write(os);
+	}
+}
+
+bool Primitive::read(std::istream &is)
+{
+	auto ok = read_binary(is, m_name)
+	          && read_binary(is, m_dimensions)
+	          && read_binary(is, m_scale)
+	          && read_binary(is, m_inv_size)
+	          && read_binary(is, m_rotation)
+	          && read_binary(is, m_min)
+	          && read_binary(is, m_max)
+	          && read_binary(is, m_pos)
+	          && read_binary(is, m_matrix)
+	          && read_binary(is, m_inv_matrix);
+
+	uint64_t num_attributes;
+
+	if (!ok || !read_binary(is, num_attributes)) {
+		return false;
+	}
+
+	for (auto &attr : m_attributes) {
+		delete attr;
+	}
+
+	m_attributes.clear();
+
+	for (auto i = 0ul; i < num_attributes; ++i) {
+		auto attr = Attribute::read(is);
+
+		if (attr == nullptr) {
+			return false;
+		}
+
+		m_attributes.push_back(attr);
+	}
+
+	tagUpdate();
+
+	return true;
 }
 
 std::string Primitive::name() const
@@ -213,9 +312,8 @@ void Primitive::remove_attribute(const std::string &name, const AttributeType ty
 
 	if (iter != m_attributes.end()) {
 		delete *iter;
+		m_attributes.erase(iter);
 	}
-
-	m_attributes.erase(iter);
 }
 
 bool Primitive::has_attribute(const std::string &name, const AttributeType type)
@@ -223,25 +321,46 @@ bool Primitive::has_attribute(const std::string &name, const AttributeType type)
 	return (attribute(name, type) != nullptr);
 }
 
+const std::vector<Attribute *> &Primitive::attributes() const
+{
+	return m_attributes;
+}
+
 /* ********************************************** */
 
 void PrimitiveCache::add(PrimitiveCollection *collection)
 {
+	/* Nodes of different branches of a graph may add to the cache at the same
+	 * time. */
+	std::unique_lock<std::mutex> lock(m_mutex);
+
 	if (collection->refcount() > 0) {
 		return;
 	}
 
 	collection->incref();
 
-	m_collections.push_back(collection);
+	m_collections.emplace_back(collection);
 }
 
-void PrimitiveCache::clear()
+PrimitiveCollectionPtr PrimitiveCache::share(const PrimitiveCollection *collection)
 {
-	for (auto &collection : m_collections) {
-		delete collection;
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	for (const auto &cached : m_collections) {
+		if (cached.get() == collection) {
+			return cached;
+		}
 	}
 
+	return nullptr;
+}
+
+void PrimitiveCache::clear()
+{
+	/* The collections still shared elsewhere, e.g. displayed in the viewport,
+	 * are only deleted once released there. */
+	std::unique_lock<std::mutex> lock(m_mutex);
 	m_collections.clear();
 }
 
@@ -360,6 +479,78 @@ PrimitiveFactory *PrimitiveCollection::factory() const
 	return m_factory;
 }
 
+size_t PrimitiveCollection::memoryUsage() const
+{
+	auto size = 0ul;
+
+	for (const auto &prim : m_collection) {
+		size += prim->memoryUsage();
+	}
+
+	return size;
+}
+
+/* Primitives are built from their key in the factory, which they do not know
+ * about, so the keys of the type IDs are found by building a primitive of each
+ * registered type once. */
+static std::string primitive_key(PrimitiveFactory *factory, size_t type_id)
+{
+	static std::mutex mutex;
+	static std::unordered_map<PrimitiveFactory *, std::unordered_map<size_t, std::string>> keys;
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	auto &factory_keys = keys[factory];
+
+	if (factory_keys.size() != factory->num_entries()) {
+		factory_keys.clear();
+
+		for (const auto &key : factory->keys()) {
+			std::unique_ptr<Primitive> prim((*factory)(key));
+			factory_keys[prim->typeID()] = key;
+		}
+	}
+
+	return factory_keys[type_id];
+}
+
+void PrimitiveCollection::write(std::ostream &os) const
+{
+	write_binary(os, static_cast<uint64_t>(m_collection.size()));
+
+	for (const auto &prim : m_collection) {
+		write_binary(os, primitive_key(m_factory, prim->typeID()));
+		prim->write(os);
+	}
+}
+
+bool PrimitiveCollection::read(std::istream &is)
+{
+	uint64_t num_prims;
+
+	if (!read_binary(is, num_prims)) {
+		return false;
+	}
+
+	for (auto i = 0ul; i < num_prims; ++i) {
+		std::string key;
+
+		if (!read_binary(is, key) || !m_factory->registered(key)) {
+			return false;
+		}
+
+		std::unique_ptr<Primitive> prim((*m_factory)(key));
+
+		if (!prim->read(is)) {
+			return false;
+		}
+
+		add(prim.release());
+	}
+
+	return true;
+}
+
 int PrimitiveCollection::refcount() const
 {
 	return m_ref;
@@ -23,7 +23,9 @@
 
 #pragma once
 
+#include <iosfwd>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 
 #include "attribute.h"
@@ -58,6 +60,7 @@ protected:
 	bool m_draw_bbox = false;
 	bool m_need_update = true;
 	bool m_need_data_update = true;
+	bool m_need_data_pack = true;
 
 	std::vector<Attribute *> m_attributes = {};
 
@@ -75,8 +78,18 @@ public:
 	virtual bool intersect(const Ray &ray, float &min) const;
 
 	/**
-	 * @brief prepareRenderData Prepare the data required for drawing this
-	 *                          primitive inside an OpenGL context.
+	 * @brief packRenderData Prepare the data required for drawing this
+	 *                       primitive which does not need an OpenGL context,
+	 *                       e.g. its bounding box, normals or triangulation.
+	 *                       This is called from the threads evaluating the
+	 *                       graphs, so that drawing only has to upload data.
+	 */
+	virtual void packRenderData();
+
+	/**
+	 * @brief prepareRenderData Upload the data required for drawing this
+	 *                          primitive inside an OpenGL context, packing
+	 *                          it first if needed.
 	 */
 	virtual void prepareRenderData() = 0;
 
@@ -160,6 +173,38 @@ public:
 	 */
 	virtual size_t typeID() const = 0;
 
+	/**
+	 * @brief memoryUsage The number of bytes used by the data of this
+	 *                    primitive, i.e. its attributes and geometry.
+	 */
+	virtual size_t memoryUsage() const;
+
+	/**
+	 * @brief ownedMemoryUsage The number of bytes used by the data of this
+	 *                         primitive which is not shared with another
+	 *                         primitive, e.g. the one it was copied from.
+	 */
+	virtual size_t ownedMemoryUsage() const;
+
+	/**
+	 * @brief pointCount The number of points of this primitive, 0 by default.
+	 */
+	virtual size_t pointCount() const;
+
+	/**
+	 * @brief write Write the data of this primitive to a binary stream.
+	 *              Derived classes should call this before writing their own
+	 *              data.
+	 */
+	virtual void write(std::ostream &os) const;
+
+	/**
+	 * @brief read Read the data of this primitive from a binary stream written
+	 *             by write(), replacing its current data.
+	 * @return False if the stream could not be read entirely.
+	 */
+	virtual bool read(std::istream &is);
+
 	/* *************************** Attributes ******************************* */
 
 	/**
@@ -189,6 +234,22 @@ public:
 	 */
 	Attribute *attribute(const std::string &name, const AttributeType type);
 
+	/**
+	 * @brief typed_attribute Look up an attribute whose values are of type T,
+	 *                        and return a handle to its values.
+	 * @param name The name of the attribute to look up.
+	 *
+	 * @return A handle to the values of the attribute, which is invalid if no
+	 *         such attribute exists. To be resolved once before looping over
+	 *         the values.
+	 */
+	template <typename T>
+	TypedAttribute<T> typed_attribute(const std::string &name)
+	{
+		using value_type = typename std::remove_const<T>::type;
+		return TypedAttribute<T>(attribute(name, attribute_type_traits<value_type>::type));
+	}
+
 	/**
 	 * @brief remove_attribute Remove an attribute from this primitive's attibute list.
 	 * @param name The name of the attribute to remove.
@@ -205,6 +266,11 @@ public:
 	 * @return True if such attribute exists, false otherwise.
 	 */
 	bool has_attribute(const std::string &name, const AttributeType type);
+
+	/**
+	 * @brief attributes Return this primitive's attribute list.
+	 */
+	const std::vector<Attribute *> &attributes() const;
 };
 
 /* ********************************************** */
@@ -317,6 +383,24 @@ public:
 	 */
 	PrimitiveFactory *factory() const;
 
+	/**
+	 * @brief memoryUsage The number of bytes used by the data of the
+	 *                    primitives in this collection.
+	 */
+	size_t memoryUsage() const;
+
+	/**
+	 * @brief write Write the primitives of this collection to a binary stream.
+	 */
+	void write(std::ostream &os) const;
+
+	/**
+	 * @brief read Read primitives written by write() from a binary stream, and
+	 *             add them to this collection.
+	 * @return False if the stream could not be read entirely.
+	 */
+	bool read(std::istream &is);
+
 	/* Reference counting, NOT to be used from plugins. They are used to
 	 * indicate that primitives are ready to be deleted.
 	 *
@@ -328,6 +412,8 @@ public:
 	void decref();
 };
 
+using PrimitiveCollectionPtr = std::shared_ptr<PrimitiveCollection>;
+
 /* ********************************************** */
 
 /**
@@ -335,10 +421,19 @@ public:
  *        inside of an object's node graph.
  */
 class PrimitiveCache {
-	std::vector<PrimitiveCollection *> m_collections;
+	std::vector<PrimitiveCollectionPtr> m_collections;
+	std::mutex m_mutex;
 
 public:
 	void add(PrimitiveCollection *collection);
+
+	/**
+	 * @brief share Share the ownership of a collection of this cache, so that
+	 *              it outlives the next call to clear().
+	 * @return nullptr if the collection is not in this cache.
+	 */
+	PrimitiveCollectionPtr share(const PrimitiveCollection *collection);
+
 	void clear();
 };
 
@@ -27,8 +27,10 @@
 #include <ego/utils.h>
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
+#include <memory>
 #include <mutex>
 #include <tbb/concurrent_vector.h>
+#include <unordered_map>
 
 #include "context.h"
 
@@ -98,34 +100,24 @@ void DrawParams::set_point_size(float size)
 
 /* ************************************************************************** */
 
-void RenderBuffer::set_shader_source(int shader_type, const std::string &source, std::ostream &os)
+void RenderBuffer::set_program(ego::Program *program)
 {
-	m_program.load(shader_type, source, os);
+	m_program = program;
 }
 
-void RenderBuffer::set_shader_params(const ProgramParams &params)
+void RenderBuffer::set_draw_params(const DrawParams &params)
 {
-	m_program.enable();
-
-	for (const auto &attribute : params.attributes()) {
-		m_program.addAttribute(attribute);
-	}
-
-	for (const auto &uniform : params.uniforms()) {
-		m_program.addUniform(uniform);
-	}
-
-	m_program.disable();
+	m_params = params;
 }
 
-void RenderBuffer::set_draw_params(const DrawParams &params)
+void RenderBuffer::set_uniform(const std::string &uniform, const glm::vec3 &value)
 {
-	m_params = params;
+	m_uniforms_vec3[uniform] = value;
 }
 
-void RenderBuffer::finalize_shader(std::ostream &os)
+void RenderBuffer::set_uniform(const std::string &uniform, const glm::vec4 &value)
 {
-	m_program.createAndLinkProgram(os);
+	m_uniforms_vec4[uniform] = value;
 }
 
 void RenderBuffer::can_outline(bool yesno)
@@ -151,7 +143,7 @@ void RenderBuffer::set_vertex_buffer(const std::string &attribute,
 	m_buffer_data->bind();
 	m_buffer_data->generateVertexBuffer(&vertices[0][0], vertices.size() * sizeof(glm::vec3));
 	m_buffer_data->generateIndexBuffer(&indices[0], indices.size() * sizeof(unsigned int));
-	m_buffer_data->attribPointer(m_program[attribute], 3);
+	m_buffer_data->attribPointer((*m_program)[attribute], 3);
 	m_buffer_data->unbind();
 }
 
@@ -174,7 +166,7 @@ void RenderBuffer::set_vertex_buffer(const std::string &attribute,
 		m_index_drawing = true;
 	}
 
-	m_buffer_data->attribPointer(m_program[attribute], 3);
+	m_buffer_data->attribPointer((*m_program)[attribute], 3);
 	m_buffer_data->unbind();
 }
 
@@ -185,7 +177,7 @@ void RenderBuffer::set_extra_buffer(const std::string &attribute,
 
 	m_buffer_data->bind();
 	m_buffer_data->generateNormalBuffer(&values[0][0], values.size() * sizeof(glm::vec3));
-	m_buffer_data->attribPointer(m_program[attribute], 3);
+	m_buffer_data->attribPointer((*m_program)[attribute], 3);
 	m_buffer_data->unbind();
 }
 
@@ -204,7 +196,7 @@ void RenderBuffer::set_extra_buffer(const std::string &attribute,
 
 	m_buffer_data->bind();
 	m_buffer_data->generateNormalBuffer(data, data_size);
-	m_buffer_data->attribPointer(m_program[attribute], 3);
+	m_buffer_data->attribPointer((*m_program)[attribute], 3);
 	m_buffer_data->unbind();
 }
 
@@ -224,7 +216,7 @@ void RenderBuffer::set_color_buffer(const std::string &attribute,
 
 	m_buffer_data->bind();
 	m_buffer_data->generateExtraBuffer(colors, colors_size);
-	m_buffer_data->attribPointer(m_program[attribute], 3);
+	m_buffer_data->attribPointer((*m_program)[attribute], 3);
 	m_buffer_data->unbind();
 
 	m_require_color = true;
@@ -236,9 +228,44 @@ void RenderBuffer::set_color_buffer(const std::string &attribute,
 	set_color_buffer(attribute, &colors[0][0], colors.size() * sizeof(glm::vec3));
 }
 
+bool RenderBuffer::update_buffer(const std::string &attribute,
+                                 const void *data,
+                                 const size_t data_size)
+{
+	if (m_buffer_data == nullptr) {
+		return false;
+	}
+
+	m_buffer_data->bind();
+
+	/* Retrieve the buffer from the vertex array state. */
+	GLint buffer = 0;
+	glGetVertexAttribiv((*m_program)[attribute], GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &buffer);
+
+	auto updated = false;
+
+	if (buffer != 0) {
+		GLint buffer_size = 0;
+
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &buffer_size);
+
+		if (static_cast<size_t>(buffer_size) == data_size) {
+			glBufferSubData(GL_ARRAY_BUFFER, 0, data_size, data);
+			updated = true;
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	m_buffer_data->unbind();
+
+	return updated;
+}
+
 void RenderBuffer::render(const ViewerContext &context)
 {
-	if (!m_program.isValid()) {
+	if (m_program == nullptr || !m_program->isValid()) {
 		std::cerr << "Invalid Program\n";
 		return;
 	}
@@ -250,22 +277,31 @@ void RenderBuffer::render(const ViewerContext &context)
 		glLineWidth(m_params.line_size());
 	}
 
-	m_program.enable();
+	auto &program = *m_program;
+
+	program.enable();
 	m_buffer_data->bind();
 
-	glUniformMatrix4fv(m_program("matrix"), 1, GL_FALSE, glm::value_ptr(context.matrix()));
-	glUniformMatrix4fv(m_program("MVP"), 1, GL_FALSE, glm::value_ptr(context.MVP()));
+	glUniformMatrix4fv(program("matrix"), 1, GL_FALSE, glm::value_ptr(context.matrix()));
+	glUniformMatrix4fv(program("MVP"), 1, GL_FALSE, glm::value_ptr(context.MVP()));
 
 	if (m_require_normal) {
-		glUniformMatrix3fv(m_program("N"), 1, GL_FALSE, glm::value_ptr(context.normal()));
+		glUniformMatrix3fv(program("N"), 1, GL_FALSE, glm::value_ptr(context.normal()));
 	}
 
-	if (m_require_color) {
-		glUniform1i(m_program("has_vcolors"), m_require_color);
-	}
+	/* The program is shared with other buffers, so always set this. */
+	glUniform1i(program("has_vcolors"), m_require_color);
 
 	if (m_can_outline) {
-		glUniform1i(m_program("for_outline"), context.for_outline());
+		glUniform1i(program("for_outline"), context.for_outline());
+	}
+
+	for (const auto &uniform : m_uniforms_vec3) {
+		glUniform3fv(program(uniform.first), 1, glm::value_ptr(uniform.second));
+	}
+
+	for (const auto &uniform : m_uniforms_vec4) {
+		glUniform4fv(program(uniform.first), 1, glm::value_ptr(uniform.second));
 	}
 
 	if (m_index_drawing) {
@@ -278,7 +314,7 @@ void RenderBuffer::render(const ViewerContext &context)
 	ego::util::GPU_check_errors("Error rendering buffer\n");
 
 	m_buffer_data->unbind();
-	m_program.disable();
+	program.disable();
 
 	if (m_params.draw_type() == GL_POINTS) {
 		glPointSize(1.0f);
@@ -290,7 +326,32 @@ void RenderBuffer::render(const ViewerContext &context)
 
 ego::Program *RenderBuffer::program()
 {
-	return &m_program;
+	return m_program;
+}
+
+void RenderBuffer::set_sources(std::vector<size_t> sources)
+{
+	m_sources = std::move(sources);
+}
+
+bool RenderBuffer::holds(const std::vector<size_t> &sources) const
+{
+	return m_sources == sources;
+}
+
+const std::vector<size_t> &RenderBuffer::sources() const
+{
+	return m_sources;
+}
+
+void RenderBuffer::topology_version(size_t version)
+{
+	m_topology_version = version;
+}
+
+size_t RenderBuffer::topology_version() const
+{
+	return m_topology_version;
 }
 
 /* ************************************************************************** */
@@ -300,6 +361,9 @@ std::mutex garbage_mutex;
 
 void free_renderbuffer(RenderBuffer *buffer)
 {
+	/* Buffers are freed from the evaluation threads as well, when the last
+	 * reference to a collection is released there. */
+	std::unique_lock<std::mutex> lock(garbage_mutex);
 	garbage_buffer.push_back(buffer);
 }
 
@@ -311,7 +375,125 @@ void purge_all_buffers()
 		for (RenderBuffer *buffer : garbage_buffer) {
 			delete buffer;
 		}
+
+		garbage_buffer.clear();
+	}
+}
+
+/* ************************************************************************** */
+
+std::shared_ptr<RenderBuffer> RenderBufferCache::find(const std::vector<size_t> &sources) const
+{
+	if (m_buffer == nullptr || !m_buffer->holds(sources)) {
+		return nullptr;
+	}
+
+	return m_buffer;
+}
+
+std::shared_ptr<RenderBuffer> RenderBufferCache::unused_buffer() const
+{
+	if (m_buffer == nullptr || m_buffer.use_count() > 1) {
+		return nullptr;
+	}
+
+	return m_buffer;
+}
+
+std::shared_ptr<RenderBuffer> RenderBufferCache::add(RenderBuffer *buffer)
+{
+	m_buffer = std::shared_ptr<RenderBuffer>(buffer, free_renderbuffer);
+	return m_buffer;
+}
+
+/* ************************************************************************** */
+
+static const std::unordered_map<std::string, std::string> embedded_shaders = {
+#include "shader_sources.inc"
+};
+
+const std::string &shader_source(const std::string &name)
+{
+	static const std::string empty_source = "";
+
+	const auto iter = embedded_shaders.find(name);
+
+	if (iter == embedded_shaders.end()) {
+		std::cerr << "Unknown shader: " << name << '\n';
+		return empty_source;
+	}
+
+	return iter->second;
+}
+
+static std::unordered_map<std::string, std::unique_ptr<ego::Program>> program_registry;
+
+ego::Program *get_program(const std::string &vertex_source,
+                          const std::string &fragment_source,
+                          const ProgramParams &params)
+{
+	/* The key holds everything the program is made of, the shaders sources
+	 * are short enough for this to be cheap. */
+	auto key = vertex_source + '\0' + fragment_source + '\0';
+
+	for (const auto &attribute : params.attributes()) {
+		key += attribute + ',';
+	}
+
+	key += '\0';
+
+	for (const auto &uniform : params.uniforms()) {
+		key += uniform + ',';
+	}
+
+	auto &program = program_registry[key];
+
+	if (program != nullptr) {
+		return program.get();
+	}
+
+	program.reset(new ego::Program);
+	program->load(ego::VERTEX_SHADER, vertex_source, std::cerr);
+	program->load(ego::FRAGMENT_SHADER, fragment_source, std::cerr);
+	program->createAndLinkProgram(std::cerr);
+
+	program->enable();
+
+	for (const auto &attribute : params.attributes()) {
+		program->addAttribute(attribute);
+	}
+
+	for (const auto &uniform : params.uniforms()) {
+		program->addUniform(uniform);
 	}
 
-	garbage_buffer.clear();
+	program->disable();
+
+	return program.get();
+}
+
+void release_programs()
+{
+	/* The registry would otherwise only be destroyed at exit, after the
+	 * context. */
+	program_registry.clear();
+}
+
+std::shared_ptr<const std::vector<unsigned int>> RenderBufferCache::indices(size_t topology_version) const
+{
+	std::unique_lock<std::mutex> lock(m_indices_mutex);
+
+	if (m_indices_version != topology_version) {
+		return nullptr;
+	}
+
+	return m_indices;
+}
+
+void RenderBufferCache::indices(size_t topology_version, std::shared_ptr<const std::vector<unsigned int>> indices)
+{
+	std::unique_lock<std::mutex> lock(m_indices_mutex);
+
+	m_indices = std::move(indices);
+	m_indices_version = topology_version;
 }
@@ -29,6 +29,9 @@
 
 #include <glm/glm.hpp>
 
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 class ViewerContext;
@@ -71,24 +74,39 @@ public:
 
 class RenderBuffer {
 	ego::BufferObject::Ptr m_buffer_data = nullptr;
-	ego::Program m_program;
+	ego::Program *m_program = nullptr;
 	size_t m_elements = 0;
 
 	DrawParams m_params;
 
+	/* Since programs are shared, uniforms specific to this buffer are set
+	 * before every draw. */
+	std::unordered_map<std::string, glm::vec3> m_uniforms_vec3 = {};
+	std::unordered_map<std::string, glm::vec4> m_uniforms_vec4 = {};
+
+	/* The data this buffer was filled with, see RenderBufferCache. */
+	std::vector<size_t> m_sources = {};
+	size_t m_topology_version = 0;
+
 	bool m_require_normal = false;
 	bool m_require_color = false;
 	bool m_can_outline = false;
 	bool m_index_drawing = false;
 
 public:
-	void set_shader_source(int shader_type, const std::string &source, std::ostream &os = std::cerr);
-
-	void set_shader_params(const ProgramParams &params);
+	/**
+	 * @brief set_program Set the program used to draw this buffer, which
+	 *                    must be set before any data is added to it. The
+	 *                    program must have the "matrix", "MVP" and
+	 *                    "has_vcolors" uniforms.
+	 */
+	void set_program(ego::Program *program);
 
 	void set_draw_params(const DrawParams &params);
 
-	void finalize_shader(std::ostream &os = std::cerr);
+	void set_uniform(const std::string &uniform, const glm::vec3 &value);
+
+	void set_uniform(const std::string &uniform, const glm::vec4 &value);
 
 	void can_outline(bool yesno);
 
@@ -124,13 +142,128 @@ public:
 	                      const void *normals,
 	                      const size_t normals_size);
 
+	/**
+	 * @brief update_buffer Overwrite the data of the buffer bound to the given
+	 *                      attribute, without reallocating it or touching the
+	 *                      index buffer.
+	 * @return False if there is no such buffer, or if its size differs from
+	 *         data_size, in which case nothing is done.
+	 */
+	bool update_buffer(const std::string &attribute,
+	                   const void *data,
+	                   const size_t data_size);
+
 	void render(const ViewerContext &context);
 
 	ego::Program *program();
 
+	/**
+	 * @brief set_sources Set the identifiers of the data this buffer was
+	 *                    filled with (see cow_vector::buffer_id()), 0 for
+	 *                    missing data.
+	 */
+	void set_sources(std::vector<size_t> sources);
+
+	/**
+	 * @brief holds Return whether this buffer was filled with the given data.
+	 */
+	bool holds(const std::vector<size_t> &sources) const;
+
+	const std::vector<size_t> &sources() const;
+
+	/**
+	 * @brief topology_version Set the version of the topology the index
+	 *                         buffer was made from (see PolygonList).
+	 */
+	void topology_version(size_t version);
+	size_t topology_version() const;
+
 private:
 	void init();
 };
 
 void free_renderbuffer(RenderBuffer *buffer);
 void purge_all_buffers();
+
+/* ************************************************************************** */
+
+/**
+ * @brief The RenderBufferCache class keeps the last buffer drawn by either a
+ *        primitive or one of its copies, between which it is shared. A copy
+ *        whose data did not change, for example because it was only
+ *        transformed, is then drawn with that buffer instead of uploading its
+ *        data again.
+ *
+ *        Buffers only record the identifiers of the data they were filled
+ *        with, without keeping it alive, so a primitive writing to its data
+ *        gives it a new identifier, which will not match the data of any
+ *        buffer.
+ */
+class RenderBufferCache {
+	std::shared_ptr<RenderBuffer> m_buffer = nullptr;
+
+	/* Last triangulation, for primitives packed on different threads. */
+	std::shared_ptr<const std::vector<unsigned int>> m_indices = nullptr;
+	size_t m_indices_version = 0;
+	mutable std::mutex m_indices_mutex;
+
+public:
+	/**
+	 * @brief find Return the buffer filled with the given data, or nullptr if
+	 *             there is none.
+	 */
+	std::shared_ptr<RenderBuffer> find(const std::vector<size_t> &sources) const;
+
+	/**
+	 * @brief unused_buffer Return the buffer of the cache if no primitive is
+	 *                      drawn with it anymore, so that its data can be
+	 *                      updated in place, or nullptr otherwise.
+	 */
+	std::shared_ptr<RenderBuffer> unused_buffer() const;
+
+	/**
+	 * @brief add Add a buffer to the cache, replacing the previous one. The
+	 *            buffer is freed when neither the cache nor any primitive
+	 *            refers to it anymore.
+	 */
+	std::shared_ptr<RenderBuffer> add(RenderBuffer *buffer);
+
+	/**
+	 * @brief indices Return the indices computed for the given topology
+	 *                version (see PolygonList), or nullptr if there are none.
+	 */
+	std::shared_ptr<const std::vector<unsigned int>> indices(size_t topology_version) const;
+
+	/**
+	 * @brief indices Store the indices computed for the given topology
+	 *                version, replacing the previous ones.
+	 */
+	void indices(size_t topology_version, std::shared_ptr<const std::vector<unsigned int>> indices);
+};
+
+/**
+ * @brief shader_source Return the source of the shader with the given file
+ *                      name (e.g. "object.vert"). Shaders are embedded in the
+ *                      library at build time, so nothing is read from disk.
+ */
+const std::string &shader_source(const std::string &name);
+
+/**
+ * @brief get_program Return the program made of the given shaders, with the
+ *                    given attributes and uniforms. Programs are shared by
+ *                    all the buffers and only compiled the first time they
+ *                    are requested. Must be called from the thread owning
+ *                    the OpenGL context.
+ */
+ego::Program *get_program(const std::string &vertex_source,
+                          const std::string &fragment_source,
+                          const ProgramParams &params);
+
+/**
+ * @brief release_programs Free the programs returned by get_program(), which
+ *                         must be done while the OpenGL context is still
+ *                         alive and current, e.g. when the viewer is
+ *                         destroyed. The buffers using them must not be drawn
+ *                         anymore afterwards.
+ */
+void release_programs();
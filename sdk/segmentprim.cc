@@ -25,23 +25,17 @@
 #include "segmentprim.h"
 
 #include <algorithm>
-#include <ego/utils.h>
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "context.h"
 #include "renderbuffer.h"
+#include "util_trace.h"
 
 /* ************************************************************************** */
 
 static RenderBuffer *create_point_buffer()
 {
-	RenderBuffer *renderbuffer = new RenderBuffer;
-
-	renderbuffer->set_shader_source(ego::VERTEX_SHADER, ego::util::str_from_file("shaders/flat_shader.vert"));
-	renderbuffer->set_shader_source(ego::FRAGMENT_SHADER, ego::util::str_from_file("shaders/flat_shader.frag"));
-	renderbuffer->finalize_shader();
-
 	ProgramParams params;
 	params.add_attribute("vertex");
 	params.add_attribute("vertex_color");
@@ -51,10 +45,11 @@ static RenderBuffer *create_point_buffer()
 	params.add_uniform("color");
 	params.add_uniform("has_vcolors");
 
-	renderbuffer->set_shader_params(params);
-
-	ego::Program *program = renderbuffer->program();
-	program->uniform("color", 0.0f, 0.0f, 0.0f);
+	RenderBuffer *renderbuffer = new RenderBuffer;
+	renderbuffer->set_program(get_program(shader_source("flat_shader.vert"),
+	                                      shader_source("flat_shader.frag"),
+	                                      params));
+	renderbuffer->set_uniform("color", glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
 
 	DrawParams draw_params;
 	draw_params.set_draw_type(GL_LINES);
@@ -69,34 +64,17 @@ static RenderBuffer *create_point_buffer()
 size_t SegmentPrim::id = -1;
 
 SegmentPrim::SegmentPrim()
-    : m_renderbuffer(nullptr)
+    : m_render_cache(std::make_shared<RenderBufferCache>())
 {}
 
 SegmentPrim::SegmentPrim(const SegmentPrim &other)
     : Primitive(other)
-    , m_renderbuffer(nullptr)
-{
-	/* Copy points. */
-	auto points = other.points();
-	m_points.resize(points->size());
-
-	for (auto i = 0ul; i < points->size(); ++i) {
-		m_points[i] = (*points)[i];
-	}
-
-	/* Copy edges. */
-	auto edges = other.edges();
-	m_edges.resize(edges->size());
-
-	for (auto i = 0ul; i < edges->size(); ++i) {
-		m_edges[i] = (*edges)[i];
-	}
-}
+    , m_points(other.m_points)
+    , m_edges(other.m_edges)
+    , m_render_cache(other.m_render_cache)
+{}
 
-SegmentPrim::~SegmentPrim()
-{
-	free_renderbuffer(m_renderbuffer);
-}
+SegmentPrim::~SegmentPrim() = default;
 
 PointList *SegmentPrim::points()
 {
@@ -131,6 +109,39 @@ size_t SegmentPrim::typeID() const
 	return SegmentPrim::id;
 }
 
+size_t SegmentPrim::memoryUsage() const
+{
+	return Primitive::memoryUsage()
+	       + m_points.byte_size()
+	       + m_edges.byte_size();
+}
+
+size_t SegmentPrim::ownedMemoryUsage() const
+{
+	return Primitive::ownedMemoryUsage()
+	       + (m_points.shared() ? 0ul : m_points.byte_size())
+	       + (m_edges.shared() ? 0ul : m_edges.byte_size());
+}
+
+size_t SegmentPrim::pointCount() const
+{
+	return m_points.size();
+}
+
+void SegmentPrim::write(std::ostream &os) const
+{
+	Primitive::write(os);
+	m_points.write(os);
+	m_edges.write(os);
+}
+
+bool SegmentPrim::read(std::istream &is)
+{
+	return Primitive::read(is)
+	       && m_points.read(is)
+	       && m_edges.read(is);
+}
+
 void SegmentPrim::render(const ViewerContext &context)
 {
 	/* Render vertices. */
@@ -153,52 +164,69 @@ void SegmentPrim::render(const ViewerContext &context)
 	}
 }
 
+void SegmentPrim::packRenderData()
+{
+	if (m_need_data_pack) {
+		computeBBox(m_min, m_max);
+	}
+
+	Primitive::packRenderData();
+}
+
 void SegmentPrim::prepareRenderData()
 {
 	if (!m_need_data_update) {
 		return;
 	}
 
-	if (!m_renderbuffer) {
-		m_renderbuffer = create_point_buffer();
+	TRACE_SPAN("SegmentPrim::prepareRenderData");
+
+	if (m_need_data_pack) {
+		packRenderData();
 	}
 
-	computeBBox(m_min, m_max);
+	/* The points are uploaded as is, the matrix of the primitive is applied
+	 * when drawing, so a transformed copy can reuse the buffer of its source. */
+	auto colors = this->attribute("color", ATTR_TYPE_VEC3);
 
-	for (size_t i = 0, ie = this->points()->size(); i < ie; ++i) {
-		m_points[i] = m_points[i] * glm::mat3(m_inv_matrix);
-	}
+	const auto sources = std::vector<size_t>{
+		m_points.buffer_id(),
+		m_edges.buffer_id(),
+		(colors != nullptr) ? colors->typed_list<glm::vec3>()->buffer_id() : 0,
+	};
 
-	auto edgelist = this->edges();
-	auto indices = std::vector<unsigned int>{};
-	indices.reserve(edgelist->size());
+	m_renderbuffer = m_render_cache->find(sources);
 
-	for (auto i = 0ul, ie = edgelist->size(); i < ie; ++i) {
-		const auto &edge = (*edgelist)[i];
-		indices.push_back(edge[0]);
-		indices.push_back(edge[1]);
+	if (m_renderbuffer != nullptr) {
+		m_need_data_update = false;
+		return;
 	}
 
+	m_renderbuffer = m_render_cache->add(create_point_buffer());
+
+	/* The edges are laid out as pairs of indices, and can be used as is. */
 	m_renderbuffer->set_vertex_buffer("vertex",
 	                                  m_points.data(),
 	                                  m_points.byte_size(),
-	                                  &indices[0],
-	                                  indices.size() * sizeof(GLuint),
-	                                  indices.size());
-
-	auto colors = this->attribute("color", ATTR_TYPE_VEC3);
+	                                  m_edges.data(),
+	                                  m_edges.byte_size(),
+	                                  m_edges.size() * 2);
 
 	if (colors != nullptr) {
 		m_renderbuffer->set_color_buffer("vertex_color", colors->data(), colors->byte_size());
 	}
 
+	m_renderbuffer->set_sources(sources);
+
 	m_need_data_update = false;
 }
 
 void SegmentPrim::computeBBox(glm::vec3 &min, glm::vec3 &max)
 {
-	for (size_t i = 0, ie = this->points()->size(); i < ie; ++i) {
-		auto vert = m_points[i];
+	const PointList &points = m_points;
+
+	for (size_t i = 0, ie = points.size(); i < ie; ++i) {
+		const auto &vert = points[i];
 
 		if (vert.x < m_min.x) {
 			m_min.x = vert.x;
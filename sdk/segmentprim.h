@@ -29,12 +29,16 @@
 #include "primitive.h"
 
 class RenderBuffer;
+class RenderBufferCache;
 
 class SegmentPrim : public Primitive {
 	PointList m_points;
 	EdgeList m_edges;
 
-	RenderBuffer *m_renderbuffer;
+	std::shared_ptr<RenderBuffer> m_renderbuffer = nullptr;
+
+	/* Shared with the copies of this primitive. */
+	std::shared_ptr<RenderBufferCache> m_render_cache = nullptr;
 
 public:
 	SegmentPrim();
@@ -53,6 +57,8 @@ public:
 
 	void render(const ViewerContext &context) override;
 
+	void packRenderData() override;
+
 	void prepareRenderData() override;
 
 	void computeBBox(glm::vec3 &min, glm::vec3 &max) override;
@@ -61,4 +67,13 @@ public:
 
 	static size_t id;
 	size_t typeID() const override;
+
+	size_t memoryUsage() const override;
+	size_t ownedMemoryUsage() const override;
+
+	size_t pointCount() const override;
+
+	void write(std::ostream &os) const override;
+
+	bool read(std::istream &is) override;
 };
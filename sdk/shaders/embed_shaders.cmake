@@ -0,0 +1,38 @@
+# ***** BEGIN GPL LICENSE BLOCK *****
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+#
+# The Original Code is Copyright (C) 2016 Kévin Dietrich.
+# All rights reserved.
+#
+# ***** END GPL LICENSE BLOCK *****
+
+# Write the sources of the shaders to a file which can be included in an
+# initializer list of {name, source} pairs, so that they are embedded in the
+# library instead of being read from disk at runtime.
+#
+# Usage: cmake -DOUTPUT=<file> -DSHADERS=<file1|file2|...> -P embed_shaders.cmake
+
+string(REPLACE "|" ";" SHADERS "${SHADERS}")
+
+set(CONTENT "/* Generated from the shaders directory, do not edit. */\n\n")
+
+foreach(SHADER ${SHADERS})
+	get_filename_component(NAME ${SHADER} NAME)
+	file(READ ${SHADER} SOURCE)
+	set(CONTENT "${CONTENT}{ \"${NAME}\", R\"KMK_SHADER(${SOURCE})KMK_SHADER\" },\n")
+endforeach()
+
+file(WRITE ${OUTPUT} "${CONTENT}")
@@ -0,0 +1,119 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+/* Helpers to write values to binary streams and to read them back. Values are
+ * written as they are laid out in memory, so they should be plain data, and
+ * the streams are only meant to be read on the platform they were written on. */
+
+template <typename T>
+inline void write_binary(std::ostream &os, const T &value)
+{
+	os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+inline void write_binary(std::ostream &os, const T *values, size_t count)
+{
+	os.write(reinterpret_cast<const char *>(values), sizeof(T) * count);
+}
+
+inline void write_binary(std::ostream &os, const std::string &str)
+{
+	write_binary(os, static_cast<uint64_t>(str.size()));
+	write_binary(os, str.data(), str.size());
+}
+
+/* Return the number of bytes left to read in the stream, or 0 if it cannot be
+ * known, i.e. if the stream cannot seek. */
+inline uint64_t binary_bytes_left(std::istream &is)
+{
+	const auto pos = is.tellg();
+
+	if (pos == std::istream::pos_type(-1)) {
+		return 0;
+	}
+
+	is.seekg(0, std::ios::end);
+	const auto end = is.tellg();
+	is.seekg(pos);
+
+	if (end == std::istream::pos_type(-1) || end < pos) {
+		return 0;
+	}
+
+	return static_cast<uint64_t>(end - pos);
+}
+
+/* Return whether count values taking at least value_size bytes each can still
+ * be read from the stream. Counts read from a stream are to be checked with
+ * this before allocating memory for them, as the stream may be corrupted. Small
+ * counts are accepted without looking at the stream, reading the values fails
+ * anyway if it is too short. */
+inline bool binary_count_fits(std::istream &is, uint64_t count, size_t value_size)
+{
+	constexpr auto small_size = 4096ul;
+
+	if (count <= small_size / value_size) {
+		return true;
+	}
+
+	return count <= binary_bytes_left(is) / value_size;
+}
+
+/* The read functions return whether the stream is still good, i.e. whether the
+ * values could be read entirely. */
+
+template <typename T>
+inline bool read_binary(std::istream &is, T &value)
+{
+	is.read(reinterpret_cast<char *>(&value), sizeof(T));
+	return is.good();
+}
+
+template <typename T>
+inline bool read_binary(std::istream &is, T *values, size_t count)
+{
+	is.read(reinterpret_cast<char *>(values), sizeof(T) * count);
+	return is.good();
+}
+
+inline bool read_binary(std::istream &is, std::string &str)
+{
+	uint64_t size;
+
+	if (!read_binary(is, size) || !binary_count_fits(is, size, sizeof(char))) {
+		return false;
+	}
+
+	str.resize(size);
+
+	return read_binary(is, &str[0], size);
+}
@@ -0,0 +1,61 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+
+/**
+ * A flag shared between whoever requested some work and the threads doing it,
+ * telling the latter that their result is not needed anymore, e.g. because a
+ * newer request superseded it. The threads are expected to check the token
+ * regularly and to return early once it is cancelled.
+ */
+class CancellationToken {
+	std::atomic<bool> m_cancelled{false};
+
+public:
+	CancellationToken() = default;
+
+	/* Disallow copy. */
+	CancellationToken(const CancellationToken &other) = delete;
+	CancellationToken &operator=(const CancellationToken &other) = delete;
+
+	/**
+	 * @brief cancel Mark the work associated with this token as cancelled.
+	 */
+	void cancel()
+	{
+		m_cancelled.store(true, std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief cancelled Return whether the work associated with this token was
+	 *                  cancelled.
+	 */
+	bool cancelled() const
+	{
+		return m_cancelled.load(std::memory_order_relaxed);
+	}
+};
@@ -0,0 +1,304 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/* Return a new identifier for the values of a cow_vector, see buffer_id(). */
+inline size_t new_cow_buffer_id()
+{
+	static std::atomic<size_t> counter(0);
+	return ++counter;
+}
+
+/**
+ * A std::vector whose buffer is shared between copies, and only duplicated
+ * when one of the copies is about to modify it (copy-on-write). This makes
+ * copying primitives cheap when the copies are only read from, as is the case
+ * for most of the collections flowing through the nodes of a graph.
+ *
+ * The vector can also refer to values stored elsewhere, e.g. in the pages of a
+ * mapped file, which are then read in place and only copied to a buffer of the
+ * vector once it is modified, see reference().
+ *
+ * Note that the non-const accessors are considered to be write accessors, so
+ * code only reading the data should go through a const object. They detach
+ * the vector when it is not writable yet, which is tracked by a flag so that
+ * accessing the values one by one stays cheap. Detaching is not thread safe
+ * though, so writers must detach the vector, through detach() or data(),
+ * before entering a parallel region, and then only write through the raw
+ * pointer or the iterators from the region.
+ */
+template <typename T>
+class cow_vector {
+	std::shared_ptr<std::vector<T>> m_data;
+
+	/* Values referred to by reference(), nullptr if the values are those of
+	 * the buffer. */
+	std::shared_ptr<const T> m_extern{};
+	size_t m_extern_size = 0;
+
+	/* See buffer_id(), the identifier is only assigned when requested after a
+	 * write access, to keep write accesses cheap. */
+	mutable std::atomic<size_t> m_buffer_id{0};
+
+	/* Whether the values can be written to as they are: the buffer is not
+	 * shared, the values are not referenced, and no identifier was handed out
+	 * for them. Cleared by copies and buffer_id(), set by detach(). */
+	mutable std::atomic<bool> m_writable{true};
+
+	void tag_modified()
+	{
+		m_buffer_id.store(0, std::memory_order_relaxed);
+	}
+
+	void make_writable()
+	{
+		if (!m_writable.load(std::memory_order_relaxed)) {
+			detach();
+		}
+	}
+
+public:
+	using value_type = T;
+	using size_type = typename std::vector<T>::size_type;
+	using iterator = typename std::vector<T>::iterator;
+	using const_iterator = const T *;
+
+	cow_vector()
+	    : m_data(std::make_shared<std::vector<T>>())
+	{}
+
+	explicit cow_vector(size_type n)
+	    : m_data(std::make_shared<std::vector<T>>(n))
+	{}
+
+	/* The identifier is resolved before copying, so that the copies share it
+	 * with their source. */
+	cow_vector(const cow_vector &other)
+	    : m_data(other.m_data)
+	    , m_extern(other.m_extern)
+	    , m_extern_size(other.m_extern_size)
+	    , m_buffer_id(other.buffer_id())
+	    , m_writable(false)
+	{}
+
+	cow_vector &operator=(const cow_vector &other)
+	{
+		m_buffer_id = other.buffer_id();
+		m_writable = false;
+		m_data = other.m_data;
+		m_extern = other.m_extern;
+		m_extern_size = other.m_extern_size;
+
+		return *this;
+	}
+
+	/**
+	 * @brief shared Return whether the buffer is shared with other copies.
+	 *               Values referred to by reference() are always shared.
+	 */
+	bool shared() const
+	{
+		return m_extern != nullptr || m_data.use_count() > 1;
+	}
+
+	/**
+	 * @brief buffer_id Return a number identifying the current values of this
+	 *                  vector. Identifiers are unique process-wide, a vector
+	 *                  and its unmodified copies have the same identifier, and
+	 *                  granting write access to the values (detach(), data(),
+	 *                  or any method changing the size) gives the vector a new
+	 *                  one. This can be used to find out whether some data is
+	 *                  still the same later on, without keeping the values
+	 *                  alive. This should not be called while the vector is
+	 *                  being modified.
+	 */
+	size_t buffer_id() const
+	{
+		/* The values have to be duplicated before they are modified again,
+		 * so that the identifier keeps referring to them. */
+		m_writable.store(false, std::memory_order_relaxed);
+
+		auto id = m_buffer_id.load(std::memory_order_relaxed);
+
+		if (id != 0) {
+			return id;
+		}
+
+		/* Copies of the same vector may be made concurrently. */
+		const auto new_id = new_cow_buffer_id();
+
+		if (m_buffer_id.compare_exchange_strong(id, new_id)) {
+			return new_id;
+		}
+
+		return id;
+	}
+
+	/**
+	 * @brief reference Make this vector refer to the n values pointed to by
+	 *                  data, without copying them. The values must remain
+	 *                  unchanged for as long as data is owned, which can be
+	 *                  an aliasing pointer keeping e.g. a mapped file alive.
+	 */
+	void reference(std::shared_ptr<const T> data, size_type n)
+	{
+		tag_modified();
+		m_writable = false;
+		m_data = std::make_shared<std::vector<T>>();
+		m_extern = std::move(data);
+		m_extern_size = n;
+	}
+
+	/**
+	 * @brief detach Make sure this vector is the only owner of its buffer,
+	 *               duplicating it if needed.
+	 */
+	void detach()
+	{
+		tag_modified();
+
+		if (m_extern != nullptr) {
+			m_data = std::make_shared<std::vector<T>>(m_extern.get(), m_extern.get() + m_extern_size);
+			m_extern.reset();
+			m_extern_size = 0;
+		}
+		else if (shared()) {
+			m_data = std::make_shared<std::vector<T>>(*m_data);
+		}
+
+		m_writable = true;
+	}
+
+	size_type size() const
+	{
+		if (m_extern != nullptr) {
+			return m_extern_size;
+		}
+
+		return m_data->size();
+	}
+
+	bool empty() const
+	{
+		return size() == 0;
+	}
+
+	void reserve(size_type n)
+	{
+		detach();
+		m_data->reserve(n);
+	}
+
+	void resize(size_type n)
+	{
+		if (n == size()) {
+			return;
+		}
+
+		detach();
+		m_data->resize(n);
+	}
+
+	void clear()
+	{
+		tag_modified();
+
+		/* No need to copy data which is about to be discarded. */
+		if (shared()) {
+			m_data = std::make_shared<std::vector<T>>();
+			m_extern.reset();
+			m_extern_size = 0;
+		}
+		else {
+			m_data->clear();
+		}
+
+		m_writable = true;
+	}
+
+	void push_back(const T &value)
+	{
+		detach();
+		m_data->push_back(value);
+	}
+
+	void push_back(T &&value)
+	{
+		detach();
+		m_data->push_back(std::move(value));
+	}
+
+	T *data()
+	{
+		make_writable();
+		return m_data->data();
+	}
+
+	const T *data() const
+	{
+		if (m_extern != nullptr) {
+			return m_extern.get();
+		}
+
+		return m_data->data();
+	}
+
+	T &operator[](size_type i)
+	{
+		make_writable();
+		return (*m_data)[i];
+	}
+
+	const T &operator[](size_type i) const
+	{
+		return data()[i];
+	}
+
+	iterator begin()
+	{
+		make_writable();
+		return m_data->begin();
+	}
+
+	iterator end()
+	{
+		make_writable();
+		return m_data->end();
+	}
+
+	const_iterator begin() const
+	{
+		return data();
+	}
+
+	const_iterator end() const
+	{
+		return data() + size();
+	}
+};
@@ -25,6 +25,7 @@
 #pragma once
 
 #include <tbb/parallel_for.h>
+#include <type_traits>
 
 /**
  * Wrappers around Intel's TBB utilities.
@@ -58,7 +59,10 @@ void parallel_for(RangeType &&range, OpType &&op, int grain_size = 1)
 		return;
 	}
 
-	tbb::parallel_for(RangeType(range.begin(), range.end(), grain_size), op);
+	/* RangeType is a reference type when called with an lvalue. */
+	using range_type = typename std::decay<RangeType>::type;
+
+	tbb::parallel_for(range_type(range.begin(), range.end(), grain_size), op);
 }
 
 template <typename RangeType, typename OpType>
@@ -0,0 +1,190 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include "util_trace.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+static constexpr auto TRACE_BUFFER_SIZE = 1ul << 15;
+
+namespace {
+
+struct TraceEvent {
+	const char *name;
+	int64_t time;
+	char phase;
+};
+
+struct TraceBuffer {
+	std::array<TraceEvent, TRACE_BUFFER_SIZE> events;
+
+	/* Number of events recorded so far, only written by the owning thread. */
+	std::atomic<size_t> head{0};
+
+	/* Number of events recorded before the last call to trace_clear(). */
+	std::atomic<size_t> cleared{0};
+
+	int thread_id = 0;
+};
+
+}  /* namespace */
+
+static std::mutex buffers_mutex;
+static std::vector<std::unique_ptr<TraceBuffer>> buffers;
+
+static std::mutex names_mutex;
+static std::unordered_set<std::string> names;
+
+static const auto trace_epoch = std::chrono::steady_clock::now();
+
+/* The buffer of the calling thread, registered on first use, so that only
+ * the first event of a thread takes a lock. */
+static TraceBuffer *thread_buffer()
+{
+	thread_local TraceBuffer *buffer = nullptr;
+
+	if (buffer == nullptr) {
+		std::unique_lock<std::mutex> lock(buffers_mutex);
+
+		buffers.emplace_back(new TraceBuffer);
+		buffer = buffers.back().get();
+		buffer->thread_id = buffers.size();
+	}
+
+	return buffer;
+}
+
+static void record_event(const char *name, char phase)
+{
+	const auto now = std::chrono::steady_clock::now() - trace_epoch;
+
+	auto buffer = thread_buffer();
+	const auto index = buffer->head.load(std::memory_order_relaxed);
+
+	auto &event = buffer->events[index % TRACE_BUFFER_SIZE];
+	event.name = name;
+	event.time = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+	event.phase = phase;
+
+	buffer->head.store(index + 1, std::memory_order_release);
+}
+
+const char *trace_intern(const std::string &name)
+{
+	thread_local std::unordered_map<std::string, const char *> cache;
+
+	auto iter = cache.find(name);
+
+	if (iter != cache.end()) {
+		return iter->second;
+	}
+
+	const char *interned;
+
+	{
+		std::unique_lock<std::mutex> lock(names_mutex);
+		interned = names.insert(name).first->c_str();
+	}
+
+	cache[name] = interned;
+
+	return interned;
+}
+
+void trace_begin(const char *name)
+{
+	record_event(name, 'B');
+}
+
+void trace_end(const char *name)
+{
+	record_event(name, 'E');
+}
+
+static void write_json_string(std::ostream &os, const char *str)
+{
+	os << '"';
+
+	for (; *str != '\0'; ++str) {
+		if (*str == '"' || *str == '\\') {
+			os << '\\';
+		}
+
+		os << *str;
+	}
+
+	os << '"';
+}
+
+size_t write_chrome_trace(std::ostream &os)
+{
+	std::unique_lock<std::mutex> lock(buffers_mutex);
+
+	os << "{\"traceEvents\":[\n";
+
+	auto num_events = 0ul;
+
+	for (const auto &buffer : buffers) {
+		const auto head = buffer->head.load(std::memory_order_acquire);
+		const auto cleared = buffer->cleared.load(std::memory_order_relaxed);
+		const auto begin = std::max(cleared, (head > TRACE_BUFFER_SIZE) ? head - TRACE_BUFFER_SIZE : 0ul);
+
+		for (auto i = begin; i < head; ++i) {
+			const auto &event = buffer->events[i % TRACE_BUFFER_SIZE];
+
+			os << ((num_events++ == 0) ? "" : ",\n");
+
+			os << "{\"name\":";
+			write_json_string(os, event.name);
+			os << ",\"ph\":\"" << event.phase << '"'
+			   << ",\"ts\":" << (event.time / 1000) << '.' << (event.time % 1000 / 100)
+			   << ",\"pid\":1"
+			   << ",\"tid\":" << buffer->thread_id
+			   << '}';
+		}
+	}
+
+	os << "\n]}\n";
+
+	return num_events;
+}
+
+void trace_clear()
+{
+	std::unique_lock<std::mutex> lock(buffers_mutex);
+
+	for (const auto &buffer : buffers) {
+		buffer->cleared.store(buffer->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+	}
+}
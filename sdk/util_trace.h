@@ -0,0 +1,104 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <iosfwd>
+#include <string>
+
+/**
+ * Tracing of the work done by the different threads, to be viewed in a trace
+ * viewer (chrome://tracing, Perfetto).
+ *
+ * Each thread records the begin and end events of its spans in its own ring
+ * buffer, so recording does not require any synchronization; once a buffer is
+ * full its oldest events are overwritten. Spans are only recorded if the code
+ * is compiled with WITH_TRACING defined, otherwise TRACE_SPAN expands to
+ * nothing.
+ */
+
+/**
+ * @brief trace_intern Return a copy of the given string which remains valid
+ *                     for the lifetime of the program, to name spans after
+ *                     strings created at runtime, e.g. node names.
+ */
+const char *trace_intern(const std::string &name);
+
+/**
+ * @brief trace_begin Record the beginning of a span on the calling thread.
+ * @param name The name of the span, which must outlive the recorded events.
+ */
+void trace_begin(const char *name);
+
+/**
+ * @brief trace_end Record the end of the last span begun on the calling thread.
+ */
+void trace_end(const char *name);
+
+/**
+ * @brief write_chrome_trace Write the events recorded by all the threads in
+ *                           the Chrome trace event format. Events recorded
+ *                           while writing may be missing or garbled, so this
+ *                           is best called once the work is done.
+ * @return The number of events written, which is zero if the code is not
+ *         compiled with WITH_TRACING defined.
+ */
+size_t write_chrome_trace(std::ostream &os);
+
+/**
+ * @brief trace_clear Discard the events recorded so far.
+ */
+void trace_clear();
+
+/**
+ * Record a span for the lifetime of the object.
+ */
+class TraceSpan {
+	const char *m_name;
+
+public:
+	explicit TraceSpan(const char *name)
+	    : m_name(name)
+	{
+		trace_begin(m_name);
+	}
+
+	~TraceSpan()
+	{
+		trace_end(m_name);
+	}
+
+	/* Disallow copy. */
+	TraceSpan(const TraceSpan &other) = delete;
+	TraceSpan &operator=(const TraceSpan &other) = delete;
+};
+
+#define TRACE_CONCAT_EX(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_EX(a, b)
+
+#ifdef WITH_TRACING
+#	define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(name)
+#else
+#	define TRACE_SPAN(name)
+#endif
@@ -21,10 +21,10 @@
  * ***** END GPL LICENSE BLOCK *****
  */
 
+#include <kamikaze/util_trace.h>
 #include <openvdb/tools/Morphology.h>
 
 #include "forces.h"
-#include "util/utils.h"
 
 Vec3s accumulate_forces(const std::vector<Vec3s> &forces)
 {
@@ -43,7 +43,7 @@ void add_buoyancy(const float dt,
                   ScalarGrid::Ptr &temperature,
                   const openvdb::Int32Grid::Ptr &flags)
 {
-	Timer(__func__);
+	TRACE_SPAN(__func__);
 
 	using namespace openvdb;
 	using namespace openvdb::math;
@@ -83,7 +83,7 @@ void add_buoyancy(const float dt,
 
 void set_neumann_boundary(VectorGrid &velocity, const openvdb::Int32Grid::Ptr &flags)
 {
-	Timer(__func__);
+	TRACE_SPAN(__func__);
 
 	using namespace openvdb;
 	using namespace openvdb::math;
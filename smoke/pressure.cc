@@ -21,13 +21,13 @@
  * ***** END GPL LICENSE BLOCK *****
  */
 
+#include <kamikaze/util_trace.h>
 #include <openvdb/math/FiniteDifference.h>
 #include <openvdb/math/Stencils.h>
 #include <openvdb/tools/GridOperators.h>
 #include <openvdb/tools/PoissonSolver.h>
 
 #include "forces.h"
-#include "util/utils.h"
 
 void correct_velocity(const float dt,
                       VectorGrid &velocity,
@@ -94,7 +94,7 @@ void solve_pressure(const float dt,
                     ScalarGrid &pressure,
                     const openvdb::Int32Grid &flags)
 {
-	Timer(__func__);
+	TRACE_SPAN(__func__);
 
 	using namespace openvdb;
 	using namespace openvdb::math;
@@ -197,7 +197,7 @@ void solve_pressure(const SimulationGlobals &sg,
                     ScalarGrid &pressure,
                     const openvdb::Int32Grid &flags)
 {
-	Timer(__func__);
+	TRACE_SPAN(__func__);
 
 	using namespace openvdb;
 	using namespace openvdb::math;
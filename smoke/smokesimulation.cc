@@ -24,6 +24,7 @@
 
 #include "smokesimulation.h"
 
+#include <kamikaze/util_trace.h>
 #include <openvdb/tools/VolumeAdvect.h>
 
 #include "advection.h"
@@ -31,7 +32,6 @@
 #include "types.h"
 #include "util_smoke.h"
 
-#include "util/utils.h"
 
 SmokeSimulation::SmokeSimulation()
     : m_dt(0.1f)
@@ -118,7 +118,7 @@ void SmokeSimulation::step()
 
 void SmokeSimulation::advectSemiLagrange()
 {
-	Timer(__func__);
+	TRACE_SPAN(__func__);
 
 	typedef openvdb::tools::Sampler<1, false> Sampler;
 
@@ -147,7 +147,7 @@ void SmokeSimulation::advectSemiLagrange()
 
 void SmokeSimulation::addInflow(const openvdb::FloatGrid::Ptr &inflow)
 {
-	Timer(__func__);
+	TRACE_SPAN(__func__);
 
 	using namespace openvdb;
 	using namespace openvdb::math;
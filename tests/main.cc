@@ -0,0 +1,82 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include <kamikaze/mesh.h>
+#include <kamikaze/nodes.h>
+#include <kamikaze/prim_points.h>
+#include <kamikaze/primitive.h>
+#include <kamikaze/segmentprim.h>
+
+#include <cstdlib>
+#include <experimental/filesystem>
+#include <iostream>
+
+#include "core/graphs/object_nodes.h"
+
+#include "tests.h"
+
+int test_failures = 0;
+
+std::string make_temp_directory(const std::string &prefix)
+{
+	namespace fs = std::experimental::filesystem;
+
+	auto path = (fs::temp_directory_path() / (prefix + "_XXXXXX")).string();
+
+	if (mkdtemp(&path[0]) == nullptr) {
+		return {};
+	}
+
+	return path;
+}
+
+int main()
+{
+	/* Register the types like Main::initialize() does, without the plugins so
+	 * the results only depend on the code of this tree. */
+	PrimitiveFactory primitive_factory;
+	NodeFactory node_factory;
+
+	{
+		auto factory = &primitive_factory;
+
+		Mesh::id = REGISTER_PRIMITIVE("Mesh", Mesh);
+		PrimPoints::id = REGISTER_PRIMITIVE("PrimPoints", PrimPoints);
+		SegmentPrim::id = REGISTER_PRIMITIVE("SegmentPrim", SegmentPrim);
+	}
+
+	register_builtin_nodes(&node_factory);
+
+	test_archive(&primitive_factory);
+	test_depsgraph(&primitive_factory, &node_factory);
+	test_import(&primitive_factory);
+	test_mesh();
+
+	if (test_failures != 0) {
+		std::cerr << test_failures << " check(s) failed\n";
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,272 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include <kamikaze/mesh.h>
+
+#include <cmath>
+#include <cstring>
+#include <experimental/filesystem>
+#include <fstream>
+#include <iterator>
+
+#include "core/geometry_archive.h"
+
+#include "tests.h"
+
+namespace fs = std::experimental::filesystem;
+
+static constexpr unsigned int GRID_SIZE = 32;
+
+/* More than the interval between the key frames of ARCHIVE_DELTA_POINTS. */
+static constexpr int NUM_FRAMES = 40;
+
+/* A grid of quads whose points move a little from one frame to the next, the
+ * topology being the same for all the frames. */
+static void build_frame(PrimitiveCollection &collection, int frame)
+{
+	auto mesh = static_cast<Mesh *>(collection.build("Mesh"));
+	auto points = mesh->points();
+	auto polys = mesh->polys();
+
+	for (auto z = 0u; z <= GRID_SIZE; ++z) {
+		for (auto x = 0u; x <= GRID_SIZE; ++x) {
+			const auto y = 0.25f * std::sin(0.3f * static_cast<float>(x + z) + 0.01f * static_cast<float>(frame));
+			points->push_back(glm::vec3(static_cast<float>(x) * 0.1f, y, static_cast<float>(z) * 0.1f));
+		}
+	}
+
+	for (auto z = 0u; z < GRID_SIZE; ++z) {
+		for (auto x = 0u; x < GRID_SIZE; ++x) {
+			const auto i = z * (GRID_SIZE + 1) + x;
+			polys->push_back(glm::uvec4(i, i + 1, i + GRID_SIZE + 2, i + GRID_SIZE + 1));
+		}
+	}
+}
+
+/* Whether the collections hold a single mesh with the same points, bit for
+ * bit, and polygons. */
+static bool same_mesh(const PrimitiveCollection &a, const PrimitiveCollection &b)
+{
+	if (a.primitives().size() != 1 || b.primitives().size() != 1
+	    || a.primitives()[0]->typeID() != Mesh::id || b.primitives()[0]->typeID() != Mesh::id)
+	{
+		return false;
+	}
+
+	const auto mesh_a = static_cast<const Mesh *>(a.primitives()[0]);
+	const auto mesh_b = static_cast<const Mesh *>(b.primitives()[0]);
+	const auto &points_a = *mesh_a->points();
+	const auto &points_b = *mesh_b->points();
+	const auto &polys_a = *mesh_a->polys();
+	const auto &polys_b = *mesh_b->polys();
+
+	if (points_a.size() != points_b.size() || polys_a.size() != polys_b.size()) {
+		return false;
+	}
+
+	if (points_a.size() != 0 && std::memcmp(&points_a[0], &points_b[0], points_a.byte_size()) != 0) {
+		return false;
+	}
+
+	for (auto i = 0ul; i < polys_a.size(); ++i) {
+		if (polys_a[i] != polys_b[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool write_archive(PrimitiveFactory *factory, const std::string &path, int flags, GeometryArchiveWriter &writer)
+{
+	std::string error;
+
+	if (!writer.open(path, flags, error)) {
+		return false;
+	}
+
+	for (auto frame = 0; frame < NUM_FRAMES; ++frame) {
+		PrimitiveCollection collection(factory);
+		build_frame(collection, frame);
+
+		if (!writer.add_frame(frame, collection, error)) {
+			return false;
+		}
+	}
+
+	return writer.close(error);
+}
+
+static std::string read_file(const std::string &path)
+{
+	std::ifstream is(path, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+static void write_file(const std::string &path, const std::string &contents)
+{
+	std::ofstream os(path, std::ios::binary);
+	os.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+}
+
+/* The polygons and the (empty) normals of the meshes, which are the same for
+ * every frame, are only written once. */
+static void test_buffer_deduplication(PrimitiveFactory *factory, const std::string &directory)
+{
+	GeometryArchiveWriter writer;
+	CHECK(write_archive(factory, directory + "/raw.kmka", 0, writer));
+
+	CHECK(writer.buffers_written() == NUM_FRAMES + 2);
+	CHECK(writer.buffers_reused() == 2 * (NUM_FRAMES - 1));
+}
+
+/* The points stored as the difference with a key frame are decoded exactly, and
+ * take less room than the points themselves, as stored in the archive written
+ * by test_buffer_deduplication(). */
+static void test_delta_points(PrimitiveFactory *factory, const std::string &directory)
+{
+	const auto raw_path = directory + "/raw.kmka";
+	const auto delta_path = directory + "/delta.kmka";
+
+	GeometryArchiveWriter writer;
+	CHECK(write_archive(factory, delta_path, ARCHIVE_DELTA_POINTS, writer));
+	CHECK(fs::file_size(delta_path) < fs::file_size(raw_path));
+
+	GeometryArchiveReader reader;
+	std::string error;
+	CHECK(reader.open(delta_path, error));
+
+	auto lossless = true;
+
+	for (auto frame = 0; frame < NUM_FRAMES; ++frame) {
+		PrimitiveCollection expected(factory);
+		build_frame(expected, frame);
+
+		PrimitiveCollection collection(factory);
+		lossless = lossless && reader.read_frame(frame, collection, error) && same_mesh(collection, expected);
+	}
+
+	CHECK(lossless);
+}
+
+/* Frames can be read in any order, whichever key frame they depend on. */
+static void test_random_access(PrimitiveFactory *factory, const std::string &directory)
+{
+	GeometryArchiveReader reader;
+	std::string error;
+	CHECK(reader.open(directory + "/delta.kmka", error));
+
+	const auto frames = reader.frames();
+	CHECK(frames.size() == NUM_FRAMES && frames.front() == 0 && frames.back() == NUM_FRAMES - 1);
+
+	for (const auto frame : { NUM_FRAMES - 1, 0, 17, 16, 3, 33, 17 }) {
+		PrimitiveCollection expected(factory);
+		build_frame(expected, frame);
+
+		PrimitiveCollection collection(factory);
+		CHECK(reader.has_frame(frame));
+		CHECK(reader.read_frame(frame, collection, error) && same_mesh(collection, expected));
+	}
+
+	PrimitiveCollection collection(factory);
+	CHECK(!reader.has_frame(NUM_FRAMES));
+	CHECK(!reader.read_frame(NUM_FRAMES, collection, error));
+	CHECK(collection.primitives().empty());
+}
+
+/* Archives whose index is truncated or holds invalid counts or offsets are not
+ * opened. */
+static void test_corrupted_index(const std::string &directory)
+{
+	const auto archive = read_file(directory + "/delta.kmka");
+	const auto footer_size = sizeof(uint64_t) + 8;
+
+	CHECK(archive.size() > footer_size);
+
+	if (archive.size() <= footer_size) {
+		return;
+	}
+
+	uint64_t index_offset;
+	std::memcpy(&index_offset, &archive[archive.size() - footer_size], sizeof(index_offset));
+
+	const auto patched = [&](size_t offset, uint64_t value)
+	{
+		auto contents = archive;
+		std::memcpy(&contents[offset], &value, sizeof(value));
+		return contents;
+	};
+
+	uint64_t num_buffers;
+	std::memcpy(&num_buffers, &archive[index_offset], sizeof(num_buffers));
+
+	const auto frames_offset = index_offset + sizeof(uint64_t) + num_buffers * 2 * sizeof(uint64_t);
+
+	/* The index without the last frames, followed by the footer. */
+	const auto truncated = archive.substr(0, archive.size() - footer_size - 64)
+	                       + archive.substr(archive.size() - footer_size);
+
+	const std::pair<const char *, std::string> files[] = {
+	    { "truncated.kmka", truncated },
+	    { "cut.kmka", archive.substr(0, archive.size() / 2) },
+	    { "index_offset.kmka", patched(archive.size() - footer_size, archive.size()) },
+	    { "num_buffers.kmka", patched(index_offset, 1ull << 40) },
+	    { "buffer_offset.kmka", patched(index_offset + sizeof(uint64_t), archive.size()) },
+	    { "num_frames.kmka", patched(frames_offset, 1ull << 40) },
+	};
+
+	for (const auto &file : files) {
+		const auto path = directory + "/" + file.first;
+		write_file(path, file.second);
+
+		GeometryArchiveReader reader;
+		std::string error;
+
+		const auto ok = reader.open(path, error);
+
+		if (ok) {
+			std::cerr << "Corrupted archive '" << file.first << "' was opened\n";
+		}
+
+		CHECK(!ok && !error.empty());
+	}
+}
+
+void test_archive(PrimitiveFactory *primitive_factory)
+{
+	const auto directory = make_temp_directory("kamikaze_test_archive");
+	CHECK(!directory.empty());
+
+	if (directory.empty()) {
+		return;
+	}
+
+	test_buffer_deduplication(primitive_factory, directory);
+	test_delta_points(primitive_factory, directory);
+	test_random_access(primitive_factory, directory);
+	test_corrupted_index(directory);
+
+	std::error_code ec;
+	fs::remove_all(directory, ec);
+}
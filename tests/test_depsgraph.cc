@@ -0,0 +1,201 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include <kamikaze/context.h>
+#include <kamikaze/mesh.h>
+#include <kamikaze/nodes.h>
+#include <kamikaze/util_cancel.h>
+
+#include <experimental/filesystem>
+
+#include "core/graphs/depsgraph.h"
+#include "core/graphs/frame_cache.h"
+#include "core/graphs/object_graph.h"
+#include "core/graphs/object_nodes.h"
+#include "core/object.h"
+#include "core/scene.h"
+
+#include "tests.h"
+
+template <typename T>
+static void set_prop(Persona *persona, const std::string &name, const T &value)
+{
+	for (auto &prop : persona->props()) {
+		if (prop.desc->name == name) {
+			prop.data = value;
+			return;
+		}
+	}
+}
+
+/* Create an object whose grid is displaced by a noise changing over time. */
+static Object *make_animated_object(NodeFactory *node_factory)
+{
+	auto object = new Object;
+	object->name("animated");
+
+	auto graph = object->graph();
+
+	auto grid = (*node_factory)("Grid");
+	object->addNode(grid);
+
+	auto noise = (*node_factory)("Noise");
+	object->addNode(noise);
+	set_prop(noise, "time_scale", 0.5f);
+
+	graph->connect(grid->output(0), noise->input(0));
+	graph->connect(noise->output(0), graph->output()->input(0));
+
+	return object;
+}
+
+/* A scene holding an object animated by make_animated_object(), along with the
+ * contexts to evaluate it. */
+struct AnimatedScene {
+	Scene scene{};
+	EvaluationContext eval_context{};
+	Context context{};
+	Object *object = nullptr;
+
+	AnimatedScene(PrimitiveFactory *primitive_factory, NodeFactory *node_factory, bool animation)
+	{
+		eval_context.edit_mode = false;
+		eval_context.animation = animation;
+		eval_context.time_direction = TIME_DIR_FORWARD;
+		eval_context.frame = 0;
+		eval_context.threaded_evaluation = true;
+
+		context.eval_ctx = &eval_context;
+		context.scene = &scene;
+		context.node_factory = node_factory;
+		context.primitive_factory = primitive_factory;
+		context.notifier_factory = nullptr;
+		context.active_widget = nullptr;
+
+		object = make_animated_object(node_factory);
+		scene.addObject(object);
+	}
+
+	/* Disallow copy, the context refers to the members. */
+	AnimatedScene(const AnimatedScene &other) = delete;
+	AnimatedScene &operator=(const AnimatedScene &other) = delete;
+};
+
+static glm::vec3 first_point(const PrimitiveCollectionPtr &collection)
+{
+	const auto mesh = static_cast<const Mesh *>(collection->primitives()[0]);
+	return (*mesh->points())[0];
+}
+
+/* The graphs whose nodes depend on time are connected to the time node, and
+ * their results are cached per frame, so that going back to a frame does not
+ * process the graph again. */
+static void test_frame_cache_reuse(PrimitiveFactory *primitive_factory, NodeFactory *node_factory)
+{
+	AnimatedScene test(primitive_factory, node_factory, false);
+	const auto &context = test.context;
+	const auto object = test.object;
+
+	const auto depsgraph = test.scene.depsgraph();
+	const auto frame_cache = depsgraph->frame_cache();
+
+	depsgraph->evaluate_frame(context, 10);
+	const auto frame_10 = object->graph()->result();
+
+	depsgraph->evaluate_frame(context, 11);
+	const auto frame_11 = object->graph()->result();
+
+	depsgraph->evaluate_frame(context, 10);
+	const auto frame_10_again = object->graph()->result();
+
+	CHECK(frame_10 != nullptr);
+	CHECK(frame_11 != nullptr);
+	CHECK(frame_10 != frame_11);
+	CHECK(frame_10_again == frame_10);
+
+	CHECK(frame_cache->misses() == 2);
+	CHECK(frame_cache->hits() == 1);
+	CHECK(depsgraph->frame_cached(10));
+	CHECK(depsgraph->frame_cached(11));
+
+	if (frame_10 != nullptr && frame_11 != nullptr) {
+		CHECK(first_point(frame_10) != first_point(frame_11));
+	}
+}
+
+/* The frames evaluated ahead for the playback are published without
+ * evaluating the graphs, and the frames written to disk are only read back by
+ * the prefetching. */
+static void test_frame_prefetch(PrimitiveFactory *primitive_factory, NodeFactory *node_factory,
+                                const std::string &spill_directory)
+{
+	AnimatedScene test(primitive_factory, node_factory, true);
+	const auto &context = test.context;
+
+	const auto depsgraph = test.scene.depsgraph();
+	const auto frame_cache = depsgraph->frame_cache();
+
+	depsgraph->evaluate_frame(context, 0);
+
+	CancellationToken token;
+
+	depsgraph->prefetch_frame(context, 1, &token);
+
+	CHECK(depsgraph->frame_cached(1));
+	CHECK(depsgraph->publish_cached_frame(context, 1));
+	CHECK(test.object->collection() != nullptr);
+
+	/* Without memory budget, the prefetched frames are written to disk as soon
+	 * as they are not in use. */
+	frame_cache->spill_directory(spill_directory);
+	frame_cache->budget(0);
+
+	depsgraph->prefetch_frame(context, 2, &token);
+	depsgraph->prefetch_frame(context, 3, &token);
+
+	CHECK(!depsgraph->frame_cached(2));
+	CHECK(!depsgraph->publish_cached_frame(context, 2));
+
+	depsgraph->prefetch_frame(context, 2, &token);
+
+	CHECK(depsgraph->frame_cached(2));
+	CHECK(depsgraph->publish_cached_frame(context, 2));
+}
+
+void test_depsgraph(PrimitiveFactory *primitive_factory, NodeFactory *node_factory)
+{
+	test_frame_cache_reuse(primitive_factory, node_factory);
+
+	/* The frames spilled to disk are removed along with the directory, once
+	 * the scene holding the frame cache is destroyed. */
+	const auto spill_directory = make_temp_directory("kamikaze_test_depsgraph");
+	CHECK(!spill_directory.empty());
+
+	if (!spill_directory.empty()) {
+		test_frame_prefetch(primitive_factory, node_factory, spill_directory);
+
+		std::error_code ec;
+		std::experimental::filesystem::remove_all(spill_directory, ec);
+	}
+}
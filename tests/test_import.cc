@@ -0,0 +1,284 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include <kamikaze/mesh.h>
+
+#include <cstdio>
+#include <experimental/filesystem>
+#include <fstream>
+
+#include "core/geometry_export.h"
+#include "core/geometry_import.h"
+
+#include "tests.h"
+
+namespace fs = std::experimental::filesystem;
+
+/* Large enough for the faces to span several chunks of the importer, whether
+ * they are parsed from text or binary records. */
+static constexpr unsigned int GRID_SIZE = 300;
+
+static void write_file(const std::string &path, const std::string &contents)
+{
+	std::ofstream os(path, std::ios::binary);
+	os.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+}
+
+/* A grid of quads whose points have integer coordinates, which are written and
+ * parsed back exactly. */
+static void build_grid(PrimitiveCollection &collection)
+{
+	auto mesh = static_cast<Mesh *>(collection.build("Mesh"));
+	auto points = mesh->points();
+	auto polys = mesh->polys();
+
+	for (auto z = 0u; z <= GRID_SIZE; ++z) {
+		for (auto x = 0u; x <= GRID_SIZE; ++x) {
+			points->push_back(glm::vec3(static_cast<float>(x), 0.0f, static_cast<float>(z)));
+		}
+	}
+
+	for (auto z = 0u; z < GRID_SIZE; ++z) {
+		for (auto x = 0u; x < GRID_SIZE; ++x) {
+			const auto i = z * (GRID_SIZE + 1) + x;
+			polys->push_back(glm::uvec4(i, i + 1, i + GRID_SIZE + 2, i + GRID_SIZE + 1));
+		}
+	}
+}
+
+static const Mesh *single_mesh(const PrimitiveCollection &collection)
+{
+	const auto &prims = collection.primitives();
+
+	if (prims.size() != 1 || prims[0]->typeID() != Mesh::id) {
+		return nullptr;
+	}
+
+	return static_cast<const Mesh *>(prims[0]);
+}
+
+static bool same_geometry(const Mesh &a, const Mesh &b)
+{
+	const auto &points_a = *a.points();
+	const auto &points_b = *b.points();
+	const auto &polys_a = *a.polys();
+	const auto &polys_b = *b.polys();
+
+	if (points_a.size() != points_b.size() || polys_a.size() != polys_b.size()) {
+		return false;
+	}
+
+	for (auto i = 0ul; i < points_a.size(); ++i) {
+		if (points_a[i] != points_b[i]) {
+			return false;
+		}
+	}
+
+	for (auto i = 0ul; i < polys_a.size(); ++i) {
+		if (polys_a[i] != polys_b[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* A mesh exported to a binary PLY or an OBJ file is imported unchanged. */
+static void test_export_round_trip(PrimitiveFactory *factory, const std::string &directory, const std::string &extension)
+{
+	const auto path = directory + "/grid" + extension;
+
+	PrimitiveCollection exported(factory);
+	build_grid(exported);
+
+	std::string error;
+	CHECK(export_geometry(exported, path, error));
+
+	PrimitiveCollection imported(factory);
+	CHECK(import_geometry(path, imported, error));
+
+	const auto mesh = single_mesh(imported);
+	CHECK(mesh != nullptr);
+	CHECK(mesh != nullptr && same_geometry(*mesh, *single_mesh(exported)));
+}
+
+/* The ASCII PLY format is only read, the file is written by hand. */
+static void test_ascii_ply(PrimitiveFactory *factory, const std::string &directory)
+{
+	const auto path = directory + "/grid_ascii.ply";
+
+	PrimitiveCollection expected(factory);
+	build_grid(expected);
+
+	const auto &points = *single_mesh(expected)->points();
+	const auto &polys = *single_mesh(expected)->polys();
+
+	std::string contents = "ply\nformat ascii 1.0\n";
+	contents += "element vertex " + std::to_string(points.size()) + "\n";
+	contents += "property float x\nproperty float y\nproperty float z\n";
+	contents += "element face " + std::to_string(polys.size()) + "\n";
+	contents += "property list uchar int vertex_indices\nend_header\n";
+
+	char line[128];
+
+	for (auto i = 0ul; i < points.size(); ++i) {
+		std::snprintf(line, sizeof(line), "%g %g %g\n", points[i].x, points[i].y, points[i].z);
+		contents += line;
+	}
+
+	for (auto i = 0ul; i < polys.size(); ++i) {
+		std::snprintf(line, sizeof(line), "4 %u %u %u %u\n", polys[i][0], polys[i][1], polys[i][2], polys[i][3]);
+		contents += line;
+	}
+
+	write_file(path, contents);
+
+	PrimitiveCollection imported(factory);
+	std::string error;
+	CHECK(import_geometry(path, imported, error));
+
+	const auto mesh = single_mesh(imported);
+	CHECK(mesh != nullptr && same_geometry(*mesh, *single_mesh(expected)));
+}
+
+/* Negative OBJ indices are relative to the last vertex defined, including in
+ * the chunks of the file which do not start with the first vertex. */
+static void test_obj_negative_indices(PrimitiveFactory *factory, const std::string &directory)
+{
+	const auto path = directory + "/relative.obj";
+	const auto num_faces = 40000u;
+
+	std::string contents;
+	char line[128];
+
+	for (auto i = 0u; i < num_faces; ++i) {
+		for (auto k = 0u; k < 4u; ++k) {
+			std::snprintf(line, sizeof(line), "v %u %u 0\n", i, k);
+			contents += line;
+		}
+
+		contents += "f -4 -3 -2 -1\n";
+	}
+
+	write_file(path, contents);
+
+	PrimitiveCollection imported(factory);
+	std::string error;
+	CHECK(import_geometry(path, imported, error));
+
+	const auto mesh = single_mesh(imported);
+	CHECK(mesh != nullptr);
+
+	if (mesh == nullptr) {
+		return;
+	}
+
+	const auto &points = *mesh->points();
+	const auto &polys = *mesh->polys();
+
+	CHECK(points.size() == 4 * num_faces);
+	CHECK(polys.size() == num_faces);
+
+	auto valid = (points.size() == 4 * num_faces && polys.size() == num_faces);
+
+	for (auto i = 0u; valid && i < num_faces; ++i) {
+		valid = (polys[i] == glm::uvec4(4 * i, 4 * i + 1, 4 * i + 2, 4 * i + 3))
+		        && points[4 * i + 3] == glm::vec3(static_cast<float>(i), 3.0f, 0.0f);
+	}
+
+	CHECK(valid);
+}
+
+/* Files with counts or indices which do not match their contents are rejected,
+ * and leave the collection untouched. */
+static void test_corrupted_files(PrimitiveFactory *factory, const std::string &directory)
+{
+	const std::string ply_header = "ply\nformat ascii 1.0\n";
+	const std::string ply_vertices = "property float x\nproperty float y\nproperty float z\n";
+	const std::string ply_faces = "element face 1\nproperty list uchar int vertex_indices\nend_header\n";
+	const std::string triangle = "0 0 0\n1 0 0\n0 1 0\n";
+
+	std::string binary_ply = "ply\nformat binary_little_endian 1.0\nelement vertex 3\n" + ply_vertices + ply_faces;
+
+	for (auto i = 0; i < 9; ++i) {
+		const auto value = static_cast<float>(i);
+		binary_ply.append(reinterpret_cast<const char *>(&value), sizeof(value));
+	}
+
+	/* A face of 200 vertices, of which only 3 are in the file. */
+	binary_ply.push_back(static_cast<char>(200));
+
+	for (auto i = 0; i < 3; ++i) {
+		binary_ply.append(reinterpret_cast<const char *>(&i), sizeof(i));
+	}
+
+	const std::pair<const char *, std::string> files[] = {
+	    { "huge_count.ply", ply_header + "element vertex 99999999999999\n" + ply_vertices + ply_faces + triangle + "3 0 1 2\n" },
+	    { "short_count.ply", ply_header + "element vertex 4\n" + ply_vertices + ply_faces + triangle + "3 0 1 2\n" },
+	    { "out_of_range.ply", ply_header + "element vertex 3\n" + ply_vertices + ply_faces + triangle + "3 0 1 7\n" },
+	    { "negative.ply", ply_header + "element vertex 3\n" + ply_vertices + ply_faces + triangle + "3 0 -1 2\n" },
+	    { "long_list.ply", binary_ply },
+	    { "zero.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 0 1 2\n" },
+	    { "out_of_range.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 4\n" },
+	    { "before_first.obj", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf -4 -1 -2\n" },
+	};
+
+	for (const auto &file : files) {
+		const auto path = directory + "/" + file.first;
+		write_file(path, file.second);
+
+		PrimitiveCollection imported(factory);
+		std::string error;
+
+		const auto ok = import_geometry(path, imported, error);
+
+		if (ok) {
+			std::cerr << "Corrupted file '" << file.first << "' was imported\n";
+		}
+
+		CHECK(!ok && !error.empty());
+		CHECK(imported.primitives().empty());
+	}
+}
+
+void test_import(PrimitiveFactory *primitive_factory)
+{
+	const auto directory = make_temp_directory("kamikaze_test_import");
+	CHECK(!directory.empty());
+
+	if (directory.empty()) {
+		return;
+	}
+
+	test_export_round_trip(primitive_factory, directory, ".ply");
+	test_export_round_trip(primitive_factory, directory, ".obj");
+	test_ascii_ply(primitive_factory, directory);
+	test_obj_negative_indices(primitive_factory, directory);
+	test_corrupted_files(primitive_factory, directory);
+
+	clear_geometry_import_cache();
+
+	std::error_code ec;
+	fs::remove_all(directory, ec);
+}
@@ -0,0 +1,138 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include <kamikaze/mesh.h>
+
+#include <memory>
+
+#include "tests.h"
+
+static Mesh *make_quad()
+{
+	auto mesh = new Mesh;
+
+	auto points = mesh->points();
+	points->push_back(glm::vec3{0.0f, 0.0f, 0.0f});
+	points->push_back(glm::vec3{1.0f, 0.0f, 0.0f});
+	points->push_back(glm::vec3{1.0f, 0.0f, 1.0f});
+	points->push_back(glm::vec3{0.0f, 0.0f, 1.0f});
+
+	mesh->polys()->push_back(glm::uvec4{0, 1, 2, 3});
+
+	return mesh;
+}
+
+/* A copy of a mesh which is only deformed keeps the topology version of its
+ * source, even if the copy is made before the version was ever requested, and
+ * reuses its triangulation. */
+static void test_deformed_copy_shares_indices()
+{
+	std::unique_ptr<Mesh> mesh(make_quad());
+	std::unique_ptr<Mesh> copy(static_cast<Mesh *>(mesh->copy()));
+
+	auto points = copy->points();
+	points->detach();
+
+	for (size_t i = 0; i < points->size(); ++i) {
+		(*points)[i].y += 1.0f;
+	}
+
+	CHECK(copy->polys()->topology_version() == mesh->polys()->topology_version());
+
+	mesh->packRenderData();
+	copy->packRenderData();
+
+	CHECK(mesh->indices() != nullptr);
+	CHECK(copy->indices() == mesh->indices());
+}
+
+/* Modifying the polygons of a copy gives it a new topology version. */
+static void test_modified_copy_has_new_topology()
+{
+	std::unique_ptr<Mesh> mesh(make_quad());
+	std::unique_ptr<Mesh> copy(static_cast<Mesh *>(mesh->copy()));
+
+	auto polys = copy->polys();
+	polys->detach();
+	(*polys)[0] = glm::uvec4{0, 1, 2, INVALID_INDEX};
+
+	CHECK(copy->polys()->topology_version() != mesh->polys()->topology_version());
+
+	mesh->packRenderData();
+	copy->packRenderData();
+
+	CHECK(copy->indices() != mesh->indices());
+	CHECK(copy->indices()->size() == 3);
+}
+
+/* Only the lists which are not shared with the source of a copy count as
+ * owned by it. */
+static void test_owned_memory_usage()
+{
+	std::unique_ptr<Mesh> mesh(make_quad());
+	std::unique_ptr<Mesh> copy(static_cast<Mesh *>(mesh->copy()));
+
+	CHECK(copy->memoryUsage() == mesh->memoryUsage());
+	CHECK(copy->ownedMemoryUsage() == 0);
+
+	copy->points()->detach();
+
+	CHECK(copy->ownedMemoryUsage() == copy->points()->byte_size());
+}
+
+/* Writing to a copy without detaching it first does not modify its source, nor
+ * the values it refers to, and gives the polygons a new topology. */
+static void test_write_without_detach()
+{
+	std::unique_ptr<Mesh> mesh(make_quad());
+	std::unique_ptr<Mesh> copy(static_cast<Mesh *>(mesh->copy()));
+
+	const auto version = mesh->polys()->topology_version();
+
+	(*copy->points())[0].y = 2.0f;
+	(*copy->polys())[0][3] = INVALID_INDEX;
+
+	const Mesh *source = mesh.get();
+	CHECK((*source->points())[0].y == 0.0f);
+	CHECK((*source->polys())[0][3] == 3);
+	CHECK(copy->polys()->topology_version() != version);
+
+	std::shared_ptr<const glm::vec3> values(new glm::vec3[1]{ glm::vec3(1.0f) },
+	                                        std::default_delete<const glm::vec3[]>());
+
+	PointList points;
+	points.reference(values, 1);
+	points[0] = glm::vec3(2.0f);
+
+	CHECK(values.get()[0] == glm::vec3(1.0f));
+	CHECK(static_cast<const PointList &>(points)[0] == glm::vec3(2.0f));
+}
+
+void test_mesh()
+{
+	test_deformed_copy_shares_indices();
+	test_modified_copy_has_new_topology();
+	test_owned_memory_usage();
+	test_write_without_detach();
+}
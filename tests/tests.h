@@ -0,0 +1,54 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <iostream>
+#include <kamikaze/primitive.h>
+#include <string>
+
+class NodeFactory;
+
+/* Number of checks which failed so far, see main.cc. */
+extern int test_failures;
+
+/* Report a failed check, and carry on with the rest of the test. */
+#define CHECK(expr) \
+	do { \
+		if (!(expr)) { \
+			std::cerr << __FILE__ << ':' << __LINE__ << ": check failed: " #expr "\n"; \
+			++test_failures; \
+		} \
+	} while (0)
+
+/* The tests, grouped by file. */
+/* Create a new directory in the temporary directory of the system, whose name
+ * starts with the given prefix, and return its path, or an empty string if it
+ * could not be created. */
+std::string make_temp_directory(const std::string &prefix);
+
+void test_archive(PrimitiveFactory *primitive_factory);
+void test_depsgraph(PrimitiveFactory *primitive_factory, NodeFactory *node_factory);
+void test_import(PrimitiveFactory *primitive_factory);
+void test_mesh();
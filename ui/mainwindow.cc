@@ -26,21 +26,29 @@
 
 #include <kamikaze/primitive.h>
 #include <kamikaze/nodes.h>
+#include <kamikaze/util_trace.h>
 
 #include <QDockWidget>
+#include <QFileDialog>
 #include <QMenuBar>
 #include <QProgressBar>
 #include <QStatusBar>
+#include <QTimer>
 #include <QToolBar>
 
+#include <fstream>
+#include <sstream>
+
 #include "core/graphs/graph_dumper.h"
 #include "core/kamikaze_main.h"
 #include "core/object.h"
 #include "core/object_ops.h"
+#include "core/scene_file.h"
 
 #include "node_editorwidget.h"
 #include "outliner_widget.h"
 #include "properties_widget.h"
+#include "task_notifier.h"
 #include "timeline_widget.h"
 #include "utils_ui.h"
 #include "viewer.h"
@@ -51,6 +59,7 @@ MainWindow::MainWindow(Main *main, QWidget *parent)
     , m_command_manager(new CommandManager)
     , m_command_factory(new CommandFactory)
 {
+	generateFileMenu();
 	generateObjectMenu();
 	generateNodeMenu();
 	generateWindowMenu();
@@ -65,13 +74,26 @@ MainWindow::MainWindow(Main *main, QWidget *parent)
 	/* setup context */
 	m_eval_context.edit_mode = false;
 	m_eval_context.animation = false;
+	m_eval_context.time_direction = TIME_DIR_FORWARD;
+	m_eval_context.frame = 0;
+	m_eval_context.threaded_evaluation = true;
 	m_context.eval_ctx = &m_eval_context;
 	m_context.scene = m_main->scene();
 	m_context.node_factory = m_main->node_factory();
 	m_context.primitive_factory = m_main->primitive_factory();
-	m_context.main_window = this;
+	m_context.notifier_factory = this;
 	m_context.active_widget = nullptr;
 
+	/* Evaluations requested while handling an event are run once, when
+	 * control returns to the event loop. */
+	m_context.scene->evaluationScheduler([this]()
+	{
+		QTimer::singleShot(0, this, [this]()
+		{
+			m_context.scene->flushEvaluations();
+		});
+	});
+
 	m_has_glwindow = false;
 
 	addGLViewerWidget();
@@ -84,10 +106,17 @@ MainWindow::MainWindow(Main *main, QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+	m_context.scene->evaluationScheduler(nullptr);
+
 	delete m_command_manager;
 	delete m_command_factory;
 }
 
+TaskNotifier *MainWindow::create_notifier()
+{
+	return new QtTaskNotifier(this);
+}
+
 void MainWindow::taskStarted()
 {
 	m_progress_bar->setValue(0);
@@ -109,6 +138,11 @@ void MainWindow::nodeProcessed()
 	m_context.scene->notify_listeners(event_type::node | event_type::processed);
 }
 
+void MainWindow::showMessage(const QString &text)
+{
+	statusBar()->showMessage(text, 10000);
+}
+
 void MainWindow::undo() const
 {
 	/* TODO: figure out how to update everything properly */
@@ -121,6 +155,24 @@ void MainWindow::redo() const
 	m_command_manager->redo();
 }
 
+void MainWindow::generateFileMenu()
+{
+	m_file_menu = menuBar()->addMenu("File");
+
+	QAction *action;
+
+	action = m_file_menu->addAction("Open Scene...");
+	connect(action, SIGNAL(triggered()), this, SLOT(openScene()));
+
+	action = m_file_menu->addAction("Save Scene...");
+	action->setData(QVariant::fromValue(0));
+	connect(action, SIGNAL(triggered()), this, SLOT(saveScene()));
+
+	action = m_file_menu->addAction("Save Scene With Caches...");
+	action->setData(QVariant::fromValue(static_cast<int>(SCENE_FILE_CACHES)));
+	connect(action, SIGNAL(triggered()), this, SLOT(saveScene()));
+}
+
 void MainWindow::generateObjectMenu()
 {
 	REGISTER_COMMAND(m_command_factory, "add object", AddObjectCmd);
@@ -147,6 +199,32 @@ void MainWindow::generateDebugMenu()
 	action->setData(QVariant::fromValue(QString("dump_object_graph")));
 
 	connect(action, SIGNAL(triggered()), this, SLOT(dumpGraph()));
+
+	action = m_add_object_menu->addAction("Print Evaluation Statistics");
+
+	connect(action, SIGNAL(triggered()), this, SLOT(printEvaluationStats()));
+
+	action = m_add_object_menu->addAction("Export Node Profile (CSV)");
+	action->setData(QVariant::fromValue(QString("export_profile_csv")));
+
+	connect(action, SIGNAL(triggered()), this, SLOT(exportNodeProfile()));
+
+	action = m_add_object_menu->addAction("Export Node Profile (JSON)");
+	action->setData(QVariant::fromValue(QString("export_profile_json")));
+
+	connect(action, SIGNAL(triggered()), this, SLOT(exportNodeProfile()));
+
+	action = m_add_object_menu->addAction("Export Trace");
+
+	connect(action, SIGNAL(triggered()), this, SLOT(exportTrace()));
+
+	m_add_object_menu->addSeparator();
+
+	action = m_add_object_menu->addAction("Threaded Evaluation");
+	action->setCheckable(true);
+	action->setChecked(true);
+
+	connect(action, SIGNAL(toggled(bool)), this, SLOT(setThreadedEvaluation(bool)));
 }
 
 void MainWindow::generateNodeMenu()
@@ -374,6 +452,46 @@ void MainWindow::addPropertiesWidget()
 	addDockWidget(Qt::RightDockWidgetArea, dock);
 }
 
+void MainWindow::openScene()
+{
+	const auto path = QFileDialog::getOpenFileName(this, "Open Scene", "", "Scene Files (*.kmks)");
+
+	if (path.isEmpty()) {
+		return;
+	}
+
+	std::string error;
+
+	if (!read_scene(m_context, path.toStdString(), error)) {
+		showMessage(error.c_str());
+		return;
+	}
+
+	/* The commands refer to the objects of the previous scene. */
+	m_command_manager->clear();
+}
+
+void MainWindow::saveScene()
+{
+	auto action = qobject_cast<QAction *>(sender());
+
+	if (!action) {
+		return;
+	}
+
+	const auto path = QFileDialog::getSaveFileName(this, "Save Scene", "", "Scene Files (*.kmks)");
+
+	if (path.isEmpty()) {
+		return;
+	}
+
+	std::string error;
+
+	if (!write_scene(m_context, path.toStdString(), action->data().toInt(), error)) {
+		showMessage(error.c_str());
+	}
+}
+
 void MainWindow::dumpGraph()
 {
 	auto action = qobject_cast<QAction *>(sender());
@@ -394,7 +512,7 @@ void MainWindow::dumpGraph()
 
 		auto object = static_cast<Object *>(scene_node);
 
-		GraphDumper gd(object->graph());
+		GraphDumper gd(object->graph(), true);
 		gd("/tmp/object_graph.gv");
 
 		if (system("dot /tmp/object_graph.gv -Tpng -o object_graph.png") == -1) {
@@ -410,3 +528,109 @@ void MainWindow::dumpGraph()
 		}
 	}
 }
+
+void MainWindow::exportNodeProfile()
+{
+	auto action = qobject_cast<QAction *>(sender());
+
+	if (!action) {
+		return;
+	}
+
+	auto scene_node = m_context.scene->active_node();
+
+	if (!scene_node) {
+		return;
+	}
+
+	const auto profiler = static_cast<Object *>(scene_node)->graph()->profiler();
+	const auto data = action->data().toString();
+
+	const auto csv = (data == "export_profile_csv");
+
+	const auto path = QFileDialog::getSaveFileName(this, "Export Node Profile", "",
+	                                               csv ? "CSV Files (*.csv)" : "JSON Files (*.json)");
+
+	if (path.isEmpty()) {
+		return;
+	}
+
+	const auto written = csv ? profiler->write_csv(path.toStdString())
+	                         : profiler->write_json(path.toStdString());
+
+	if (!written) {
+		std::cerr << "Cannot write node profile to " << path.toStdString() << '\n';
+	}
+}
+
+void MainWindow::exportTrace()
+{
+	const auto path = QFileDialog::getSaveFileName(this, "Export Trace", "", "JSON Files (*.json)");
+
+	if (path.isEmpty()) {
+		return;
+	}
+
+	std::ofstream os(path.toStdString());
+
+	if (!os.is_open()) {
+		showMessage("Cannot open file '" + path + "' for writing");
+		return;
+	}
+
+	const auto num_events = write_chrome_trace(os);
+
+	if (!os.good()) {
+		showMessage("Cannot write trace to '" + path + "'");
+		return;
+	}
+
+	if (num_events == 0) {
+		showMessage("The trace is empty: spans are only recorded if built with WITH_TRACING");
+		return;
+	}
+
+	showMessage("Exported " + QString::number(num_events) + " trace events to '" + path + "'");
+}
+
+void MainWindow::printEvaluationStats()
+{
+	auto scene = m_context.scene;
+
+	auto frame_cache = scene->depsgraph()->frame_cache();
+
+	std::stringstream ss;
+
+	ss << "Evaluations requested: " << scene->evaluationsRequested()
+	   << ", executed: " << scene->evaluationsExecuted();
+
+	ss << " | Playback frames shown: " << scene->playback()->frames_shown()
+	   << ", held: " << scene->playback()->frames_held()
+	   << ", dropped: " << scene->playback()->frames_dropped();
+
+	ss << " | Frame cache hits: " << frame_cache->hits()
+	   << ", misses: " << frame_cache->misses()
+	   << ", memory: " << frame_cache->memory_usage() << " bytes";
+
+	/* The nodes reused or processed again by the last evaluation of each
+	 * object. */
+	auto node_cache_hits = 0;
+	auto node_cache_misses = 0;
+
+	for (const auto &scene_node : scene->nodes()) {
+		const auto graph = static_cast<Object *>(scene_node.get())->graph();
+		node_cache_hits += graph->cache_hits();
+		node_cache_misses += graph->cache_misses();
+	}
+
+	ss << " | Node cache hits: " << node_cache_hits
+	   << ", misses: " << node_cache_misses;
+
+	std::unique_ptr<TaskNotifier> notifier(create_notifier());
+	notifier->signalMessage(ss.str());
+}
+
+void MainWindow::setThreadedEvaluation(bool yesno)
+{
+	m_eval_context.threaded_evaluation = yesno;
+}
@@ -29,12 +29,13 @@
 #include <kamikaze/context.h>
 #include "core/context.h"
 
+#include "core/task.h"
 #include "core/undo.h"
 
 class Main;
 class QProgressBar;
 
-class MainWindow : public QMainWindow {
+class MainWindow : public QMainWindow, public TaskNotifierFactory {
 	Q_OBJECT
 
 	QProgressBar *m_progress_bar;
@@ -50,6 +51,7 @@ class MainWindow : public QMainWindow {
 	Context m_context;
 	EvaluationContext m_eval_context;
 
+	QMenu *m_file_menu;
 	QMenu *m_add_object_menu;
 	QMenu *m_add_nodes_menu;
 	QMenu *m_edit_menu;
@@ -63,14 +65,18 @@ public:
 	explicit MainWindow(Main *main, QWidget *parent = nullptr);
 	~MainWindow();
 
+	TaskNotifier *create_notifier() override;
+
 public Q_SLOTS:
 	/* Progress Bar */
 	void taskStarted();
 	void updateProgress(float progress);
 	void taskEnded();
 	void nodeProcessed();
+	void showMessage(const QString &text);
 
 private:
+	void generateFileMenu();
 	void generateWindowMenu();
 	void generateEditMenu();
 	void generateObjectMenu();
@@ -84,6 +90,9 @@ private Q_SLOTS:
 	void redo() const;
 	void handleCommand();
 
+	void openScene();
+	void saveScene();
+
 	void addTimeLineWidget();
 	void addGraphEditorWidget();
 	void addGraphOutlinerWidget();
@@ -92,4 +101,8 @@ private Q_SLOTS:
 	void addPropertiesWidget();
 
 	void dumpGraph();
+	void printEvaluationStats();
+	void exportNodeProfile();
+	void exportTrace();
+	void setThreadedEvaluation(bool yesno);
 };
@@ -60,6 +60,7 @@ static constexpr auto NODE_ACTION_COLLAPSE_ALL = "Collapse all nodes";
 static constexpr auto NODE_ACTION_EXPAND_ALL = "Expand all nodes";
 static constexpr auto NODE_ENTER_OBJECT = "Enter object";
 static constexpr auto NODE_EXIT_OBJECT = "Exit object";
+static constexpr auto NODE_ACTION_HEAT_MAP = "Show processing time heat map";
 
 /* ************************************************************************** */
 
@@ -130,6 +131,10 @@ QtNodeEditor::QtNodeEditor(QWidget *parent)
 	m_context_menu->addAction(new QAction(NODE_ACTION_CENTER, this));
 	m_context_menu->addAction(new QAction(NODE_ENTER_OBJECT, this));
 
+	action = new QAction(NODE_ACTION_HEAT_MAP, this);
+	action->setCheckable(true);
+	m_context_menu->addAction(action);
+
 	setMenuZoomEnabled(true);
 	setMenuCollapseExpandEnabled(true);
 	setContextMenuPolicy(Qt::CustomContextMenu);
@@ -466,6 +471,21 @@ bool QtNodeEditor::mouseClickHandler(QGraphicsSceneMouseEvent *mouseEvent)
 				ss << "Node: " << node->name() << '\n';
 				ss << "Processing time: " << node->process_time() << " seconds.";
 
+				auto object = static_cast<Object *>(m_context->scene->active_node());
+
+				if (m_context->eval_ctx->edit_mode && object != nullptr) {
+					const auto profile = object->graph()->profiler()->profile(node);
+
+					ss << "\nAverage over " << profile.evaluations << " evaluations: "
+					   << profile.wall_time << " seconds (self: " << profile.self_time
+					   << ", input copy: " << profile.copy_time << ")\n";
+					ss << "Output: " << profile.points << " points, "
+					   << profile.primitives << " primitives, "
+					   << profile.bytes << " bytes\n";
+					ss << "Cache hits: " << profile.cache_hits
+					   << ", misses: " << profile.cache_misses;
+				}
+
 				QToolTip::showText(mouseEvent->screenPos(), ss.str().c_str());
 			}
 
@@ -1225,6 +1245,13 @@ void QtNodeEditor::contextMenuItemSelected(QAction *action)
 		return;
 	}
 
+	/* ---------------- Heat map action ---------------- */
+	if (action->text() == NODE_ACTION_HEAT_MAP) {
+		m_show_heat_map = action->isChecked();
+		updateHeatMap();
+		return;
+	}
+
 	/* ---------------- Exit object action ---------------- */
 	if (action->text() == NODE_EXIT_OBJECT) {
 		m_editor_mode = EDITOR_MODE_SCENE;
@@ -1237,9 +1264,44 @@ void QtNodeEditor::contextMenuItemSelected(QAction *action)
 	}
 }
 
+void QtNodeEditor::updateHeatMap()
+{
+	if (!m_context->eval_ctx->edit_mode) {
+		return;
+	}
+
+	auto scene_node = m_context->scene->active_node();
+
+	if (scene_node == nullptr) {
+		return;
+	}
+
+	const auto profiler = static_cast<Object *>(scene_node)->graph()->profiler();
+	const auto max_time = profiler->max_wall_time();
+
+	for (const auto &item : m_graphics_scene->items()) {
+		if (!is_node(item)) {
+			continue;
+		}
+
+		auto node_item = static_cast<QtNode *>(item);
+
+		if (!m_show_heat_map || max_time == 0.0f) {
+			node_item->setHeat(-1.0f);
+			continue;
+		}
+
+		const auto profile = profiler->profile(node_item->getNode());
+		node_item->setHeat(profile.wall_time / max_time);
+	}
+}
+
 void QtNodeEditor::update_state(event_type event)
 {
+	/* An evaluation finished, only the measurements changed. This is called
+	 * from the evaluation thread. */
 	if (event == static_cast<event_type>(-1)) {
+		QMetaObject::invokeMethod(this, "updateHeatMap", Qt::QueuedConnection);
 		return;
 	}
 
@@ -1312,6 +1374,8 @@ void QtNodeEditor::update_state(event_type event)
 			}
 		}
 
+		updateHeatMap();
+
 		/* Add the children of this object. */
 	}
 	/* Add the object nodes to the scene. */
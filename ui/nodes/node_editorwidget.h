@@ -72,6 +72,7 @@ class QtNodeEditor : public WidgetBase {
 	bool m_menu_zoom_enabled;
 	bool m_menu_collapse_expand_enabled;
 	bool m_mouse_down = false;
+	bool m_show_heat_map = false;
 
 	/* Cached informations */
 	QtConnection *m_hover_connection;
@@ -176,6 +177,10 @@ private:
 
 	void enterObjectNode(QAction *action);
 
+private Q_SLOTS:
+	/* Colour the nodes of the active object by their processing time. */
+	void updateHeatMap();
+
 protected:
 	/* Event handling */
 	bool eventFilter(QObject *object, QEvent *event) override;
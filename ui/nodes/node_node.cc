@@ -34,6 +34,8 @@
 #include "node_port.h"
 #include "node_editorwidget.h"
 
+#include "graphs/node_profiler.h"
+
 static constexpr auto NODE_HEADER_TITLE_FONT_SIZE = 12;
 static constexpr auto NODE_HEADER_ICON_SIZE = 20.0f;
 static constexpr auto NODE_WIDTH = 200.0f;
@@ -268,6 +270,18 @@ void QtNode::redraw()
 	}
 }
 
+void QtNode::setHeat(float heat)
+{
+	if (heat < 0.0f) {
+		m_body->setBrush(QColor("#3e3e3e"));
+		return;
+	}
+
+	const auto color = heat_color(heat);
+
+	m_body->setBrush(QColor::fromRgbF(color.r, color.g, color.b));
+}
+
 void QtNode::setTitleColor(const QColor &color)
 {
 	m_title_label->setDefaultTextColor(color);
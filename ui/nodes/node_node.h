@@ -113,6 +113,11 @@ public:
 	/* Align the text of the header (default is center) */
 	void alignTitle(Alignment alignment);
 
+	/* Colour the body of the node depending on its cost relative to the most
+	 * expensive node of the graph, from 0 to 1; a negative value restores the
+	 * default colour. */
+	void setHeat(float heat);
+
 	/* Create a port
 	 * portId:          Identification (handle) of the port.
 	 * portName:        The name of the port. This is also the text displayed.
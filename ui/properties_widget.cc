@@ -167,7 +167,7 @@ void PropertiesWidget::updateProperties()
 
 	if (persona->update_properties()) {
 		for (Property &prop : persona->props()) {
-			m_callback.setVisible(prop.ui_name.c_str(), prop.visible);
+			m_callback.setVisible(prop.desc->ui_name.c_str(), prop.visible);
 		}
 	}
 }
@@ -179,69 +179,69 @@ void PropertiesWidget::drawProperties(Persona *persona, bool set_context)
 	for (Property &prop : persona->props()) {
 		assert(!prop.data.empty());
 
-		switch (prop.type) {
+		switch (prop.desc->type) {
 			case property_type::prop_bool:
 				bool_param(m_callback,
-				           prop.ui_name.c_str(),
+				           prop.desc->ui_name.c_str(),
 				           any_cast<bool>(&prop.data),
 				           any_cast<bool>(prop.data));
 				break;
 			case property_type::prop_float:
 				float_param(m_callback,
-				            prop.ui_name.c_str(),
+				            prop.desc->ui_name.c_str(),
 				            any_cast<float>(&prop.data),
-				            prop.min, prop.max,
+				            prop.desc->min, prop.desc->max,
 				            any_cast<float>(prop.data));
 				break;
 			case property_type::prop_int:
 				int_param(m_callback,
-				          prop.ui_name.c_str(),
+				          prop.desc->ui_name.c_str(),
 				          any_cast<int>(&prop.data),
-				          prop.min, prop.max,
+				          prop.desc->min, prop.desc->max,
 				          any_cast<int>(prop.data));
 				break;
 			case property_type::prop_enum:
 				enum_param(m_callback,
-				           prop.ui_name.c_str(),
+				           prop.desc->ui_name.c_str(),
 				           any_cast<int>(&prop.data),
-				           prop.enum_items,
+				           prop.desc->enum_items,
 				           any_cast<int>(prop.data));
 				break;
 			case property_type::prop_vec3:
 				xyz_param(m_callback,
-				          prop.ui_name.c_str(),
+				          prop.desc->ui_name.c_str(),
 				          &(any_cast<glm::vec3>(&prop.data)->x),
-				          prop.min, prop.max);
+				          prop.desc->min, prop.desc->max);
 				break;
 			case property_type::prop_input_file:
 				input_file_param(m_callback,
-				                 prop.ui_name.c_str(),
+				                 prop.desc->ui_name.c_str(),
 				                 any_cast<std::string>(&prop.data));
 				break;
 			case property_type::prop_output_file:
 				output_file_param(m_callback,
-				                  prop.ui_name.c_str(),
+				                  prop.desc->ui_name.c_str(),
 				                  any_cast<std::string>(&prop.data));
 				break;
 			case property_type::prop_string:
 				string_param(m_callback,
-				             prop.ui_name.c_str(),
+				             prop.desc->ui_name.c_str(),
 				             any_cast<std::string>(&prop.data),
 				             any_cast<std::string>(prop.data).c_str());
 				break;
 			case property_type::prop_list:
 				list_selection_param(m_callback,
-				                     prop.ui_name.c_str(),
-				                     prop.enum_items,
+				                     prop.desc->ui_name.c_str(),
+				                     prop.desc->enum_items,
 				                     any_cast<std::string>(&prop.data));
 				break;
 		}
 
-		if (!prop.tooltip.empty()) {
-			param_tooltip(m_callback, prop.tooltip.c_str());
+		if (!prop.desc->tooltip.empty()) {
+			param_tooltip(m_callback, prop.desc->tooltip.c_str());
 		}
 
-		m_callback.setVisible(prop.ui_name.c_str(), prop.visible);
+		m_callback.setVisible(prop.desc->ui_name.c_str(), prop.visible);
 	}
 
 	if (set_context) {
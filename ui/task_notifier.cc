@@ -0,0 +1,65 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#include "task_notifier.h"
+
+#include "mainwindow.h"
+
+QtTaskNotifier::QtTaskNotifier(MainWindow *window)
+{
+	if (!window) {
+		return;
+	}
+
+	connect(this, SIGNAL(startTask()), window, SLOT(taskStarted()));
+	connect(this, SIGNAL(updateProgress(float)), window, SLOT(updateProgress(float)));
+	connect(this, SIGNAL(endTask()), window, SLOT(taskEnded()));
+	connect(this, SIGNAL(nodeProcessed()), window, SLOT(nodeProcessed()));
+	connect(this, SIGNAL(message(const QString &)), window, SLOT(showMessage(const QString &)));
+}
+
+void QtTaskNotifier::signalStart()
+{
+	Q_EMIT(startTask());
+}
+
+void QtTaskNotifier::signalProgressUpdate(float progress)
+{
+	Q_EMIT(updateProgress(progress));
+}
+
+void QtTaskNotifier::signalEnd()
+{
+	Q_EMIT(endTask());
+}
+
+void QtTaskNotifier::signalNodeProcessed()
+{
+	Q_EMIT(nodeProcessed());
+}
+
+void QtTaskNotifier::signalMessage(const std::string &text)
+{
+	Q_EMIT(message(QString::fromStdString(text)));
+}
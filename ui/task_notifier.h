@@ -0,0 +1,54 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software  Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * The Original Code is Copyright (C) 2016 Kévin Dietrich.
+ * All rights reserved.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ *
+ */
+
+#pragma once
+
+#include <QObject>
+
+#include "core/task.h"
+
+class MainWindow;
+
+/* Forward the notifications of the tasks to the main window. The signals are
+ * emitted from the threads running the tasks, so they are queued to the
+ * thread of the window. */
+class QtTaskNotifier : public QObject, public TaskNotifier {
+	Q_OBJECT
+
+public:
+	explicit QtTaskNotifier(MainWindow *window);
+
+	void signalStart() override;
+	void signalProgressUpdate(float progress) override;
+	void signalEnd() override;
+	void signalNodeProcessed() override;
+	void signalMessage(const std::string &text) override;
+
+Q_SIGNALS:
+	void startTask();
+	void updateProgress(float progress);
+	void endTask();
+	void nodeProcessed();
+	void message(const QString &text);
+};
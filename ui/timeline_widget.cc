@@ -220,8 +220,14 @@ void TimeLineWidget::setEndFrame(int value)
 
 void TimeLineWidget::setCurrentFrame(int value)
 {
-	this->set_active();
 	auto scene = m_context->scene;
+
+	/* The slider is also moved when the scene's frame changes. */
+	if (value == scene->currentFrame()) {
+		return;
+	}
+
+	this->set_active();
 	scene->currentFrame(value);
 	scene->updateForNewFrame(*m_context);
 }
@@ -254,6 +260,7 @@ void TimeLineWidget::playForward()
 	this->set_active();
 	m_context->eval_ctx->animation = true;
 	m_context->eval_ctx->time_direction = TIME_DIR_FORWARD;
+	m_context->scene->playback()->start(*m_context);
 	m_context->scene->notify_listeners(event_type::time | event_type::modified);
 }
 
@@ -262,6 +269,7 @@ void TimeLineWidget::playBackward()
 	this->set_active();
 	m_context->eval_ctx->animation = true;
 	m_context->eval_ctx->time_direction = TIME_DIR_BACKWARD;
+	m_context->scene->playback()->start(*m_context);
 	m_context->scene->notify_listeners(event_type::time | event_type::modified);
 }
 
@@ -289,29 +297,12 @@ void TimeLineWidget::stopAnimation()
 {
 	this->set_active();
 	m_context->eval_ctx->animation = false;
+	m_context->scene->playback()->stop();
 	m_context->scene->notify_listeners(event_type::time | event_type::modified);
 }
 
 void TimeLineWidget::updateFrame() const
 {
-	auto scene = m_context->scene;
-	auto value = scene->currentFrame();
-
-	if (m_context->eval_ctx->time_direction == TIME_DIR_FORWARD) {
-		++value;
-
-		if (value > scene->endFrame()) {
-			value = scene->startFrame();
-		}
-	}
-	else {
-		--value;
-
-		if (value < scene->startFrame()) {
-			value = scene->endFrame();
-		}
-	}
-
-	scene->currentFrame(value);
-	scene->updateForNewFrame(*m_context);
+	/* The frames are evaluated ahead by the playback engine. */
+	m_context->scene->playback()->tick(*m_context);
 }
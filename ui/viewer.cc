@@ -28,6 +28,7 @@
 #include <glm/gtc/matrix_inverse.hpp>
 #include <iostream>
 #include <kamikaze/renderbuffer.h>
+#include <kamikaze/util_trace.h>
 
 #include <QApplication>
 #include <QCheckBox>
@@ -54,8 +55,13 @@ Viewer::Viewer(QWidget *parent)
 
 Viewer::~Viewer()
 {
+	/* The OpenGL resources are freed while the context is still alive. */
+	makeCurrent();
+
 	delete m_camera;
 	delete m_grid;
+
+	release_programs();
 }
 
 void Viewer::initializeGL()
@@ -87,6 +93,8 @@ void Viewer::resizeGL(int w, int h)
 
 void Viewer::paintGL()
 {
+	TRACE_SPAN("Viewer::paintGL");
+
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
 	/* setup stencil mask for outlining active object */
@@ -124,14 +132,16 @@ void Viewer::paintGL()
 		for (auto &node : m_context->scene->nodes()) {
 			auto object = static_cast<Object *>(node.get());
 
-			if (!object->collection()) {
+			/* Hold on to the collection while drawing it, an evaluation running
+			 * in the background may publish a new one in the meantime. */
+			const auto collection = object->collection();
+
+			if (!collection) {
 				continue;
 			}
 
 			const bool active_object = (object == m_context->scene->active_node());
 
-			const auto collection = object->collection();
-
 			if (object->parent()) {
 				m_stack.push(object->parent()->matrix());
 			}
@@ -139,7 +149,8 @@ void Viewer::paintGL()
 			m_stack.push(object->matrix());
 
 			for (auto &prim : collection->primitives()) {
-				/* update prim before drawing */
+				/* The render data was packed after the evaluation of the
+				 * object, so this should only have to upload it. */
 				prim->update();
 				prim->prepareRenderData();
 
@@ -23,7 +23,6 @@
 
 #pragma once
 
-#include <cstdio>
 #include <string>
 
 template <typename T1, typename T2>
@@ -41,24 +40,3 @@ auto is_elem(T1 &&a, T2 &&b, Ts &&... t) -> bool
 /* return current time */
 double time_dt();
 
-/* A utility class to print the time elapsed during its lifetime, usefull for e.g.
- * timing the overall execution time of a function */
-class ScopeTimer {
-	double m_start;
-	std::string m_message;
-
-public:
-	explicit ScopeTimer(const std::string &message)
-	    : m_start(time_dt())
-	    , m_message(message)
-	{}
-
-	~ScopeTimer()
-	{
-		printf("%s: %fs\n", m_message.c_str(), time_dt() - m_start);
-	}
-};
-
-#define Timer(x) \
-	ScopeTimer func(x);
-